@@ -73,8 +73,8 @@ namespace sl2 {
 		FILE * pfFile = std::fopen( reinterpret_cast<const char *>(_pcFile), "rb" );
 		if ( nullptr == pfFile ) { return false; }
 
-		std::fseek( pfFile, 0, SEEK_END );
-		m_ui64Size = std::ftell( pfFile );
+		::fseeko( pfFile, 0, SEEK_END );
+		m_ui64Size = uint64_t( ::ftello( pfFile ) );
 		std::rewind( pfFile );
 
 		m_pfFile = pfFile;
@@ -141,32 +141,61 @@ namespace sl2 {
 			}
 			::_fseeki64( m_pfFile, i64Pos, SEEK_SET );
 #else
-			long lPos = std::ftell( m_pfFile );
-			std::fseek( m_pfFile, 0, SEEK_END );
-			long lLen = std::ftell( m_pfFile );
+			off_t oPos = ::ftello( m_pfFile );
+			::fseeko( m_pfFile, 0, SEEK_END );
+			off_t oLen = ::ftello( m_pfFile );
 			std::rewind( m_pfFile );
 			try {
-				_vResult.resize( size_t( lLen ) );
+				_vResult.resize( size_t( oLen ) );
 			}
 			catch ( ... ) {
-				std::fseek( m_pfFile, lPos, SEEK_SET );
+				::fseeko( m_pfFile, oPos, SEEK_SET );
 				return false;
 			}
-			if ( _vResult.size() != lLen ) {
-				std::fseek( m_pfFile, lPos, SEEK_SET );
+			if ( off_t( _vResult.size() ) != oLen ) {
+				::fseeko( m_pfFile, oPos, SEEK_SET );
 				return false;
 			}
 			if ( std::fread( _vResult.data(), _vResult.size(), 1, m_pfFile ) != 1 ) {
-				std::fseek( m_pfFile, lPos, SEEK_SET );
+				::fseeko( m_pfFile, oPos, SEEK_SET );
 				return false;
 			}
-			std::fseek( m_pfFile, lPos, SEEK_SET );
+			::fseeko( m_pfFile, oPos, SEEK_SET );
 #endif	// #ifdef SL2_WINDOWS
 			return true;
 		}
 		return false;
 	}
 
+	/**
+	 * Loads part of the opened file to memory.
+	 *
+	 * \param _ui64Offset The offset into the file from which to begin reading.
+	 * \param _pui8Data The buffer to which to read.
+	 * \param _tsSize The number of bytes to read.
+	 * \return Returns true if _tsSize bytes were read from the file.
+	 */
+	bool CStdFile::LoadToMemory( uint64_t _ui64Offset, uint8_t * _pui8Data, size_t _tsSize ) const {
+		if ( m_pfFile != nullptr ) {
+			if ( _ui64Offset > m_ui64Size || m_ui64Size - _ui64Offset < _tsSize ) { return false; }
+			if ( !_tsSize ) { return true; }
+#ifdef SL2_WINDOWS
+			__int64 i64Pos = ::_ftelli64( m_pfFile );
+			if ( ::_fseeki64( m_pfFile, __int64( _ui64Offset ), SEEK_SET ) != 0 ) { return false; }
+			bool bRet = std::fread( _pui8Data, _tsSize, 1, m_pfFile ) == 1;
+			::_fseeki64( m_pfFile, i64Pos, SEEK_SET );
+#else
+			// fseek() takes a long, which cannot reach past 2 GB where long is 32 bits.
+			off_t oPos = ::ftello( m_pfFile );
+			if ( ::fseeko( m_pfFile, off_t( _ui64Offset ), SEEK_SET ) != 0 ) { return false; }
+			bool bRet = std::fread( _pui8Data, _tsSize, 1, m_pfFile ) == 1;
+			::fseeko( m_pfFile, oPos, SEEK_SET );
+#endif	// #ifdef SL2_WINDOWS
+			return bRet;
+		}
+		return false;
+	}
+
 	/**
 	 * Writes the given data to the created file.  File must have been cerated with Create().
 	 *
@@ -106,6 +106,16 @@ namespace sl2 {
 		 */
 		virtual bool										LoadToMemory( std::vector<uint8_t> &_vResult ) const;
 
+		/**
+		 * Loads part of the opened file to memory.
+		 *
+		 * \param _ui64Offset The offset into the file from which to begin reading.
+		 * \param _pui8Data The buffer to which to read.
+		 * \param _tsSize The number of bytes to read.
+		 * \return Returns true if _tsSize bytes were read from the file.
+		 */
+		virtual bool										LoadToMemory( uint64_t _ui64Offset, uint8_t * _pui8Data, size_t _tsSize ) const;
+
 		/**
 		 * Writes the given data to the created file.  File must have been cerated with Create().
 		 *
@@ -130,6 +140,13 @@ namespace sl2 {
 		 **/
 		virtual FILE *										Handle() { return m_pfFile; }
 
+		/**
+		 * Gets the size of the opened file.
+		 * 
+		 * \return Returns the size of the opened file.
+		 **/
+		inline uint64_t										Size() const { return m_ui64Size; }
+
 		/**
 		 * Loads the opened file to memory, storing the result in _vResult.
 		 *
@@ -0,0 +1,116 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: A queue of whole-file writes performed on a background thread, so that writing one file overlaps with producing the
+ *	next.
+ */
+
+#include "SL2WriteBehind.h"
+#include "../Time/SL2Clock.h"
+#include "SL2StdFile.h"
+
+
+namespace sl2 {
+
+	CWriteBehind::CWriteBehind( uint64_t _ui64MaxBytes ) :
+		m_ui64MaxBytes( _ui64MaxBytes ),
+		m_tThread( WriteThread, this ) {
+	}
+	CWriteBehind::~CWriteBehind() {
+		{
+			std::lock_guard<std::mutex> lgLock( m_mMutex );
+			m_bStop = true;
+		}
+		m_cvSignal.notify_all();
+		if ( m_tThread.joinable() ) {
+			m_tThread.join();
+		}
+	}
+
+	// == Functions.
+	/**
+	 * Queues a file to be written.  Blocks while the queue holds more than the memory budget.
+	 *
+	 * \param _u16Path The path of the file to create.
+	 * \param _vData The contents of the file.  Moved into the queue.
+	 * \return Returns false if the write could not be queued, in which case _vData is left untouched.
+	 **/
+	bool CWriteBehind::Write( const std::u16string &_u16Path, std::vector<uint8_t> &_vData ) {
+		std::unique_lock<std::mutex> ulLock( m_mMutex );
+		if ( m_bStop ) { return false; }
+		// A file larger than the budget is still queued once everything before it has been written.
+		if ( m_ui64Queued && m_ui64Queued + _vData.size() > m_ui64MaxBytes ) {
+			CClock cClock;
+			m_cvSignal.wait( ulLock, [&]() { return !m_ui64Queued || m_ui64Queued + _vData.size() <= m_ui64MaxBytes; } );
+			m_dWaitTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+		}
+		try {
+			m_dQueue.push_back( { _u16Path, std::vector<uint8_t>() } );
+		}
+		catch ( ... ) { return false; }
+		m_dQueue.back().vData.swap( _vData );
+		m_ui64Queued += m_dQueue.back().vData.size();
+		ulLock.unlock();
+		m_cvSignal.notify_all();
+		return true;
+	}
+
+	/**
+	 * Waits for every queued file to be written.
+	 *
+	 * \param _u16FailedPath Holds the path of the first file that could not be created or written.
+	 * \return Returns true if every file was written.
+	 **/
+	bool CWriteBehind::Finish( std::u16string &_u16FailedPath ) {
+		std::unique_lock<std::mutex> ulLock( m_mMutex );
+		m_cvSignal.wait( ulLock, [&]() { return m_dQueue.empty() && !m_bWriting; } );
+		if ( !m_bFailed ) { return true; }
+		try {
+			_u16FailedPath = m_u16FailedPath;
+		}
+		catch ( ... ) {}
+		return false;
+	}
+
+	/**
+	 * The background thread.  Writes queued files in order until told to stop.
+	 *
+	 * \param _pwbThis The queue.
+	 **/
+	void CWriteBehind::WriteThread( CWriteBehind * _pwbThis ) {
+		std::unique_lock<std::mutex> ulLock( _pwbThis->m_mMutex );
+		while ( true ) {
+			_pwbThis->m_cvSignal.wait( ulLock, [&]() { return _pwbThis->m_bStop || !_pwbThis->m_dQueue.empty(); } );
+			if ( _pwbThis->m_dQueue.empty() ) { break; }		// Only reached when stopping.
+
+			SL2_WRITE wWrite = std::move( _pwbThis->m_dQueue.front() );
+			_pwbThis->m_dQueue.pop_front();
+			_pwbThis->m_bWriting = true;
+			ulLock.unlock();
+
+			CClock cClock;
+			bool bWritten = false;
+			{
+				CStdFile sfFile;
+				bWritten = sfFile.Create( wWrite.u16Path.c_str() ) && sfFile.WriteToFile( wWrite.vData );
+			}
+			double dTime = (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+
+			ulLock.lock();
+			_pwbThis->m_dWriteTime += dTime;
+			_pwbThis->m_ui64Queued -= wWrite.vData.size();
+			_pwbThis->m_bWriting = false;
+			if ( !bWritten && !_pwbThis->m_bFailed ) {
+				_pwbThis->m_bFailed = true;
+				try {
+					_pwbThis->m_u16FailedPath = wWrite.u16Path;
+				}
+				catch ( ... ) {}
+			}
+			_pwbThis->m_cvSignal.notify_all();
+		}
+	}
+
+}	// namespace sl2
@@ -0,0 +1,126 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: A queue of whole-file writes performed on a background thread, so that writing one file overlaps with producing the
+ *	next.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CWriteBehind
+	 * \brief A queue of whole-file writes performed on a background thread.
+	 *
+	 * Description: A queue of whole-file writes performed on a background thread, so that writing one file overlaps with producing the
+	 *	next.  Files are created and written in the order they are queued, so a path queued twice ends up with the later contents.
+	 *	Write() blocks while the queued data would exceed the memory budget.  Failures are kept and returned by Finish().
+	 */
+	class CWriteBehind {
+	public :
+		CWriteBehind( uint64_t _ui64MaxBytes );
+		~CWriteBehind();
+
+
+		// == Functions.
+		/**
+		 * Queues a file to be written.  Blocks while the queue holds more than the memory budget.
+		 *
+		 * \param _u16Path The path of the file to create.
+		 * \param _vData The contents of the file.  Moved into the queue.
+		 * \return Returns false if the write could not be queued, in which case _vData is left untouched.
+		 **/
+		bool												Write( const std::u16string &_u16Path, std::vector<uint8_t> &_vData );
+
+		/**
+		 * Waits for every queued file to be written.
+		 *
+		 * \param _u16FailedPath Holds the path of the first file that could not be created or written.
+		 * \return Returns true if every file was written.
+		 **/
+		bool												Finish( std::u16string &_u16FailedPath );
+
+		/**
+		 * Gets the time Write() spent waiting for the queue to drain below the memory budget.
+		 *
+		 * \return Returns the time spent waiting, in seconds.
+		 **/
+		inline double										WaitTime() const { return m_dWaitTime; }
+
+		/**
+		 * Gets the time the background thread spent creating and writing files.
+		 *
+		 * \return Returns the time spent writing, in seconds.
+		 **/
+		inline double										WriteTime() const { return m_dWriteTime; }
+
+
+	protected :
+		// == Types.
+		/** A queued file. */
+		struct SL2_WRITE {
+			std::u16string									u16Path;							/**< The path of the file to create. */
+			std::vector<uint8_t>							vData;								/**< The contents of the file. */
+		};
+
+
+		// == Members.
+		/** The queued files. */
+		std::deque<SL2_WRITE>								m_dQueue;
+
+		/** Guards everything below. */
+		std::mutex											m_mMutex;
+
+		/** Signalled when a file is queued or written, or when the thread is to stop. */
+		std::condition_variable								m_cvSignal;
+
+		/** The size of the queued files, including the one being written. */
+		uint64_t											m_ui64Queued = 0;
+
+		/** The size past which Write() waits. */
+		uint64_t											m_ui64MaxBytes;
+
+		/** True while the background thread is writing a file it has taken from the queue. */
+		bool												m_bWriting = false;
+
+		/** Tells the background thread to stop once the queue is empty. */
+		bool												m_bStop = false;
+
+		/** Set once a file fails. */
+		bool												m_bFailed = false;
+
+		/** The first file that failed. */
+		std::u16string										m_u16FailedPath;
+
+		/** Time spent waiting in Write(). */
+		double												m_dWaitTime = 0.0;
+
+		/** Time spent writing. */
+		double												m_dWriteTime = 0.0;
+
+		/** The background thread.  Declared last so that it starts after everything it uses. */
+		std::thread											m_tThread;
+
+
+		// == Functions.
+		/**
+		 * The background thread.  Writes queued files in order until told to stop.
+		 *
+		 * \param _pwbThis The queue.
+		 **/
+		static void											WriteThread( CWriteBehind * _pwbThis );
+	};
+
+}	// namespace sl2
@@ -9,6 +9,8 @@
 #include "SL2Dds.h"
 #include "../../Utilities/SL2Stream.h"
 
+#include <immintrin.h>
+
 
 namespace sl2 {
 #define SL2_TYPE( D3D, DXGI, OGL_IF, OGL_TYPE, OGL_BIF )		SL2_ ## D3D, SL2_ ## DXGI, #D3D, #DXGI, #OGL_IF, #OGL_TYPE, #OGL_BIF
@@ -205,53 +207,48 @@ namespace sl2 {
 		if ( m_pfdFormat ) {
 			// We have known metadata regarding the format.  This might require conversions.
 			//	Convert (optionally) and load the data.
-			uint32_t ui32Pitch = m_dhHeader.ui32PitchOrLinearSize;
-			uint32_t ui32PitchAfter = m_dhHeader.ui32PitchOrLinearSize;
-			size_t sSrcSize = 0;
-			if ( m_pfdFormat->bIsCompressed ) {
-				ui32Pitch = (m_dhHeader.ui32Width + 3) / 4 * m_pfdFormat->ui8BitsPerBlock / 8;
-				ui32PitchAfter = (m_dhHeader.ui32Width + 3) / 4 * m_pfdFormat->ui8BitsAfterConvert / 8;
-			
-			}
-			else if ( m_pfdFormat->bPacked ) {
-				ui32Pitch = ((m_dhHeader.ui32Width + 1) >> 1) * 4;
-				ui32PitchAfter = ((m_dhHeader.ui32Width + 1) >> 1) * 4;
-			}
-			else {
-				ui32Pitch = (m_dhHeader.ui32Width * m_pfdFormat->ui8BitsPerBlock + 7) / 8;
-				ui32PitchAfter = (m_dhHeader.ui32Width * m_pfdFormat->ui8BitsAfterConvert + 7) / 8;
-			}
-			if ( !m_pfdFormat->ui8BitsAfterConvert ) {
-				ui32PitchAfter = ui32Pitch;
-			}
+			// The pitch of a level, in the file or after pfConverter runs.  Rows of compressed formats are rows of blocks.
+			auto Pitch = [&]( uint32_t _ui32W, uint32_t _ui32Bits ) {
+				if ( m_pfdFormat->bIsCompressed ) { return (_ui32W + 3) / 4 * _ui32Bits / 8; }
+				if ( m_pfdFormat->bPacked ) { return ((_ui32W + 1) >> 1) * 4; }
+				return (_ui32W * _ui32Bits + 7) / 8;
+			};
+			uint32_t ui32Pitch = Pitch( m_dhHeader.ui32Width, m_pfdFormat->ui8BitsPerBlock );
 
-			size_t iIndex = 0;
-			uint8_t * pui8Src = sStream.Data();
 			for ( uint32_t J = 0; J < ui32Array; J++ ) {
 				uint32_t ui32W = std::max( m_dhHeader.ui32Width, static_cast<uint32_t>(1) );
 				uint32_t ui32H = std::max( m_dhHeader.ui32Height, static_cast<uint32_t>(1) );
 				uint32_t ui32D = std::max( m_dhHeader.ui32Depth, static_cast<uint32_t>(1) );
-				for ( uint32_t I = 0; I < m_dhHeader.ui32MipMapCount; I++ ) {
-					size_t sSrcSize = ui32D * ui32H * ui32Pitch;
+				for ( uint32_t I = 0; I < Mips(); I++ ) {
+					uint32_t ui32LevelPitch = Pitch( ui32W, m_pfdFormat->ui8BitsPerBlock );
+					uint32_t ui32PitchAfter = m_pfdFormat->ui8BitsAfterConvert ? Pitch( ui32W, m_pfdFormat->ui8BitsAfterConvert ) : ui32LevelPitch;
+					size_t sSrcSize = size_t( ui32D ) * ui32H * ui32LevelPitch;
+					size_t sDstSize = size_t( ui32D ) * ui32H * ui32PitchAfter;
 					if ( m_pfdFormat->bIsCompressed ) {
 						sSrcSize = GetCompressedSizeBc( ui32W,
 							ui32H,
 							ui32D, m_pfdFormat->ui8BitsPerBlock );
+						sDstSize = size_t( ui32D ) * ((ui32H + 3) / 4) * ui32PitchAfter;
 					}
+					if ( sStream.Remaining() < sSrcSize ) { return false; }
 
 					SL2_TEX tTexture;
 					tTexture.ui32Pitch = ui32PitchAfter;
-					try {
-						tTexture.vTexture.resize( sSrcSize );
-					}
-					catch ( ... ) { return false; }
 					if ( m_pfdFormat->pfConverter ) {
-						m_pfdFormat->pfConverter( pui8Src, tTexture.vTexture.data(), ui32W, ui32H, ui32D, ui32Pitch, m_dhHeader.dpPixelFormat );
-						if ( sStream.Read( nullptr, sSrcSize ) != sSrcSize ) { return false; };
+						// The converted rows can be wider than those in the file (RGB24 to RGBA32).
+						try {
+							tTexture.vTexture.resize( sDstSize );
+						}
+						catch ( ... ) { return false; }
+						m_pfdFormat->pfConverter( sStream.Data(), tTexture.vTexture.data(), ui32W, ui32H, ui32D, ui32LevelPitch, m_dhHeader.dpPixelFormat );
+						tTexture.pui8Texels = tTexture.vTexture.data();
+						tTexture.sSize = sDstSize;
 					}
 					else {
-						if ( sStream.Read( tTexture.vTexture.data(), tTexture.vTexture.size() ) != tTexture.vTexture.size() ) { return false; }
+						tTexture.pui8Texels = sStream.Data();
+						tTexture.sSize = sSrcSize;
 					}
+					sStream.Read( nullptr, sSrcSize );
 					tTexture.ui32W = ui32W;
 					tTexture.ui32H = ui32H;
 					tTexture.ui32D = ui32D;
@@ -266,25 +263,21 @@ namespace sl2 {
 		}
 		else {
 			// Going based on the pixel format data using bit sizes and assuming tight packing.
-			size_t iIndex = 0;
 			//uint32_t ui32Pitch = m_dhHeader.ui32PitchOrLinearSize;
-			uint8_t * pui8Src = sStream.Data();
 			for ( uint32_t J = 0; J < ui32Array; J++ ) {
 				uint32_t ui32W = std::max( m_dhHeader.ui32Width, static_cast<uint32_t>(1) );
 				uint32_t ui32H = std::max( m_dhHeader.ui32Height, static_cast<uint32_t>(1) );
 				uint32_t ui32D = std::max( m_dhHeader.ui32Depth, static_cast<uint32_t>(1) );
 				
-				for ( uint32_t I = 0; I < m_dhHeader.ui32MipMapCount; I++ ) {
+				for ( uint32_t I = 0; I < Mips(); I++ ) {
 					size_t sPitch = static_cast<size_t>(static_cast<uint64_t>(m_dhHeader.dpPixelFormat.ui32RGBBitCount) * ui32W);
 					size_t sSrcSize = static_cast<size_t>(static_cast<uint64_t>(ui32D) * ui32H * sPitch / 8ULL);
+					if ( sStream.Remaining() < sSrcSize ) { return false; }
 					SL2_TEX tTexture;
 					tTexture.ui32Pitch = static_cast<uint32_t>(sPitch);
-					try {
-						tTexture.vTexture.resize( sSrcSize );
-					}
-					catch ( ... ) { return false; }
-
-					if ( sStream.Read( tTexture.vTexture.data(), tTexture.vTexture.size() ) != tTexture.vTexture.size() ) { return false; }
+					tTexture.pui8Texels = sStream.Data();
+					tTexture.sSize = sSrcSize;
+					sStream.Read( nullptr, sSrcSize );
 					tTexture.ui32W = ui32W;
 					tTexture.ui32H = ui32H;
 					tTexture.ui32D = ui32D;
@@ -341,25 +334,35 @@ namespace sl2 {
 	 * \param _dpfPixelFormat The pixel format data.
 	 **/
 	void CDds::Convert_UYVY_to_YUY2( uint8_t * _pui8Src, uint8_t * _pui8Dst, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, uint32_t _ui32Pitch, const SL2_DDS_PIXELFORMAT &/*_dpfPixelFormat*/ ) {
-		struct SL2_TEXELS {
-			uint8_t				ui8U;
-			uint8_t				ui8Y0;
-			uint8_t				ui8V;
-			uint8_t				ui8Y1;
-		};
-
-		size_t sSliceSize = _ui32Pitch * _ui32Height;		
+		// Each pair of texels is stored as U Y0 V Y1.  Swapping the bytes of each 16-bit half gives Y0 U Y1 V.
+		size_t sRowSize = size_t( (_ui32Width + 1) >> 1 ) * 4;
 		for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 			for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-				for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-					SL2_TEXELS * ptTexelsSrc = reinterpret_cast<SL2_TEXELS *>(_pui8Src + _ui32Pitch * H + sSliceSize * D) + W;
-					SL2_TEXELS * ptTexelsDst = reinterpret_cast<SL2_TEXELS *>(_pui8Dst + _ui32Pitch * H + sSliceSize * D) + W;
-					ptTexelsDst->ui8U = ptTexelsSrc->ui8Y0;
-					ptTexelsDst->ui8Y0 = ptTexelsSrc->ui8U;
-					ptTexelsDst->ui8V = ptTexelsSrc->ui8Y1;
-					ptTexelsDst->ui8Y1 = ptTexelsSrc->ui8V;
-					/*std::swap( ptTexels->ui8U, ptTexels->ui8Y0 );
-					std::swap( ptTexels->ui8V, ptTexels->ui8Y1 );*/
+				size_t sRow = size_t( D ) * _ui32Height + H;
+				const uint8_t * pui8Src = _pui8Src + _ui32Pitch * sRow;
+				uint8_t * pui8Dst = _pui8Dst + _ui32Pitch * sRow;
+				size_t I = 0;
+#ifdef __AVX2__
+				if ( CUtilities::IsAvx2Supported() ) {
+					for ( ; I + sizeof( __m256i ) <= sRowSize; I += sizeof( __m256i ) ) {
+						__m256i mSrc = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(pui8Src + I) );
+						_mm256_storeu_si256( reinterpret_cast<__m256i *>(pui8Dst + I), _mm256_or_si256( _mm256_slli_epi16( mSrc, 8 ), _mm256_srli_epi16( mSrc, 8 ) ) );
+					}
+				}
+#endif	// #ifdef __AVX2__
+
+#ifdef __SSE4_1__
+				if ( CUtilities::IsSse4Supported() ) {
+					for ( ; I + sizeof( __m128i ) <= sRowSize; I += sizeof( __m128i ) ) {
+						__m128i mSrc = _mm_loadu_si128( reinterpret_cast<const __m128i *>(pui8Src + I) );
+						_mm_storeu_si128( reinterpret_cast<__m128i *>(pui8Dst + I), _mm_or_si128( _mm_slli_epi16( mSrc, 8 ), _mm_srli_epi16( mSrc, 8 ) ) );
+					}
+				}
+#endif	// #ifdef __SSE4_1__
+
+				for ( ; I < sRowSize; I += 2 ) {
+					pui8Dst[I] = pui8Src[I+1];
+					pui8Dst[I+1] = pui8Src[I];
 				}
 			}
 		}
@@ -377,26 +380,103 @@ namespace sl2 {
 	 * \param _dpfPixelFormat The pixel format data.
 	 **/
 	void CDds::Convert_RGB24_to_RGBA32( uint8_t * _pui8Src, uint8_t * _pui8Dst, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, uint32_t _ui32Pitch, const SL2_DDS_PIXELFORMAT &_dpfPixelFormat ) {
-		struct SL2_TEXELS {
-			uint8_t				ui8R;
-			uint8_t				ui8G;
-			uint8_t				ui8B;
-			uint8_t				ui8A;
-		};
-		double dR, dG, dB;
-		size_t sR = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32RBitMask, dR );
-		size_t sG = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32GBitMask, dG );
-		size_t sB = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32BBitMask, dB );
-		size_t sSliceSize = _ui32Pitch * _ui32Height;		
+		SL2_CHANNEL_MOVE cmMoves[4];
+		uint32_t ui32Const = MaskedMoves<SL2_TEXEL_RGBA8>( _dpfPixelFormat, false, cmMoves );
+		ConvertMasked( _pui8Src, _pui8Dst, _ui32Width, _ui32Height, _ui32Depth, _ui32Pitch, size_t( _ui32Width ) * sizeof( uint32_t ), 3, cmMoves, ui32Const );
+	}
+
+	/**
+	 * Converts masked 24- or 32-bit texels to 32-bit texels.  Each converted channel is the source texel shifted down by the
+	 *	channel's shift, cut to the channel's width, and placed at the channel's position.
+	 * 
+	 * \param _pui8Src The data to convert.
+	 * \param _pui8Dst The converted data.
+	 * \param _ui32Width The width of the given data.
+	 * \param _ui32Height The height of the given data.
+	 * \param _ui32Depth The depth of the given data.
+	 * \param _sSrcPitch The row width in bytes of the given data.
+	 * \param _sDstPitch The row width in bytes of the converted data.
+	 * \param _sSrcSize The size of a source texel, 3 or 4.
+	 * \param _cmMoves The moves for R, G, B, and A.
+	 * \param _ui32Const Bits to set in every converted texel.
+	 **/
+	void CDds::ConvertMasked( const uint8_t * _pui8Src, uint8_t * _pui8Dst, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth,
+		size_t _sSrcPitch, size_t _sDstPitch, size_t _sSrcSize, const SL2_CHANNEL_MOVE (&_cmMoves)[4], uint32_t _ui32Const ) {
+		// 24-bit texels are read 16 bytes at a time, which reaches into the 2 texels after those converted.
+		uint32_t ui32Overread = _sSrcSize == 3 ? 2 : 0;
 		for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 			for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-				for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-					uint32_t * pui32TexelsSrc = reinterpret_cast<uint32_t *>(_pui8Src + _ui32Pitch * H + sSliceSize * D + (W * 3));
-					SL2_TEXELS * ptTexelsDst = reinterpret_cast<SL2_TEXELS *>(_pui8Dst + _ui32Pitch * H + sSliceSize * D) + W;
-					ptTexelsDst->ui8R = (*pui32TexelsSrc) >> sR;
-					ptTexelsDst->ui8G = (*pui32TexelsSrc) >> sG;
-					ptTexelsDst->ui8B = (*pui32TexelsSrc) >> sB;
-					ptTexelsDst->ui8A = 0xFF;
+				size_t sRow = size_t( D ) * _ui32Height + H;
+				const uint8_t * pui8Src = _pui8Src + _sSrcPitch * sRow;
+				uint32_t * pui32Dst = reinterpret_cast<uint32_t *>(_pui8Dst + _sDstPitch * sRow);
+				uint32_t W = 0;
+#ifdef __AVX2__
+				if ( CUtilities::IsAvx2Supported() ) {
+					// Spreads 4 24-bit texels to 32 bits in each 128-bit lane.
+					const __m256i mSpread = _mm256_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+						0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+					__m128i mShift[4], mPos[4];
+					__m256i mMask[4];
+					for ( size_t C = 0; C < 4; ++C ) {
+						mShift[C] = _mm_cvtsi32_si128( int( _cmMoves[C].ui32Shift ) );
+						mPos[C] = _mm_cvtsi32_si128( int( _cmMoves[C].ui32Pos ) );
+						mMask[C] = _mm256_set1_epi32( int( _cmMoves[C].ui32Mask ) );
+					}
+					const __m256i mConst = _mm256_set1_epi32( int( _ui32Const ) );
+					for ( ; W + 8 + ui32Overread <= _ui32Width; W += 8 ) {
+						__m256i mSrc;
+						if ( _sSrcSize == 3 ) {
+							mSrc = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i *>(pui8Src + W * 3) ) ),
+								_mm_loadu_si128( reinterpret_cast<const __m128i *>(pui8Src + W * 3 + 12) ), 1 );
+							mSrc = _mm256_shuffle_epi8( mSrc, mSpread );
+						}
+						else {
+							mSrc = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(pui8Src + W * 4) );
+						}
+						__m256i mDst = mConst;
+						for ( size_t C = 0; C < 4; ++C ) {
+							mDst = _mm256_or_si256( mDst, _mm256_sll_epi32( _mm256_and_si256( _mm256_srl_epi32( mSrc, mShift[C] ), mMask[C] ), mPos[C] ) );
+						}
+						_mm256_storeu_si256( reinterpret_cast<__m256i *>(pui32Dst + W), mDst );
+					}
+				}
+#endif	// #ifdef __AVX2__
+
+#ifdef __SSE4_1__
+				if ( CUtilities::IsSse4Supported() ) {
+					const __m128i mSpread = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+					__m128i mShift[4], mPos[4], mMask[4];
+					for ( size_t C = 0; C < 4; ++C ) {
+						mShift[C] = _mm_cvtsi32_si128( int( _cmMoves[C].ui32Shift ) );
+						mPos[C] = _mm_cvtsi32_si128( int( _cmMoves[C].ui32Pos ) );
+						mMask[C] = _mm_set1_epi32( int( _cmMoves[C].ui32Mask ) );
+					}
+					const __m128i mConst = _mm_set1_epi32( int( _ui32Const ) );
+					for ( ; W + 4 + ui32Overread <= _ui32Width; W += 4 ) {
+						__m128i mSrc;
+						if ( _sSrcSize == 3 ) {
+							mSrc = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i *>(pui8Src + W * 3) ), mSpread );
+						}
+						else {
+							mSrc = _mm_loadu_si128( reinterpret_cast<const __m128i *>(pui8Src + W * 4) );
+						}
+						__m128i mDst = mConst;
+						for ( size_t C = 0; C < 4; ++C ) {
+							mDst = _mm_or_si128( mDst, _mm_sll_epi32( _mm_and_si128( _mm_srl_epi32( mSrc, mShift[C] ), mMask[C] ), mPos[C] ) );
+						}
+						_mm_storeu_si128( reinterpret_cast<__m128i *>(pui32Dst + W), mDst );
+					}
+				}
+#endif	// #ifdef __SSE4_1__
+
+				for ( ; W < _ui32Width; ++W ) {
+					uint32_t ui32Src = 0;
+					std::memcpy( &ui32Src, pui8Src + W * _sSrcSize, _sSrcSize );
+					uint32_t ui32Dst = _ui32Const;
+					for ( size_t C = 0; C < 4; ++C ) {
+						ui32Dst |= ((ui32Src >> _cmMoves[C].ui32Shift) & _cmMoves[C].ui32Mask) << _cmMoves[C].ui32Pos;
+					}
+					pui32Dst[W] = ui32Dst;
 				}
 			}
 		}
@@ -382,11 +382,13 @@ namespace sl2 {
 		/** A conversion function. */
 		typedef void (*										PfConversion)( uint8_t * _pui8Src, uint8_t * _pui8Dst, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, uint32_t _ui32Pitch, const SL2_DDS_PIXELFORMAT &_dpfPixelFormat );
 
-		/** A single texture. */
+		/** A single texture.  Textures that need no conversion are not copied out of the file data; pui8Texels points into it instead. */
 		struct SL2_TEX {
 			SL2_TEX() = default;
 			SL2_TEX( SL2_TEX &&_tOther ) noexcept :
 				vTexture( std::move( _tOther.vTexture ) ),
+				pui8Texels( _tOther.pui8Texels ),
+				sSize( _tOther.sSize ),
 				ui32Pitch( _tOther.ui32Pitch ),
 				ui32W( _tOther.ui32W ),
 				ui32H( _tOther.ui32H ),
@@ -394,7 +396,9 @@ namespace sl2 {
 			SL2_TEX( const SL2_TEX & ) = delete;
 			SL2_TEX &										operator = ( const SL2_TEX & ) = delete;
 
-			std::vector<uint8_t>							vTexture;
+			std::vector<uint8_t>							vTexture;								/**< The converted texels, or empty if the texels are used from the file data. */
+			const uint8_t *									pui8Texels = nullptr;					/**< The texels, either in vTexture or in the file data. */
+			size_t											sSize = 0;								/**< The size of the texels in bytes. */
 			uint32_t										ui32Pitch;
 			uint32_t										ui32W;
 			uint32_t										ui32H;
@@ -404,6 +408,8 @@ namespace sl2 {
 			SL2_TEX &										operator = ( SL2_TEX &&_tOther ) noexcept {
 				if ( this != &_tOther ) {
 					vTexture = std::move( _tOther.vTexture );
+					pui8Texels = _tOther.pui8Texels;
+					sSize = _tOther.sSize;
 					ui32Pitch = _tOther.ui32Pitch;
 					ui32W = _tOther.ui32W;
 					ui32H = _tOther.ui32H;
@@ -435,7 +441,8 @@ namespace sl2 {
 
 
 		/**
-		 * Loads a DDS file from memory.
+		 * Loads a DDS file from memory.  Textures that need no conversion point into _vFileData, which must not be changed or
+		 *	freed while Buffers() is used.
 		 *
 		 * \param _vFileData The in-memory image of the file.
 		 * \return Returns true if the file was successfully loaded.  False indicates an invalid file or lack of RAM.
@@ -566,6 +573,9 @@ namespace sl2 {
 			uint8_t											ui8G;
 			uint8_t											ui8B;
 			uint8_t											ui8A;
+
+			static constexpr uint32_t						ui32Bits[4] = { 8, 8, 8, 8 };			/**< The widths of R, G, B, and A. */
+			static constexpr uint32_t						ui32Pos[4] = { 0, 8, 16, 24 };			/**< The bit positions of R, G, B, and A. */
 		};
 
 		/** RGBA8. */
@@ -574,6 +584,9 @@ namespace sl2 {
 			uint8_t											ui8G;
 			uint8_t											ui8R;
 			uint8_t											ui8A;
+
+			static constexpr uint32_t						ui32Bits[4] = { 8, 8, 8, 8 };			/**< The widths of R, G, B, and A. */
+			static constexpr uint32_t						ui32Pos[4] = { 16, 8, 0, 24 };			/**< The bit positions of R, G, B, and A. */
 		};
 
 		/** RGB10A2. */
@@ -582,6 +595,16 @@ namespace sl2 {
 			uint32_t										ui8G : 10;
 			uint32_t										ui8B : 10;
 			uint32_t										ui8A : 2;
+
+			static constexpr uint32_t						ui32Bits[4] = { 10, 10, 10, 2 };		/**< The widths of R, G, B, and A. */
+			static constexpr uint32_t						ui32Pos[4] = { 0, 10, 20, 30 };		/**< The bit positions of R, G, B, and A. */
+		};
+
+		/** Where a masked source channel goes in a converted 32-bit texel. */
+		struct SL2_CHANNEL_MOVE {
+			uint32_t										ui32Shift;								/**< The right shift that brings the channel to bit 0. */
+			uint32_t										ui32Mask;								/**< The mask of the channel's width in the converted texel. */
+			uint32_t										ui32Pos;								/**< The bit position of the channel in the converted texel. */
 		};
 
 
@@ -618,7 +641,7 @@ namespace sl2 {
 		 * Converts a maskd 24-bit RGB to a 32-bit SL2_DXGI_FORMAT_R8G8B8A8_UNORM or SL2_DXGI_FORMAT_R8G8B8A8_UNORM_SRGB.
 		 * 
 		 * \param _pui8Src The data to convert.
-		 * \param _pui8Dst The data to convert.
+		 * \param _pui8Dst The data to convert.  Rows are _ui32Width * 4 bytes.
 		 * \param _ui32Width The width of the given data.
 		 * \param _ui32Height The height of the given data.
 		 * \param _ui32Depth The depth of the given data.
@@ -640,38 +663,53 @@ namespace sl2 {
 		 **/
 		template <typename _tDstType, bool _bHasAlpha>
 			static void										Convert_RGBA32_to_RGBA32( uint8_t * _pui8Src, uint8_t * _pui8Dst, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, uint32_t _ui32Pitch, const SL2_DDS_PIXELFORMAT &_dpfPixelFormat ) {
-			double dR, dG, dB, dA;
-			size_t sR = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32RBitMask, dR );
-			size_t sG = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32GBitMask, dG );
-			size_t sB = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32BBitMask, dB );
-			size_t sA;
-			if constexpr ( _bHasAlpha ) {
-				sA = CUtilities::BitMaskToShift( _dpfPixelFormat.ui32BBitMask, dA );
-			}
-			else {
-				sA = 255;
-			}
-			
-			size_t sSliceSize = _ui32Pitch * _ui32Height;		
-			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						uint32_t * pui32TexelsSrc = reinterpret_cast<uint32_t *>(_pui8Src + _ui32Pitch * H + sSliceSize * D) + W;
-						_tDstType * ptTexelsDst = reinterpret_cast<_tDstType *>(_pui8Dst + _ui32Pitch * H + sSliceSize * D) + W;
-						ptTexelsDst->ui8R = (*pui32TexelsSrc) >> sR;
-						ptTexelsDst->ui8G = (*pui32TexelsSrc) >> sG;
-						ptTexelsDst->ui8B = (*pui32TexelsSrc) >> sB;
-						if constexpr ( _bHasAlpha ) {
-							ptTexelsDst->ui8A = (*pui32TexelsSrc) >> sA;
-						}
-						else {
-							ptTexelsDst->ui8A = static_cast<uint8_t>(sA);
-						}
-					}
-				}
+			static_assert( sizeof( _tDstType ) == sizeof( uint32_t ) );
+			SL2_CHANNEL_MOVE cmMoves[4];
+			uint32_t ui32Const = MaskedMoves<_tDstType>( _dpfPixelFormat, _bHasAlpha, cmMoves );
+			ConvertMasked( _pui8Src, _pui8Dst, _ui32Width, _ui32Height, _ui32Depth, _ui32Pitch, _ui32Pitch, sizeof( uint32_t ), cmMoves, ui32Const );
+		}
+
+		/**
+		 * Gets where each masked channel of a source texel goes in a converted texel.
+		 * 
+		 * \param _dpfPixelFormat The pixel format data.
+		 * \param _bHasAlpha If false, alpha is not read and is set to its maximum instead.
+		 * \param _cmMoves Holds the moves for R, G, B, and A.
+		 * \return Returns the bits to set in every converted texel.
+		 **/
+		template <typename _tDstType>
+			static uint32_t									MaskedMoves( const SL2_DDS_PIXELFORMAT &_dpfPixelFormat, bool _bHasAlpha, SL2_CHANNEL_MOVE (&_cmMoves)[4] ) {
+			const uint32_t ui32Masks[4] = { _dpfPixelFormat.ui32RBitMask, _dpfPixelFormat.ui32GBitMask, _dpfPixelFormat.ui32BBitMask, _dpfPixelFormat.ui32ABitMask };
+			for ( size_t I = 0; I < 4; ++I ) {
+				double dMax;
+				_cmMoves[I].ui32Shift = static_cast<uint32_t>(CUtilities::BitMaskToShift( ui32Masks[I], dMax ));
+				_cmMoves[I].ui32Mask = (1U << _tDstType::ui32Bits[I]) - 1U;
+				_cmMoves[I].ui32Pos = _tDstType::ui32Pos[I];
 			}
+			if ( _bHasAlpha ) { return 0; }
+			uint32_t ui32Const = _cmMoves[3].ui32Mask << _cmMoves[3].ui32Pos;
+			_cmMoves[3].ui32Mask = 0;
+			return ui32Const;
 		}
 
+		/**
+		 * Converts masked 24- or 32-bit texels to 32-bit texels.  Each converted channel is the source texel shifted down by the
+		 *	channel's shift, cut to the channel's width, and placed at the channel's position.
+		 * 
+		 * \param _pui8Src The data to convert.
+		 * \param _pui8Dst The converted data.
+		 * \param _ui32Width The width of the given data.
+		 * \param _ui32Height The height of the given data.
+		 * \param _ui32Depth The depth of the given data.
+		 * \param _sSrcPitch The row width in bytes of the given data.
+		 * \param _sDstPitch The row width in bytes of the converted data.
+		 * \param _sSrcSize The size of a source texel, 3 or 4.
+		 * \param _cmMoves The moves for R, G, B, and A.
+		 * \param _ui32Const Bits to set in every converted texel.
+		 **/
+		static void											ConvertMasked( const uint8_t * _pui8Src, uint8_t * _pui8Dst, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth,
+			size_t _sSrcPitch, size_t _sDstPitch, size_t _sSrcSize, const SL2_CHANNEL_MOVE (&_cmMoves)[4], uint32_t _ui32Const );
+
 		/**
 		 * Gets format data given a SL2_D3DFORMAT format.
 		 * 
@@ -251,6 +251,24 @@ DecodeImage(WebPData *webp_image, int flags) {
 		unsigned width = (unsigned)bitstream->width;
 		unsigned height = (unsigned)bitstream->height;
 
+		// like the JPEG plugin, use the upper 16 bits of the flags as a requested size in pixels and 
+		// let the decoder scale the image by the largest power of 2 that keeps it at least that large
+		int requested_size = flags >> 16;
+		if((requested_size > 0) && !header_only) {
+			const unsigned max_size = MAX(width, height);
+			unsigned shift = 0;
+			while((max_size >> (shift + 1)) >= (unsigned)requested_size) {
+				shift++;
+			}
+			if(shift) {
+				width = (width + (1U << shift) - 1) >> shift;
+				height = (height + (1U << shift) - 1) >> shift;
+				decoder_config.options.use_scaling = 1;
+				decoder_config.options.scaled_width = (int)width;
+				decoder_config.options.scaled_height = (int)height;
+			}
+		}
+
 		dib = FreeImage_AllocateHeader(header_only, width, height, bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
 		if(!dib) {
 			throw FI_MSG_ERROR_DIB_MEMORY;
@@ -81,6 +81,7 @@ extern "C" {
     extern void ispc_lab2rgb_single(const struct ColorLABA *lab, struct ColorRGBA *rgb);
 #endif // ispc_lab2rgb_single function declaraion
     extern void ispc_medianCutQuantization(struct Color * colors, int64_t imageSize, struct Color * palette, int32_t paletteSize);
+    extern bool ispc_nearest_CIEDE2000(const struct ColorRGBA * rgb, uint32_t * indices, uint64_t n, const struct ColorLABA * palette, uint32_t paletteSize);
     extern void ispc_rgb2lab(const struct ColorRGBA * rgb, struct ColorLABA * lab, uint64_t n);
 #if defined(__cplusplus)
     extern void ispc_rgb2lab_single(const struct ColorRGBA &rgb, struct ColorLABA &lab);
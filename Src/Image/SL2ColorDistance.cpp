@@ -0,0 +1,241 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Color-distance metrics used to match colors against a palette.
+ */
+
+#include "SL2ColorDistance.h"
+#include "SL2Formats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+
+namespace sl2 {
+
+	// == Functions.
+	/**
+	 * Converts a linear RGBA color into the space of a metric.
+	 *
+	 * \param _cdDistance The metric.
+	 * \param _cColor The color to convert.
+	 * \return Returns the converted color.
+	 **/
+	CColorDistance::CColor CColorDistance::ToSpace( SL2_COLOR_DISTANCE _cdDistance, const CColor &_cColor ) {
+		switch ( _cdDistance ) {
+			case SL2_CD_WEIGHTED_RGB : {
+				return CColor( _cColor[0] * LumaScale( 0 ), _cColor[1] * LumaScale( 1 ), _cColor[2] * LumaScale( 2 ), _cColor[3] );
+			}
+			case SL2_CD_OKLAB : { return RgbToOkLab( _cColor ); }
+			case SL2_CD_CIE76 :
+			case SL2_CD_CIE94 :
+			case SL2_CD_CIEDE2000 : { return RgbToLab( _cColor ); }
+			default : { return _cColor; }
+		}
+	}
+
+	/**
+	 * Converts a color in the space of a metric back to linear RGBA.
+	 *
+	 * \param _cdDistance The metric.
+	 * \param _cColor The color to convert.
+	 * \return Returns the converted color.
+	 **/
+	CColorDistance::CColor CColorDistance::FromSpace( SL2_COLOR_DISTANCE _cdDistance, const CColor &_cColor ) {
+		switch ( _cdDistance ) {
+			case SL2_CD_WEIGHTED_RGB : {
+				return CColor( _cColor[0] / LumaScale( 0 ), _cColor[1] / LumaScale( 1 ), _cColor[2] / LumaScale( 2 ), _cColor[3] );
+			}
+			case SL2_CD_OKLAB : { return OkLabToRgb( _cColor ); }
+			case SL2_CD_CIE76 :
+			case SL2_CD_CIE94 :
+			case SL2_CD_CIEDE2000 : { return LabToRgb( _cColor ); }
+			default : { return _cColor; }
+		}
+	}
+
+	/**
+	 * Gets the squared distance between 2 colors that are already in the space of a metric.  CIE94 is not symmetric; _cRef
+	 *	is its reference color.
+	 *
+	 * \param _cdDistance The metric.
+	 * \param _cRef The first color.
+	 * \param _cColor The second color.
+	 * \return Returns the squared distance between the colors.
+	 **/
+	double CColorDistance::DistanceSq( SL2_COLOR_DISTANCE _cdDistance, const CColor &_cRef, const CColor &_cColor ) {
+		switch ( _cdDistance ) {
+			case SL2_CD_CIE94 : { return Cie94Sq( _cRef, _cColor ); }
+			case SL2_CD_CIEDE2000 : { return Ciede2000Sq( _cRef, _cColor ); }
+			default : { return CColor::EuclideanDistanceSq( _cRef, _cColor ); }
+		}
+	}
+
+	/**
+	 * Gets the factor by which SL2_CD_WEIGHTED_RGB scales a channel.  Coefficients from -luma can be 0 or negative, so they are
+	 *	raised to a small minimum; the channel then barely counts toward distances but can still be converted back.
+	 *
+	 * \param _sChannel The channel (0 = R, 1 = G, 2 = B).
+	 * \return Returns the square root of the channel's luma coefficient.
+	 **/
+	double CColorDistance::LumaScale( size_t _sChannel ) {
+		return std::sqrt( std::max( CFormat::Luma().dRgb[_sChannel], 1.0e-6 ) );
+	}
+
+	/**
+	 * Linear RGB -> CIELAB (D65).
+	 *
+	 * \param _cColor The color to convert.
+	 * \return Returns the converted color.
+	 **/
+	CColorDistance::CColor CColorDistance::RgbToLab( const CColor &_cColor ) {
+		// Same constants as CFormat::ToLab().
+		double dXyz[3] = {
+			(_cColor[0] * 0.4124 + _cColor[1] * 0.3576 + _cColor[2] * 0.1805) / 0.95047,
+			(_cColor[0] * 0.2126 + _cColor[1] * 0.7152 + _cColor[2] * 0.0722),
+			(_cColor[0] * 0.0193 + _cColor[1] * 0.1192 + _cColor[2] * 0.9505) / 1.08883,
+		};
+		for ( size_t I = 0; I < 3; ++I ) {
+			dXyz[I] = (dXyz[I] > 0.008856) ? std::cbrt( dXyz[I] ) : (7.787 * dXyz[I]) + (16.0 / 116.0);
+		}
+		return CColor( (116.0 * dXyz[1]) - 16.0, 500.0 * (dXyz[0] - dXyz[1]), 200.0 * (dXyz[1] - dXyz[2]), _cColor[3] * 100.0 );
+	}
+
+	/**
+	 * CIELAB (D65) -> linear RGB.
+	 *
+	 * \param _cColor The color to convert.
+	 * \return Returns the converted color.
+	 **/
+	CColorDistance::CColor CColorDistance::LabToRgb( const CColor &_cColor ) {
+		double dY = (_cColor[0] + 16.0) / 116.0;
+		double dXyz[3] = { _cColor[1] / 500.0 + dY, dY, dY - _cColor[2] / 200.0 };
+		for ( size_t I = 0; I < 3; ++I ) {
+			double dCube = dXyz[I] * dXyz[I] * dXyz[I];
+			dXyz[I] = (dCube > 0.008856) ? dCube : (dXyz[I] - 16.0 / 116.0) / 7.787;
+		}
+		dXyz[0] *= 0.95047;
+		dXyz[2] *= 1.08883;
+		return CColor( dXyz[0] * 3.2406254773 + dXyz[1] * -1.5372079722 + dXyz[2] * -0.4986285987,
+			dXyz[0] * -0.9689139977 + dXyz[1] * 1.8758805039 + dXyz[2] * 0.0415032848,
+			dXyz[0] * 0.0557101204 + dXyz[1] * -0.2040229458 + dXyz[2] * 1.0569959423,
+			_cColor[3] / 100.0 );
+	}
+
+	/**
+	 * Linear RGB -> OKLab.
+	 *
+	 * \param _cColor The color to convert.
+	 * \return Returns the converted color.
+	 **/
+	CColorDistance::CColor CColorDistance::RgbToOkLab( const CColor &_cColor ) {
+		double dL = std::cbrt( 0.4122214708 * _cColor[0] + 0.5363325363 * _cColor[1] + 0.0514459929 * _cColor[2] );
+		double dM = std::cbrt( 0.2119034982 * _cColor[0] + 0.6806995451 * _cColor[1] + 0.1073969566 * _cColor[2] );
+		double dS = std::cbrt( 0.0883024619 * _cColor[0] + 0.2817188376 * _cColor[1] + 0.6299787005 * _cColor[2] );
+		return CColor( 0.2104542553 * dL + 0.7936177850 * dM - 0.0040720468 * dS,
+			1.9779984951 * dL - 2.4285922050 * dM + 0.4505937099 * dS,
+			0.0259040371 * dL + 0.7827717662 * dM - 0.8086757660 * dS,
+			_cColor[3] );
+	}
+
+	/**
+	 * OKLab -> linear RGB.
+	 *
+	 * \param _cColor The color to convert.
+	 * \return Returns the converted color.
+	 **/
+	CColorDistance::CColor CColorDistance::OkLabToRgb( const CColor &_cColor ) {
+		double dL = _cColor[0] + 0.3963377774 * _cColor[1] + 0.2158037573 * _cColor[2];
+		double dM = _cColor[0] - 0.1055613458 * _cColor[1] - 0.0638541728 * _cColor[2];
+		double dS = _cColor[0] - 0.0894841775 * _cColor[1] - 1.2914855480 * _cColor[2];
+		dL = dL * dL * dL;
+		dM = dM * dM * dM;
+		dS = dS * dS * dS;
+		return CColor( 4.0767416621 * dL - 3.3077115913 * dM + 0.2309699292 * dS,
+			-1.2684380046 * dL + 2.6097574011 * dM - 0.3413193965 * dS,
+			-0.0041960863 * dL - 0.7034186147 * dM + 1.7076147010 * dS,
+			_cColor[3] );
+	}
+
+	/**
+	 * Gets the squared CIE94 (graphic arts) distance between 2 CIELAB colors, plus the squared alpha difference.
+	 *
+	 * \param _cRef The reference color.
+	 * \param _cColor The sample color.
+	 * \return Returns the squared distance.
+	 **/
+	double CColorDistance::Cie94Sq( const CColor &_cRef, const CColor &_cColor ) {
+		double dL = _cRef[0] - _cColor[0];
+		double dA = _cRef[1] - _cColor[1];
+		double dB = _cRef[2] - _cColor[2];
+		double dC1 = std::sqrt( _cRef[1] * _cRef[1] + _cRef[2] * _cRef[2] );
+		double dC2 = std::sqrt( _cColor[1] * _cColor[1] + _cColor[2] * _cColor[2] );
+		double dC = dC1 - dC2;
+		double dH2 = std::max( dA * dA + dB * dB - dC * dC, 0.0 );
+		double dSc = 1.0 + 0.045 * dC1;
+		double dSh = 1.0 + 0.015 * dC1;
+		double dAlpha = _cRef[3] - _cColor[3];
+		return dL * dL + (dC * dC) / (dSc * dSc) + dH2 / (dSh * dSh) + dAlpha * dAlpha;
+	}
+
+	/**
+	 * Gets the squared CIEDE2000 distance between 2 CIELAB colors, plus the squared alpha difference.
+	 *
+	 * \param _cA The first color.
+	 * \param _cB The second color.
+	 * \return Returns the squared distance.
+	 **/
+	double CColorDistance::Ciede2000Sq( const CColor &_cA, const CColor &_cB ) {
+		constexpr double dPi = std::numbers::pi;
+		constexpr double d25_7 = 6103515625.0;
+		double dC1 = std::sqrt( _cA[1] * _cA[1] + _cA[2] * _cA[2] );
+		double dC2 = std::sqrt( _cB[1] * _cB[1] + _cB[2] * _cB[2] );
+		double dCBar = (dC1 + dC2) * 0.5;
+		double dCBar7 = dCBar * dCBar * dCBar;
+		dCBar7 = dCBar7 * dCBar7 * dCBar;
+		double dG = 0.5 * (1.0 - std::sqrt( dCBar7 / (dCBar7 + d25_7) ));
+		double dA1 = (1.0 + dG) * _cA[1];
+		double dA2 = (1.0 + dG) * _cB[1];
+		double dC1p = std::sqrt( dA1 * dA1 + _cA[2] * _cA[2] );
+		double dC2p = std::sqrt( dA2 * dA2 + _cB[2] * _cB[2] );
+		double dCBarP = (dC1p + dC2p) * 0.5;
+
+		double dH1 = std::atan2( _cA[2], dA1 );
+		if ( dH1 < 0.0 ) { dH1 += 2.0 * dPi; }
+		double dH2 = std::atan2( _cB[2], dA2 );
+		if ( dH2 < 0.0 ) { dH2 += 2.0 * dPi; }
+		double dHBarP = (std::abs( dH1 - dH2 ) > dPi) ? (dH1 + dH2 + 2.0 * dPi) * 0.5 : (dH1 + dH2) * 0.5;
+
+		double dT = 1.0 - 0.17 * std::cos( dHBarP - dPi / 6.0 ) +
+			0.24 * std::cos( 2.0 * dHBarP ) +
+			0.32 * std::cos( 3.0 * dHBarP + dPi / 30.0 ) -
+			0.20 * std::cos( 4.0 * dHBarP - dPi / 3.0 );
+
+		double dDh = dH2 - dH1;
+		if ( std::abs( dDh ) > dPi ) {
+			dDh -= (dDh > 0.0) ? 2.0 * dPi : -2.0 * dPi;
+		}
+		double dDH = 2.0 * std::sqrt( dC1p * dC2p ) * std::sin( dDh * 0.5 );
+
+		double dL50 = (_cA[0] - 50.0) * (_cA[0] - 50.0);
+		double dSl = 1.0 + (0.015 * dL50) / std::sqrt( 20.0 + dL50 );
+		double dSc = 1.0 + 0.045 * dCBarP;
+		double dSh = 1.0 + 0.015 * dCBarP * dT;
+
+		double dTheta = (dHBarP - 275.0 * dPi / 180.0) / (25.0 * dPi / 180.0);
+		double dDTheta = dPi / 6.0 * std::exp( -(dTheta * dTheta) );
+		double dCBarP7 = dCBarP * dCBarP * dCBarP;
+		dCBarP7 = dCBarP7 * dCBarP7 * dCBarP;
+		double dRt = -2.0 * std::sqrt( dCBarP7 / (dCBarP7 + d25_7) ) * std::sin( 2.0 * dDTheta );
+
+		double dTl = (_cB[0] - _cA[0]) / dSl;
+		double dTc = (dC2p - dC1p) / dSc;
+		double dTh = dDH / dSh;
+		double dAlpha = _cB[3] - _cA[3];
+		return dTl * dTl + dTc * dTc + dTh * dTh + dRt * dTc * dTh + dAlpha * dAlpha;
+	}
+
+}	// namespace sl2
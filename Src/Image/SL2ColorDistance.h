@@ -0,0 +1,161 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Color-distance metrics used to match colors against a palette.
+ */
+
+#pragma once
+
+#include "../Utilities/SL2Vector4.h"
+
+
+namespace sl2 {
+
+	// == Enumerations.
+	/** Palette generators. */
+	enum SL2_PALETTE_METHOD {
+		SL2_PM_KMEANS,
+		SL2_PM_WU,
+		SL2_PM_MEDIAN_CUT,
+		SL2_PM_OCTREE,
+	};
+
+	/** Color-distance metrics for palette matching. */
+	enum SL2_COLOR_DISTANCE {
+		SL2_CD_DEFAULT,										/**< K-means and dithering use RGBA distance; the final index mapping uses CIEDE2000. */
+		SL2_CD_RGB,											/**< Squared Euclidean distance in linear RGBA. */
+		SL2_CD_WEIGHTED_RGB,								/**< Squared Euclidean distance with R, G, and B weighted by CFormat::Luma(). */
+		SL2_CD_OKLAB,										/**< Squared Euclidean distance in OKLab. */
+		SL2_CD_CIE76,										/**< Squared Euclidean distance in CIELAB. */
+		SL2_CD_CIE94,										/**< CIE94 (graphic arts) in CIELAB. */
+		SL2_CD_CIEDE2000,									/**< CIEDE2000 in CIELAB.  The final index mapping uses the ISPC search, as SL2_CD_DEFAULT does. */
+	};
+
+
+	/**
+	 * Class CColorDistance
+	 * \brief Color-distance metrics used to match colors against a palette.
+	 *
+	 * Description: Color-distance metrics used to match colors against a palette.  Each metric works on colors that have first
+	 *	been moved into its space with ToSpace().  In that space the Euclidean metrics are plain squared Euclidean distances, so
+	 *	k-means and sorted-axis searches can run there unchanged.  Alpha is kept as the 4th channel in every space, scaled to the
+	 *	0-100 range of L in the CIELAB spaces.
+	 */
+	class CColorDistance {
+	public :
+		// == Types.
+		/** A color. */
+		typedef CVector4<SL2_ST_AVX512>						CColor;
+
+
+		// == Functions.
+		/**
+		 * Determines whether colors must be converted before being measured by a given metric.
+		 *
+		 * \param _cdDistance The metric.
+		 * \return Returns true if ToSpace() changes colors for the given metric.
+		 **/
+		static inline bool									HasSpace( SL2_COLOR_DISTANCE _cdDistance ) { return _cdDistance != SL2_CD_DEFAULT && _cdDistance != SL2_CD_RGB; }
+
+		/**
+		 * Determines whether a metric is the squared Euclidean distance in its space.
+		 *
+		 * \param _cdDistance The metric.
+		 * \return Returns true if DistanceSq() is CColor::EuclideanDistanceSq() for the given metric.
+		 **/
+		static inline bool									IsEuclidean( SL2_COLOR_DISTANCE _cdDistance ) { return _cdDistance != SL2_CD_CIE94 && _cdDistance != SL2_CD_CIEDE2000; }
+
+		/**
+		 * Converts a linear RGBA color into the space of a metric.
+		 *
+		 * \param _cdDistance The metric.
+		 * \param _cColor The color to convert.
+		 * \return Returns the converted color.
+		 **/
+		static CColor										ToSpace( SL2_COLOR_DISTANCE _cdDistance, const CColor &_cColor );
+
+		/**
+		 * Converts a color in the space of a metric back to linear RGBA.
+		 *
+		 * \param _cdDistance The metric.
+		 * \param _cColor The color to convert.
+		 * \return Returns the converted color.
+		 **/
+		static CColor										FromSpace( SL2_COLOR_DISTANCE _cdDistance, const CColor &_cColor );
+
+		/**
+		 * Gets the squared distance between 2 colors that are already in the space of a metric.  CIE94 is not symmetric; _cRef
+		 *	is its reference color.
+		 *
+		 * \param _cdDistance The metric.
+		 * \param _cRef The first color.
+		 * \param _cColor The second color.
+		 * \return Returns the squared distance between the colors.
+		 **/
+		static double										DistanceSq( SL2_COLOR_DISTANCE _cdDistance, const CColor &_cRef, const CColor &_cColor );
+
+
+	protected :
+		// == Functions.
+		/**
+		 * Gets the factor by which SL2_CD_WEIGHTED_RGB scales a channel.  Coefficients of 0 or less are raised to a small minimum.
+		 *
+		 * \param _sChannel The channel (0 = R, 1 = G, 2 = B).
+		 * \return Returns the square root of the channel's luma coefficient.
+		 **/
+		static double										LumaScale( size_t _sChannel );
+
+		/**
+		 * Linear RGB -> CIELAB (D65).
+		 *
+		 * \param _cColor The color to convert.
+		 * \return Returns the converted color.
+		 **/
+		static CColor										RgbToLab( const CColor &_cColor );
+
+		/**
+		 * CIELAB (D65) -> linear RGB.
+		 *
+		 * \param _cColor The color to convert.
+		 * \return Returns the converted color.
+		 **/
+		static CColor										LabToRgb( const CColor &_cColor );
+
+		/**
+		 * Linear RGB -> OKLab.
+		 *
+		 * \param _cColor The color to convert.
+		 * \return Returns the converted color.
+		 **/
+		static CColor										RgbToOkLab( const CColor &_cColor );
+
+		/**
+		 * OKLab -> linear RGB.
+		 *
+		 * \param _cColor The color to convert.
+		 * \return Returns the converted color.
+		 **/
+		static CColor										OkLabToRgb( const CColor &_cColor );
+
+		/**
+		 * Gets the squared CIE94 (graphic arts) distance between 2 CIELAB colors, plus the squared alpha difference.
+		 *
+		 * \param _cRef The reference color.
+		 * \param _cColor The sample color.
+		 * \return Returns the squared distance.
+		 **/
+		static double										Cie94Sq( const CColor &_cRef, const CColor &_cColor );
+
+		/**
+		 * Gets the squared CIEDE2000 distance between 2 CIELAB colors, plus the squared alpha difference.
+		 *
+		 * \param _cA The first color.
+		 * \param _cB The second color.
+		 * \return Returns the squared distance.
+		 **/
+		static double										Ciede2000Sq( const CColor &_cA, const CColor &_cB );
+	};
+
+}	// namespace sl2
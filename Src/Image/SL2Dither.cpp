@@ -0,0 +1,253 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Dithering modes and the threshold maps used by ordered dithering.
+ */
+
+#include "SL2Dither.h"
+#include "../Files/SL2StdFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <random>
+#include <thread>
+
+
+namespace sl2 {
+
+	// == Functions.
+	/**
+	 * Gets the 4x4 Bayer matrix.
+	 *
+	 * \return Returns the 4x4 Bayer matrix.
+	 **/
+	const double * CDither::Bayer4x4() {
+		static const double dBayer4[4*4] = {
+			 0.0 / 16.0,  8.0 / 16.0,  2.0 / 16.0, 10.0 / 16.0,
+			12.0 / 16.0,  4.0 / 16.0, 14.0 / 16.0,  6.0 / 16.0,
+			 3.0 / 16.0, 11.0 / 16.0,  1.0 / 16.0,  9.0 / 16.0,
+			15.0 / 16.0,  7.0 / 16.0, 13.0 / 16.0,  5.0 / 16.0,
+		};
+		return dBayer4;
+	}
+
+	/**
+	 * Gets the 8x8 Bayer matrix.
+	 *
+	 * \return Returns the 8x8 Bayer matrix.
+	 **/
+	const double * CDither::Bayer8x8() {
+		static const double dBayer8[8*8] = {
+			 0.0 / 64.0, 48.0 / 64.0, 12.0 / 64.0, 60.0 / 64.0,  3.0 / 64.0, 51.0 / 64.0, 15.0 / 64.0, 63.0 / 64.0,
+			32.0 / 64.0, 16.0 / 64.0, 44.0 / 64.0, 28.0 / 64.0, 35.0 / 64.0, 19.0 / 64.0, 47.0 / 64.0, 31.0 / 64.0,
+			 8.0 / 64.0, 56.0 / 64.0,  4.0 / 64.0, 52.0 / 64.0, 11.0 / 64.0, 59.0 / 64.0,  7.0 / 64.0, 55.0 / 64.0,
+			40.0 / 64.0, 24.0 / 64.0, 36.0 / 64.0, 20.0 / 64.0, 43.0 / 64.0, 27.0 / 64.0, 39.0 / 64.0, 23.0 / 64.0,
+			 2.0 / 64.0, 50.0 / 64.0, 14.0 / 64.0, 62.0 / 64.0,  1.0 / 64.0, 49.0 / 64.0, 13.0 / 64.0, 61.0 / 64.0,
+			34.0 / 64.0, 18.0 / 64.0, 46.0 / 64.0, 30.0 / 64.0, 33.0 / 64.0, 17.0 / 64.0, 45.0 / 64.0, 29.0 / 64.0,
+			10.0 / 64.0, 58.0 / 64.0,  6.0 / 64.0, 54.0 / 64.0,  9.0 / 64.0, 57.0 / 64.0,  5.0 / 64.0, 53.0 / 64.0,
+			42.0 / 64.0, 26.0 / 64.0, 38.0 / 64.0, 22.0 / 64.0, 41.0 / 64.0, 25.0 / 64.0, 37.0 / 64.0, 21.0 / 64.0,
+		};
+		return dBayer8;
+	}
+
+	/**
+	 * Gets the 16x16 Bayer matrix.  It is built on first use.
+	 *
+	 * \return Returns the 16x16 Bayer matrix.
+	 **/
+	const double * CDither::Bayer16x16() {
+		struct SL2_BAYER16 {
+			SL2_BAYER16() {
+				// M(2n)[Y][X] = 4 * M(n)[Y%n][X%n] + M(2)[Y/n][X/n], starting from M(1) = 0.
+				uint32_t ui32Matrix[16*16] = { 0 };
+				for ( uint32_t N = 1; N < 16; N *= 2 ) {
+					uint32_t ui32Next[16*16];
+					for ( uint32_t Y = 0; Y < N * 2; ++Y ) {
+						for ( uint32_t X = 0; X < N * 2; ++X ) {
+							static const uint32_t ui32Two[2][2] = { { 0, 2 }, { 3, 1 } };
+							ui32Next[Y*16+X] = 4 * ui32Matrix[(Y%N)*16+(X%N)] + ui32Two[Y/N][X/N];
+						}
+					}
+					std::memcpy( ui32Matrix, ui32Next, sizeof( ui32Matrix ) );
+				}
+				for ( uint32_t I = 0; I < 16 * 16; ++I ) {
+					dMatrix[I] = ui32Matrix[I] / 256.0;
+				}
+			}
+			double											dMatrix[16*16];
+		};
+		static const SL2_BAYER16 bMatrix;
+		return bMatrix.dMatrix;
+	}
+
+	/**
+	 * Gets the blue-noise mask.  On first use it is loaded from the temporary directory, or generated and saved there if
+	 *	the cached file is missing or invalid.  The file name and header carry the size and SL2_BLUE_NOISE_VERSION, and the
+	 *	file is written to a temporary name and renamed so that concurrent runs never read a partial mask.
+	 *
+	 * \return Returns the SL2_BLUE_NOISE_SIZE x SL2_BLUE_NOISE_SIZE blue-noise mask.
+	 **/
+	const double * CDither::BlueNoise() {
+		static const std::vector<double> vMask = []() {
+			constexpr uint32_t ui32Total = SL2_BLUE_NOISE_SIZE * SL2_BLUE_NOISE_SIZE;
+			// "SL2N", the version, and the size.
+			const uint32_t ui32Header[3] = { 0x4E324C53, SL2_BLUE_NOISE_VERSION, SL2_BLUE_NOISE_SIZE };
+			std::vector<double> vRet;
+			try {
+				std::vector<uint16_t> vRanks;
+				std::filesystem::path pPath = std::filesystem::temp_directory_path() /
+					std::format( "SL2BlueNoise{}_v{}.bin", SL2_BLUE_NOISE_SIZE, SL2_BLUE_NOISE_VERSION );
+				std::vector<uint8_t> vFile;
+				bool bLoaded = false;
+				if ( CStdFile::LoadToMemory( pPath.u16string().c_str(), vFile ) && vFile.size() == sizeof( ui32Header ) + ui32Total * sizeof( uint16_t ) &&
+					std::memcmp( vFile.data(), ui32Header, sizeof( ui32Header ) ) == 0 ) {
+					vRanks.resize( ui32Total );
+					std::memcpy( vRanks.data(), vFile.data() + sizeof( ui32Header ), ui32Total * sizeof( uint16_t ) );
+					// Each rank must appear exactly once.
+					std::vector<uint8_t> vSeen( ui32Total );
+					bLoaded = true;
+					for ( uint32_t I = 0; I < ui32Total && bLoaded; ++I ) {
+						if ( vRanks[I] >= ui32Total || vSeen[vRanks[I]] ) { bLoaded = false; }
+						else { vSeen[vRanks[I]] = 1; }
+					}
+				}
+				if ( !bLoaded ) {
+					if ( !GenerateBlueNoise( SL2_BLUE_NOISE_SIZE, vRanks ) ) { return vRet; }
+					// Failing to cache it only means generating it again next time.
+					vFile.resize( sizeof( ui32Header ) + ui32Total * sizeof( uint16_t ) );
+					std::memcpy( vFile.data(), ui32Header, sizeof( ui32Header ) );
+					std::memcpy( vFile.data() + sizeof( ui32Header ), vRanks.data(), ui32Total * sizeof( uint16_t ) );
+					std::filesystem::path pTmpPath = pPath;
+					pTmpPath += std::format( ".{}.tmp", std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+					if ( CStdFile::WriteToFile( pTmpPath.u16string().c_str(), vFile ) ) {
+						std::error_code ecError;
+						std::filesystem::rename( pTmpPath, pPath, ecError );
+						if ( ecError ) { std::filesystem::remove( pTmpPath, ecError ); }
+					}
+				}
+
+				// Ranks are stored [Y*Size+X]; maps are indexed [X*Size+Y].
+				vRet.resize( ui32Total );
+				for ( uint32_t Y = 0; Y < SL2_BLUE_NOISE_SIZE; ++Y ) {
+					for ( uint32_t X = 0; X < SL2_BLUE_NOISE_SIZE; ++X ) {
+						vRet[X*SL2_BLUE_NOISE_SIZE+Y] = vRanks[Y*SL2_BLUE_NOISE_SIZE+X] / double( ui32Total );
+					}
+				}
+			}
+			catch ( ... ) { vRet.clear(); }
+			return vRet;
+		}();
+		return vMask.size() ? vMask.data() : nullptr;
+	}
+
+	/**
+	 * Generates a blue-noise mask with the void-and-cluster method (Ulichney).  Pixels are ranked by the order in which they
+	 *	are removed from the tightest clusters of the initial pattern and then added to the largest voids.  The result is the
+	 *	same on every run.
+	 *
+	 * \param _ui32Size The side length of the mask.  Must be a power of 2.
+	 * \param _vRanks Holds the returned rank of each pixel.
+	 * \return Returns true if all allocations succeed.
+	 **/
+	bool CDither::GenerateBlueNoise( uint32_t _ui32Size, std::vector<uint16_t> &_vRanks ) {
+		try {
+			const uint32_t ui32Total = _ui32Size * _ui32Size;
+			const uint32_t ui32Mask = _ui32Size - 1;
+			if ( !_ui32Size || (_ui32Size & ui32Mask) || ui32Total > 0x10000 ) { return false; }
+
+			// A wrapping Gaussian (sigma = 1.5) measures how crowded each pixel's neighborhood is.
+			std::vector<double> vLut( ui32Total );
+			for ( uint32_t Y = 0; Y < _ui32Size; ++Y ) {
+				for ( uint32_t X = 0; X < _ui32Size; ++X ) {
+					double dX = std::min( X, _ui32Size - X ), dY = std::min( Y, _ui32Size - Y );
+					vLut[Y*_ui32Size+X] = std::exp( -(dX * dX + dY * dY) / (2.0 * 1.5 * 1.5) );
+				}
+			}
+			std::vector<uint8_t> vOn( ui32Total );
+			std::vector<double> vEnergy( ui32Total );
+			auto Toggle = [&]( uint32_t _ui32Idx, bool _bOn ) {
+				uint32_t ui32X = _ui32Idx & ui32Mask, ui32Y = _ui32Idx / _ui32Size;
+				double dSign = _bOn ? 1.0 : -1.0;
+				for ( uint32_t Y = 0; Y < _ui32Size; ++Y ) {
+					const double * pdLut = &vLut[((Y - ui32Y) & ui32Mask)*_ui32Size];
+					double * pdEnergy = &vEnergy[Y*_ui32Size];
+					for ( uint32_t X = 0; X < _ui32Size; ++X ) {
+						pdEnergy[X] += dSign * pdLut[(X - ui32X) & ui32Mask];
+					}
+				}
+				vOn[_ui32Idx] = _bOn;
+			};
+			// The set pixel with the most energy.
+			auto Tightest = [&]() {
+				uint32_t ui32Best = 0;
+				double dBest = -std::numeric_limits<double>::infinity();
+				for ( uint32_t I = 0; I < ui32Total; ++I ) {
+					if ( vOn[I] && vEnergy[I] > dBest ) {
+						dBest = vEnergy[I];
+						ui32Best = I;
+					}
+				}
+				return ui32Best;
+			};
+			// The unset pixel with the least energy.
+			auto Largest = [&]() {
+				uint32_t ui32Best = 0;
+				double dBest = std::numeric_limits<double>::infinity();
+				for ( uint32_t I = 0; I < ui32Total; ++I ) {
+					if ( !vOn[I] && vEnergy[I] < dBest ) {
+						dBest = vEnergy[I];
+						ui32Best = I;
+					}
+				}
+				return ui32Best;
+			};
+
+			// A fixed-seed random initial pattern with 1 pixel in 10 set.
+			std::mt19937 mRand( 5489 );
+			uint32_t ui32Ones = 0;
+			while ( ui32Ones < ui32Total / 10 ) {
+				uint32_t ui32Idx = uint32_t( mRand() % ui32Total );
+				if ( !vOn[ui32Idx] ) {
+					Toggle( ui32Idx, true );
+					++ui32Ones;
+				}
+			}
+			// Move the tightest cluster into the largest void until that no longer changes anything.
+			for ( uint32_t I = 0; I < ui32Total; ++I ) {
+				uint32_t ui32Cluster = Tightest();
+				Toggle( ui32Cluster, false );
+				uint32_t ui32Void = Largest();
+				Toggle( ui32Void, true );
+				if ( ui32Void == ui32Cluster ) { break; }
+			}
+			std::vector<uint8_t> vInitialOn( vOn );
+			std::vector<double> vInitialEnergy( vEnergy );
+
+			_vRanks.assign( ui32Total, 0 );
+			// Phase 1: the initial pattern's tightest clusters get the highest of its ranks.
+			for ( uint32_t R = ui32Ones; R--; ) {
+				uint32_t ui32Cluster = Tightest();
+				Toggle( ui32Cluster, false );
+				_vRanks[ui32Cluster] = uint16_t( R );
+			}
+			// Phases 2 and 3: fill the largest voids.  Past half full, the tightest cluster of unset pixels (by the energy of the
+			//	unset pixels) is the same pixel as the largest void (by the energy of the set pixels), so one loop covers both.
+			vOn = vInitialOn;
+			vEnergy = vInitialEnergy;
+			for ( uint32_t R = ui32Ones; R < ui32Total; ++R ) {
+				uint32_t ui32Void = Largest();
+				Toggle( ui32Void, true );
+				_vRanks[ui32Void] = uint16_t( R );
+			}
+		}
+		catch ( ... ) { return false; }
+		return true;
+	}
+
+}	// namespace sl2
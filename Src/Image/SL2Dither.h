@@ -3,11 +3,20 @@
  *
  * Written by: Shawn (L. Spiro) Wilcoxen
  *
- * Description: A palette and palette functionality.
+ * Description: Dithering modes and the threshold maps used by ordered dithering.
  */
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
+/** The side length of the blue-noise mask. */
+#define SL2_BLUE_NOISE_SIZE									64
+
+/** The version of the blue-noise generator.  Increase it whenever GenerateBlueNoise() changes so that masks cached by older builds are not used. */
+#define SL2_BLUE_NOISE_VERSION								1
+
 
 namespace sl2 {
 
@@ -25,6 +34,63 @@ namespace sl2 {
 
 		SL2_D_BAYER_4X4,
 		SL2_D_BAYER_8X8,
+		SL2_D_BAYER_16X16,
+		SL2_D_BLUE_NOISE,
+	};
+
+
+	/**
+	 * Class CDither
+	 * \brief The threshold maps used by ordered dithering.
+	 *
+	 * Description: The threshold maps used by ordered dithering.  Each map is square with a power-of-2 side, is indexed as
+	 *	[X*Side+Y], and holds thresholds in [0, 1).
+	 */
+	class CDither {
+	public :
+		// == Functions.
+		/**
+		 * Gets the 4x4 Bayer matrix.
+		 *
+		 * \return Returns the 4x4 Bayer matrix.
+		 **/
+		static const double *								Bayer4x4();
+
+		/**
+		 * Gets the 8x8 Bayer matrix.
+		 *
+		 * \return Returns the 8x8 Bayer matrix.
+		 **/
+		static const double *								Bayer8x8();
+
+		/**
+		 * Gets the 16x16 Bayer matrix.  It is built on first use.
+		 *
+		 * \return Returns the 16x16 Bayer matrix.
+		 **/
+		static const double *								Bayer16x16();
+
+		/**
+		 * Gets the blue-noise mask.  On first use it is loaded from the temporary directory, or generated and saved there if
+		 *	the cached file is missing or invalid.
+		 *
+		 * \return Returns the SL2_BLUE_NOISE_SIZE x SL2_BLUE_NOISE_SIZE blue-noise mask.
+		 **/
+		static const double *								BlueNoise();
+
+
+	protected :
+		// == Functions.
+		/**
+		 * Generates a blue-noise mask with the void-and-cluster method (Ulichney).  Pixels are ranked by the order in which they
+		 *	are removed from the tightest clusters of the initial pattern and then added to the largest voids.  The result is the
+		 *	same on every run.
+		 *
+		 * \param _ui32Size The side length of the mask.  Must be a power of 2.
+		 * \param _vRanks Holds the returned rank of each pixel.
+		 * \return Returns true if all allocations succeed.
+		 **/
+		static bool											GenerateBlueNoise( uint32_t _ui32Size, std::vector<uint16_t> &_vRanks );
 	};
 
 }	// namespace sl2
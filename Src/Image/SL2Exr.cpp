@@ -0,0 +1,438 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Reads and writes OpenEXR files through the bundled OpenEXR library, with control over its thread pool, tiling,
+ *	mipmap levels, and compression.
+ */
+
+#include "SL2Exr.h"
+#include "../Thread/SL2ParallelFor.h"
+#include "../Time/SL2Clock.h"
+
+#include <OpenEXR/Half/half.h>
+#include <OpenEXR/IlmImf/ImfChannelList.h>
+#include <OpenEXR/IlmImf/ImfFrameBuffer.h>
+#include <OpenEXR/IlmImf/ImfHeader.h>
+#include <OpenEXR/IlmImf/ImfInputFile.h>
+#include <OpenEXR/IlmImf/ImfIO.h>
+#include <OpenEXR/IlmImf/ImfOutputFile.h>
+#include <OpenEXR/IlmImf/ImfThreading.h>
+#include <OpenEXR/IlmImf/ImfTiledInputFile.h>
+#include <OpenEXR/IlmImf/ImfTiledOutputFile.h>
+#include <OpenEXR/IlmImf/ImfVersion.h>
+#include <OpenEXR/IlmThread/IlmThread.h>
+#include <OpenEXR/Iex/IexBaseExc.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CExrMemIStream
+	 * \brief An OpenEXR input stream over a file held in memory.
+	 *
+	 * Description: An OpenEXR input stream over a file held in memory.  The stream is memory-mapped, so OpenEXR reads compressed
+	 *	data straight from the file instead of copying it into its line buffers first.
+	 */
+	class CExrMemIStream : public Imf::IStream {
+	public :
+		CExrMemIStream( const std::vector<uint8_t> &_vData ) :
+			Imf::IStream( "" ),
+			m_vData( _vData ),
+			m_ui64Pos( 0 ) {
+		}
+
+
+		// == Functions.
+		/**
+		 * Determines whether the stream supports memory-mapped reads.
+		 *
+		 * \return Returns true.
+		 **/
+		virtual bool																			isMemoryMapped() const { return true; }
+
+		/**
+		 * Reads from the stream.
+		 *
+		 * \param _pcDst Holds the bytes read.
+		 * \param _iSize The number of bytes to read.
+		 * \return Returns false if the last byte of the file was read.
+		 **/
+		virtual bool																			read( char _pcDst[], int _iSize ) {
+			std::memcpy( _pcDst, readMemoryMapped( _iSize ), size_t( _iSize ) );
+			return m_ui64Pos < m_vData.size();
+		}
+
+		/**
+		 * Reads from the stream without copying.
+		 *
+		 * \param _iSize The number of bytes to read.
+		 * \return Returns a pointer to the bytes read.
+		 **/
+		virtual char *																			readMemoryMapped( int _iSize ) {
+			if ( _iSize < 0 || m_ui64Pos > m_vData.size() || uint64_t( _iSize ) > m_vData.size() - m_ui64Pos ) {
+				throw Iex::InputExc( "Unexpected end of file." );
+			}
+			char * pcRet = const_cast<char *>(reinterpret_cast<const char *>(m_vData.data())) + m_ui64Pos;
+			m_ui64Pos += uint64_t( _iSize );
+			return pcRet;
+		}
+
+		/**
+		 * Gets the reading position.
+		 *
+		 * \return Returns the offset of the next byte to read.
+		 **/
+		virtual Imf::Int64																		tellg() { return m_ui64Pos; }
+
+		/**
+		 * Sets the reading position.
+		 *
+		 * \param _i64Pos The offset of the next byte to read.
+		 **/
+		virtual void																			seekg( Imf::Int64 _i64Pos ) { m_ui64Pos = _i64Pos; }
+
+
+	protected :
+		// == Members.
+		/** The file. */
+		const std::vector<uint8_t> &															m_vData;
+
+		/** The reading position. */
+		uint64_t																				m_ui64Pos;
+	};
+
+	/**
+	 * Class CExrMemOStream
+	 * \brief An OpenEXR output stream into memory.
+	 *
+	 * Description: An OpenEXR output stream into memory.  OpenEXR seeks back to fill in the line-offset table once the pixels
+	 *	have been written.
+	 */
+	class CExrMemOStream : public Imf::OStream {
+	public :
+		CExrMemOStream( std::vector<uint8_t> &_vData ) :
+			Imf::OStream( "" ),
+			m_vData( _vData ),
+			m_ui64Pos( 0 ) {
+		}
+
+
+		// == Functions.
+		/**
+		 * Writes to the stream.
+		 *
+		 * \param _pcSrc The bytes to write.
+		 * \param _iSize The number of bytes to write.
+		 **/
+		virtual void																			write( const char _pcSrc[], int _iSize ) {
+			if ( m_ui64Pos + _iSize > m_vData.size() ) {
+				if ( m_ui64Pos + _iSize > m_vData.capacity() ) {
+					m_vData.reserve( std::max<size_t>( size_t( m_ui64Pos + _iSize ), m_vData.capacity() * 2 ) );
+				}
+				m_vData.resize( size_t( m_ui64Pos + _iSize ) );
+			}
+			std::memcpy( m_vData.data() + m_ui64Pos, _pcSrc, size_t( _iSize ) );
+			m_ui64Pos += uint64_t( _iSize );
+		}
+
+		/**
+		 * Gets the writing position.
+		 *
+		 * \return Returns the offset of the next byte to write.
+		 **/
+		virtual Imf::Int64																		tellp() { return m_ui64Pos; }
+
+		/**
+		 * Sets the writing position.
+		 *
+		 * \param _i64Pos The offset of the next byte to write.
+		 **/
+		virtual void																			seekp( Imf::Int64 _i64Pos ) { m_ui64Pos = _i64Pos; }
+
+
+	protected :
+		// == Members.
+		/** The file. */
+		std::vector<uint8_t> &																	m_vData;
+
+		/** The writing position. */
+		uint64_t																				m_ui64Pos;
+	};
+
+
+	/** The channel names for 1, 3, and 4 channels. */
+	static const char * const																	g_pcChannels[5][4] = {
+		{},
+		{ "Y" },
+		{},
+		{ "R", "G", "B" },
+		{ "R", "G", "B", "A" },
+	};
+
+	/**
+	 * Adds the slices for an image of interleaved channels to a frame buffer.
+	 *
+	 * \param _fbBuffer The frame buffer to which to add the slices.
+	 * \param _ui32Channels The number of channels: 1, 3, or 4.
+	 * \param _ptType The type of each channel, Imf::FLOAT or Imf::HALF.
+	 * \param _pvTexels The first texel of the image.
+	 * \param _sPitch The distance in bytes from one row to the next.
+	 * \param _v2Min The coordinates of the first texel in the file's data window.
+	 **/
+	static void																					InsertSlices( Imf::FrameBuffer &_fbBuffer, uint32_t _ui32Channels, Imf::PixelType _ptType, const void * _pvTexels,
+		size_t _sPitch, const Imath::V2i &_v2Min ) {
+		const size_t sSize = _ptType == Imf::HALF ? sizeof( half ) : sizeof( float );
+		const size_t sStride = sSize * _ui32Channels;
+		// OpenEXR addresses texels by their coordinates in the data window, which need not start at 0.
+		char * pcBase = const_cast<char *>(static_cast<const char *>(_pvTexels)) - ptrdiff_t( sStride ) * _v2Min.x - ptrdiff_t( _sPitch ) * _v2Min.y;
+		for ( uint32_t I = 0; I < _ui32Channels; ++I ) {
+			_fbBuffer.insert( g_pcChannels[_ui32Channels][I], Imf::Slice( _ptType, pcBase + sSize * I, sStride, _sPitch ) );
+		}
+	}
+
+	/**
+	 * Converts a level to half floats.  Rows are split across up to CExr::Threads() workers.
+	 *
+	 * \param _lLevel The level to convert.
+	 * \param _ui32Channels The number of channels.
+	 * \param _vDst Holds the converted level, with rows packed.
+	 **/
+	static void																					ToHalf( const CExr::SL2_LEVEL &_lLevel, uint32_t _ui32Channels, std::vector<half> &_vDst ) {
+		const size_t sRow = size_t( _lLevel.ui32Width ) * _ui32Channels;
+		_vDst.resize( sRow * _lLevel.ui32Height );
+
+		std::atomic<uint32_t> aNext = 0;
+		auto Work = [&]() {
+			// Claim 16 rows at a time.
+			for ( uint32_t ui32Y = aNext.fetch_add( 16 ); ui32Y < _lLevel.ui32Height; ui32Y = aNext.fetch_add( 16 ) ) {
+				uint32_t ui32End = std::min( ui32Y + 16, _lLevel.ui32Height );
+				for ( uint32_t Y = ui32Y; Y < ui32End; ++Y ) {
+					const float * pfSrc = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(_lLevel.pfTexels) + _lLevel.sPitch * Y);
+					half * phDst = _vDst.data() + sRow * Y;
+					for ( size_t X = 0; X < sRow; ++X ) {
+						phDst[X] = pfSrc[X];
+					}
+				}
+			}
+		};
+		size_t sThreads = std::min<size_t>( CExr::Threads(), (_lLevel.ui32Height + 15) / 16 );
+		CParallelFor::Run( CParallelFor::Workers( sThreads ), [&]( size_t ) { Work(); } );
+	}
+
+	/**
+	 * Gets the number of channels to read from a file.
+	 *
+	 * \param _hHeader The header of the file.
+	 * \return Returns 4 for RGBA, 3 for RGB, 1 for Y, or 0 if the file has none of those sets of channels.
+	 **/
+	static uint32_t																				ReadChannels( const Imf::Header &_hHeader ) {
+		const Imf::ChannelList & clChannels = _hHeader.channels();
+		if ( clChannels.findChannel( "R" ) && clChannels.findChannel( "G" ) && clChannels.findChannel( "B" ) ) {
+			return clChannels.findChannel( "A" ) ? 4 : 3;
+		}
+		// Luminance/chroma files (EXR_LC) have RY and BY channels as well, and are left to FreeImage.
+		if ( clChannels.findChannel( "Y" ) && !clChannels.findChannel( "RY" ) && !clChannels.findChannel( "BY" ) ) {
+			return 1;
+		}
+		return 0;
+	}
+
+
+	// == Members.
+	/** Microseconds spent in Write(). */
+	std::atomic<uint64_t> CExr::m_aWriteMicros = 0;
+
+	/** Microseconds spent in Read(). */
+	std::atomic<uint64_t> CExr::m_aReadMicros = 0;
+
+	// == Functions.
+	/**
+	 * Sets the number of threads OpenEXR uses to compress and decompress.  Affects every file read or written afterwards,
+	 *	including those read and written through FreeImage.
+	 *
+	 * \param _ui32Threads The number of threads, or 0 for one per core.
+	 **/
+	void CExr::SetThreads( uint32_t _ui32Threads ) {
+		if ( !IlmThread::supportsThreads() ) { return; }
+		if ( !_ui32Threads ) { _ui32Threads = std::max( std::thread::hardware_concurrency(), 1U ); }
+		// A pool of 1 only moves the work off the calling thread, which then waits for it.
+		if ( _ui32Threads == 1 ) { _ui32Threads = 0; }
+		try {
+			Imf::setGlobalThreadCount( int( _ui32Threads ) );
+		}
+		catch ( ... ) {}
+	}
+
+	/**
+	 * Gets the number of threads OpenEXR uses to compress and decompress.
+	 *
+	 * \return Returns the size of OpenEXR's thread pool.  0 means files are read and written on the calling thread.
+	 **/
+	uint32_t CExr::Threads() {
+		return uint32_t( Imf::globalThreadCount() );
+	}
+
+	/**
+	 * Writes an OpenEXR file to memory.  A single level is written as scanlines unless a tile size is set.  Multiple levels
+	 *	are written as a tiled, mipmapped file, and must be the full chain, each level half the size of the one before it
+	 *	rounded down.
+	 *
+	 * \param _plLevels The levels to write, starting with the base level.
+	 * \param _sLevels The number of levels to which _plLevels points.
+	 * \param _ui32Channels The number of channels: 1 (Y), 3 (RGB), or 4 (RGBA).
+	 * \param _sSettings Output settings.
+	 * \param _vOut Holds the returned file.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CExr::Write( const SL2_LEVEL * _plLevels, size_t _sLevels, uint32_t _ui32Channels, const SL2_SETTINGS &_sSettings,
+		std::vector<uint8_t> &_vOut ) {
+		if ( !_sLevels || (_ui32Channels != 1 && _ui32Channels != 3 && _ui32Channels != 4) || _sSettings.cCompression > SL2_C_B44A ) { return SL2_E_INVALIDCALL; }
+		if ( !_plLevels[0].ui32Width || !_plLevels[0].ui32Height || _plLevels[0].ui32Width > 0x7FFFFFFF || _plLevels[0].ui32Height > 0x7FFFFFFF ) { return SL2_E_UNSUPPORTEDSIZE; }
+		if ( _sLevels > 1 ) {
+			if ( _sLevels != FullChain( _plLevels[0].ui32Width, _plLevels[0].ui32Height ) ) { return SL2_E_INVALIDCALL; }
+			for ( size_t I = 1; I < _sLevels; ++I ) {
+				if ( _plLevels[I].ui32Width != std::max( _plLevels[0].ui32Width >> I, 1U ) ||
+					_plLevels[I].ui32Height != std::max( _plLevels[0].ui32Height >> I, 1U ) ) { return SL2_E_INVALIDCALL; }
+			}
+		}
+
+		CClock cClock;
+		SL2_ERRORS eRet = SL2_E_SUCCESS;
+		try {
+			_vOut.clear();
+			CExrMemOStream mosStream( _vOut );
+
+			Imf::Header hHeader( int( _plLevels[0].ui32Width ), int( _plLevels[0].ui32Height ), 1.0f, Imath::V2f( 0.0f, 0.0f ), 1.0f,
+				Imf::INCREASING_Y, Imf::Compression( _sSettings.cCompression ) );
+			for ( uint32_t I = 0; I < _ui32Channels; ++I ) {
+				hHeader.channels().insert( g_pcChannels[_ui32Channels][I], Imf::Channel( _sSettings.bFloat ? Imf::FLOAT : Imf::HALF ) );
+			}
+			const Imath::V2i v2Origin( 0, 0 );
+
+			// OpenEXR converts the channels it reads to the frame buffer's type, but writes them only from the same type.
+			std::vector<half> vHalf;
+			auto Insert = [&]( Imf::FrameBuffer &_fbBuffer, const SL2_LEVEL &_lLevel ) {
+				if ( _sSettings.bFloat ) {
+					InsertSlices( _fbBuffer, _ui32Channels, Imf::FLOAT, _lLevel.pfTexels, _lLevel.sPitch, v2Origin );
+				}
+				else {
+					ToHalf( _lLevel, _ui32Channels, vHalf );
+					InsertSlices( _fbBuffer, _ui32Channels, Imf::HALF, vHalf.data(), sizeof( half ) * _ui32Channels * _lLevel.ui32Width, v2Origin );
+				}
+			};
+
+			if ( _sLevels == 1 && !_sSettings.ui32TileSize ) {
+				Imf::OutputFile ofFile( mosStream, hHeader );
+				Imf::FrameBuffer fbBuffer;
+				Insert( fbBuffer, _plLevels[0] );
+				ofFile.setFrameBuffer( fbBuffer );
+				ofFile.writePixels( int( _plLevels[0].ui32Height ) );
+			}
+			else {
+				uint32_t ui32Tile = _sSettings.ui32TileSize ? _sSettings.ui32TileSize : 64;
+				hHeader.setTileDescription( Imf::TileDescription( ui32Tile, ui32Tile, _sLevels > 1 ? Imf::MIPMAP_LEVELS : Imf::ONE_LEVEL, Imf::ROUND_DOWN ) );
+				Imf::TiledOutputFile tofFile( mosStream, hHeader );
+				for ( size_t I = 0; I < _sLevels; ++I ) {
+					Imf::FrameBuffer fbBuffer;
+					Insert( fbBuffer, _plLevels[I] );
+					tofFile.setFrameBuffer( fbBuffer );
+					tofFile.writeTiles( 0, tofFile.numXTiles( int( I ) ) - 1, 0, tofFile.numYTiles( int( I ) ) - 1, int( I ) );
+				}
+			}
+		}
+		catch ( const std::bad_alloc & ) { eRet = SL2_E_OUTOFMEMORY; }
+		catch ( ... ) { eRet = SL2_E_INTERNALERROR; }
+		m_aWriteMicros += (cClock.GetRealTick() - cClock.GetStartTick()) * 1000000ULL / cClock.GetResolution();
+		return eRet;
+	}
+
+	/**
+	 * Reads an OpenEXR file from memory.  Files with R, G, and B channels are read as RGB, or RGBA if they also have an A
+	 *	channel, and files with only a Y channel are read as Y.  Luminance/chroma files and others are rejected so that they
+	 *	can be read by FreeImage.  Every level of a tiled, mipmapped file whose levels round down is read; other files are read
+	 *	at the base level only.
+	 *
+	 * \param _vData The file to read.
+	 * \param _pfLevelBuffer Gets the buffer into which to read each level.
+	 * \param _pvParm Passed to _pfLevelBuffer.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CExr::Read( const std::vector<uint8_t> &_vData, PfLevelBuffer _pfLevelBuffer, void * _pvParm ) {
+		if ( _vData.size() < 8 || !Imf::isImfMagic( reinterpret_cast<const char *>(_vData.data()) ) ) { return SL2_E_INVALIDFILETYPE; }
+		int32_t i32Version;
+		std::memcpy( &i32Version, _vData.data() + 4, sizeof( i32Version ) );
+
+		CClock cClock;
+		SL2_ERRORS eRet = SL2_E_SUCCESS;
+		try {
+			CExrMemIStream misStream( _vData );
+			SL2_HEADER hHeader;
+			if ( Imf::isTiled( i32Version ) ) {
+				Imf::TiledInputFile tifFile( misStream );
+				const Imath::Box2i & b2Window = tifFile.header().dataWindow();
+				hHeader.ui32Width = uint32_t( b2Window.max.x - b2Window.min.x + 1 );
+				hHeader.ui32Height = uint32_t( b2Window.max.y - b2Window.min.y + 1 );
+				hHeader.ui32Channels = ReadChannels( tifFile.header() );
+				if ( !hHeader.ui32Channels ) { return SL2_E_INVALIDFILETYPE; }
+				const Imf::TileDescription & tdTiles = tifFile.header().tileDescription();
+				// Rip-maps and levels that round up have no counterpart in a mipmap chain.
+				hHeader.sLevels = (tdTiles.mode == Imf::MIPMAP_LEVELS && tdTiles.roundingMode == Imf::ROUND_DOWN) ? size_t( tifFile.numLevels() ) : 1;
+				for ( size_t I = 0; I < hHeader.sLevels && eRet == SL2_E_SUCCESS; ++I ) {
+					size_t sPitch = 0;
+					float * pfTexels = _pfLevelBuffer( _pvParm, hHeader, I, sPitch );
+					if ( !pfTexels ) {
+						eRet = SL2_E_OUTOFMEMORY;
+						break;
+					}
+					Imf::FrameBuffer fbBuffer;
+					InsertSlices( fbBuffer, hHeader.ui32Channels, Imf::FLOAT, pfTexels, sPitch, b2Window.min );
+					tifFile.setFrameBuffer( fbBuffer );
+					tifFile.readTiles( 0, tifFile.numXTiles( int( I ) ) - 1, 0, tifFile.numYTiles( int( I ) ) - 1, int( I ) );
+				}
+			}
+			else {
+				Imf::InputFile ifFile( misStream );
+				const Imath::Box2i & b2Window = ifFile.header().dataWindow();
+				hHeader.ui32Width = uint32_t( b2Window.max.x - b2Window.min.x + 1 );
+				hHeader.ui32Height = uint32_t( b2Window.max.y - b2Window.min.y + 1 );
+				hHeader.ui32Channels = ReadChannels( ifFile.header() );
+				if ( !hHeader.ui32Channels ) { return SL2_E_INVALIDFILETYPE; }
+				hHeader.sLevels = 1;
+				size_t sPitch = 0;
+				float * pfTexels = _pfLevelBuffer( _pvParm, hHeader, 0, sPitch );
+				if ( !pfTexels ) { eRet = SL2_E_OUTOFMEMORY; }
+				else {
+					Imf::FrameBuffer fbBuffer;
+					InsertSlices( fbBuffer, hHeader.ui32Channels, Imf::FLOAT, pfTexels, sPitch, b2Window.min );
+					ifFile.setFrameBuffer( fbBuffer );
+					ifFile.readPixels( b2Window.min.y, b2Window.max.y );
+				}
+			}
+		}
+		catch ( const std::bad_alloc & ) { eRet = SL2_E_OUTOFMEMORY; }
+		catch ( ... ) { eRet = SL2_E_INVALIDDATA; }
+		m_aReadMicros += (cClock.GetRealTick() - cClock.GetStartTick()) * 1000000ULL / cClock.GetResolution();
+		return eRet;
+	}
+
+	/**
+	 * Gets the number of levels in a full mipmap chain whose levels round down, as OpenEXR counts them.
+	 *
+	 * \param _ui32Width The width of the base level.
+	 * \param _ui32Height The height of the base level.
+	 * \return Returns the number of levels down to 1-by-1.
+	 **/
+	size_t CExr::FullChain( uint32_t _ui32Width, uint32_t _ui32Height ) {
+		size_t sRet = 1;
+		for ( uint32_t ui32Size = std::max( _ui32Width, _ui32Height ); ui32Size > 1; ui32Size >>= 1 ) { ++sRet; }
+		return sRet;
+	}
+
+}	// namespace sl2
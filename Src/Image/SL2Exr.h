@@ -0,0 +1,158 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Reads and writes OpenEXR files through the bundled OpenEXR library, with control over its thread pool, tiling,
+ *	mipmap levels, and compression.
+ */
+
+#pragma once
+
+#include "SL2Formats.h"
+
+#include <atomic>
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CExr
+	 * \brief Reads and writes OpenEXR files through the bundled OpenEXR library.
+	 *
+	 * Description: Reads and writes OpenEXR files through the bundled OpenEXR library, with control over its thread pool, tiling,
+	 *	mipmap levels, and compression.  OpenEXR compresses and decompresses line buffers and tiles on a global pool of threads, set
+	 *	with SetThreads().  Texels are always passed as 32-bit floats, interleaved and from the top row down.  Half-float files are
+	 *	converted on the worker threads.
+	 */
+	class CExr {
+	public :
+		// == Enumerations.
+		/** Compression methods.  The values match Imf::Compression. */
+		enum SL2_COMPRESSION : uint8_t {
+			SL2_C_NONE,																			/**< No compression. */
+			SL2_C_RLE,																			/**< Run-length encoding. */
+			SL2_C_ZIPS,																			/**< zlib, one scanline at a time. */
+			SL2_C_ZIP,																			/**< zlib, in blocks of 16 scanlines. */
+			SL2_C_PIZ,																			/**< Wavelet compression.  The FreeImage default. */
+			SL2_C_PXR24,																		/**< Lossy 24-bit float compression. */
+			SL2_C_B44,																			/**< Lossy 4-by-4 block compression with a fixed rate. */
+			SL2_C_B44A,																			/**< B44, with flat blocks compressed further. */
+		};
+
+
+		// == Types.
+		/** Output settings. */
+		struct SL2_SETTINGS {
+			SL2_COMPRESSION																		cCompression = SL2_C_PIZ;			/**< The compression method. */
+			bool																				bFloat = false;						/**< Write 32-bit float channels instead of half floats. */
+			uint32_t																			ui32TileSize = 0;					/**< The width and height of a tile, or 0 to write scanlines. */
+		};
+
+		/** A level of an image to write. */
+		struct SL2_LEVEL {
+			const float *																		pfTexels;							/**< The texels, interleaved and from the top row down. */
+			size_t																				sPitch;								/**< The distance in bytes from one row to the next. */
+			uint32_t																			ui32Width;							/**< The width of the level. */
+			uint32_t																			ui32Height;							/**< The height of the level. */
+		};
+
+		/** The image in a file being read. */
+		struct SL2_HEADER {
+			uint32_t																			ui32Width;							/**< The width of the base level. */
+			uint32_t																			ui32Height;							/**< The height of the base level. */
+			uint32_t																			ui32Channels;						/**< 1 (Y), 3 (RGB), or 4 (RGBA). */
+			size_t																				sLevels;							/**< The number of mipmap levels that will be read. */
+		};
+
+		/**
+		 * Gets the buffer into which to read a level.  Called for each level in order, after the header has been read.
+		 *
+		 * \param _pvParm The parameter passed to Read().
+		 * \param _hHeader The image in the file.
+		 * \param _sLevel The level to be read.
+		 * \param _sPitch Holds the distance in bytes from one row to the next.
+		 * \return Returns the first texel of the level, or nullptr to stop reading.
+		 **/
+		typedef float * (*																		PfLevelBuffer)( void * _pvParm, const SL2_HEADER &_hHeader, size_t _sLevel, size_t &_sPitch );
+
+
+		// == Functions.
+		/**
+		 * Sets the number of threads OpenEXR uses to compress and decompress.  Affects every file read or written afterwards,
+		 *	including those read and written through FreeImage.
+		 *
+		 * \param _ui32Threads The number of threads, or 0 for one per core.
+		 **/
+		static void																				SetThreads( uint32_t _ui32Threads );
+
+		/**
+		 * Gets the number of threads OpenEXR uses to compress and decompress.
+		 *
+		 * \return Returns the size of OpenEXR's thread pool.  0 means files are read and written on the calling thread.
+		 **/
+		static uint32_t																			Threads();
+
+		/**
+		 * Writes an OpenEXR file to memory.  A single level is written as scanlines unless a tile size is set.  Multiple levels
+		 *	are written as a tiled, mipmapped file, and must be the full chain, each level half the size of the one before it
+		 *	rounded down.
+		 *
+		 * \param _plLevels The levels to write, starting with the base level.
+		 * \param _sLevels The number of levels to which _plLevels points.
+		 * \param _ui32Channels The number of channels: 1 (Y), 3 (RGB), or 4 (RGBA).
+		 * \param _sSettings Output settings.
+		 * \param _vOut Holds the returned file.
+		 * \return Returns an error code.
+		 **/
+		static SL2_ERRORS																		Write( const SL2_LEVEL * _plLevels, size_t _sLevels, uint32_t _ui32Channels, const SL2_SETTINGS &_sSettings,
+			std::vector<uint8_t> &_vOut );
+
+		/**
+		 * Reads an OpenEXR file from memory.  Files with R, G, and B channels are read as RGB, or RGBA if they also have an A
+		 *	channel, and files with only a Y channel are read as Y.  Luminance/chroma files and others are rejected so that they
+		 *	can be read by FreeImage.  Every level of a tiled, mipmapped file whose levels round down is read; other files are read
+		 *	at the base level only.
+		 *
+		 * \param _vData The file to read.
+		 * \param _pfLevelBuffer Gets the buffer into which to read each level.
+		 * \param _pvParm Passed to _pfLevelBuffer.
+		 * \return Returns an error code.
+		 **/
+		static SL2_ERRORS																		Read( const std::vector<uint8_t> &_vData, PfLevelBuffer _pfLevelBuffer, void * _pvParm );
+
+		/**
+		 * Gets the number of levels in a full mipmap chain whose levels round down, as OpenEXR counts them.
+		 *
+		 * \param _ui32Width The width of the base level.
+		 * \param _ui32Height The height of the base level.
+		 * \return Returns the number of levels down to 1-by-1.
+		 **/
+		static size_t																			FullChain( uint32_t _ui32Width, uint32_t _ui32Height );
+
+		/**
+		 * Gets the time spent in Write().
+		 *
+		 * \return Returns the time spent writing files, in seconds.
+		 **/
+		static inline double																	WriteTime() { return m_aWriteMicros / 1000000.0; }
+
+		/**
+		 * Gets the time spent in Read().
+		 *
+		 * \return Returns the time spent reading files, in seconds.
+		 **/
+		static inline double																	ReadTime() { return m_aReadMicros / 1000000.0; }
+
+
+	protected :
+		// == Members.
+		/** Microseconds spent in Write(). */
+		static std::atomic<uint64_t>															m_aWriteMicros;
+
+		/** Microseconds spent in Read(). */
+		static std::atomic<uint64_t>															m_aReadMicros;
+	};
+
+}	// namespace sl2
@@ -8,6 +8,7 @@
 
 #include "SL2Formats.h"
 #include "SL2Image.h"
+#include "../Thread/SL2ParallelFor.h"
 
 
 namespace sl2 {
@@ -651,6 +652,18 @@ namespace sl2 {
 	/** K-Means iteration count. */
 	size_t CFormat::m_skMeansIterations = ~size_t( 0 );
 
+	/** K-Means seed. */
+	uint64_t CFormat::m_ui64kMeansSeed = 5489;
+
+	/** Palette generator. */
+	SL2_PALETTE_METHOD CFormat::m_pmPaletteMethod = SL2_PM_KMEANS;
+
+	/** K-Means refinement iterations run after a non-K-Means palette generator. */
+	size_t CFormat::m_sPaletteRefineIterations = 0;
+
+	/** Color-distance metric used for palette generation, dithering, and index mapping. */
+	SL2_COLOR_DISTANCE CFormat::m_cdColorDistance = SL2_CD_DEFAULT;
+
 	/** Whether to use NVIDA's decoding of block formats or not. */
 	bool CFormat::m_bUseNVidiaDecode = true;
 
@@ -1090,6 +1103,49 @@ namespace sl2 {
 		return 0;
 	}
 
+	/**
+	 * Gets the size of a glType as stored in the glTypeSize field of a KTX 1 file.  Packed types are the size of a whole texel.
+	 * 
+	 * \param _ktType The type.
+	 * \return Returns the size of the type in bytes, or 0 if KTX 1 files can't store the type.
+	 **/
+	uint32_t CFormat::KtxTypeSize( SL2_KTX_TYPE _ktType ) {
+		switch ( _ktType ) {
+			case SL2_KT_GL_BYTE : {}							SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_BYTE : {}					SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_BYTE_3_3_2 : {}				SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_BYTE_2_3_3_REV : {
+				return 1;
+			}
+			case SL2_KT_GL_SHORT : {}							SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT : {}					SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT_5_6_5 : {}			SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT_5_6_5_REV : {}		SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT_4_4_4_4 : {}			SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT_4_4_4_4_REV : {}		SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT_5_5_5_1 : {}			SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_SHORT_1_5_5_5_REV : {}		SL2_FALLTHROUGH
+			case SL2_KT_GL_HALF_FLOAT : {}						SL2_FALLTHROUGH
+			case SL2_KT_GL_HALF_FLOAT_OES : {
+				return 2;
+			}
+			case SL2_KT_GL_INT : {}								SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT : {}					SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_8_8_8_8 : {}			SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_8_8_8_8_REV : {}		SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_10_10_10_2 : {}			SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_2_10_10_10_REV : {}		SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_24_8 : {}				SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_10F_11F_11F_REV : {}	SL2_FALLTHROUGH
+			case SL2_KT_GL_UNSIGNED_INT_5_9_9_9_REV : {}		SL2_FALLTHROUGH
+			case SL2_KT_GL_FLOAT : {}							SL2_FALLTHROUGH
+			case SL2_KT_GL_FLOAT_32_UNSIGNED_INT_24_8_REV : {
+				return 4;
+			}
+			default : { return 0; }
+		}
+	}
+
 	/**
 	 * Applies settings based on the current value of m_ui32Perf.
 	 * 
@@ -2154,244 +2210,117 @@ namespace sl2 {
 	}
 
 	/**
-	 * Applies Floyd-Steinberg Dithering to a given color buffer.
+	 * Applies dithering to a given color buffer.  Ordered kernels run through CPalette::OrderedDither(), which splits rows
+	 *	across threads.  Error-diffusion kernels run through CPalette::DiffuseError(), which spreads rows across threads and
+	 *	matches a serial pass exactly.  Either way each texel is left snapped to a palette entry.
 	 * 
 	 * \param _prgbaColors The in/out color buffer.
 	 * \param _ui32Width The width of the image.
 	 * \param _ui32Height The height of the image.
 	 * \param _pPalette The palette.
 	 * \param _pclLabPal The palette in LAB.
+	 * \return Returns false if the kernel could not be run, for example when the blue-noise map could not be created.
 	 **/
 	template <unsigned _uDither>
 	bool CFormat::Dither( SL2_RGBA64F * _prgbaColors, uint32_t _ui32Width, uint32_t _ui32Height, const CPalette &_pPalette, const ispc::ColorLABA * _pclLabPal ) {
-		static const double dBayer4[4][4] = {
-			{  0.0 / 16.0,  8.0 / 16.0,  2.0 / 16.0, 10.0 / 16.0 },
-			{ 12.0 / 16.0,  4.0 / 16.0, 14.0 / 16.0,  6.0 / 16.0 },
-			{  3.0 / 16.0, 11.0 / 16.0,  1.0 / 16.0,  9.0 / 16.0 },
-			{ 15.0 / 16.0,  7.0 / 16.0, 13.0 / 16.0,  5.0 / 16.0 }
-		};
-		static const double dBayer8[8][8] = {
-			{  0.0 / 64.0, 48.0 / 64.0, 12.0 / 64.0, 60.0 / 64.0,  3.0 / 64.0, 51.0 / 64.0, 15.0 / 64.0, 63.0 / 64.0 },
-			{ 32.0 / 64.0, 16.0 / 64.0, 44.0 / 64.0, 28.0 / 64.0, 35.0 / 64.0, 19.0 / 64.0, 47.0 / 64.0, 31.0 / 64.0 },
-			{  8.0 / 64.0, 56.0 / 64.0,  4.0 / 64.0, 52.0 / 64.0, 11.0 / 64.0, 59.0 / 64.0,  7.0 / 64.0, 55.0 / 64.0 },
-			{ 40.0 / 64.0, 24.0 / 64.0, 36.0 / 64.0, 20.0 / 64.0, 43.0 / 64.0, 27.0 / 64.0, 39.0 / 64.0, 23.0 / 64.0 },
-			{  2.0 / 64.0, 50.0 / 64.0, 14.0 / 64.0, 62.0 / 64.0,  1.0 / 64.0, 49.0 / 64.0, 13.0 / 64.0, 61.0 / 64.0 },
-			{ 34.0 / 64.0, 18.0 / 64.0, 46.0 / 64.0, 30.0 / 64.0, 33.0 / 64.0, 17.0 / 64.0, 45.0 / 64.0, 29.0 / 64.0 },
-			{ 10.0 / 64.0, 58.0 / 64.0,  6.0 / 64.0, 54.0 / 64.0,  9.0 / 64.0, 57.0 / 64.0,  5.0 / 64.0, 53.0 / 64.0 },
-			{ 42.0 / 64.0, 26.0 / 64.0, 38.0 / 64.0, 22.0 / 64.0, 41.0 / 64.0, 25.0 / 64.0, 37.0 / 64.0, 21.0 / 64.0 }
-		};
-		CPalette::CColor cWeight( 0.212639005871510, 0.715168678767756, 0.072192315360734, 0.0 );
-		//cWeight = cWeight.Normalize();
-		//const double * pdMatrix = dBayer4;
-		CPalette::CColor cWeights( m_vDitherFactor );
-		for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-			for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-				size_t sIdx = size_t( H * _ui32Width + W );
-
-				if constexpr ( _uDither == SL2_D_BAYER_4X4 ) {
-					double dThresh = (dBayer4[W&3][H&3] - 0.5) * 1.0 / 32.0;
-
-					reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]) = (reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]) + (cWeight * dThresh)).Clamp( 0.0, 1.0 );
-				}
-				else if constexpr ( _uDither == SL2_D_BAYER_8X8 ) {
-					double dThresh = (dBayer8[W&7][H&7] - 0.5) * (1.0 / 32.0);
-
-					reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]) = (reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]) + (cWeight * dThresh)).Clamp( 0.0, 1.0 );
-					/*reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]) = (reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]) + CPalette::CColor(
-						dThresh * 0.212639005871510, dThresh * 0.715168678767756, dThresh * 0.072192315360734, 0.0 )).Clamp( 0.0, 1.0 );*/
-				}
-				else {
-
-					/*CPalette::CColor cTmp = reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]).Clamp( 0.0, 1.0 );
-					SL2_RGBA64F rgbaOld = reinterpret_cast<SL2_RGBA64F &>(cTmp);//_prgbaColors[sIdx];*/
-					SL2_RGBA64F rgbaOld = _prgbaColors[sIdx];
-					constexpr bool bUseAdvanced = false;
-					ispc::ColorLABA clLab;
-					/*if ( reinterpret_cast<CPalette::CColor &>(rgbaOld).Min() < 0.0 || reinterpret_cast<CPalette::CColor &>(rgbaOld).Max() > 1.0 ) {
-						bUseAdvanced = false;
-					}
-				
-					if ( bUseAdvanced ) {
-						ispc::ispc_rgb2lab_single( (*reinterpret_cast<const ispc::ColorRGBA *>(&rgbaOld)), clLab );
-					}*/
-					/*ispc::ColorRGBA crRgba;
-					ispc::ispc_lab2rgb_single( clLab, crRgba );*/
-					//if ( reinterpret_cast<CPalette::CColor &>(rgbaOld).Min() < 0.0 || reinterpret_cast<CPalette::CColor &>(rgbaOld).Max() > 1.0 ) {
-						/*volatile double dDst = CPalette::CColor::EuclideanDistanceSq( reinterpret_cast<CPalette::CColor &>(rgbaOld), reinterpret_cast<CPalette::CColor &>(crRgba) );
-						if ( dDst >= 0.1 ) {
-							return false;
-						}*/
-					//}
-
-					size_t sWinner = _pPalette.Palette().size();
-					double dDist = std::numeric_limits<double>::infinity();
-					for ( auto I = _pPalette.Palette().size(); I--; ) {
-						double dThisDist;
-						if ( bUseAdvanced ) {
-							dThisDist = ispc::ispc_deltaE_CIEDE2000( clLab.l, clLab.a, clLab.b, clLab.alpha,
-								_pclLabPal[I].l, _pclLabPal[I].a, _pclLabPal[I].b, _pclLabPal[I].alpha );
-						}
-						else {
-							dThisDist = CPalette::CColor::EuclideanDistanceSq( reinterpret_cast<CPalette::CColor &>(rgbaOld), _pPalette.Palette()[I] );
-						}
-						/*double dThisDist = ispc::ispc_deltaE_CIEDE2000( clLab.l, clLab.a, clLab.b, clLab.alpha,
-							_pclLabPal[I].l, _pclLabPal[I].a, _pclLabPal[I].b, _pclLabPal[I].alpha );*/
-						if ( dThisDist <= dDist ) {
-							dDist = dThisDist;
-							sWinner = I;
-						}
-					}
-
-					_prgbaColors[sIdx] = (*reinterpret_cast<const SL2_RGBA64F *>(&_pPalette.Palette()[sWinner]));
-					CPalette::CColor cError = reinterpret_cast<CPalette::CColor &>(rgbaOld) - reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx]);
-					cError = cError * cWeights;
-
-					if constexpr ( _uDither == SL2_D_JARVIS_JUDICE_NINKE ) {
-						CPalette::CColor c1 = cError * (1.0 / 48.0);
-						CPalette::CColor c3 = cError * (3.0 / 48.0);
-						CPalette::CColor c5 = cError * (5.0 / 48.0);
-						CPalette::CColor c7 = cError * (7.0 / 48.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c7; }
-						if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2]) += c5; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-2]) += c3; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c5; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c7;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += c5; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+2]) += c3; }
-						}
-
-						if ( H + 2 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width-2]) += c1; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width-1]) += c3; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width]) += c5;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width+1]) += c3; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width+2]) += c1; }
-						}
-					}
-					else if constexpr ( _uDither == SL2_D_STUCKI ) {
-						CPalette::CColor c1 = cError * (1.0 / 42.0);
-						CPalette::CColor c2 = cError * (2.0 / 42.0);
-						CPalette::CColor c4 = cError * (4.0 / 42.0);
-						CPalette::CColor c8 = cError * (8.0 / 42.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c8; }
-						if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2]) += c4; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-2]) += c2; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c4; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c8;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += c4; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+2]) += c2; }
-						}
-
-						if ( H + 2 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width-2]) += c1; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width-1]) += c2; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width]) += c4;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width+1]) += c2; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width+2]) += c1; }
-						}
-					}
-					else if constexpr ( _uDither == SL2_D_BURKES ) {
-						CPalette::CColor c1 = cError * (1.0 / 32.0);
-						CPalette::CColor c2 = cError * (2.0 / 32.0);
-						CPalette::CColor c4 = cError * (4.0 / 32.0);
-						CPalette::CColor c8 = cError * (8.0 / 32.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c8; }
-						if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2]) += c4; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-2]) += c2; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c4; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c8;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += c4; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+2]) += c2; }
-						}
-					}
-					else if constexpr ( _uDither == SL2_D_SIERRA ) {
-						CPalette::CColor c2 = cError * (2.0 / 32.0);
-						CPalette::CColor c3 = cError * (3.0 / 32.0);
-						CPalette::CColor c4 = cError * (4.0 / 32.0);
-						CPalette::CColor c5 = cError * (5.0 / 32.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c5; }
-						if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2]) += c3; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-2]) += c2; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c4; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c5;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += c4; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+2]) += c2; }
-						}
-
-						if ( H + 2 < _ui32Height ) {
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width-1]) += c2; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width]) += c3;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width+1]) += c2; }
-						}
-					}
-					else if constexpr ( _uDither == SL2_D_SIERRA_2 ) {
-						CPalette::CColor c1 = cError * (1.0 / 16.0);
-						CPalette::CColor c2 = cError * (2.0 / 16.0);
-						CPalette::CColor c3 = cError * (3.0 / 16.0);
-						CPalette::CColor c4 = cError * (4.0 / 16.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c4; }
-						if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2]) += c3; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 1 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-2]) += c1; }
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c2; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c3;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += c2; }
-							if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+2]) += c1; }
-						}
-					}
-					else if constexpr ( _uDither == SL2_D_SIERRA_LITE ) {
-						CPalette::CColor c1 = cError * (1.0 / 4.0);
-						CPalette::CColor c2 = cError * (2.0 / 4.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c2; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c1; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c1;
-						}
-					}
-					else if constexpr ( _uDither == SL2_D_ATKINSON ) {
-						CPalette::CColor c1 = cError * (1.0 / 8.0);
-						if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += c1; }
-						if ( W + 2 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2]) += c1; }
-
-						if ( H + 1 < _ui32Height ) {
-							if ( W > 0 ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += c1; }
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += c1;
-							if ( W + 1 < _ui32Width ) { reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += c1; }
-						}
-
-						if ( H + 2 < _ui32Height ) {
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+2*_ui32Width]) += c1;
-						}
-					}
-
-					else if constexpr ( _uDither == SL2_D_FLOYD_STEINBERG ) {
-						if ( W + 1 < _ui32Width ) {
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+1]) += (cError * (7.0 / 16.0));				// Right pixel
-						}
-						if ( W > 0 && H + 1 < _ui32Height ) {
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width-1]) += (cError * (3.0 / 16.0));	// Bottom-left pixel
-						}
-						if ( H + 1 < _ui32Height ) {
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width]) += (cError * (5.0 / 16.0));		// Bottom pixel
-						}
-						if ( W + 1 < _ui32Width && H + 1 < _ui32Height ) {
-							reinterpret_cast<CPalette::CColor &>(_prgbaColors[sIdx+_ui32Width+1]) += (cError * (1.0 / 16.0));	// Bottom-right pixel
-						}
-					}
-				}
+		if constexpr ( _uDither == SL2_D_BAYER_4X4 || _uDither == SL2_D_BAYER_8X8 || _uDither == SL2_D_BAYER_16X16 || _uDither == SL2_D_BLUE_NOISE ) {
+			// Ordered kernels.  Thresholds are weighted by luminance.
+			const double * pdMap = nullptr;
+			uint32_t ui32Size = 0;
+			if constexpr ( _uDither == SL2_D_BAYER_4X4 ) {
+				pdMap = CDither::Bayer4x4();
+				ui32Size = 4;
 			}
+			else if constexpr ( _uDither == SL2_D_BAYER_8X8 ) {
+				pdMap = CDither::Bayer8x8();
+				ui32Size = 8;
+			}
+			else if constexpr ( _uDither == SL2_D_BAYER_16X16 ) {
+				pdMap = CDither::Bayer16x16();
+				ui32Size = 16;
+			}
+			else {
+				pdMap = CDither::BlueNoise();
+				ui32Size = SL2_BLUE_NOISE_SIZE;
+			}
+			CPalette::CColor cWeight( 0.212639005871510, 0.715168678767756, 0.072192315360734, 0.0 );
+			return CPalette::OrderedDither( _prgbaColors, _ui32Width, _ui32Height, _pPalette.Palette(), pdMap, ui32Size, cWeight );
+		}
+		else {
+			// Error-diffusion kernels.  Each tap gives a fraction of a texel's error to the texel i32X across and i32Y down.
+			const CPalette::SL2_DIFFUSION_TAP * pdtTaps = nullptr;
+			size_t sTaps = 0;
+			if constexpr ( _uDither == SL2_D_JARVIS_JUDICE_NINKE ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 7.0 / 48.0 }, { 2, 0, 5.0 / 48.0 },
+					{ -2, 1, 3.0 / 48.0 }, { -1, 1, 5.0 / 48.0 }, { 0, 1, 7.0 / 48.0 }, { 1, 1, 5.0 / 48.0 }, { 2, 1, 3.0 / 48.0 },
+					{ -2, 2, 1.0 / 48.0 }, { -1, 2, 3.0 / 48.0 }, { 0, 2, 5.0 / 48.0 }, { 1, 2, 3.0 / 48.0 }, { 2, 2, 1.0 / 48.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else if constexpr ( _uDither == SL2_D_STUCKI ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 8.0 / 42.0 }, { 2, 0, 4.0 / 42.0 },
+					{ -2, 1, 2.0 / 42.0 }, { -1, 1, 4.0 / 42.0 }, { 0, 1, 8.0 / 42.0 }, { 1, 1, 4.0 / 42.0 }, { 2, 1, 2.0 / 42.0 },
+					{ -2, 2, 1.0 / 42.0 }, { -1, 2, 2.0 / 42.0 }, { 0, 2, 4.0 / 42.0 }, { 1, 2, 2.0 / 42.0 }, { 2, 2, 1.0 / 42.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else if constexpr ( _uDither == SL2_D_BURKES ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 8.0 / 32.0 }, { 2, 0, 4.0 / 32.0 },
+					{ -2, 1, 2.0 / 32.0 }, { -1, 1, 4.0 / 32.0 }, { 0, 1, 8.0 / 32.0 }, { 1, 1, 4.0 / 32.0 }, { 2, 1, 2.0 / 32.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else if constexpr ( _uDither == SL2_D_SIERRA ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 5.0 / 32.0 }, { 2, 0, 3.0 / 32.0 },
+					{ -2, 1, 2.0 / 32.0 }, { -1, 1, 4.0 / 32.0 }, { 0, 1, 5.0 / 32.0 }, { 1, 1, 4.0 / 32.0 }, { 2, 1, 2.0 / 32.0 },
+					{ -1, 2, 2.0 / 32.0 }, { 0, 2, 3.0 / 32.0 }, { 1, 2, 2.0 / 32.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else if constexpr ( _uDither == SL2_D_SIERRA_2 ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 4.0 / 16.0 }, { 2, 0, 3.0 / 16.0 },
+					{ -2, 1, 1.0 / 16.0 }, { -1, 1, 2.0 / 16.0 }, { 0, 1, 3.0 / 16.0 }, { 1, 1, 2.0 / 16.0 }, { 2, 1, 1.0 / 16.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else if constexpr ( _uDither == SL2_D_SIERRA_LITE ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 2.0 / 4.0 },
+					{ -1, 1, 1.0 / 4.0 }, { 0, 1, 1.0 / 4.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else if constexpr ( _uDither == SL2_D_ATKINSON ) {
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 1.0 / 8.0 }, { 2, 0, 1.0 / 8.0 },
+					{ -1, 1, 1.0 / 8.0 }, { 0, 1, 1.0 / 8.0 }, { 1, 1, 1.0 / 8.0 },
+					{ 0, 2, 1.0 / 8.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			else {
+				// Floyd-Steinberg.
+				static const CPalette::SL2_DIFFUSION_TAP dtTaps[] = {
+					{ 1, 0, 7.0 / 16.0 },
+					{ -1, 1, 3.0 / 16.0 }, { 0, 1, 5.0 / 16.0 }, { 1, 1, 1.0 / 16.0 },
+				};
+				pdtTaps = dtTaps;
+				sTaps = std::size( dtTaps );
+			}
+			return CPalette::DiffuseError( _prgbaColors, _ui32Width, _ui32Height, _pPalette.Palette(), pdtTaps, sTaps, CPalette::CColor( m_vDitherFactor ) );
 		}
-		return true;
 	}
 
 	/**
@@ -3269,24 +3198,37 @@ namespace sl2 {
 		const SL2_KTX_INTERNAL_FORMAT_DATA * pkifdData = reinterpret_cast< const SL2_KTX_INTERNAL_FORMAT_DATA *>(_pvParms);
 		if ( !pkifdData->pvCustom ) { return false; }
 		CImage * piImage = reinterpret_cast<CImage *>(pkifdData->pvCustom);
-		std::vector<ispc::ColorLABA> vLabBuffer, vPalette;
+		std::vector<ispc::ColorLABA> vPalette;
 		std::vector<CFormat::SL2_RGBA64F, CAlignmentAllocator<CFormat::SL2_RGBA64F, 64>> vQuant;
 
 		if ( uint32_t( _ui32Width * _ui32Height ) != (uint64_t( _ui32Width ) * _ui32Height) ) { return false; }
 		bool bDither = true;
 		try {
-			vLabBuffer.resize( size_t( size_t( _ui32Width ) * _ui32Height ) );
 			vPalette.resize( piImage->Palette().Palette().size() );
 
 			if ( bDither ) {
 				vQuant.resize( size_t( size_t( _ui32Width ) * _ui32Height ) );
 			}
 		}
-		catch ( ... ) { false; }
+		catch ( ... ) { return false; }
 
 		_tType * ptDst = reinterpret_cast<_tType *>(_pui8Dst);
 		const SL2_RGBA64F * prgbaSrc = reinterpret_cast<const SL2_RGBA64F *>(_pui8Src);
 		constexpr uint32_t ui32Mask = (1 << _uBits) - 1;
+		// Entries past the index range would alias lower ones.
+		uint32_t ui32PalSize = uint32_t( std::min<size_t>( vPalette.size(), size_t( ui32Mask ) + 1 ) );
+
+		// A selected metric matches through the same search the dithers use.  CIEDE2000 is what the ISPC search measures, so it
+		//	keeps the ISPC path.
+		CPalette::SL2_NEAREST nNearest;
+		bool bNearest = m_cdColorDistance != SL2_CD_DEFAULT && m_cdColorDistance != SL2_CD_CIEDE2000;
+		if ( bNearest ) {
+			try {
+				CPalette::CPal pIndexable( piImage->Palette().Palette().begin(), piImage->Palette().Palette().begin() + ui32PalSize );
+				if ( !pIndexable.size() || !CPalette::BuildNearest( pIndexable, nNearest, m_cdColorDistance ) ) { return false; }
+			}
+			catch ( ... ) { return false; }
+		}
 
 		ispc::ispc_rgb2lab( reinterpret_cast<const ispc::ColorRGBA *>(piImage->Palette().Palette().data()), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()), piImage->Palette().Palette().size() );
 		for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
@@ -3295,89 +3237,80 @@ namespace sl2 {
 			if ( bDither ) {
 				// Copy to dithered RGB.
 				std::memcpy( vQuant.data(), prgbaSrc, vQuant.size() * sizeof( CFormat::SL2_RGBA64F ) );
+				bool bDithered = true;
 				switch ( m_dDither ) {
 					case SL2_D_ATKINSON : {
-						Dither<SL2_D_ATKINSON>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_ATKINSON>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_SIERRA_LITE : {
-						Dither<SL2_D_SIERRA_LITE>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_SIERRA_LITE>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_SIERRA_2 : {
-						Dither<SL2_D_SIERRA_2>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_SIERRA_2>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_SIERRA : {
-						Dither<SL2_D_SIERRA>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_SIERRA>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_BURKES : {
-						Dither<SL2_D_BURKES>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_BURKES>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_STUCKI : {
-						Dither<SL2_D_STUCKI>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_STUCKI>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_JARVIS_JUDICE_NINKE : {
-						Dither<SL2_D_JARVIS_JUDICE_NINKE>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_JARVIS_JUDICE_NINKE>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_FLOYD_STEINBERG : {
-						Dither<SL2_D_FLOYD_STEINBERG>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_FLOYD_STEINBERG>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 
 					case SL2_D_BAYER_4X4 : {
-						Dither<SL2_D_BAYER_4X4>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_BAYER_4X4>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 					case SL2_D_BAYER_8X8 : {
-						Dither<SL2_D_BAYER_8X8>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						bDithered = Dither<SL2_D_BAYER_8X8>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						break;
+					}
+					case SL2_D_BAYER_16X16 : {
+						bDithered = Dither<SL2_D_BAYER_16X16>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
+						break;
+					}
+					case SL2_D_BLUE_NOISE : {
+						bDithered = Dither<SL2_D_BLUE_NOISE>( vQuant.data(), _ui32Width, _ui32Height, piImage->Palette(), reinterpret_cast<ispc::ColorLABA *>(vPalette.data()) );
 						break;
 					}
 				}
+				// A kernel that could not run (no blue-noise map, no memory) would otherwise leave the texels undithered.
+				if ( !bDithered ) { return false; }
 				prgbaUseMe = vQuant.data();
 			}
 
-			// Convert this slice to LAB.
-			ispc::ispc_rgb2lab( reinterpret_cast<const ispc::ColorRGBA *>(prgbaUseMe), reinterpret_cast<ispc::ColorLABA *>(vLabBuffer.data()), uint64_t( _ui32Width ) * _ui32Height );
-			
+			// Each thread converts its own rows to LAB as it matches them, so no LAB copy of the slice is made.
 			bool bRet = true;
-			//CPalette::IndexedFromRgba64F_Thread<_tType, _uBits>( ptDst, 0, _ui32Height, _ui32Width, vLabBuffer, vPalette, piImage->Palette().Palette(), bRet );
-			size_t sNumThreads = std::thread::hardware_concurrency();  // Get number of cores
-			std::vector<std::thread> vThreads;
+			size_t sNumThreads = CParallelFor::Workers( std::max<uint32_t>( _ui32Height, 1 ) );
 			size_t sRowsPerThread = _ui32Height / sNumThreads;
-
-			for ( size_t T = 0; T < sNumThreads; ++T ) {
-				size_t sStart = T * sRowsPerThread;
-				size_t sEnd = (T == sNumThreads - 1) ? _ui32Height : (T + 1) * sRowsPerThread;
-				vThreads.push_back( std::thread( (&CPalette::IndexedFromRgba64F_Thread<_tType, _uBits>), ptDst, uint32_t( sStart ), uint32_t( sEnd ), _ui32Width, vLabBuffer, vPalette, piImage->Palette().Palette(), T, std::ref( bRet ) ) );  // Pass core ID
-			}
-
-			for ( auto & tThis : vThreads ) {
-				tThis.join();
-			}
-			if ( !bRet ) { return false; }
-			
-			/*for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-				for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-					size_t sIdx = size_t( H * _ui32Width + W );
-					size_t sWinner = piImage->Palette().Palette().size();
-					double dDist = std::numeric_limits<double>::infinity();
-					for ( auto I = piImage->Palette().Palette().size(); I--; ) {
-						double dThisDist = ispc::ispc_deltaE_CIEDE2000( vLabBuffer[sIdx].l, vLabBuffer[sIdx].a, vLabBuffer[sIdx].b, vLabBuffer[sIdx].alpha,
-							vPalette[I&ui32Mask].l, vPalette[I&ui32Mask].a, vPalette[I&ui32Mask].b, vPalette[I&ui32Mask].alpha );
-						if ( dThisDist <= dDist ) {
-							dDist = dThisDist;
-							sWinner = I & ui32Mask;
-						}
-					}
-					if ( sWinner == piImage->Palette().Palette().size() ) { return false; }
-					ptDst[sIdx] = _tType( sWinner );
+			CParallelFor::Run( sNumThreads, [&]( size_t _sWorker ) {
+				uint32_t ui32Start = uint32_t( _sWorker * sRowsPerThread );
+				uint32_t ui32End = (_sWorker == sNumThreads - 1) ? _ui32Height : uint32_t( (_sWorker + 1) * sRowsPerThread );
+				if ( bNearest ) {
+					CPalette::IndexedFromRgba64F_NearestThread<_tType>( ptDst, ui32Start, ui32End, _ui32Width, prgbaUseMe, &nNearest );
 				}
-			}*/
+				else {
+					// Workers can run on the calling thread or share cores with other loops, so they are not pinned.
+					CPalette::IndexedFromRgba64F_Thread<_tType>( ptDst, ui32Start, ui32End, _ui32Width,
+						reinterpret_cast<const ispc::ColorRGBA *>(prgbaUseMe), vPalette.data(), ui32PalSize, ~size_t( 0 ), bRet );
+				}
+			} );
+			if ( !bRet ) { return false; }
 
 			ptDst += _ui32Width * _ui32Height;
 			prgbaSrc += _ui32Width * _ui32Height;
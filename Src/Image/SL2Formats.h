@@ -22,7 +22,9 @@
 #include "ISPC/cielab_ispc.h"
 #include "ISPC/ispc_texcomp.h"
 #include "PVRTexTool/PVRTexLib.hpp"
+#include "SL2ColorDistance.h"
 #include "SL2Dither.h"
+#include "SL2Yuv.h"
 #include "Squish/squish.h"
 
 #include <atomic>
@@ -1846,6 +1848,14 @@ namespace sl2 {
 		 **/
 		static uint64_t SL2_FASTCALL												GetRowSize_NoPadding( const SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, uint32_t _ui32RowLen );
 
+		/**
+		 * Gets the size of a glType as stored in the glTypeSize field of a KTX 1 file.  Packed types are the size of a whole texel.
+		 * 
+		 * \param _ktType The type.
+		 * \return Returns the size of the type in bytes, or 0 if KTX 1 files can't store the type.
+		 **/
+		static uint32_t 															KtxTypeSize( SL2_KTX_TYPE _ktType );
+
 		/**
 		 * Gets the width of a row of texels in bytes.
 		 *
@@ -2357,13 +2367,16 @@ namespace sl2 {
 			size_t _sM = 8, uint32_t _ui32BlackLevel = 0, uint32_t _ui32S = 255 );
 
 		/**
-		 * Applies Floyd-Steinberg Dithering to a given color buffer.
+		 * Applies dithering to a given color buffer.  Ordered kernels run through CPalette::OrderedDither(), which splits rows
+		 *	across threads.  Error-diffusion kernels run through CPalette::DiffuseError(), which spreads rows across threads and
+		 *	matches a serial pass exactly.  Either way each texel is left snapped to a palette entry.
 		 * 
 		 * \param _prgbaColors The in/out color buffer.
 		 * \param _ui32Width The width of the image.
 		 * \param _ui32Height The height of the image.
 		 * \param _pPalette The palette.
 		 * \param _pclLabPal The palette in LAB.
+		 * \return Returns false if the kernel could not be run, for example when the blue-noise map could not be created.
 		 **/
 		template <unsigned _uDither>
 		static bool																	Dither( SL2_RGBA64F * _prgbaColors, uint32_t _ui32Width, uint32_t _ui32Height, const class CPalette &_pPalette, const ispc::ColorLABA * _pclLabPal );
@@ -2409,6 +2422,18 @@ namespace sl2 {
 		/** K-Means iteration count. */
 		static size_t																m_skMeansIterations;
 
+		/** K-Means seed. */
+		static uint64_t																m_ui64kMeansSeed;
+
+		/** Palette generator. */
+		static SL2_PALETTE_METHOD													m_pmPaletteMethod;
+
+		/** K-Means refinement iterations run after a non-K-Means palette generator. */
+		static size_t																m_sPaletteRefineIterations;
+
+		/** Color-distance metric used for palette generation, dithering, and index mapping. */
+		static SL2_COLOR_DISTANCE													m_cdColorDistance;
+
 	protected :
 		// == Types.
 		/** A block of texels for DDS encoding. */
@@ -4043,26 +4068,36 @@ namespace sl2 {
 			}
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( (1.0 / ui16Mask) * 0xFFFFFFFFU );
+			constexpr double dNormalize = 1.0 / ui16Mask;
+			std::vector<double> vRowY, vRowU, vRowV;
+			try {
+				vRowY.resize( _ui32Width );
+				vRowU.resize( _ui32Width );
+				vRowV.resize( _ui32Width );
+			}
+			catch ( ... ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				// Normalize the Y values.
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							vRowY[W] = prgbapui16Yuv[sIdx+W] * dNormalize;
+							vRowU[W] = prgbapui16Yuv[sIdx+W+ui64OffU] * dNormalize;
+							vRowV[W] = prgbapui16Yuv[sIdx+W+ui64OffV] * dNormalize;
+						}
+						CYuv::YuvToRgbRow( vRowY.data(), vRowU.data(), vRowV.data(), prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( prgbapui16Yuv[sIdx] * dMuliplier ) ),
 								uint32_t( std::round( prgbapui16Yuv[sIdx+ui64OffU] * dMuliplier ) ), uint32_t( std::round( prgbapui16Yuv[sIdx+ui64OffV] * dMuliplier ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( prgbapui16Yuv[sIdx] * dMuliplier ) ),
-								uint32_t( std::round( prgbapui16Yuv[sIdx+ui64OffU] * dMuliplier ) ),
-								uint32_t( std::round( prgbapui16Yuv[sIdx+ui64OffV] * dMuliplier ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 				prgba64Rgba += _ui32Width * _ui32Height * 3;
@@ -4092,29 +4127,38 @@ namespace sl2 {
 			}
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( (1.0 / 0xFFFFFFFFU) * ui16Mask );
+			std::vector<double> vRowY, vRowU, vRowV;
+			try {
+				vRowY.resize( _ui32Width );
+				vRowU.resize( _ui32Width );
+				vRowV.resize( _ui32Width );
+			}
+			catch ( ... ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				// Normalize the Y values.
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, vRowY.data(), vRowU.data(), vRowV.data(), _ui32Width, ymMatrix );
+						// Truncated from the 32-bit samples as below.
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							prgbapui16Yuv[sIdx+W] = _tType( std::round( vRowY[W] * 0xFFFFFFFFU ) * dMuliplier );
+							prgbapui16Yuv[sIdx+W+ui64OffU] = _tType( std::round( vRowU[W] * 0xFFFFFFFFU ) * dMuliplier );
+							prgbapui16Yuv[sIdx+W+ui64OffV] = _tType( std::round( vRowV[W] * 0xFFFFFFFFU ) * dMuliplier );
+						}
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							prgbapui16Yuv[sIdx] = _tType( ui32Y * dMuliplier );
+							prgbapui16Yuv[sIdx+ui64OffU] = _tType( ui32U * dMuliplier );
+							prgbapui16Yuv[sIdx+ui64OffV] = _tType( ui32V * dMuliplier );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgbapui16Yuv[sIdx] = _tType( ui32Y * dMuliplier );
-						prgbapui16Yuv[sIdx+ui64OffU] = _tType( ui32U * dMuliplier );
-						prgbapui16Yuv[sIdx+ui64OffV] = _tType( ui32V * dMuliplier );
-						/*YuvToRgb<uint32_t>( uint32_t( std::round( prgbapui16Yuv[sIdx] * dMuliplier ) ),
-							uint32_t( std::round( prgbapui16Yuv[sIdx+ui64OffU] * dMuliplier ) ), uint32_t( std::round( prgbapui16Yuv[sIdx+ui64OffV] * dMuliplier ) ),
-							prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;*/
 					}
 				}
 				prgba64Rgba += _ui32Width * _ui32Height * 3;
@@ -4143,28 +4187,39 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = (1.0 / ui16Mask);
+			std::vector<double> vRowY, vRowU, vRowV;
+			try {
+				vRowY.resize( _ui32Width );
+				vRowU.resize( _ui32Width );
+				vRowV.resize( _ui32Width );
+			}
+			catch ( ... ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				uint64_t ui64Off = _ui32Height * _ui32Width;
 
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							vRowY[W] = prgbapui16Yuv[H*_ui32Width+W] * dMuliplier;
+							vRowU[W] = prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] * dMuliplier;
+							vRowV[W] = prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] * dMuliplier;
+						}
+						CYuv::YuvToRgbRow( vRowY.data(), vRowU.data(), vRowV.data(), prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( prgbapui16Yuv[H*_ui32Width+W] * dMuliplier * 0xFFFFFFFFU ) ),
 								uint32_t( std::round( prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] * dMuliplier * 0xFFFFFFFFU ) ),
 								uint32_t( std::round( prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] * dMuliplier * 0xFFFFFFFFU ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( prgbapui16Yuv[H*_ui32Width+W] * dMuliplier * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] * dMuliplier * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] * dMuliplier * 0xFFFFFFFFU ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 
@@ -4194,41 +4249,35 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( ui16Mask );
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledDown;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( _ui32Width * _ui32Height );
 				vConvertedVSrc.resize( _ui32Width * _ui32Height );
-				vScaledDown.resize( ui32ChromaW * ui32ChromaH );
 			}
 			catch ( ... ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, &vConvertedYSrc[sIdx], &vConvertedUSrc[sIdx], &vConvertedVSrc[sIdx], _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
+							vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
+							vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 					}
 				}
 				// Copy the Y values.
@@ -4274,22 +4323,23 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = (1.0 / ui16Mask);
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledUp;
+			std::vector<double> vScaledUpU;
+			std::vector<double> vScaledUpV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( ui32ChromaW * ui32ChromaH );
 				vConvertedVSrc.resize( ui32ChromaW * ui32ChromaH );
-				vScaledUp.resize( _ui32Width * _ui32Height );
+				vScaledUpU.resize( _ui32Width * _ui32Height );
+				vScaledUpV.resize( _ui32Width * _ui32Height );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( ui32ChromaW, ui32ChromaH, _ui32Width, _ui32Height ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				// Normalize the Y values.
@@ -4310,37 +4360,24 @@ namespace sl2 {
 						vConvertedVSrc[H*ui32ChromaW+W] = prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off2] * dMuliplier;
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = ui32ChromaW;
-				rResample.ui32H = ui32ChromaH;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = _ui32Width;
-				rResample.ui32NewH = _ui32Height;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledUp[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledUp[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledUpU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledUpV.data() );
 
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::YuvToRgbRow( &vConvertedYSrc[sIdx], &vScaledUpU[sIdx], &vScaledUpV[sIdx], prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
+								uint32_t( std::round( vScaledUpU[sIdx] * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUpV[sIdx] * 0xFFFFFFFFU ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 
@@ -4370,55 +4407,46 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( ui16Mask );
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledDown;
+			std::vector<double> vScaledDownU;
+			std::vector<double> vScaledDownV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( _ui32Width * _ui32Height );
 				vConvertedVSrc.resize( _ui32Width * _ui32Height );
-				vScaledDown.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownU.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownV.resize( ui32ChromaW * ui32ChromaH );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( _ui32Width, _ui32Height, ui32ChromaW, ui32ChromaH ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, &vConvertedYSrc[sIdx], &vConvertedUSrc[sIdx], &vConvertedVSrc[sIdx], _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
+							vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
+							vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = _ui32Width;
-				rResample.ui32H = _ui32Height;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = ui32ChromaW;
-				rResample.ui32NewH = ui32ChromaH;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledDown[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledDown[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledDownU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledDownV.data() );
 
 				// Copy the Y values.
 				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
@@ -4436,8 +4464,8 @@ namespace sl2 {
 				// Normalize the U and V values.
 				for ( uint32_t H = 0; H < ui32ChromaH; ++H ) {
 					for ( uint32_t W = 0; W < ui32ChromaW; ++W ) {
-						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dU * dMuliplier ) );
-						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off2] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dV * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off] = _tType( std::round( vScaledDownU[H*ui32ChromaW+W] * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off2] = _tType( std::round( vScaledDownV[H*ui32ChromaW+W] * dMuliplier ) );
 					}
 				}
 
@@ -4467,22 +4495,23 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = (1.0 / ui16Mask);
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledUp;
+			std::vector<double> vScaledUpU;
+			std::vector<double> vScaledUpV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( ui32ChromaW * ui32ChromaH );
 				vConvertedVSrc.resize( ui32ChromaW * ui32ChromaH );
-				vScaledUp.resize( _ui32Width * _ui32Height );
+				vScaledUpU.resize( _ui32Width * _ui32Height );
+				vScaledUpV.resize( _ui32Width * _ui32Height );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( ui32ChromaW, ui32ChromaH, _ui32Width, _ui32Height ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				// Normalize the Y values.
@@ -4499,37 +4528,24 @@ namespace sl2 {
 						vConvertedVSrc[H*ui32ChromaW+W] = prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] * dMuliplier;
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = ui32ChromaW;
-				rResample.ui32H = ui32ChromaH;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = _ui32Width;
-				rResample.ui32NewH = _ui32Height;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledUp[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledUp[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledUpU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledUpV.data() );
 
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::YuvToRgbRow( &vConvertedYSrc[sIdx], &vScaledUpU[sIdx], &vScaledUpV[sIdx], prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
+								uint32_t( std::round( vScaledUpU[sIdx] * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUpV[sIdx] * 0xFFFFFFFFU ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 
@@ -4559,61 +4575,46 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( ui16Mask );
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledDown;
+			std::vector<double> vScaledDownU;
+			std::vector<double> vScaledDownV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( _ui32Width * _ui32Height );
 				vConvertedVSrc.resize( _ui32Width * _ui32Height );
-				vScaledDown.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownU.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownV.resize( ui32ChromaW * ui32ChromaH );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( _ui32Width, _ui32Height, ui32ChromaW, ui32ChromaH ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, &vConvertedYSrc[sIdx], &vConvertedUSrc[sIdx], &vConvertedVSrc[sIdx], _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
+							vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
+							vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
-						/*RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-							ui32Y, ui32U, ui32V );
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );*/
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = _ui32Width;
-				rResample.ui32H = _ui32Height;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = ui32ChromaW;
-				rResample.ui32NewH = ui32ChromaH;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledDown[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledDown[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledDownU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledDownV.data() );
 
 				// Copy the Y values.
 				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
@@ -4627,8 +4628,8 @@ namespace sl2 {
 				// Normalize the U and V values.
 				for ( uint32_t H = 0; H < ui32ChromaH; ++H ) {
 					for ( uint32_t W = 0; W < ui32ChromaW; ++W ) {
-						prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dU * dMuliplier ) );
-						prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dV * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] = _tType( std::round( vScaledDownU[H*ui32ChromaW+W] * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] = _tType( std::round( vScaledDownV[H*ui32ChromaW+W] * dMuliplier ) );
 					}
 				}
 
@@ -4658,22 +4659,23 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = (1.0 / ui16Mask);
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledUp;
+			std::vector<double> vScaledUpU;
+			std::vector<double> vScaledUpV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( ui32ChromaW * ui32ChromaH );
 				vConvertedVSrc.resize( ui32ChromaW * ui32ChromaH );
-				vScaledUp.resize( _ui32Width * _ui32Height );
+				vScaledUpU.resize( _ui32Width * _ui32Height );
+				vScaledUpV.resize( _ui32Width * _ui32Height );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( ui32ChromaW, ui32ChromaH, _ui32Width, _ui32Height ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				// Normalize the Y values.
@@ -4694,37 +4696,24 @@ namespace sl2 {
 						vConvertedVSrc[H*ui32ChromaW+W] = prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off2] * dMuliplier;
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = ui32ChromaW;
-				rResample.ui32H = ui32ChromaH;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = _ui32Width;
-				rResample.ui32NewH = _ui32Height;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledUp[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledUp[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledUpU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledUpV.data() );
 
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::YuvToRgbRow( &vConvertedYSrc[sIdx], &vScaledUpU[sIdx], &vScaledUpV[sIdx], prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
+								uint32_t( std::round( vScaledUpU[sIdx] * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUpV[sIdx] * 0xFFFFFFFFU ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 
@@ -4754,55 +4743,46 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( ui16Mask );
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledDown;
+			std::vector<double> vScaledDownU;
+			std::vector<double> vScaledDownV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( _ui32Width * _ui32Height );
 				vConvertedVSrc.resize( _ui32Width * _ui32Height );
-				vScaledDown.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownU.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownV.resize( ui32ChromaW * ui32ChromaH );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( _ui32Width, _ui32Height, ui32ChromaW, ui32ChromaH ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, &vConvertedYSrc[sIdx], &vConvertedUSrc[sIdx], &vConvertedVSrc[sIdx], _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
+							vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
+							vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = _ui32Width;
-				rResample.ui32H = _ui32Height;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = ui32ChromaW;
-				rResample.ui32NewH = ui32ChromaH;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledDown[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledDown[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledDownU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledDownV.data() );
 
 				// Copy the Y values.
 				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
@@ -4820,8 +4800,8 @@ namespace sl2 {
 				// Normalize the U and V values.
 				for ( uint32_t H = 0; H < ui32ChromaH; ++H ) {
 					for ( uint32_t W = 0; W < ui32ChromaW; ++W ) {
-						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dU * dMuliplier ) );
-						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off2] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dV * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off] = _tType( std::round( vScaledDownU[H*ui32ChromaW+W] * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W))+ui64Off2] = _tType( std::round( vScaledDownV[H*ui32ChromaW+W] * dMuliplier ) );
 					}
 				}
 
@@ -4851,22 +4831,23 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = (1.0 / ui16Mask);
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledUp;
+			std::vector<double> vScaledUpU;
+			std::vector<double> vScaledUpV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( ui32ChromaW * ui32ChromaH );
 				vConvertedVSrc.resize( ui32ChromaW * ui32ChromaH );
-				vScaledUp.resize( _ui32Width * _ui32Height );
+				vScaledUpU.resize( _ui32Width * _ui32Height );
+				vScaledUpV.resize( _ui32Width * _ui32Height );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( ui32ChromaW, ui32ChromaH, _ui32Width, _ui32Height ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				// Normalize the Y values.
@@ -4883,37 +4864,24 @@ namespace sl2 {
 						vConvertedVSrc[H*ui32ChromaW+W] = prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] * dMuliplier;
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = ui32ChromaW;
-				rResample.ui32H = ui32ChromaH;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = _ui32Width;
-				rResample.ui32NewH = _ui32Height;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledUp[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledUp[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledUpU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledUpV.data() );
 
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::YuvToRgbRow( &vConvertedYSrc[sIdx], &vScaledUpU[sIdx], &vScaledUpV[sIdx], prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
+								uint32_t( std::round( vScaledUpU[sIdx] * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUpV[sIdx] * 0xFFFFFFFFU ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 
@@ -4943,55 +4911,46 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( ui16Mask );
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledDown;
+			std::vector<double> vScaledDownU;
+			std::vector<double> vScaledDownV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( _ui32Width * _ui32Height );
 				vConvertedVSrc.resize( _ui32Width * _ui32Height );
-				vScaledDown.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownU.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownV.resize( ui32ChromaW * ui32ChromaH );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( _ui32Width, _ui32Height, ui32ChromaW, ui32ChromaH ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, &vConvertedYSrc[sIdx], &vConvertedUSrc[sIdx], &vConvertedVSrc[sIdx], _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
+							vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
+							vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = _ui32Width;
-				rResample.ui32H = _ui32Height;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = ui32ChromaW;
-				rResample.ui32NewH = ui32ChromaH;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledDown[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledDown[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledDownU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledDownV.data() );
 
 				// Copy the Y values.
 				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
@@ -5005,8 +4964,8 @@ namespace sl2 {
 				// Normalize the U and V values.
 				for ( uint32_t H = 0; H < ui32ChromaH; ++H ) {
 					for ( uint32_t W = 0; W < ui32ChromaW; ++W ) {
-						prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dU * dMuliplier ) );
-						prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dV * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W)*2+_bSwapUv)+ui64Off] = _tType( std::round( vScaledDownU[H*ui32ChromaW+W] * dMuliplier ) );
+						prgbapui16Yuv[((H*ui32ChromaW+W)*2+!_bSwapUv)+ui64Off] = _tType( std::round( vScaledDownV[H*ui32ChromaW+W] * dMuliplier ) );
 					}
 				}
 
@@ -5037,22 +4996,23 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = (1.0 / ui16Mask);
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledUp;
+			std::vector<double> vScaledUpU;
+			std::vector<double> vScaledUpV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( ui32ChromaW * ui32ChromaH );
 				vConvertedVSrc.resize( ui32ChromaW * ui32ChromaH );
-				vScaledUp.resize( _ui32Width * _ui32Height );
+				vScaledUpU.resize( _ui32Width * _ui32Height );
+				vScaledUpV.resize( _ui32Width * _ui32Height );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( ui32ChromaW, ui32ChromaH, _ui32Width, _ui32Height ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				// Normalize the Y values.
@@ -5068,37 +5028,24 @@ namespace sl2 {
 						vConvertedVSrc[H*ui32ChromaW+W] = prgbapui16Yuv[H*ui64Stride+W*4+_uV] * dMuliplier;
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = ui32ChromaW;
-				rResample.ui32H = ui32ChromaH;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = _ui32Width;
-				rResample.ui32NewH = _ui32Height;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledUp[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledUp[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledUpU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledUpV.data() );
 
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::YuvToRgbRow( &vConvertedYSrc[sIdx], &vScaledUpU[sIdx], &vScaledUpV[sIdx], prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
+								uint32_t( std::round( vScaledUpU[sIdx] * 0xFFFFFFFFU ) ), uint32_t( std::round( vScaledUpV[sIdx] * 0xFFFFFFFFU ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( vConvertedYSrc[sIdx] * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dU * 0xFFFFFFFFU ) ),
-								uint32_t( std::round( vScaledUp[sIdx].dV * 0xFFFFFFFFU ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = 1.0;
 					}
 				}
 
@@ -5129,56 +5076,46 @@ namespace sl2 {
 
 			constexpr uint16_t ui16Mask = (1 << _uBits) - 1;
 			constexpr double dMuliplier = double( ui16Mask );
-			struct SL2_UV {
-				double			dU;
-				double			dV;
-			};
-
 			std::vector<double> vConvertedYSrc;
 			std::vector<double> vConvertedUSrc;
 			std::vector<double> vConvertedVSrc;
-			std::vector<SL2_UV> vScaledDown;
+			std::vector<double> vScaledDownU;
+			std::vector<double> vScaledDownV;
 			try {
 				vConvertedYSrc.resize( _ui32Width * _ui32Height );
 				vConvertedUSrc.resize( _ui32Width * _ui32Height );
 				vConvertedVSrc.resize( _ui32Width * _ui32Height );
-				vScaledDown.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownU.resize( ui32ChromaW * ui32ChromaH );
+				vScaledDownV.resize( ui32ChromaW * ui32ChromaH );
 			}
 			catch ( ... ) { return false; }
+			// The chroma contributions are the same for every slice.
+			CYuv yYuv;
+			if ( !yYuv.SetChromaSize( _ui32Width, _ui32Height, ui32ChromaW, ui32ChromaH ) ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						uint32_t ui32Y, ui32U, ui32V;
-						
-						if ( !m_ycoRgbToYuv.bFullAlgorithm ) {
+				if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						CYuv::RgbToYuvRow( prgba64Rgba[sIdx].dRgba, &vConvertedYSrc[sIdx], &vConvertedUSrc[sIdx], &vConvertedVSrc[sIdx], _ui32Width, ymMatrix );
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
+							uint32_t ui32Y, ui32U, ui32V;
 							RgbToYuv<uint32_t>( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
 								ui32Y, ui32U, ui32V );
+							vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
+							vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
+							vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 						}
-						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
-						}
-						vConvertedYSrc[sIdx] = ui32Y / double( 0xFFFFFFFFU );
-						vConvertedUSrc[sIdx] = ui32U / double( 0xFFFFFFFFU );
-						vConvertedVSrc[sIdx] = ui32V / double( 0xFFFFFFFFU );
 					}
 				}
-				CResampler::SL2_RESAMPLE rResample;
-				CResampler rResampler;
-				rResample.ui32W = _ui32Width;
-				rResample.ui32H = _ui32Height;
-				rResample.ui32D = 1;
-				rResample.ui32NewW = ui32ChromaW;
-				rResample.ui32NewH = ui32ChromaH;
-				rResample.ui32NewD = 1;
-				rResample.fFilterW = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
-				rResample.fFilterH = rResample.fFilterW;
-				if ( !rResampler.Resample_1Channel_2d( vConvertedUSrc.data(), &vScaledDown[0].dU, rResample, 2 ) ) { return false; }
-				if ( !rResampler.Resample_1Channel_2d( vConvertedVSrc.data(), &vScaledDown[0].dV, rResample, 2 ) ) { return false; }
+				yYuv.ResampleChroma( vConvertedUSrc.data(), vScaledDownU.data() );
+				yYuv.ResampleChroma( vConvertedVSrc.data(), vScaledDownV.data() );
 
 				// Copy the Y values.
 				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
@@ -5190,8 +5127,8 @@ namespace sl2 {
 				// Copy the U and V values.
 				for ( uint32_t H = 0; H < ui32ChromaH; ++H ) {
 					for ( uint32_t W = 0; W < ui32ChromaW; ++W ) {
-						prgbapui16Yuv[H*ui64Stride+W*4+_uU] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dU * dMuliplier ) );
-						prgbapui16Yuv[H*ui64Stride+W*4+_uV] = _tType( std::round( vScaledDown[H*ui32ChromaW+W].dV * dMuliplier ) );
+						prgbapui16Yuv[H*ui64Stride+W*4+_uU] = _tType( std::round( vScaledDownU[H*ui32ChromaW+W] * dMuliplier ) );
+						prgbapui16Yuv[H*ui64Stride+W*4+_uV] = _tType( std::round( vScaledDownV[H*ui32ChromaW+W] * dMuliplier ) );
 					}
 				}
 
@@ -5228,26 +5165,40 @@ namespace sl2 {
 			constexpr double dMuliplierU = (1.0 / ui16MaskU) * 0xFFFFFFFFU;
 			constexpr double dMuliplierV = (1.0 / ui16MaskV) * 0xFFFFFFFFU;
 			constexpr double dMuliplierA = (1.0 / ui16MaskA);
+			std::vector<double> vRowY, vRowU, vRowV;
+			try {
+				vRowY.resize( _ui32Width );
+				vRowU.resize( _ui32Width );
+				vRowV.resize( _ui32Width );
+			}
+			catch ( ... ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::DecodeMatrix( m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb, m_ycoYuvToRgb.dBlack, m_ycoYuvToRgb.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
-				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
-					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-						size_t sIdx = size_t( H * _ui32Width + W );
-						if ( !m_ycoYuvToRgb.bFullAlgorithm ) {
+				if ( m_ycoYuvToRgb.bFullAlgorithm ) {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						size_t sIdx = size_t( H ) * _ui32Width;
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							vRowY[W] = (prgbapui16Yuv[sIdx+W].uiR & ui16MaskY) * (1.0 / ui16MaskY);
+							vRowU[W] = (prgbapui16Yuv[sIdx+W].uiG & ui16MaskU) * (1.0 / ui16MaskU);
+							vRowV[W] = (prgbapui16Yuv[sIdx+W].uiB & ui16MaskV) * (1.0 / ui16MaskV);
+						}
+						CYuv::YuvToRgbRow( vRowY.data(), vRowU.data(), vRowV.data(), prgba64Rgba[sIdx].dRgba, _ui32Width, ymMatrix );
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							prgba64Rgba[sIdx+W].dRgba[SL2_PC_A] = (prgbapui16Yuv[sIdx+W].uiA & ui16MaskA) * dMuliplierA;
+						}
+					}
+				}
+				else {
+					for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+						for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+							size_t sIdx = size_t( H * _ui32Width + W );
 							YuvToRgb<uint32_t>( uint32_t( std::round( (prgbapui16Yuv[sIdx].uiR & ui16MaskY) * dMuliplierY ) ),
 								uint32_t( std::round( (prgbapui16Yuv[sIdx].uiG & ui16MaskU) * dMuliplierU ) ),
 								uint32_t( std::round( (prgbapui16Yuv[sIdx].uiB & ui16MaskV) * dMuliplierV ) ),
 								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B] );
+							prgba64Rgba[sIdx].dRgba[SL2_PC_A] = (prgbapui16Yuv[sIdx].uiA & ui16MaskA) * dMuliplierA;
 						}
-						else {
-							YuvToRgb( uint32_t( std::round( (prgbapui16Yuv[sIdx].uiR & ui16MaskY) * dMuliplierY ) ),
-								uint32_t( std::round( (prgbapui16Yuv[sIdx].uiG & ui16MaskU) * dMuliplierU ) ),
-								uint32_t( std::round( (prgbapui16Yuv[sIdx].uiB & ui16MaskV) * dMuliplierV ) ),
-								prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								m_ycoYuvToRgb.dKr, m_ycoYuvToRgb.dKb,
-								32, uint32_t( std::round( m_ycoYuvToRgb.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoYuvToRgb.dS * 0xFFFFFFFFU ) ) );
-						}
-						prgba64Rgba[sIdx].dRgba[SL2_PC_A] = (prgbapui16Yuv[sIdx].uiA & ui16MaskA) * dMuliplierA;
 					}
 				}
 
@@ -5283,9 +5234,20 @@ namespace sl2 {
 			constexpr double dMuliplierU = (1.0 / 0xFFFFFFFFU) * ui16MaskU;
 			constexpr double dMuliplierV = (1.0 / 0xFFFFFFFFU) * ui16MaskV;
 			constexpr double dMuliplierA = (1.0 * ui16MaskA);
+			std::vector<double> vRowY, vRowU, vRowV;
+			try {
+				vRowY.resize( _ui32Width );
+				vRowU.resize( _ui32Width );
+				vRowV.resize( _ui32Width );
+			}
+			catch ( ... ) { return false; }
+			const CYuv::SL2_YUV_MATRIX ymMatrix = CYuv::EncodeMatrix( m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb, m_ycoRgbToYuv.dBlack, m_ycoRgbToYuv.dS );
 
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 				for ( uint32_t H = 0; H < _ui32Height; ++H ) {
+					if ( m_ycoRgbToYuv.bFullAlgorithm ) {
+						CYuv::RgbToYuvRow( prgba64Rgba[size_t( H )*_ui32Width].dRgba, vRowY.data(), vRowU.data(), vRowV.data(), _ui32Width, ymMatrix );
+					}
 					for ( uint32_t W = 0; W < _ui32Width; ++W ) {
 						size_t sIdx = size_t( H * _ui32Width + W );
 						uint32_t ui32Y, ui32U, ui32V;
@@ -5295,10 +5257,9 @@ namespace sl2 {
 								ui32Y, ui32U, ui32V );
 						}
 						else {
-							RgbToYuv( prgba64Rgba[sIdx].dRgba[SL2_PC_R], prgba64Rgba[sIdx].dRgba[SL2_PC_G], prgba64Rgba[sIdx].dRgba[SL2_PC_B],
-								ui32Y, ui32U, ui32V,
-								m_ycoRgbToYuv.dKr, m_ycoRgbToYuv.dKb,
-								32, uint32_t( std::round( m_ycoRgbToYuv.dBlack * 0xFFFFFFFFU ) ), uint32_t( std::round( m_ycoRgbToYuv.dS * 0xFFFFFFFFU ) ) );
+							ui32Y = uint32_t( std::round( vRowY[W] * 0xFFFFFFFFU ) );
+							ui32U = uint32_t( std::round( vRowU[W] * 0xFFFFFFFFU ) );
+							ui32V = uint32_t( std::round( vRowV[W] * 0xFFFFFFFFU ) );
 						}
 						prgbapui16Yuv[sIdx].uiR = uint16_t( ui32Y * dMuliplierY ) & ui16MaskY;
 						prgbapui16Yuv[sIdx].uiG = uint16_t( ui32U * dMuliplierU ) & ui16MaskU;
@@ -14,16 +14,130 @@
 
 #include "SL2Image.h"
 #include "../Files/SL2StdFile.h"
+#include "../Thread/SL2ParallelFor.h"
+#include "../Time/SL2Clock.h"
 #include "../Utilities/SL2Stream.h"
+#include "../Utilities/SL2TransferLut.h"
 #include "../Utilities/SL2Vector4.h"
 #include "DDS/SL2Dds.h"
 #include "SL2KtxTexture.h"
 
 #include <basisu_transcoder.h>
+#include <unordered_map>
 
 
 namespace sl2 {
 
+	// == Members.
+#define SL2_SIG( MAGIC, OFFSET, LOADER, FIF )		{ MAGIC, sizeof( MAGIC ) - 1, OFFSET, LOADER, FIF }
+	/** Loaders chosen by signature. */
+	const CImage::SL2_SIGNATURE_LOADER CImage::m_slSignatureLoaders[] = {
+		SL2_SIG( "\x89PNG\r\n\x1A\n",						0,	nullptr,			FIF_PNG ),
+		SL2_SIG( "\xFF\xD8\xFF",								0,	nullptr,			FIF_JPEG ),
+		SL2_SIG( "DDS ",									0,	&CImage::LoadDds,	FIF_DDS ),
+		SL2_SIG( "\xABKTX 11\xBB\r\n\x1A\n",					0,	&CImage::LoadKtx1,	FIF_UNKNOWN ),
+		SL2_SIG( "\xABKTX 20\xBB\r\n\x1A\n",					0,	&CImage::LoadKtx2,	FIF_UNKNOWN ),
+		SL2_SIG( "BM",										0,	&CImage::LoadBmp,	FIF_BMP ),
+		SL2_SIG( "GIF87a",									0,	nullptr,			FIF_GIF ),
+		SL2_SIG( "GIF89a",									0,	nullptr,			FIF_GIF ),
+		SL2_SIG( "II*\0",									0,	nullptr,			FIF_TIFF ),
+		SL2_SIG( "MM\0*",									0,	nullptr,			FIF_TIFF ),
+		SL2_SIG( "v/1\x01",								0,	&CImage::LoadExr,	FIF_EXR ),
+		SL2_SIG( "8BPS",									0,	nullptr,			FIF_PSD ),
+		SL2_SIG( "WEBP",									8,	nullptr,			FIF_WEBP ),		// Follows "RIFF" and the chunk size.
+		SL2_SIG( "#?RADIANCE",								0,	nullptr,			FIF_HDR ),
+		SL2_SIG( "#?RGBE",									0,	nullptr,			FIF_HDR ),
+		SL2_SIG( "\0\0\0\x0CjP  \r\n\x87\n",					0,	nullptr,			FIF_JP2 ),
+		SL2_SIG( "\xFF\x4F\xFF\x51",							0,	nullptr,			FIF_J2K ),
+		SL2_SIG( "\0\0\x01\0",								0,	nullptr,			FIF_ICO ),
+	};
+#undef SL2_SIG
+
+#define SL2_VUL_YUV( FMT, EXT )						{ u ## #EXT, SL2_ ## FMT, SL2_DXGI_FORMAT_UNKNOWN, &CImage::LoadYuv_Vulkan_Basic<SL2_ ## FMT>, FIF_UNKNOWN }
+#define SL2_DX_YUV( FMT, EXT )						{ u ## #EXT, SL2_VK_FORMAT_UNDEFINED, SL2_ ## FMT, &CImage::LoadYuv_Dgxi_Basic<SL2_ ## FMT>, FIF_UNKNOWN }
+#define SL2_YUV( EXT, VKFMT, DXFMT, LOADER )		{ u ## #EXT, SL2_ ## VKFMT, SL2_ ## DXFMT, &CImage::LOADER, FIF_UNKNOWN }
+#define SL2_FI( FIF, EXT )							{ u ## #EXT, SL2_VK_FORMAT_UNDEFINED, SL2_DXGI_FORMAT_UNKNOWN, nullptr, FIF }
+	/** Loaders chosen by YUV format or extension, in priority order. */
+	const CImage::SL2_EXTENSION_LOADER CImage::m_elExtensionLoaders[] = {
+		// 4:4:4.
+		SL2_VUL_YUV( VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM, yuv444p16 ),
+		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16, yuv444p12le ),
+		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16, yuv444p10le ),
+		SL2_VUL_YUV( VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM, yuv444p ),
+
+		SL2_VUL_YUV( VK_FORMAT_G16_B16R16_2PLANE_444_UNORM, yuv444y16 ),
+		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_444_UNORM_3PACK16, yuv444y12le ),
+		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_444_UNORM_3PACK16, yuv444y10le ),
+		SL2_VUL_YUV( VK_FORMAT_G8_B8R8_2PLANE_444_UNORM, yuv444y ),
+
+
+		// 4:2:2.
+		SL2_VUL_YUV( VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM, yuv422p16 ),
+		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16, yuv422p12le ),
+		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16, yuv422p10le ),
+		SL2_VUL_YUV( VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM, yuv422p ),
+
+		SL2_VUL_YUV( VK_FORMAT_G16_B16R16_2PLANE_422_UNORM, yuv422y16 ),
+		SL2_DX_YUV( DXGI_FORMAT_P216, p216 ),
+		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16, yuv422y12le ),
+		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16, yuv422y10le ),
+		SL2_DX_YUV( DXGI_FORMAT_P210, p210 ),
+		SL2_VUL_YUV( VK_FORMAT_G8_B8R8_2PLANE_422_UNORM, yuv422y ),
+		SL2_DX_YUV( DXGI_FORMAT_P208, p208 ),
+
+		SL2_DX_YUV( DXGI_FORMAT_Y216, y216 ),
+		SL2_YUV( yuyv16, VK_FORMAT_G16B16G16R16_422_UNORM, DXGI_FORMAT_UNKNOWN, LoadYuv_Dgxi_Basic<SL2_DXGI_FORMAT_Y216> ),
+		SL2_VUL_YUV( VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16, yuyv12le ),
+		SL2_DX_YUV( DXGI_FORMAT_Y210, y210 ),
+		SL2_YUV( yuyv10le, VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16, DXGI_FORMAT_UNKNOWN, LoadYuv_Dgxi_Basic<SL2_DXGI_FORMAT_Y210> ),
+		SL2_DX_YUV( DXGI_FORMAT_YUY2, yuy2 ),
+		SL2_YUV( yuyv, VK_FORMAT_G8B8G8R8_422_UNORM, DXGI_FORMAT_UNKNOWN, LoadYuv_Dgxi_Basic<SL2_DXGI_FORMAT_YUY2> ),
+
+		SL2_VUL_YUV( VK_FORMAT_B16G16R16G16_422_UNORM, uyvy16 ),
+		SL2_VUL_YUV( VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16, uyvy12le ),
+		SL2_VUL_YUV( VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16, uyvy10le ),
+		SL2_YUV( uyv2, VK_FORMAT_UNDEFINED, DXGI_FORMAT_R8G8_B8G8_UNORM, LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_B8G8R8G8_422_UNORM> ),
+		SL2_VUL_YUV( VK_FORMAT_B8G8R8G8_422_UNORM, uyvy ),
+
+
+		// 4:2:0.
+		SL2_VUL_YUV( VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM, yuv420p16 ),
+		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16, yuv420p12le ),
+		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16, yuv420p10le ),
+		SL2_VUL_YUV( VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM, yuv420p ),
+		SL2_DX_YUV( DXGI_FORMAT_420_OPAQUE, yv12 ),
+		SL2_DX_YUV( DXGI_FORMAT_YV12, yv12 ),
+
+		SL2_VUL_YUV( VK_FORMAT_G16_B16R16_2PLANE_420_UNORM, yuv420y16 ),
+		SL2_DX_YUV( DXGI_FORMAT_P016, p016 ),
+		SL2_DX_YUV( DXGI_FORMAT_P010, p010 ),
+
+		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16, yuv420y12le ),
+		SL2_YUV( p012, VK_FORMAT_UNDEFINED, DXGI_FORMAT_UNKNOWN, LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16> ),
+		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16, yuv420y10le ),
+		SL2_VUL_YUV( VK_FORMAT_G8_B8R8_2PLANE_420_UNORM, yuv420y ),
+		SL2_YUV( nv12, VK_FORMAT_UNDEFINED, DXGI_FORMAT_NV12, LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_G8_B8R8_2PLANE_420_UNORM> ),
+
+		SL2_DX_YUV( DXGI_FORMAT_NV21, nv21 ),
+
+		// Alpha.
+		SL2_DX_YUV( DXGI_FORMAT_Y416, y416 ),
+		SL2_VUL_YUV( VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16, yuva12le ),
+		SL2_VUL_YUV( VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16, yuva10le ),
+		SL2_DX_YUV( DXGI_FORMAT_Y410, y410 ),
+		SL2_DX_YUV( DXGI_FORMAT_AYUV, ayuv ),
+
+
+		// Headerless formats loaded by FreeImage.
+		SL2_FI( FIF_TARGA, tga ),
+		SL2_FI( FIF_TARGA, targa ),
+		SL2_FI( FIF_WBMP, wbmp ),
+	};
+#undef SL2_FI
+#undef SL2_YUV
+#undef SL2_DX_YUV
+#undef SL2_VUL_YUV
+
 	CImage::CImage() :
 		m_dGamma( -2.2 ),
 		m_dTargetGamma( -2.2 ),
@@ -56,8 +170,24 @@ namespace sl2 {
 		m_bIgnoreSourceColorspaceGamma( false ),
 		m_ui32YuvW( 0 ),
 		m_ui32YuvH( 0 ),
+		m_ui64YuvFirstFrame( 0 ),
+		m_ui32YuvFrames( 0 ),
+		m_ui64YuvFileFrames( 0 ),
 		m_bGenPalette( false ),
-		m_qrQuickRotation( SL2_QR_ROT_0 ) {
+		m_bSharedPalette( false ),
+		m_ui32SharedPaletteSize( 0 ),
+		m_dPaletteTime( 0.0 ),
+		m_dIndexMapTime( 0.0 ),
+		m_dLoaderTime( 0.0 ),
+		m_ui32FailedProbes( 0 ),
+		m_pfDecodeSize( nullptr ),
+		m_pvDecodeSizeParm( nullptr ),
+		m_ui32FullWidth( 0 ),
+		m_ui32FullHeight( 0 ),
+		m_qrQuickRotation( SL2_QR_ROT_0 ),
+		m_bLazyDecode( false ),
+		m_sLazyMaxResident( 0 ),
+		m_sLazyDecodes( 0 ) {
 		m_sSwizzle = CFormat::DefaultSwizzle();
 	}
 	CImage::~CImage() {
@@ -118,11 +248,31 @@ namespace sl2 {
 			m_pkifdYuvFormat = _iOther.m_pkifdYuvFormat;
 			m_ui32YuvW = _iOther.m_ui32YuvW;
 			m_ui32YuvH = _iOther.m_ui32YuvH;
+			m_ui64YuvFirstFrame = _iOther.m_ui64YuvFirstFrame;
+			m_ui32YuvFrames = _iOther.m_ui32YuvFrames;
+			m_ui64YuvFileFrames = _iOther.m_ui64YuvFileFrames;
 			m_pPalette = _iOther.m_pPalette;
 			m_bGenPalette = _iOther.m_bGenPalette;
+			m_bSharedPalette = _iOther.m_bSharedPalette;
+			m_ui32SharedPaletteSize = _iOther.m_ui32SharedPaletteSize;
+			m_dPaletteTime = _iOther.m_dPaletteTime;
+			m_dIndexMapTime = _iOther.m_dIndexMapTime;
+			m_dLoaderTime = _iOther.m_dLoaderTime;
+			m_ui32FailedProbes = _iOther.m_ui32FailedProbes;
+			m_pfDecodeSize = _iOther.m_pfDecodeSize;
+			m_pvDecodeSizeParm = _iOther.m_pvDecodeSizeParm;
+			m_ui32FullWidth = _iOther.m_ui32FullWidth;
+			m_ui32FullHeight = _iOther.m_ui32FullHeight;
 			m_wCroppingWindow = _iOther.m_wCroppingWindow;
 			m_qrQuickRotation = _iOther.m_qrQuickRotation;
 			m_vFrameTimes = _iOther.m_vFrameTimes;
+			m_plsLazy = std::move( _iOther.m_plsLazy );
+			m_bLazyDecode = _iOther.m_bLazyDecode;
+			m_sLazyMaxResident = _iOther.m_sLazyMaxResident;
+			m_sLazyDecodes = _iOther.m_sLazyDecodes;
+			// The tables point into the transfer functions of the images they were made for.
+			ResetIccLuts();
+			_iOther.ResetIccLuts();
 			
 			_iOther.m_sArraySize = 0;
 			_iOther.m_kKernel.SetSize( 0 );
@@ -162,12 +312,25 @@ namespace sl2 {
 			_iOther.m_bIgnoreSourceColorspaceGamma = false;
 			_iOther.m_pkifdYuvFormat = nullptr;
 			_iOther.m_ui32YuvW = _iOther.m_ui32YuvH = 0;
+			_iOther.m_ui64YuvFirstFrame = _iOther.m_ui64YuvFileFrames = 0;
+			_iOther.m_ui32YuvFrames = 0;
 			_iOther.m_pPalette.Reset();
 			_iOther.m_bGenPalette = false;
+			_iOther.m_bSharedPalette = false;
+			_iOther.m_ui32SharedPaletteSize = 0;
+			_iOther.m_dPaletteTime = _iOther.m_dIndexMapTime = 0.0;
+			_iOther.m_dLoaderTime = 0.0;
+			_iOther.m_ui32FailedProbes = 0;
+			_iOther.m_pfDecodeSize = nullptr;
+			_iOther.m_pvDecodeSizeParm = nullptr;
+			_iOther.m_ui32FullWidth = _iOther.m_ui32FullHeight = 0;
 			_iOther.m_wCroppingWindow.i32X = _iOther.m_wCroppingWindow.i32Y = _iOther.m_wCroppingWindow.i32Z = 0;
 			_iOther.m_wCroppingWindow.ui32W = _iOther.m_wCroppingWindow.ui32H = _iOther.m_wCroppingWindow.ui32D = 0;
 			_iOther.m_qrQuickRotation = SL2_QR_ROT_0;
 			_iOther.m_vFrameTimes.clear();
+			_iOther.m_bLazyDecode = false;
+			_iOther.m_sLazyMaxResident = 0;
+			_iOther.m_sLazyDecodes = 0;
 		}
 
 		return (*this);
@@ -193,12 +356,14 @@ namespace sl2 {
 			m_vMipMaps[I].reset();
 		}
 		m_vMipMaps = std::vector<std::unique_ptr<CSurface>>();
+		m_plsLazy.reset();
 		for ( size_t I = SL2_ELEMENTS( m_tfInColorSpaceTransferFunc ); I--; ) {
 			m_tfInColorSpaceTransferFunc[I] = CIcc::SL2_TRANSFER_FUNC();
 		}
 		for ( size_t I = SL2_ELEMENTS( m_tfOutColorSpaceTransferFunc ); I--; ) {
 			m_tfOutColorSpaceTransferFunc[I] = CIcc::SL2_TRANSFER_FUNC();
 		}
+		ResetIccLuts();
 		m_sSwizzle = CFormat::DefaultSwizzle();
 		m_caKernelChannal = SL2_CA_R;
 		m_dKernelScale = 1.0;
@@ -227,138 +392,122 @@ namespace sl2 {
 		m_bIgnoreSourceColorspaceGamma = false;
 		m_pkifdYuvFormat = nullptr;
 		m_ui32YuvW = m_ui32YuvH = 0;
+		m_ui64YuvFirstFrame = m_ui64YuvFileFrames = 0;
+		m_ui32YuvFrames = 0;
 		m_pPalette.Reset();
 		m_bGenPalette = false;
+		m_bSharedPalette = false;
+		m_ui32SharedPaletteSize = 0;
+		m_dPaletteTime = m_dIndexMapTime = 0.0;
+		m_dLoaderTime = 0.0;
+		m_ui32FailedProbes = 0;
+		m_pfDecodeSize = nullptr;
+		m_pvDecodeSizeParm = nullptr;
+		m_ui32FullWidth = m_ui32FullHeight = 0;
 		m_wCroppingWindow.i32X = m_wCroppingWindow.i32Y = m_wCroppingWindow.i32Z = 0;
 		m_wCroppingWindow.ui32W = m_wCroppingWindow.ui32H = m_wCroppingWindow.ui32D = 0;
 		m_qrQuickRotation = SL2_QR_ROT_0;
 		m_vFrameTimes.clear();
+		m_bLazyDecode = false;
+		m_sLazyMaxResident = 0;
+		m_sLazyDecodes = 0;
 	}
 
 	/**
-	 * Loads an image file.  All image slices, faces, and array slices will be loaded.
+	 * Loads an image file.  All image slices, faces, and array slices will be loaded.  Headerless formats are chosen by the
+	 *	format set with SetYuvSize() or by extension; all others are chosen by their signature.
 	 * 
 	 * \param _pcFile The name of the file to load.
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS CImage::LoadFile( const char16_t * _pcFile ) {
-		std::vector<uint8_t> vFile;
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Open( _pcFile ) ) { return SL2_E_FILENOTFOUND; }
-			if ( !sfFile.LoadToMemory( vFile ) ) { return SL2_E_OUTOFMEMORY; }
-		}
-
-#define SL2_YUV_CHECK( FMT, EXT )	(m_pkifdYuvFormat && m_pkifdYuvFormat->vfVulkanFormat == SL2_ ## FMT) || ::_wcsicmp( reinterpret_cast<const wchar_t *>(sl2::CFileBase::GetFileExtension( _pcFile ).c_str()), L ## #EXT ) == 0
-#define SL2_VUL_YUV( FMT, EXT )									\
-	if ( SL2_YUV_CHECK( FMT, EXT ) ) {							\
-		return LoadYuv_Vulkan_Basic<SL2_ ## FMT>( vFile );		\
-	}
-#define SL2_DX_CHECK( FMT, EXT )	(m_pkifdYuvFormat && m_pkifdYuvFormat->dfDxFormat == SL2_ ## FMT) || ::_wcsicmp( reinterpret_cast<const wchar_t *>(sl2::CFileBase::GetFileExtension( _pcFile ).c_str()), L ## #EXT ) == 0
-#define SL2_DX_YUV( FMT, EXT )									\
-	if ( SL2_DX_CHECK( FMT, EXT ) ) {							\
-		return LoadYuv_Dgxi_Basic<SL2_ ## FMT>( vFile );		\
-	}
-
-		
-		// 4:4:4.
-		SL2_VUL_YUV( VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM, yuv444p16 )
-		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16, yuv444p12le )
-		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16, yuv444p10le )
-		SL2_VUL_YUV( VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM, yuv444p )
+		CStdFile sfFile;
+		if ( !sfFile.Open( _pcFile ) ) { return SL2_E_FILENOTFOUND; }
+		m_dLoaderTime = 0.0;
+		m_ui32FailedProbes = 0;
+		m_ui32FullWidth = m_ui32FullHeight = 0;
 
-		SL2_VUL_YUV( VK_FORMAT_G16_B16R16_2PLANE_444_UNORM, yuv444y16 )
-		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_444_UNORM_3PACK16, yuv444y12le )
-		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_444_UNORM_3PACK16, yuv444y10le )
-		SL2_VUL_YUV( VK_FORMAT_G8_B8R8_2PLANE_444_UNORM, yuv444y )
-
-
-		// 4:2:2.
-		SL2_VUL_YUV( VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM, yuv422p16 )
-		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16, yuv422p12le )
-		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16, yuv422p10le )
-		SL2_VUL_YUV( VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM, yuv422p )
-
-		SL2_VUL_YUV( VK_FORMAT_G16_B16R16_2PLANE_422_UNORM, yuv422y16 )
-		SL2_DX_YUV( DXGI_FORMAT_P216, p216 );
-		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16, yuv422y12le )
-		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16, yuv422y10le )
-		SL2_DX_YUV( DXGI_FORMAT_P210, p210 );
-		SL2_VUL_YUV( VK_FORMAT_G8_B8R8_2PLANE_422_UNORM, yuv422y )
-		SL2_DX_YUV( DXGI_FORMAT_P208, p208 );
-
-		if ( SL2_DX_CHECK( DXGI_FORMAT_Y216, y216 ) || SL2_YUV_CHECK( VK_FORMAT_G16B16G16R16_422_UNORM, yuyv16 ) ) {
-			return LoadYuv_Dgxi_Basic<SL2_DXGI_FORMAT_Y216>( vFile );
-		}
-		SL2_VUL_YUV( VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16, yuyv12le )
-		if ( SL2_DX_CHECK( DXGI_FORMAT_Y210, y210 ) || SL2_YUV_CHECK( VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16, yuyv10le ) ) {
-			return LoadYuv_Dgxi_Basic<SL2_DXGI_FORMAT_Y210>( vFile );
+		CClock cClock;
+		// A format given by SetYuvSize() overrides the extension.
+		const SL2_EXTENSION_LOADER * pelLoader = FindYuvLoader( m_pkifdYuvFormat );
+		if ( !pelLoader ) {
+			pelLoader = FindExtensionLoader( CFileBase::GetFileExtension( _pcFile ) );
 		}
-		if ( SL2_DX_CHECK( DXGI_FORMAT_YUY2, yuy2 ) || SL2_YUV_CHECK( VK_FORMAT_G8B8G8R8_422_UNORM, yuyv ) ) {
-			return LoadYuv_Dgxi_Basic<SL2_DXGI_FORMAT_YUY2>( vFile );
+		m_dLoaderTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+		if ( pelLoader && pelLoader->pfLoader ) {
+			return (this->*pelLoader->pfLoader)( sfFile );
 		}
 
-		SL2_VUL_YUV( VK_FORMAT_B16G16R16G16_422_UNORM, uyvy16 );
-		SL2_VUL_YUV( VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16, uyvy12le );
-		SL2_VUL_YUV( VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16, uyvy10le );
-		if ( SL2_DX_CHECK( VK_FORMAT_B8G8R8G8_422_UNORM, uyv2 ) || SL2_YUV_CHECK( DXGI_FORMAT_R8G8_B8G8_UNORM, uyvy ) ) {
-			return LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_B8G8R8G8_422_UNORM>( vFile );
-		}
-
-		
-
-
-		// 4:2:0.
-		SL2_VUL_YUV( VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM, yuv420p16 )
-		SL2_VUL_YUV( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16, yuv420p12le )
-		SL2_VUL_YUV( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16, yuv420p10le )
-		SL2_VUL_YUV( VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM, yuv420p )
-		SL2_DX_YUV( DXGI_FORMAT_420_OPAQUE, yv12 )
-		SL2_DX_YUV( DXGI_FORMAT_YV12, yv12 )
+		std::vector<uint8_t> vFile;
+		if ( !sfFile.LoadToMemory( vFile ) ) { return SL2_E_OUTOFMEMORY; }
+		sfFile.Close();
+		if ( m_bLazyDecode ) {
+			// Lazily decoded surfaces point into the file, so a DDS file is handed over rather than copied.
+			cClock.SetStartingTick();
+			const SL2_SIGNATURE_LOADER * pslLoader = FindSignatureLoader( vFile );
+			m_dLoaderTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+			if ( pslLoader && pslLoader->pfLoader == static_cast<PfLoader>(&CImage::LoadDds) ) {
+				if ( SL2_E_SUCCESS == LoadDds( std::move( vFile ) ) ) { return SL2_E_SUCCESS; }
+				// vFile is given back on failure, and the other loaders are tried as usual.
+			}
+		}
+		return LoadFile( vFile, pelLoader ? pelLoader->fifFormat : FIF_UNKNOWN );
+	}
 
-		SL2_VUL_YUV( VK_FORMAT_G16_B16R16_2PLANE_420_UNORM, yuv420y16 )
-		SL2_DX_YUV( DXGI_FORMAT_P016, p016 );
-		SL2_DX_YUV( DXGI_FORMAT_P010, p010 );
+	/**
+	 * Loads an image file that has already been read into memory.  The loader is chosen as it is by
+	 *	LoadFile( const char16_t * ), and loaders that stream from the file reopen it by name.
+	 * 
+	 * \param _pcFile The name of the file.
+	 * \param _vData The contents of the file.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadFile( const char16_t * _pcFile, const std::vector<uint8_t> &_vData ) {
+		m_dLoaderTime = 0.0;
+		m_ui32FailedProbes = 0;
+		m_ui32FullWidth = m_ui32FullHeight = 0;
 
-		if ( SL2_YUV_CHECK( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16, yuv420y12le ) || ::_wcsicmp( reinterpret_cast<const wchar_t *>(sl2::CFileBase::GetFileExtension( _pcFile ).c_str()), L"p012" ) == 0 ) {
-			return LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16>( vFile );
-		}
-		if ( SL2_YUV_CHECK( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16, yuv420y10le ) || ::_wcsicmp( reinterpret_cast<const wchar_t *>(sl2::CFileBase::GetFileExtension( _pcFile ).c_str()), L"p010" ) == 0 ) {
-			return LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16>( vFile );
+		CClock cClock;
+		const SL2_EXTENSION_LOADER * pelLoader = FindYuvLoader( m_pkifdYuvFormat );
+		if ( !pelLoader ) {
+			pelLoader = FindExtensionLoader( CFileBase::GetFileExtension( _pcFile ) );
 		}
-		if ( SL2_YUV_CHECK( VK_FORMAT_G8_B8R8_2PLANE_420_UNORM, yuv420y ) || SL2_YUV_CHECK( DXGI_FORMAT_NV12, nv12 ) || ::_wcsicmp( reinterpret_cast<const wchar_t *>(sl2::CFileBase::GetFileExtension( _pcFile ).c_str()), L"yuv420y" ) == 0 ) {
-			return LoadYuv_Vulkan_Basic<SL2_VK_FORMAT_G8_B8R8_2PLANE_420_UNORM>( vFile );
+		m_dLoaderTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+		if ( pelLoader && pelLoader->pfLoader ) {
+			return LoadFile( _pcFile );
 		}
+		return LoadFile( _vData, pelLoader ? pelLoader->fifFormat : FIF_UNKNOWN );
+	}
 
-		SL2_DX_YUV( DXGI_FORMAT_NV21, nv21 )
-
-		// Alpha.
-		SL2_DX_YUV( DXGI_FORMAT_Y416, y416 )
-		SL2_VUL_YUV( VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16, yuva12le )
-		SL2_VUL_YUV( VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16, yuva10le )
-		SL2_DX_YUV( DXGI_FORMAT_Y410, y410 )
-		SL2_DX_YUV( DXGI_FORMAT_AYUV, ayuv )
-		
-
-		return LoadFile( vFile );
-#undef SL2_DX_YUV
-#undef SL2_DX_CHECK
-#undef SL2_YUV_CHECK
-#undef SL2_VUL_YUV
+	/**
+	 * Loads a raw YUV file that is already open, using the format and size set with SetYuvSize().  Only the frames selected by
+	 *	SetYuvFrames() are read, and the file is not reopened, so several images can take turns loading frames from one file.
+	 * 
+	 * \param _sfFile The opened file to load.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadFile( CStdFile &_sfFile ) {
+		m_dLoaderTime = 0.0;
+		m_ui32FailedProbes = 0;
+		m_ui32FullWidth = m_ui32FullHeight = 0;
+
+		const SL2_EXTENSION_LOADER * pelLoader = FindYuvLoader( m_pkifdYuvFormat );
+		if ( !pelLoader || !pelLoader->pfLoader ) { return SL2_E_INVALIDFILETYPE; }
+		return (this->*pelLoader->pfLoader)( _sfFile );
 	}
 
 	/**
-	 * Loads an image file.  All image slices, faces, and array slices will be loaded.
+	 * Loads an image file.  All image slices, faces, and array slices will be loaded.  The loader is chosen by the signature
+	 *	at the start of the file.
 	 * 
 	 * \param _vData The image file to load.
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS CImage::LoadFile( const std::vector<uint8_t> &_vData ) {
-		if ( SL2_E_SUCCESS == LoadBmp( _vData ) ) { return SL2_E_SUCCESS; }
-		if ( SL2_E_SUCCESS == LoadDds( _vData ) ) { return SL2_E_SUCCESS; }
-		if ( SL2_E_SUCCESS == LoadKtx1( _vData ) ) { return SL2_E_SUCCESS; }
-		if ( SL2_E_SUCCESS == LoadKtx2( _vData ) ) { return SL2_E_SUCCESS; }
-		return LoadFreeImage( _vData );
+		m_dLoaderTime = 0.0;
+		m_ui32FailedProbes = 0;
+		m_ui32FullWidth = m_ui32FullHeight = 0;
+		return LoadFile( _vData, FIF_UNKNOWN );
 	}
 
 	/**
@@ -536,7 +685,12 @@ namespace sl2 {
 					ui32H = m_vMipMaps[M]->Height();
 					ui32D = m_vMipMaps[M]->Depth();
 
-					if ( !Format()->pfToRgba64F( Data( M, 0, A, F ), pui8Dest, ui32W, ui32H, ui32D, &ifdData ) ) { return SL2_E_INTERNALERROR; }
+					{
+						// A lazily decoded surface is decoded here and can be released again as soon as it has been read.
+						SL2_SURFACE_PIN spSrc( (*this), M, A, F );
+						if ( !spSrc.pui8Data ) { return SL2_E_OUTOFMEMORY; }
+						if ( !Format()->pfToRgba64F( spSrc.pui8Data, pui8Dest, ui32W, ui32H, ui32D, &ifdData ) ) { return SL2_E_INTERNALERROR; }
+					}
 					if ( !QuickRotate( pui8Dest, ui32W, ui32H, ui32D, m_qrQuickRotation ) ) { return SL2_E_OUTOFMEMORY; }
 					try {
 						Crop( pui8Dest, vCrop, ui32W, ui32H, ui32D,
@@ -662,9 +816,20 @@ namespace sl2 {
 			if ( m_bGenPalette || Palette().Palette().size() == 0 || Palette().Palette().size() > sMax ) {
 				uint64_t ui64Total = uint64_t( iTmp.Width() ) * iTmp.Height() * iTmp.Depth() * iTmp.Faces() * iTmp.ArraySize();
 				if ( ui64Total ) {
-					if ( !GeneratePalette( iTmp.Data( 0, 0, 0, 0 ), ui64Total, uint32_t( sMax ) ) ) { return SL2_E_OUTOFMEMORY; }
+					CClock cClock;
+					if ( m_bSharedPalette ) {
+						// Lower mipmaps contribute too.
+						if ( !GenerateSharedPalette( iTmp, uint32_t( sMax ) ) ) { return SL2_E_OUTOFMEMORY; }
+					}
+					else {
+						if ( !GeneratePalette( iTmp.Data( 0, 0, 0, 0 ), ui64Total, uint32_t( sMax ) ) ) { return SL2_E_OUTOFMEMORY; }
+					}
+					m_dPaletteTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
 				}
 			}
+			if ( m_bSharedPalette ) {
+				m_ui32SharedPaletteSize = uint32_t( sMax );
+			}
 		}
 
 		if ( _pkifFormat->vfVulkanFormat == SL2_VK_FORMAT_R64G64B64A64_SFLOAT ) {
@@ -679,6 +844,10 @@ namespace sl2 {
 			_iDst.m_bApplyInputColorSpaceTransfer = m_bApplyInputColorSpaceTransfer;
 			_iDst.m_pPalette = m_pPalette;
 			_iDst.m_bGenPalette = false;
+			_iDst.m_bSharedPalette = m_bSharedPalette;
+			_iDst.m_ui32SharedPaletteSize = m_ui32SharedPaletteSize;
+			_iDst.m_dPaletteTime = m_dPaletteTime;
+			_iDst.m_dIndexMapTime = m_dIndexMapTime;
 			if ( !_iDst.m_vOutIccProfile.size() ) {
 				_iDst.m_bApplyInputColorSpaceTransfer = false;
 			}
@@ -686,6 +855,7 @@ namespace sl2 {
 				_iDst.m_tfInColorSpaceTransferFunc[I] = m_tfOutColorSpaceTransferFunc[I];	// Not a bug.
 				_iDst.m_tfOutColorSpaceTransferFunc[I] = m_tfOutColorSpaceTransferFunc[I];
 			}
+			_iDst.ResetIccLuts();
 			return SL2_E_SUCCESS;
 		}
 		if ( !_pkifFormat->pfFromRgba64F ) { return SL2_E_BADFORMAT; }
@@ -693,15 +863,39 @@ namespace sl2 {
 		if ( !_iDst.AllocateTexture( _pkifFormat, ui32NewW, ui32NewH, ui32NewD, iTmp.Mipmaps(), iTmp.ArraySize(), iTmp.Faces() ) ) { return SL2_E_OUTOFMEMORY; }
 		ifdData = (*_pkifFormat);
 		ifdData.pvCustom = this;
-		for ( size_t M = 0; M < iTmp.Mipmaps(); ++M ) {
-			for ( size_t A = 0; A < iTmp.ArraySize(); ++A ) {
-				for ( size_t F = 0; F < iTmp.Faces(); ++F ) {
+		CClock cClock;
+		if ( SL2_GET_IDX_FLAG( _pkifFormat->ui32Flags ) ) {
+			// Mapping to a palette only reads the palette, so surfaces are mapped in parallel.  Each surface also splits its rows over the
+			//	threads the surfaces leave free, so a single large surface still uses every core while many small mipmaps don't wait on one another.
+			size_t sSurfaces = iTmp.Mipmaps() * iTmp.ArraySize() * iTmp.Faces();
+			std::atomic<size_t> aNext( 0 );
+			std::atomic<bool> aFailed( false );
+			CParallelFor::Run( CParallelFor::Workers( sSurfaces ), [&]( size_t ) {
+				for ( size_t I = aNext++; I < sSurfaces && !aFailed; I = aNext++ ) {
+					size_t F = I % iTmp.Faces();
+					size_t A = (I / iTmp.Faces()) % iTmp.ArraySize();
+					size_t M = I / (iTmp.Faces() * iTmp.ArraySize());
 					if ( !_pkifFormat->pfFromRgba64F( iTmp.Data( M, 0, A, F ), _iDst.Data( M, 0, A, F ), iTmp.m_vMipMaps[M]->Width(), iTmp.m_vMipMaps[M]->Height(), iTmp.m_vMipMaps[M]->Depth(), &ifdData ) ) {
-						return SL2_E_INTERNALERROR;
+						aFailed = true;
+					}
+				}
+			} );
+			if ( aFailed ) { return SL2_E_INTERNALERROR; }
+		}
+		else {
+			for ( size_t M = 0; M < iTmp.Mipmaps(); ++M ) {
+				for ( size_t A = 0; A < iTmp.ArraySize(); ++A ) {
+					for ( size_t F = 0; F < iTmp.Faces(); ++F ) {
+						if ( !_pkifFormat->pfFromRgba64F( iTmp.Data( M, 0, A, F ), _iDst.Data( M, 0, A, F ), iTmp.m_vMipMaps[M]->Width(), iTmp.m_vMipMaps[M]->Height(), iTmp.m_vMipMaps[M]->Depth(), &ifdData ) ) {
+							return SL2_E_INTERNALERROR;
+						}
 					}
 				}
 			}
 		}
+		if ( SL2_GET_IDX_FLAG( _pkifFormat->ui32Flags ) ) {
+			m_dIndexMapTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+		}
 		_iDst.m_bNeedsPreMultiply = _iDst.m_bIsPreMultiplied = bTargetIsPremulAlpha;
 		_iDst.m_ttType = m_ttType;
 		_iDst.m_bFullyOpaque = bOpaque;
@@ -711,6 +905,10 @@ namespace sl2 {
 		_iDst.m_bApplyInputColorSpaceTransfer = m_bApplyInputColorSpaceTransfer;
 		_iDst.m_pPalette = m_pPalette;
 		_iDst.m_bGenPalette = false;
+		_iDst.m_bSharedPalette = m_bSharedPalette;
+		_iDst.m_ui32SharedPaletteSize = m_ui32SharedPaletteSize;
+		_iDst.m_dPaletteTime = m_dPaletteTime;
+		_iDst.m_dIndexMapTime = m_dIndexMapTime;
 		if ( !_iDst.m_vOutIccProfile.size() ) {
 			_iDst.m_bApplyInputColorSpaceTransfer = false;
 		}
@@ -718,6 +916,7 @@ namespace sl2 {
 			_iDst.m_tfInColorSpaceTransferFunc[I] = m_tfOutColorSpaceTransferFunc[I];	// Not a bug.
 			_iDst.m_tfOutColorSpaceTransferFunc[I] = m_tfOutColorSpaceTransferFunc[I];
 		}
+		_iDst.ResetIccLuts();
 		return SL2_E_SUCCESS;
 	}
 
@@ -765,6 +964,11 @@ namespace sl2 {
 
 		uint64_t ui64BaseSize = CFormat::GetFormatSize( CFormat::FindFormatDataByVulkan( SL2_VK_FORMAT_R64G64B64A64_SFLOAT ), m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), m_vMipMaps[_sMip]->Depth() );
 		if ( uint64_t( size_t( ui64BaseSize ) ) != ui64BaseSize ) { return SL2_E_UNSUPPORTEDSIZE; }
+		// Indexed conversions temporarily replace m_pPalette below, and indexed sources read it.  Other conversions only read the image and can run
+		//	in parallel.
+		bool bIndexed = SL2_GET_IDX_FLAG( _pkifFormat->ui32Flags ) != 0;
+		std::unique_lock<std::mutex> ulLock( m_mPaletteMutex, std::defer_lock );
+		if ( bIndexed || SL2_GET_IDX_FLAG( Format()->ui32Flags ) ) { ulLock.lock(); }
 		//if ( ParametersAreUnchanged( _pkifFormat, _bInvertY, m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), m_vMipMaps[_sMip]->Depth() ) ) {
 		//	// No format conversion needed.  Just copy the buffers.
 		//	ui64BaseSize = CFormat::GetFormatSize( _pkifFormat, m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), m_vMipMaps[_sMip]->Depth() );
@@ -784,7 +988,9 @@ namespace sl2 {
 
 		CFormat::SL2_KTX_INTERNAL_FORMAT_DATA ifdData = (*Format());
 		ifdData.pvCustom = this;
-		if ( !Format()->pfToRgba64F( Data( _sMip, 0, _sArray, _sFace ), vTmp.data(), m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), m_vMipMaps[_sMip]->Depth(), &ifdData ) ) {
+		SL2_SURFACE_PIN spSrc( (*this), _sMip, _sArray, _sFace );
+		if ( !spSrc.pui8Data ) { return SL2_E_OUTOFMEMORY; }
+		if ( !Format()->pfToRgba64F( spSrc.pui8Data, vTmp.data(), m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), m_vMipMaps[_sMip]->Depth(), &ifdData ) ) {
 			return SL2_E_INTERNALERROR;
 		}
 		
@@ -826,13 +1032,27 @@ namespace sl2 {
 
 		// Back up our palette.
 		auto pTmp = m_pPalette;
-		if ( SL2_GET_IDX_FLAG( _pkifFormat->ui32Flags ) ) {
+		if ( bIndexed ) {
 			// Converting to an indexed format?  May need to generate a palette.
 			size_t sMax = size_t( 1ULL << _pkifFormat->ui32BlockSizeInBits );
-			if ( m_bGenPalette || Palette().Palette().size() == 0 || Palette().Palette().size() > sMax || _bGenPalette ) {
+			bool bNeedPalette = m_bGenPalette || Palette().Palette().size() == 0 || Palette().Palette().size() > sMax || _bGenPalette;
+			if ( m_bSharedPalette ) {
+				// The first surface to need a palette of this size generates it from all surfaces, and the rest reuse it.  A palette given
+				//	with -pal is kept, as it is when the whole image is converted.
+				if ( bNeedPalette && m_ui32SharedPaletteSize != uint32_t( sMax ) ) {
+					CClock cClock;
+					if ( !GenerateSharedPalette( (*this), uint32_t( sMax ) ) ) { return SL2_E_OUTOFMEMORY; }
+					m_dPaletteTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+					m_ui32SharedPaletteSize = uint32_t( sMax );
+					pTmp = m_pPalette;
+				}
+			}
+			else if ( bNeedPalette ) {
 				uint64_t ui64Total = ui64BaseSize / sizeof( CFormat::SL2_RGBA64F );
 				if ( ui64Total ) {
+					CClock cClock;
 					if ( !GeneratePalette( vTmp.data(), ui64Total, uint32_t( sMax ) ) ) { return SL2_E_OUTOFMEMORY; }
+					m_dPaletteTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
 				}
 			}
 		}
@@ -843,10 +1063,14 @@ namespace sl2 {
 
 		ifdData = (*_pkifFormat);
 		ifdData.pvCustom = this;
+		CClock cClock;
 		if ( !_pkifFormat->pfFromRgba64F( vTmp.data(), _pui8Dst, m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), m_vMipMaps[_sMip]->Depth(), &ifdData ) ) {
 			m_pPalette = pTmp;
 			return SL2_E_INTERNALERROR;
 		}
+		if ( bIndexed ) {
+			m_dIndexMapTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+		}
 		m_pPalette = pTmp;
 		return SL2_E_SUCCESS;
 	}
@@ -901,7 +1125,9 @@ namespace sl2 {
 
 		CFormat::SL2_KTX_INTERNAL_FORMAT_DATA ifdData = (*Format());
 		ifdData.pvCustom = this;
-		if ( !Format()->pfToRgba64F( Data( _sMip, _ui32Slice, _sArray, _sFace ), reinterpret_cast<uint8_t *>(_vResult.data()), ui32W, ui32H, 1, &ifdData ) ) { return false; }
+		uint8_t * pui8Src = Data( _sMip, _ui32Slice, _sArray, _sFace );
+		if ( !pui8Src ) { return false; }
+		if ( !Format()->pfToRgba64F( pui8Src, reinterpret_cast<uint8_t *>(_vResult.data()), ui32W, ui32H, 1, &ifdData ) ) { return false; }
 
 		if ( m_dTargetGamma ) {
 			BakeGamma( reinterpret_cast<uint8_t *>(_vResult.data()), 1.0 / m_dTargetGamma, ui32W, ui32H, 1, CFormat::TransferFunc( m_cgcOutputCurve ) );
@@ -984,10 +1210,12 @@ namespace sl2 {
 	 * \param _sMips Number of mipmaps.  Must be at least 1.  If 0, a full mipmap chain is allocated.
 	 * \param _sArray Number of array slices.  Must be at least 1.
 	 * \param _sFaces Number of faces.  Either 1 or 6.
+	 * \param _bLazy If true, only the sizes of the mipmaps are set, and their surfaces are decoded by LazyData().
 	 * \return Returns true if all mipmaps could be allocated and the texture size is valid (non-0) and a supported format.
 	 **/
-	bool CImage::AllocateTexture( const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, size_t _sMips, size_t _sArray, size_t _sFaces ) {
+	bool CImage::AllocateTexture( const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, size_t _sMips, size_t _sArray, size_t _sFaces, bool _bLazy ) {
 		if ( !_pkifFormat ) { return false; }
+		m_plsLazy.reset();
 		if ( !_sMips ) {
 			_sMips = CUtilities::Max( size_t( std::floor( std::log2( _ui32Width ) ) ), size_t( std::floor( std::log2( _ui32Height ) ) ) );
 			_sMips = CUtilities::Max( size_t( std::floor( std::log2( _ui32Depth ) ) ), _sMips ) + 1;
@@ -1012,6 +1240,7 @@ namespace sl2 {
 				uint64_t ui64FullSize = ui64ThisBaseSize * _sArray * _sFaces;
 				if ( !ui64FullSize || (uint64_t( size_t( ui64FullSize ) ) != ui64FullSize) ) { Reset(); return false; }
 
+				if ( _bLazy ) { ui64FullSize = 0; }
 				if ( m_vMipMaps[I].get() ) {
 					if ( !m_vMipMaps[I]->Reallocate( size_t( ui64FullSize ), size_t( ui64ThisBaseSize ), _ui32Width, _ui32Height, _ui32Depth ) ) { Reset(); return false; }
 				}
@@ -1233,6 +1462,15 @@ namespace sl2 {
 		if ( !_pui8Buffer ) { return; }
 		if ( _dGamma == 0.0 || _dGamma == 1.0 ) { return; }
 		CFormat::SL2_RGBA64F * prDst = reinterpret_cast<CFormat::SL2_RGBA64F *>(_pui8Buffer);
+		size_t sTotal = size_t( _ui32Width ) * _ui32Height * _ui32Depth;
+		if ( sTotal >= CTransferLut::m_sMinTexels ) {
+			// Large enough to go through the (shared, validated) tables.
+			const CTransferLut & tlLut = (_dGamma <= -1.0) ? CTransferLut::Cached( _ptfGamma.pfLinearToX ) :
+				(_dGamma < 0.0) ? CTransferLut::Cached( _ptfGamma.pfXtoLinear ) :
+				CTransferLut::CachedPow( 1.0 / _dGamma );
+			tlLut.TransformRgb( prDst->dRgba, sTotal );
+			return;
+		}
 		if ( _dGamma <= -1.0 ) {
 			// True Linear -> sRGB conversion.
 			for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
@@ -1321,6 +1559,15 @@ namespace sl2 {
 		CIcc::PfTransferFunc _pfGammaFuncB, const void * _pvGammaFuncParmB ) {
 		if ( !_pui8Buffer ) { return; }
 		CFormat::SL2_RGBA64F * prDst = reinterpret_cast<CFormat::SL2_RGBA64F *>(_pui8Buffer);
+		size_t sTotal = size_t( _ui32Width ) * _ui32Height * _ui32Depth;
+		if ( sTotal >= CTransferLut::m_sMinTexels ) {
+			// ICC curves carry their own parameters so their tables can't be shared between images; they are kept per image instead.
+			CTransferLut::TransformRgb( prDst->dRgba, sTotal,
+				IccLut( _pfGammaFuncR, _pvGammaFuncParmR ),
+				IccLut( _pfGammaFuncG, _pvGammaFuncParmG ),
+				IccLut( _pfGammaFuncB, _pvGammaFuncParmB ) );
+			return;
+		}
 		for ( uint32_t D = 0; D < _ui32Depth; ++D ) {
 			uint32_t ui32Slice = _ui32Width * _ui32Height * D;
 			for ( uint32_t H = 0; H < _ui32Height; ++H ) {
@@ -1469,11 +1716,80 @@ namespace sl2 {
 		}
 
 
-		return Palette().GenPalette_kMeans( reinterpret_cast<const CPalette::CColor *>(vQuant.data()), vQuant.size(),
+		return Palette().GenPalette( reinterpret_cast<const CPalette::CColor *>(vQuant.data()), vQuant.size(),
 			_ui32PalTotal,
 			(CFormat::m_skMeansIterations == ~size_t( 0 )) ? _ui32PalTotal : CFormat::m_skMeansIterations );
 	}
 
+	/**
+	 * Generates one palette from every mipmap, array slice, and face of an image.  Large images are sampled at an even stride
+	 *	across all surfaces, so each sample stands for the same number of texels.
+	 * 
+	 * \param _iSrc The image whose surfaces are to be sampled.  Can be this image.
+	 * \param _ui32PalTotal The total number of entries to generate in the palette.
+	 * \return Returns true if all necessary allocations and conversions succeed.
+	 **/
+	bool CImage::GenerateSharedPalette( CImage &_iSrc, uint32_t _ui32PalTotal ) {
+		if ( !_iSrc.Format() || !_iSrc.Format()->pfToRgba64F ) { return false; }
+		// Past this many texels, every Nth texel stands in for its neighbors.
+		constexpr uint64_t ui64MaxSamples = 1ULL << 22;
+
+		uint64_t ui64Total = 0;
+		for ( size_t M = 0; M < _iSrc.Mipmaps(); ++M ) {
+			ui64Total += uint64_t( _iSrc.m_vMipMaps[M]->Width() ) * _iSrc.m_vMipMaps[M]->Height() * _iSrc.m_vMipMaps[M]->Depth() * _iSrc.ArraySize() * _iSrc.Faces();
+		}
+		if ( !ui64Total ) { return true; }
+		uint64_t ui64Stride = (ui64Total + ui64MaxSamples - 1) / ui64MaxSamples;
+
+		bool bRgba64F = _iSrc.Format()->vfVulkanFormat == SL2_VK_FORMAT_R64G64B64A64_SFLOAT;
+		std::vector<CFormat::SL2_RGBA64F, CAlignmentAllocator<CFormat::SL2_RGBA64F, 64>> vSamples, vTmp;
+		try {
+			vSamples.reserve( size_t( (ui64Total + ui64Stride - 1) / ui64Stride ) );
+		}
+		catch ( ... ) { return false; }
+
+		CFormat::SL2_KTX_INTERNAL_FORMAT_DATA ifdData = (*_iSrc.Format());
+		ifdData.pvCustom = &_iSrc;
+		bool bAlpha = !m_bIgnoreAlpha;
+		// Texels are counted across all surfaces so that the stride carries over from one surface to the next.
+		uint64_t ui64Base = 0, ui64Next = 0;
+		for ( size_t M = 0; M < _iSrc.Mipmaps(); ++M ) {
+			uint32_t ui32W = _iSrc.m_vMipMaps[M]->Width(), ui32H = _iSrc.m_vMipMaps[M]->Height(), ui32D = _iSrc.m_vMipMaps[M]->Depth();
+			uint64_t ui64Texels = uint64_t( ui32W ) * ui32H * ui32D;
+			for ( size_t A = 0; A < _iSrc.ArraySize(); ++A ) {
+				for ( size_t F = 0; F < _iSrc.Faces(); ++F ) {
+					const CFormat::SL2_RGBA64F * prgbaSurface = reinterpret_cast<const CFormat::SL2_RGBA64F *>(_iSrc.Data( M, 0, A, F ));
+					if ( !bRgba64F ) {
+						try {
+							vTmp.resize( size_t( ui64Texels ) );
+						}
+						catch ( ... ) { return false; }
+						if ( !_iSrc.Format()->pfToRgba64F( _iSrc.Data( M, 0, A, F ), reinterpret_cast<uint8_t *>(vTmp.data()), ui32W, ui32H, ui32D, &ifdData ) ) { return false; }
+						prgbaSurface = vTmp.data();
+					}
+					if ( bAlpha && !Palette().Format() ) {
+						bAlpha = AlphaIsFullyEqualTo( reinterpret_cast<const uint8_t *>(prgbaSurface), 1.0, ui64Texels );
+					}
+					for ( ; ui64Next < ui64Base + ui64Texels; ui64Next += ui64Stride ) {
+						vSamples.push_back( prgbaSurface[ui64Next-ui64Base] );
+					}
+					ui64Base += ui64Texels;
+				}
+			}
+		}
+
+		// Chosen over all surfaces, the same way GeneratePalette() chooses it for one.
+		if ( !Palette().Format() ) {
+			if ( bAlpha ) {
+				Palette().SetFormat( CFormat::FindPaletteFormatData( SL2_GL_PALETTE8_RGBA8_OES ) );
+			}
+			else {
+				Palette().SetFormat( CFormat::FindPaletteFormatData( SL2_GL_PALETTE8_RGB8_OES ) );
+			}
+		}
+		return GeneratePalette( reinterpret_cast<const uint8_t *>(vSamples.data()), vSamples.size(), _ui32PalTotal );
+	}
+
 	/**
 	 * Sets alpha to 1.0.
 	 *
@@ -1537,158 +1853,626 @@ namespace sl2 {
 	 * \return Returns true if the temporary buffer was allocated.
 	 **/
 	bool CImage::ConvertToNormalMap( CFormat::SL2_RGBA64F * _prgbaData, uint32_t _ui32W, uint32_t _ui32H, uint32_t _ui32D ) {
+		if ( !m_kKernel.Size() ) { return true; }
+		size_t sPageSize = size_t( _ui32W ) * size_t( _ui32H );
 		std::vector<double> vBuffer;
 		try {
-			vBuffer.resize( _ui32W * _ui32H * _ui32D );
+			vBuffer.resize( sPageSize * _ui32D );
 		}
 		catch ( ... ) { return false; }
 
-		size_t sPageSize = size_t( _ui32W ) * size_t( _ui32H );
 		double dBorder = 0.0;
-		for ( uint32_t D = 0; D < _ui32D; ++D ) {
-			for ( uint32_t H = 0; H < _ui32H; ++H ) {
-				for ( uint32_t W = 0; W < _ui32W; ++W ) {
-					size_t sIdx = (sPageSize * D) + (size_t( H ) * size_t( _ui32W )) + size_t( W );
-					if ( m_caKernelChannal == SL2_CA_AVERAGE ) {
-						vBuffer[sIdx] = (_prgbaData[sIdx].dRgba[SL2_CA_R] + _prgbaData[sIdx].dRgba[SL2_CA_G] + _prgbaData[sIdx].dRgba[SL2_CA_B]) / 3.0;
-						dBorder = (m_rResample.dBorderColor[0] + m_rResample.dBorderColor[1] + m_rResample.dBorderColor[2]) / 3.0;
-					}
-					else if ( m_caKernelChannal == SL2_CA_WEIGHTED_AVERAGE ) {
-						vBuffer[sIdx] = _prgbaData[sIdx].dRgba[SL2_CA_R] * CFormat::Luma().dRgb[0] + _prgbaData[sIdx].dRgba[SL2_CA_G] * CFormat::Luma().dRgb[1] + _prgbaData[sIdx].dRgba[SL2_CA_B] * CFormat::Luma().dRgb[2];
-						dBorder = m_rResample.dBorderColor[SL2_CA_R] * CFormat::Luma().dRgb[0] + m_rResample.dBorderColor[SL2_CA_G] * CFormat::Luma().dRgb[1] + m_rResample.dBorderColor[SL2_CA_B] * CFormat::Luma().dRgb[2];
-					}
-					else if ( m_caKernelChannal == SL2_CA_MAX ) {
-						CVector4<SL2_ST_AVX512> vVec( _prgbaData[sIdx].dRgba );
-						vBuffer[sIdx] = vVec.Max();
-						CVector4<SL2_ST_AVX512> vVecBorder( m_rResample.dBorderColor );
-						dBorder = vVecBorder.Max();
-					}
-					else {
-						vBuffer[sIdx] = _prgbaData[sIdx].dRgba[m_caKernelChannal];
-						dBorder = m_rResample.dBorderColor[m_caKernelChannal];
-					}
-				}
+		size_t sTotal = vBuffer.size();
+		if ( m_caKernelChannal == SL2_CA_AVERAGE ) {
+			for ( size_t I = 0; I < sTotal; ++I ) {
+				vBuffer[I] = (_prgbaData[I].dRgba[SL2_CA_R] + _prgbaData[I].dRgba[SL2_CA_G] + _prgbaData[I].dRgba[SL2_CA_B]) / 3.0;
 			}
+			dBorder = (m_rResample.dBorderColor[0] + m_rResample.dBorderColor[1] + m_rResample.dBorderColor[2]) / 3.0;
 		}
+		else if ( m_caKernelChannal == SL2_CA_WEIGHTED_AVERAGE ) {
+			const double dR = CFormat::Luma().dRgb[0], dG = CFormat::Luma().dRgb[1], dB = CFormat::Luma().dRgb[2];
+			for ( size_t I = 0; I < sTotal; ++I ) {
+				vBuffer[I] = _prgbaData[I].dRgba[SL2_CA_R] * dR + _prgbaData[I].dRgba[SL2_CA_G] * dG + _prgbaData[I].dRgba[SL2_CA_B] * dB;
+			}
+			dBorder = m_rResample.dBorderColor[SL2_CA_R] * dR + m_rResample.dBorderColor[SL2_CA_G] * dG + m_rResample.dBorderColor[SL2_CA_B] * dB;
+		}
+		else if ( m_caKernelChannal == SL2_CA_MAX ) {
+			for ( size_t I = 0; I < sTotal; ++I ) {
+				CVector4<SL2_ST_AVX512> vVec( _prgbaData[I].dRgba );
+				vBuffer[I] = vVec.Max();
+			}
+			CVector4<SL2_ST_AVX512> vVecBorder( m_rResample.dBorderColor );
+			dBorder = vVecBorder.Max();
+		}
+		else {
+			for ( size_t I = 0; I < sTotal; ++I ) {
+				vBuffer[I] = _prgbaData[I].dRgba[m_caKernelChannal];
+			}
+			dBorder = m_rResample.dBorderColor[m_caKernelChannal];
+		}
+
 		CKernel kTransp;
 		kTransp = m_kKernel;
 		kTransp.Transpose();
+
+		// Null borders drop taps and change the divisor per texel, which 1-D passes can't reproduce.
+		std::vector<CKernel::SL2_SEPARABLE_TERM> vTerms;
+		bool bSeparable = m_rResample.taColorW != SL2_TA_NULL_BORDER && m_rResample.taColorH != SL2_TA_NULL_BORDER &&
+			m_kKernel.Separate( vTerms );
+
+		// Keep bands tall enough that the rows shared between neighboring bands are a small part of the work.
+		size_t sThreads = CParallelFor::Workers( std::max<size_t>( _ui32H / 32, 1 ) );
+		std::vector<SL2_NORMAL_MAP_THREAD_DATA> vData;
+		try {
+			vData.resize( sThreads );
+		}
+		catch ( ... ) { return false; }
+
 		for ( uint32_t D = 0; D < _ui32D; ++D ) {
-			for ( uint32_t H = 0; H < _ui32H; ++H ) {
-				for ( uint32_t W = 0; W < _ui32W; ++W ) {
-					size_t sIdx = (sPageSize * D) + (size_t( H ) * size_t( _ui32W )) + size_t( W );
-					double dVal0 = ApplyKernel( vBuffer.data(), W, H, _ui32W, _ui32H, D, m_kKernel, m_rResample.taColorW, m_rResample.taColorH, dBorder );
-					double dVal1 = ApplyKernel( vBuffer.data(), W, H, _ui32W, _ui32H, D, kTransp, m_rResample.taColorW, m_rResample.taColorH, dBorder );
-					CVector4<SL2_ST_AVX512> vTmp( dVal0, dVal1, m_dKernelScale, 0.0 );
-					vTmp.Normalize();
-					_prgbaData[sIdx].dRgba[SL2_CA_R] = -vTmp[0] * 0.5 + 0.5;
-					_prgbaData[sIdx].dRgba[SL2_CA_G] = (vTmp[1] * m_dKernelYAxis) * 0.5 + 0.5;
-					_prgbaData[sIdx].dRgba[SL2_CA_B] = vTmp[2] * 0.5 + 0.5;
-					_prgbaData[sIdx].dRgba[SL2_CA_A] = 1.0;
+			uint32_t ui32Rows = uint32_t( (_ui32H + sThreads - 1) / sThreads );
+			for ( size_t T = 0; T < sThreads; ++T ) {
+				SL2_NORMAL_MAP_THREAD_DATA & nmtdThis = vData[T];
+				nmtdThis.pdHeight = vBuffer.data() + sPageSize * D;
+				nmtdThis.prgbaDst = _prgbaData + sPageSize * D;
+				nmtdThis.ui32W = _ui32W;
+				nmtdThis.ui32H = _ui32H;
+				nmtdThis.ui32RowStart = std::min( uint32_t( T * ui32Rows ), _ui32H );
+				nmtdThis.ui32RowEnd = std::min( nmtdThis.ui32RowStart + ui32Rows, _ui32H );
+				nmtdThis.pvTerms = bSeparable ? &vTerms : nullptr;
+				nmtdThis.pkKernel = &m_kKernel;
+				nmtdThis.pkTransp = &kTransp;
+				nmtdThis.taW = m_rResample.taColorW;
+				nmtdThis.taH = m_rResample.taColorH;
+				nmtdThis.dBorder = dBorder;
+				nmtdThis.dScale = m_dKernelScale;
+				nmtdThis.dYAxis = m_dKernelYAxis;
+				nmtdThis.bRet = true;
+			}
+			CParallelFor::Run( sThreads, [&]( size_t _sWorker ) { NormalMapThread( &vData[_sWorker] ); } );
+			for ( size_t T = 0; T < sThreads; ++T ) {
+				if ( !vData[T].bRet ) { return false; }
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Generates a band of rows of a normal map.  When separable terms are supplied, the derivatives are made with 1-D passes over cached
+	 *	rows of horizontally filtered heights, otherwise the kernels are applied directly.  The derivatives are normalized and encoded in
+	 *	the same pass.
+	 * 
+	 * \param _pnmtdData The band to generate.
+	 **/
+	void CImage::NormalMapThread( SL2_NORMAL_MAP_THREAD_DATA * _pnmtdData ) {
+		const uint32_t ui32W = _pnmtdData->ui32W;
+		const uint32_t ui32H = _pnmtdData->ui32H;
+		const uint32_t ui32Size = _pnmtdData->pkKernel->Size();
+		const double dDiv = 1.0 / (double( ui32Size ) * double( ui32Size ));
+		std::vector<double> vDx, vDy;
+		try {
+			vDx.resize( ui32W );
+			vDy.resize( ui32W );
+		}
+		catch ( ... ) { _pnmtdData->bRet = false; return; }
+
+		// Fused normalize and encode of one row.
+		auto aEncode = [&]( uint32_t _ui32Row ) {
+			CFormat::SL2_RGBA64F * prRow = _pnmtdData->prgbaDst + size_t( _ui32Row ) * ui32W;
+			const double dZ2 = _pnmtdData->dScale * _pnmtdData->dScale;
+			for ( uint32_t W = 0; W < ui32W; ++W ) {
+				double dX = vDx[W] * dDiv;
+				double dY = vDy[W] * dDiv;
+				double dInvLen = 1.0 / std::sqrt( dX * dX + dY * dY + dZ2 );
+				prRow[W].dRgba[SL2_CA_R] = -(dX * dInvLen) * 0.5 + 0.5;
+				prRow[W].dRgba[SL2_CA_G] = (dY * dInvLen * _pnmtdData->dYAxis) * 0.5 + 0.5;
+				prRow[W].dRgba[SL2_CA_B] = (_pnmtdData->dScale * dInvLen) * 0.5 + 0.5;
+				prRow[W].dRgba[SL2_CA_A] = 1.0;
+			}
+		};
+
+		if ( !_pnmtdData->pvTerms ) {
+			// Direct 2-D application.
+			double * pdHeight = const_cast<double *>(_pnmtdData->pdHeight);
+			for ( uint32_t H = _pnmtdData->ui32RowStart; H < _pnmtdData->ui32RowEnd; ++H ) {
+				for ( uint32_t W = 0; W < ui32W; ++W ) {
+					// ApplyKernel() already divides.
+					vDx[W] = ApplyKernel( pdHeight, W, H, ui32W, ui32H, 0, (*_pnmtdData->pkKernel), _pnmtdData->taW, _pnmtdData->taH, _pnmtdData->dBorder ) / dDiv;
+					vDy[W] = ApplyKernel( pdHeight, W, H, ui32W, ui32H, 0, (*_pnmtdData->pkTransp), _pnmtdData->taW, _pnmtdData->taH, _pnmtdData->dBorder ) / dDiv;
+				}
+				aEncode( H );
+			}
+			return;
+		}
+
+		// Separable passes.  K = sum( vCol[t] * vRow[t] ), so X = sum( Vert( vCol[t], Horz( vRow[t] ) ) ) and, because the Y kernel is the
+		//	transpose, Y = sum( Vert( vRow[t], Horz( vCol[t] ) ) ).  Horizontal results are cached per source row in a ring of ui32Size rows
+		//	per filter so that each source row is filtered once per band.
+		const std::vector<CKernel::SL2_SEPARABLE_TERM> & vTerms = (*_pnmtdData->pvTerms);
+		const size_t sFilters = vTerms.size() * 2;
+		const int32_t i32Offset = int32_t( ui32Size >> 1 );
+		std::vector<const double *> vHorzFilters, vVertFilters;
+		std::vector<double> vRowSums;
+		std::vector<double> vCache;
+		std::vector<int64_t> vCacheTags;
+		try {
+			for ( size_t T = 0; T < vTerms.size(); ++T ) {
+				vHorzFilters.push_back( vTerms[T].vRow.data() );	// X derivative.
+				vVertFilters.push_back( vTerms[T].vCol.data() );
+				vHorzFilters.push_back( vTerms[T].vCol.data() );	// Y derivative.
+				vVertFilters.push_back( vTerms[T].vRow.data() );
+			}
+			for ( size_t F = 0; F < sFilters; ++F ) {
+				double dSum = 0.0;
+				for ( uint32_t I = 0; I < ui32Size; ++I ) { dSum += vHorzFilters[F][I]; }
+				vRowSums.push_back( dSum );
+			}
+			vCache.resize( sFilters * ui32Size * ui32W );
+			vCacheTags.resize( sFilters * ui32Size, -1 );
+		}
+		catch ( ... ) { _pnmtdData->bRet = false; return; }
+
+		// The columns where every tap lands inside the row.
+		const uint32_t ui32Lo = std::min( uint32_t( i32Offset ), ui32W );
+		const uint32_t ui32Hi = std::max( ui32Lo, ui32W > uint32_t( i32Offset ) ? ui32W - uint32_t( i32Offset ) : 0 );
+
+		// Gets a horizontally filtered source row, filtering it if not already cached.
+		auto aHorzRow = [&]( size_t _sFilter, uint32_t _ui32SrcRow ) -> const double * {
+			size_t sSlot = _sFilter * ui32Size + (_ui32SrcRow % ui32Size);
+			double * pdDst = &vCache[sSlot*ui32W];
+			if ( vCacheTags[sSlot] == int64_t( _ui32SrcRow ) ) { return pdDst; }
+			vCacheTags[sSlot] = int64_t( _ui32SrcRow );
+
+			const double * pdSrc = _pnmtdData->pdHeight + size_t( _ui32SrcRow ) * ui32W;
+			const double * pdFilter = vHorzFilters[_sFilter];
+			std::memset( pdDst, 0, sizeof( double ) * ui32W );
+			for ( uint32_t X = 0; X < ui32Size && ui32Hi > ui32Lo; ++X ) {
+				if ( pdFilter[X] == 0.0 ) { continue; }
+				CResampler::AddWeightedRow( pdDst + ui32Lo, pdSrc + ui32Lo + X - i32Offset, pdFilter[X], ui32Hi - ui32Lo );
+			}
+			// Edges go through texture addressing.
+			for ( uint32_t W = 0; W < ui32W; ++W ) {
+				if ( W == ui32Lo ) { W = ui32Hi; if ( W >= ui32W ) { break; } }
+				double dSum = 0.0;
+				for ( uint32_t X = 0; X < ui32Size; ++X ) {
+					int32_t i32Idx = CTextureAddressing::m_pfFuncs[_pnmtdData->taW]( ui32W, int32_t( W + X ) - i32Offset );
+					dSum += pdFilter[X] * (i32Idx == -1 ? _pnmtdData->dBorder : pdSrc[i32Idx]);
+				}
+				pdDst[W] = dSum;
+			}
+			return pdDst;
+		};
+
+		for ( uint32_t H = _pnmtdData->ui32RowStart; H < _pnmtdData->ui32RowEnd; ++H ) {
+			std::memset( vDx.data(), 0, sizeof( double ) * ui32W );
+			std::memset( vDy.data(), 0, sizeof( double ) * ui32W );
+			double dBorderX = 0.0, dBorderY = 0.0;
+			for ( uint32_t Y = 0; Y < ui32Size; ++Y ) {
+				int32_t i32Idx = CTextureAddressing::m_pfFuncs[_pnmtdData->taH]( ui32H, int32_t( H + Y ) - i32Offset );
+				for ( size_t F = 0; F < sFilters; ++F ) {
+					double dWeight = vVertFilters[F][Y];
+					if ( dWeight == 0.0 ) { continue; }
+					bool bX = (F & 1) == 0;
+					if ( i32Idx == -1 ) {
+						// A whole row of border texels.
+						(bX ? dBorderX : dBorderY) += dWeight * _pnmtdData->dBorder * vRowSums[F];
+					}
+					else {
+						CResampler::AddWeightedRow( bX ? vDx.data() : vDy.data(), aHorzRow( F, uint32_t( i32Idx ) ), dWeight, ui32W );
+					}
+				}
+			}
+			if ( dBorderX != 0.0 || dBorderY != 0.0 ) {
+				for ( uint32_t W = 0; W < ui32W; ++W ) {
+					vDx[W] += dBorderX;
+					vDy[W] += dBorderY;
 				}
 			}
+			aEncode( H );
 		}
+	}
 
+	/**
+	 * Loads an image file held in memory, choosing the loader by the signature at the start of the file.
+	 * 
+	 * \param _vData The image file to load.
+	 * \param _fifHint The FreeImage format to try first when the file has no known signature.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadFile( const std::vector<uint8_t> &_vData, FREE_IMAGE_FORMAT _fifHint ) {
+		CClock cClock;
+		auto Elapsed = [&]() { return (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() ); };
+
+		const SL2_SIGNATURE_LOADER * pslLoader = FindSignatureLoader( _vData );
+		m_dLoaderTime += Elapsed();
+		if ( pslLoader ) {
+			if ( pslLoader->pfLoader ) {
+				cClock.SetStartingTick();
+				if ( SL2_E_SUCCESS == (this->*pslLoader->pfLoader)( _vData ) ) { return SL2_E_SUCCESS; }
+				// FreeImage reads some files the built-in loaders reject, such as BMP files with unusual bit depths.
+				++m_ui32FailedProbes;
+				m_dLoaderTime += Elapsed();
+			}
+			_fifHint = pslLoader->fifFormat;
+		}
+
+		if ( FIF_UNKNOWN != _fifHint ) {
+			cClock.SetStartingTick();
+			if ( SL2_E_SUCCESS == LoadFreeImage( _vData, _fifHint ) ) { return SL2_E_SUCCESS; }
+			// Signatures such as ICO's are short, and extensions can lie.  Let FreeImage identify the file.
+			++m_ui32FailedProbes;
+			m_dLoaderTime += Elapsed();
+		}
+		return LoadFreeImage( _vData );
+	}
 
-		return true;
+	/**
+	 * Finds the loader for a file by the signature at its start.
+	 * 
+	 * \param _vData The file.
+	 * \return Returns the loader, or nullptr if no signature matches.
+	 **/
+	const CImage::SL2_SIGNATURE_LOADER * CImage::FindSignatureLoader( const std::vector<uint8_t> &_vData ) {
+		for ( const auto & slLoader : m_slSignatureLoaders ) {
+			if ( _vData.size() >= slLoader.sOffset + slLoader.sMagicSize &&
+				std::memcmp( _vData.data() + slLoader.sOffset, slLoader.pcMagic, slLoader.sMagicSize ) == 0 ) {
+				return &slLoader;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Finds the loader for a headerless file by its extension.
+	 * 
+	 * \param _u16Extension The file extension.
+	 * \return Returns the loader, or nullptr if no loader handles the extension.
+	 **/
+	const CImage::SL2_EXTENSION_LOADER * CImage::FindExtensionLoader( const std::u16string &_u16Extension ) {
+		try {
+			static const std::unordered_map<std::u16string, const SL2_EXTENSION_LOADER *> umLoaders = []() {
+				std::unordered_map<std::u16string, const SL2_EXTENSION_LOADER *> umRet;
+				for ( const auto & elLoader : m_elExtensionLoaders ) {
+					// The first loader listed for an extension takes it.
+					umRet.emplace( elLoader.pcExtension, &elLoader );
+				}
+				return umRet;
+			}();
+
+			std::u16string u16Lower = _u16Extension;
+			for ( auto & cChar : u16Lower ) {
+				if ( cChar >= u'A' && cChar <= u'Z' ) { cChar += u'a' - u'A'; }
+			}
+			auto aFound = umLoaders.find( u16Lower );
+			return aFound == umLoaders.end() ? nullptr : aFound->second;
+		}
+		catch ( ... ) { return nullptr; }
+	}
+
+	/**
+	 * Finds the YUV loader for a format set with SetYuvSize().
+	 * 
+	 * \param _pkifdFormat The YUV format.
+	 * \return Returns the loader, or nullptr if no loader handles the format.
+	 **/
+	const CImage::SL2_EXTENSION_LOADER * CImage::FindYuvLoader( const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifdFormat ) {
+		if ( !_pkifdFormat ) { return nullptr; }
+		for ( const auto & elLoader : m_elExtensionLoaders ) {
+			if ( (elLoader.vfVulkanFormat != SL2_VK_FORMAT_UNDEFINED && elLoader.vfVulkanFormat == _pkifdFormat->vfVulkanFormat) ||
+				(elLoader.dfDxFormat != SL2_DXGI_FORMAT_UNKNOWN && elLoader.dfDxFormat == _pkifdFormat->dfDxFormat) ) {
+				return &elLoader;
+			}
+		}
+		return nullptr;
 	}
 
 	/**
 	 * Loads using the FreeImage library.
 	 * 
 	 * \param _vData The file to load.
+	 * \param _fifFormat The format of the file, or FIF_UNKNOWN to have FreeImage identify it.
 	 * \return Returns an error code.
 	 **/
-	SL2_ERRORS CImage::LoadFreeImage( const std::vector<uint8_t> &_vData ) {
+	SL2_ERRORS CImage::LoadFreeImage( const std::vector<uint8_t> &_vData, FREE_IMAGE_FORMAT _fifFormat ) {
 		SL2_FREE_IMAGE fiImage( _vData );
 		if ( !fiImage.pmMemory ) { return SL2_E_OUTOFMEMORY; }
 
-		FREE_IMAGE_FORMAT fifFormat = ::FreeImage_GetFileTypeFromMemory( fiImage.pmMemory, 0 );
+		FREE_IMAGE_FORMAT fifFormat = _fifFormat;
+		if ( FIF_UNKNOWN == fifFormat ) {
+			CClock cClock;
+			fifFormat = ::FreeImage_GetFileTypeFromMemory( fiImage.pmMemory, 0 );
+			m_dLoaderTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+		}
 		if ( FIF_UNKNOWN == fifFormat ) { return SL2_E_INVALIDFILETYPE; }
 
 		if ( fifFormat == FIF_GIF || fifFormat == FIF_ICO || fifFormat == FIF_TIFF ) {
-			SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY flmbfmData( fiImage );
+			SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY flmbfmData( fiImage, fifFormat );
+			if ( !flmbfmData.pbBitmap ) { return SL2_E_INVALIDFILETYPE; }
 			int iFrameCount = ::FreeImage_GetPageCount( flmbfmData.pbBitmap );
 
-			SL2_FREEIMAGE_CLONE fcBase;
-			for ( int I = 0; I < iFrameCount; ++I ) {
-				SL2_FREEIMAGE_LOCK_PAGE flpLocked( flmbfmData.pbBitmap, I );
+			// The first page that can be read gives the canvas and the color profile.
+			SL2_PAGE_FRAME pfFirst;
+			uint32_t ui32CanvasW = 0, ui32CanvasH = 0;
+			int iFirst = 0;
+			for ( ; iFirst < iFrameCount; ++iFirst ) {
+				SL2_FREEIMAGE_LOCK_PAGE flpLocked( flmbfmData.pbBitmap, iFirst );
 				if ( !flpLocked.pbBitmap ) { continue; }
 
-				// Retrieve frame metadata.
-				FITAG * pTag = nullptr;
-				long lFrameTime = 0;
-				uint16_t iFrameLeft = 0, iFrameTop = 0;
-				uint8_t iDisposalMethod = 0;
-
-				::FreeImage_GetMetadata( FIMD_ANIMATION, flpLocked.pbBitmap, "FrameLeft", &pTag );
-				if ( pTag ) { iFrameLeft = (*reinterpret_cast<const uint16_t *>(::FreeImage_GetTagValue( pTag ))); }
-
-				pTag = nullptr;
-				::FreeImage_GetMetadata( FIMD_ANIMATION, flpLocked.pbBitmap, "FrameTop", &pTag );
-				if ( pTag ) { iFrameTop = (*reinterpret_cast<const uint16_t *>(::FreeImage_GetTagValue( pTag ))); }
+				SL2_ERRORS eError = LoadFreeImageIcc( flpLocked.pbBitmap );
+				if ( eError != SL2_E_SUCCESS ) { return eError; }
 
+				// The canvas is the GIF logical screen, or the size of the first page for formats without one.
+				ui32CanvasW = ::FreeImage_GetWidth( flpLocked.pbBitmap );
+				ui32CanvasH = ::FreeImage_GetHeight( flpLocked.pbBitmap );
+				FITAG * pTag = nullptr;
+				::FreeImage_GetMetadata( FIMD_ANIMATION, flpLocked.pbBitmap, "LogicalWidth", &pTag );
+				if ( pTag ) { ui32CanvasW = (*reinterpret_cast<const uint16_t *>(::FreeImage_GetTagValue( pTag ))); }
 				pTag = nullptr;
-				::FreeImage_GetMetadata( FIMD_ANIMATION, flpLocked.pbBitmap, "DisposalMethod", &pTag );
-				if ( pTag ) { iDisposalMethod = (*reinterpret_cast<const uint8_t *>(::FreeImage_GetTagValue( pTag ))); }
+				::FreeImage_GetMetadata( FIMD_ANIMATION, flpLocked.pbBitmap, "LogicalHeight", &pTag );
+				if ( pTag ) { ui32CanvasH = (*reinterpret_cast<const uint16_t *>(::FreeImage_GetTagValue( pTag ))); }
 
-				pTag = nullptr;
-				::FreeImage_GetMetadata( FIMD_ANIMATION, flpLocked.pbBitmap, "FrameTime", &pTag );
-				if ( pTag ) { lFrameTime = (*reinterpret_cast<const long *>(::FreeImage_GetTagValue( pTag ))); }
-				
-				// Initialize or restore the base canvas.
-				if ( I == 0 || !fcBase.Bitmap() ) { fcBase = flpLocked.pbBitmap; }
+				DecodeFreeImagePage( flpLocked.pbBitmap, pfFirst );
+				if ( pfFirst.eError != SL2_E_SUCCESS ) { return pfFirst.eError; }
+				break;
+			}
+			if ( iFirst == iFrameCount ) { return SL2_E_INVALIDDATA; }
+			if ( !AllocateTexture( CFormat::FindFormatDataByVulkan( SL2_VK_FORMAT_R8G8B8A8_UNORM ), ui32CanvasW, ui32CanvasH, 1, 1, size_t( iFrameCount - iFirst ) ) ) { return SL2_E_OUTOFMEMORY; }
 
-				// Convert to RGBA32.
-				SL2_FREEIMAGE_FIBITMAP fbTmpBase;
-				SL2_FREEIMAGE_FIBITMAP fbTmpLocked;
+			// Each page is composited into its array slice in order and then released, so only the rectangle of the page before it is kept (with
+			//	what was under it, for disposal 3).
+			SL2_PAGE_FRAME pfPrev;
+			std::vector<CFormat::SL2_RGBA_UNORM> vPrevSaved, vSaved;
+			size_t sSlices = 0;
+			auto Composite = [&]( SL2_PAGE_FRAME &_pfFrame ) {
 				try {
-					fbTmpBase = ConvertToRGBA32( fcBase.Bitmap() );
-					fbTmpLocked = ConvertToRGBA32( flpLocked.pbBitmap );
-					m_vFrameTimes.push_back( lFrameTime );
-				}
-				catch ( ... ) { return SL2_E_INTERNALERROR; }
-
-				// Blend.
-				AlphaBlend( fbTmpBase.Bitmap(), fbTmpLocked.Bitmap(), iFrameLeft, iFrameTop );
-
-				auto aErr = LoadFreeImagePage( fbTmpBase.Bitmap(), I, iFrameCount );
-				if ( aErr != SL2_E_SUCCESS ) { return aErr; }
-
-				// Disposal.
-				if ( iDisposalMethod == 0 || iDisposalMethod == 1 ) {			// GIF_DISPOSAL_LEAVE
-					// Keeps the current contents for the next image.
-					fcBase = fbTmpBase.Bitmap();
-				}
-				else if ( iDisposalMethod == 2 ) {								// GIF_DISPOSAL_BACKGROUND
-					// Clear the current contents for the next image.
-					switch ( ::FreeImage_GetBPP( fbTmpBase.Bitmap() ) ) {
-						case 1 : {} SL2_FALLTHROUGH
-						case 4 : {} SL2_FALLTHROUGH
-						case 8 : {
-							RGBQUAD rgbaVal;
-							rgbaVal.rgbReserved = 0;
-							::FreeImage_FillBackground( fcBase.Bitmap(), &rgbaVal, FI_COLOR_ALPHA_IS_INDEX );
+					m_vFrameTimes.push_back( _pfFrame.lFrameTime );
+					if ( _pfFrame.ui8Disposal == 3 ) {
+						SL2_COMPOSITE_RECT crRect = CompositeRect( _pfFrame, ui32CanvasW, ui32CanvasH );
+						vSaved.resize( size_t( crRect.ui32X1 - crRect.ui32X0 ) * (crRect.ui32Y1 - crRect.ui32Y0) );
+					}
+				}
+				catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+
+				// A texel depends only on the texel at the same location in the slice before it, so bands of rows are composited in parallel.
+				std::atomic<uint32_t> aNext( 0 );
+				SL2_COMPOSITE_THREAD_DATA ctdData;
+				ctdData.piImage = this;
+				ctdData.sSlice = sSlices;
+				ctdData.ppfFrame = &_pfFrame;
+				ctdData.ppfPrev = sSlices ? &pfPrev : nullptr;
+				ctdData.pvPrevSaved = &vPrevSaved;
+				ctdData.pvSaved = &vSaved;
+				ctdData.paNext = &aNext;
+				uint32_t ui32Bands = (ui32CanvasH + SL2_COMPOSITE_BAND - 1) / SL2_COMPOSITE_BAND;
+				CParallelFor::Run( CParallelFor::Workers( ui32Bands ), [&]( size_t ) { CompositeFramesThread( &ctdData ); } );
+
+				// Only the rectangle and disposal of this page are needed from here on.
+				pfPrev = std::move( _pfFrame );
+				pfPrev.vTexels = std::vector<CFormat::SL2_RGBA_UNORM>();
+				std::swap( vPrevSaved, vSaved );
+				++sSlices;
+				return SL2_E_SUCCESS;
+			};
+			SL2_ERRORS eRet = Composite( pfFirst );
+
+			// Pages are decoded independently, so the rest are decoded in parallel, each thread reading from its own FIMULTIBITMAP, while this
+			//	thread composites them in order.  Disposal only affects compositing, which stays in order.
+			SL2_PAGE_QUEUE pqQueue;
+			pqQueue.piImage = this;
+			pqQueue.pvData = &_vData;
+			pqQueue.fifFormat = fifFormat;
+			pqQueue.iPages = iFrameCount;
+			pqQueue.iNext = pqQueue.iComposited = iFirst + 1;
+			size_t sThreads = CParallelFor::Workers( size_t( iFrameCount - pqQueue.iNext ) + 1 );
+			try {
+				// Enough slots that the decoding threads stay ahead while a page is composited.
+				pqQueue.vPages.resize( sThreads * 2 );
+			}
+			catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+			auto Consume = [&]() {
+				for ( int I = pqQueue.iComposited; I < iFrameCount && eRet == SL2_E_SUCCESS; ++I ) {
+					SL2_PAGE_FRAME & pfFrame = pqQueue.vPages[size_t( I )%pqQueue.vPages.size()];
+					{
+						std::unique_lock<std::mutex> ulLock( pqQueue.mMutex );
+						if ( pqQueue.iNext <= I ) {
+							// No thread has taken this page (or none is running); decode it on this thread.
+							pqQueue.iNext = I + 1;
+							ulLock.unlock();
+							pfFrame = SL2_PAGE_FRAME();
+							SL2_FREEIMAGE_LOCK_PAGE flpLocked( flmbfmData.pbBitmap, I );
+							if ( !flpLocked.pbBitmap ) { pfFrame.bSkipped = true; }
+							else { DecodeFreeImagePage( flpLocked.pbBitmap, pfFrame ); }
 						}
-						default : {
-							RGBQUAD rgbaVal;
-							rgbaVal.rgbRed = rgbaVal.rgbBlue = rgbaVal.rgbGreen = rgbaVal.rgbReserved = 0xFF;
-							::FreeImage_FillBackground( fcBase.Bitmap(), &rgbaVal, FI_COLOR_IS_RGBA_COLOR );
+						else {
+							pqQueue.cvChanged.wait( ulLock, [&]() { return pfFrame.bDone; } );
 						}
 					}
-				}
-				else if ( iDisposalMethod == 3 ) {								// GIF_DISPOSAL_PREVIOUS
-					// fcBase already contains the previous contents.
-				}
+					if ( pfFrame.eError != SL2_E_SUCCESS ) { eRet = pfFrame.eError; }
+					else if ( !pfFrame.bSkipped ) { eRet = Composite( pfFrame ); }
+					pfFrame.vTexels = std::vector<CFormat::SL2_RGBA_UNORM>();
+					{
+						std::lock_guard<std::mutex> lgLock( pqQueue.mMutex );
+						pfFrame.bDone = false;
+						++pqQueue.iComposited;
+					}
+					pqQueue.cvChanged.notify_all();
+				}
+				{
+					std::lock_guard<std::mutex> lgLock( pqQueue.mMutex );
+					pqQueue.bStop = true;
+				}
+				pqQueue.cvChanged.notify_all();
+			};
+			// Worker 0 is this thread.  Threads the budget can't start run after it has finished and find nothing left to take.
+			CParallelFor::Run( sThreads, [&]( size_t _sWorker ) {
+				if ( _sWorker ) { DecodeFreeImagePagesThread( &pqQueue ); }
+				else { Consume(); }
+			} );
+			if ( eRet != SL2_E_SUCCESS ) { return eRet; }
+
+			if ( sSlices != ArraySize() ) {
+				// Pages that could not be read leave slices at the end unused.
+				m_vMipMaps[0]->resize( m_vMipMaps[0]->BaseSize() * sSlices );
+				m_sArraySize = sSlices;
 			}
 			return SL2_E_SUCCESS;
 		}
 		else {
-			SL2_FREEIMAGE_LOAD_FROM_MEMORY flfmData( fiImage );
+			uint32_t ui32FullW, ui32FullH;
+			int iFlags = ScaledDecodeFlags( fiImage, fifFormat, ui32FullW, ui32FullH );
+			SL2_FREEIMAGE_LOAD_FROM_MEMORY flfmData( fiImage, fifFormat, iFlags );
+			if ( !flfmData.pbBitmap ) { return SL2_E_INVALIDFILETYPE; }
+			if ( iFlags && (::FreeImage_GetWidth( flfmData.pbBitmap ) != ui32FullW || ::FreeImage_GetHeight( flfmData.pbBitmap ) != ui32FullH) ) {
+				m_ui32FullWidth = ui32FullW;
+				m_ui32FullHeight = ui32FullH;
+			}
 			return LoadFreeImagePage( flfmData.pbBitmap );
 		}
 	}
 
+	/**
+	 * Decodes a page of a multi-page image to RGBA at the size of its own rectangle and reads its animation metadata.  No members are
+	 *	touched, so pages can be decoded on several threads at once, each from its own FIMULTIBITMAP.
+	 * 
+	 * \param _pbPage The locked page.
+	 * \param _pfFrame Holds the decoded page.
+	 **/
+	void CImage::DecodeFreeImagePage( FIBITMAP * _pbPage, SL2_PAGE_FRAME &_pfFrame ) {
+		// Retrieve frame metadata.
+		FITAG * pTag = nullptr;
+		::FreeImage_GetMetadata( FIMD_ANIMATION, _pbPage, "FrameLeft", &pTag );
+		if ( pTag ) { _pfFrame.ui32Left = (*reinterpret_cast<const uint16_t *>(::FreeImage_GetTagValue( pTag ))); }
+
+		pTag = nullptr;
+		::FreeImage_GetMetadata( FIMD_ANIMATION, _pbPage, "FrameTop", &pTag );
+		if ( pTag ) { _pfFrame.ui32Top = (*reinterpret_cast<const uint16_t *>(::FreeImage_GetTagValue( pTag ))); }
+
+		pTag = nullptr;
+		::FreeImage_GetMetadata( FIMD_ANIMATION, _pbPage, "DisposalMethod", &pTag );
+		if ( pTag ) { _pfFrame.ui8Disposal = (*reinterpret_cast<const uint8_t *>(::FreeImage_GetTagValue( pTag ))); }
+
+		pTag = nullptr;
+		::FreeImage_GetMetadata( FIMD_ANIMATION, _pbPage, "FrameTime", &pTag );
+		if ( pTag ) { _pfFrame.lFrameTime = (*reinterpret_cast<const long *>(::FreeImage_GetTagValue( pTag ))); }
+
+		// Convert to RGBA32.
+		SL2_FREEIMAGE_FIBITMAP fbTmpLocked;
+		try {
+			fbTmpLocked = ConvertToRGBA32( _pbPage );
+		}
+		catch ( ... ) {
+			_pfFrame.eError = SL2_E_INTERNALERROR;
+			return;
+		}
+		if ( !fbTmpLocked.Bitmap() ) {
+			_pfFrame.eError = SL2_E_INTERNALERROR;
+			return;
+		}
+
+		_pfFrame.ui32Width = ::FreeImage_GetWidth( fbTmpLocked.Bitmap() );
+		_pfFrame.ui32Height = ::FreeImage_GetHeight( fbTmpLocked.Bitmap() );
+		try {
+			_pfFrame.vTexels.resize( size_t( _pfFrame.ui32Width ) * _pfFrame.ui32Height );
+		}
+		catch ( ... ) {
+			_pfFrame.eError = SL2_E_OUTOFMEMORY;
+			return;
+		}
+		for ( uint32_t Y = 0; Y < _pfFrame.ui32Height; ++Y ) {
+			const RGBQUAD * prgbqData = reinterpret_cast<const RGBQUAD *>(::FreeImage_GetScanLine( fbTmpLocked.Bitmap(), int( _pfFrame.ui32Height - Y - 1 ) ));
+			CFormat::SL2_RGBA_UNORM * pRgb = _pfFrame.vTexels.data() + size_t( _pfFrame.ui32Width ) * Y;
+			for ( uint32_t X = 0; X < _pfFrame.ui32Width; ++X ) {
+				pRgb[X].ui8Rgba[SL2_PC_R] = prgbqData[X].rgbRed;
+				pRgb[X].ui8Rgba[SL2_PC_G] = prgbqData[X].rgbGreen;
+				pRgb[X].ui8Rgba[SL2_PC_B] = prgbqData[X].rgbBlue;
+				pRgb[X].ui8Rgba[SL2_PC_A] = prgbqData[X].rgbReserved;
+			}
+		}
+	}
+
+	/**
+	 * A thread decoding pages of a multi-page image ahead of LoadFreeImage().  Takes pages in order until none remain or it is told to stop.
+	 * 
+	 * \param _ppqQueue The shared state of the load.
+	 **/
+	void CImage::DecodeFreeImagePagesThread( SL2_PAGE_QUEUE * _ppqQueue ) {
+		SL2_PAGE_QUEUE & pqQueue = (*_ppqQueue);
+		// FreeImage keeps a read position in each FIMULTIBITMAP, so this thread opens the file on its own, once it has a page to decode.
+		std::unique_ptr<SL2_FREE_IMAGE> upImage;
+		std::unique_ptr<SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY> upPages;
+		for ( ;; ) {
+			int iPage;
+			{
+				std::unique_lock<std::mutex> ulLock( pqQueue.mMutex );
+				pqQueue.cvChanged.wait( ulLock, [&]() {
+					return pqQueue.bStop || pqQueue.iNext == pqQueue.iPages ||
+						size_t( pqQueue.iNext - pqQueue.iComposited ) < pqQueue.vPages.size();
+				} );
+				if ( pqQueue.bStop || pqQueue.iNext == pqQueue.iPages ) { return; }
+				iPage = pqQueue.iNext++;
+			}
+
+			SL2_PAGE_FRAME pfFrame;
+			try {
+				if ( !upPages ) {
+					upImage = std::make_unique<SL2_FREE_IMAGE>( (*pqQueue.pvData) );
+					upPages = std::make_unique<SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY>( (*upImage), pqQueue.fifFormat );
+				}
+				if ( !upImage->pmMemory || !upPages->pbBitmap ) { pfFrame.eError = SL2_E_OUTOFMEMORY; }
+				else {
+					SL2_FREEIMAGE_LOCK_PAGE flpLocked( upPages->pbBitmap, iPage );
+					if ( !flpLocked.pbBitmap ) { pfFrame.bSkipped = true; }
+					else { pqQueue.piImage->DecodeFreeImagePage( flpLocked.pbBitmap, pfFrame ); }
+				}
+			}
+			catch ( ... ) { pfFrame.eError = SL2_E_OUTOFMEMORY; }
+			{
+				std::lock_guard<std::mutex> lgLock( pqQueue.mMutex );
+				SL2_PAGE_FRAME & pfSlot = pqQueue.vPages[size_t( iPage )%pqQueue.vPages.size()];
+				pfSlot = std::move( pfFrame );
+				pfSlot.bDone = true;
+			}
+			pqQueue.cvChanged.notify_all();
+		}
+	}
+
+	/**
+	 * Gets the FreeImage load flags that have the JPEG or WebP decoder scale an image down to the size
+	 *	returned by m_pfDecodeSize.  Only the header of the file is read.
+	 * 
+	 * \param _fiImage The file to load.
+	 * \param _fifFormat The format of the file.
+	 * \param _ui32FullW Holds the width of the image in the file.
+	 * \param _ui32FullH Holds the height of the image in the file.
+	 * \return Returns the flags to pass to FreeImage_LoadFromMemory(), or 0 if the image must be decoded at the full size.
+	 **/
+	int CImage::ScaledDecodeFlags( SL2_FREE_IMAGE &_fiImage, FREE_IMAGE_FORMAT _fifFormat, uint32_t &_ui32FullW, uint32_t &_ui32FullH ) {
+		_ui32FullW = _ui32FullH = 0;
+		if ( !m_pfDecodeSize ) { return 0; }
+		if ( _fifFormat != FIF_JPEG && _fifFormat != FIF_WEBP ) { return 0; }
+		{
+			SL2_FREEIMAGE_LOAD_FROM_MEMORY flfmHeader( _fiImage, _fifFormat, FIF_LOAD_NOPIXELS );
+			::FreeImage_SeekMemory( _fiImage.pmMemory, 0, SEEK_SET );
+			if ( !flfmHeader.pbBitmap ) { return 0; }
+			_ui32FullW = ::FreeImage_GetWidth( flfmHeader.pbBitmap );
+			_ui32FullH = ::FreeImage_GetHeight( flfmHeader.pbBitmap );
+		}
+		uint32_t ui32NeededW = 0, ui32NeededH = 0;
+		if ( !_ui32FullW || !_ui32FullH || !m_pfDecodeSize( m_pvDecodeSizeParm, _ui32FullW, _ui32FullH, ui32NeededW, ui32NeededH ) ) { return 0; }
+		ui32NeededW = std::max( ui32NeededW, 1U );
+		ui32NeededH = std::max( ui32NeededH, 1U );
+
+		// The decoders scale by powers of 2, rounding up.  Find the largest that keeps both dimensions at least as large as needed.
+		uint32_t ui32Shift = 0;
+		while ( (_ui32FullW >> (ui32Shift + 1)) >= ui32NeededW && (_ui32FullH >> (ui32Shift + 1)) >= ui32NeededH ) { ++ui32Shift; }
+		if ( !ui32Shift ) { return 0; }
+
+		// FreeImage takes a requested size for the larger dimension in the upper 16 bits and chooses the same power of 2 from it.
+		uint32_t ui32Requested = std::max( _ui32FullW, _ui32FullH ) >> ui32Shift;
+		if ( ui32Requested > 0x7FFF ) { return 0; }
+		return int( ui32Requested << 16 );
+	}
+
 	/**
 	 * Loads a page given a FreeImage FIBITMAP pointer and the page index.
 	 * 
@@ -1709,59 +2493,8 @@ namespace sl2 {
 		FREE_IMAGE_TYPE fitType = ::FreeImage_GetImageType( _pbBitmap );
 
 		if ( _sIdx == 0 ) {
-			FIICCPROFILE * pProfile = _pbBitmap ? ::FreeImage_GetICCProfile( _pbBitmap ) : nullptr;
-			if ( pProfile && (pProfile->flags & FIICC_COLOR_IS_CMYK) == FIICC_COLOR_IS_CMYK ) {
-				return SL2_E_BADFORMAT;
-			}
-			if ( pProfile && pProfile->size ) {
-				try {
-					m_vIccProfile.resize( pProfile->size );
-					std::memcpy( m_vIccProfile.data(), pProfile->data, pProfile->size );
-				}
-				catch ( ... ) { return SL2_E_OUTOFMEMORY; }
-				m_dGamma = 0.0;
-				m_dTargetGamma = 0.0;
-				size_t sSize;
-				size_t sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigRedTRCTag, sSize );
-				if ( sOffset ) {
-					uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
-					if ( CIcc::FillOutTransferFunc( m_tfInColorSpaceTransferFunc[SL2_PC_R], pui8Data, sSize ) ) {
-						m_dGamma = 0.0;
-					}
-				}
-				/*sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigGreenTRCTag, sSize );
-				if ( sOffset ) {
-					uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
-					if ( CIcc::FillOutTransferFunc( m_tfInColorSpaceTransferFunc[SL2_PC_G], pui8Data, sSize ) ) {
-						m_dGamma = 0.0;
-					}
-				}
-				sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigBlueTRCTag, sSize );
-				if ( sOffset ) {
-					uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
-					if ( CIcc::FillOutTransferFunc( m_tfInColorSpaceTransferFunc[SL2_PC_B], pui8Data, sSize ) ) {
-						m_dGamma = 0.0;
-					}
-				}*/
-
-
-				/*sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigRedColorantTag, sSize );
-				if ( sOffset ) {
-					CVector4<SL2_ST_AVX512> vTmp( 0.43603515625, 0.2224884033203125, 0.013916015625, 0.0 );
-					CVector4<SL2_ST_AVX512> vTmp1( vTmp[0] / vTmp[1], 1.0, vTmp[2] / vTmp[1], 0.0 );
-					CVector4<SL2_ST_AVX512> vTmp2 = vTmp1;
-					vTmp2.Normalize();
-					double dX = vTmp1[0] / (vTmp1[0] + vTmp1[1] + vTmp1[2]);
-					double dY = vTmp1[1] / (vTmp1[0] + vTmp1[1] + vTmp1[2]);
-					double dChromaX, dChromaZ;
-					CUtilities::XYZtoChromaticity( 0.43603515625, 0.2224884033203125, 0.013916015625, dChromaX, dChromaZ );
-					CVector4<SL2_ST_AVX512> vChroma( dX * (0.2224884033203125 / dY), 0.2224884033203125, (1.0 - dX - dY) * (0.2224884033203125 / dY), 0.0 );
-					vTmp = vChroma;
-					vTmp.Normalize();
-					uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
-					sOffset = 0;
-				}*/
-			}
+			SL2_ERRORS eError = LoadFreeImageIcc( _pbBitmap );
+			if ( eError != SL2_E_SUCCESS ) { return eError; }
 		}
 
 		switch ( fitType ) {
@@ -2109,6 +2842,70 @@ namespace sl2 {
 		return SL2_E_SUCCESS;
 	}
 
+	/**
+	 * Loads the ICC profile of a FreeImage bitmap and the transfer functions in it.
+	 * 
+	 * \param _pbBitmap The bitmap whose profile is to be loaded.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadFreeImageIcc( FIBITMAP * _pbBitmap ) {
+		FIICCPROFILE * pProfile = _pbBitmap ? ::FreeImage_GetICCProfile( _pbBitmap ) : nullptr;
+		if ( pProfile && (pProfile->flags & FIICC_COLOR_IS_CMYK) == FIICC_COLOR_IS_CMYK ) {
+			return SL2_E_BADFORMAT;
+		}
+		if ( pProfile && pProfile->size ) {
+			try {
+				m_vIccProfile.resize( pProfile->size );
+				std::memcpy( m_vIccProfile.data(), pProfile->data, pProfile->size );
+			}
+			catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+			m_dGamma = 0.0;
+			m_dTargetGamma = 0.0;
+			ResetIccLuts();
+			size_t sSize;
+			size_t sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigRedTRCTag, sSize );
+			if ( sOffset ) {
+				uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
+				if ( CIcc::FillOutTransferFunc( m_tfInColorSpaceTransferFunc[SL2_PC_R], pui8Data, sSize ) ) {
+					m_dGamma = 0.0;
+				}
+			}
+			/*sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigGreenTRCTag, sSize );
+			if ( sOffset ) {
+				uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
+				if ( CIcc::FillOutTransferFunc( m_tfInColorSpaceTransferFunc[SL2_PC_G], pui8Data, sSize ) ) {
+					m_dGamma = 0.0;
+				}
+			}
+			sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigBlueTRCTag, sSize );
+			if ( sOffset ) {
+				uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
+				if ( CIcc::FillOutTransferFunc( m_tfInColorSpaceTransferFunc[SL2_PC_B], pui8Data, sSize ) ) {
+					m_dGamma = 0.0;
+				}
+			}*/
+
+
+			/*sOffset = CIcc::GetTagDataOffset( static_cast<uint8_t *>(pProfile->data), pProfile->size, icSigRedColorantTag, sSize );
+			if ( sOffset ) {
+				CVector4<SL2_ST_AVX512> vTmp( 0.43603515625, 0.2224884033203125, 0.013916015625, 0.0 );
+				CVector4<SL2_ST_AVX512> vTmp1( vTmp[0] / vTmp[1], 1.0, vTmp[2] / vTmp[1], 0.0 );
+				CVector4<SL2_ST_AVX512> vTmp2 = vTmp1;
+				vTmp2.Normalize();
+				double dX = vTmp1[0] / (vTmp1[0] + vTmp1[1] + vTmp1[2]);
+				double dY = vTmp1[1] / (vTmp1[0] + vTmp1[1] + vTmp1[2]);
+				double dChromaX, dChromaZ;
+				CUtilities::XYZtoChromaticity( 0.43603515625, 0.2224884033203125, 0.013916015625, dChromaX, dChromaZ );
+				CVector4<SL2_ST_AVX512> vChroma( dX * (0.2224884033203125 / dY), 0.2224884033203125, (1.0 - dX - dY) * (0.2224884033203125 / dY), 0.0 );
+				vTmp = vChroma;
+				vTmp.Normalize();
+				uint8_t * pui8Data = static_cast<uint8_t *>(pProfile->data) + sOffset;
+				sOffset = 0;
+			}*/
+		}
+		return SL2_E_SUCCESS;
+	}
+
 	/**
 	 * \brief Converts a FreeImage bitmap to 32-bit RGBA.
 	 *
@@ -2178,44 +2975,73 @@ namespace sl2 {
 	//}
 
 	/**
-	 * \brief Blends one image onto another with transparency support.
-	 *
-	 * \param _pbBaseCanvas The destination image.
-	 * \param _pbBitmapFrame The source image to blend onto the destination.
-	 * \param _iFrameLeft The left offset for the frame.
-	 * \param _iFrameTop The top offset for the frame.
-	 */
-	void CImage::AlphaBlend( FIBITMAP * _pbBaseCanvas, FIBITMAP * _pbBitmapFrame, uint16_t _iFrameLeft, uint16_t _iFrameTop ) {
-		unsigned uBaseW = ::FreeImage_GetWidth( _pbBaseCanvas );
-		unsigned uBaseH = ::FreeImage_GetHeight( _pbBaseCanvas );
-		unsigned uFrameW = ::FreeImage_GetWidth( _pbBitmapFrame );
-		unsigned uFrameH = ::FreeImage_GetHeight( _pbBitmapFrame );
-
-		unsigned uBasePitch = ::FreeImage_GetPitch( _pbBaseCanvas );
-		unsigned uFramePitch = ::FreeImage_GetPitch( _pbBitmapFrame );
-
-		BYTE * pbBaseBits = ::FreeImage_GetBits( _pbBaseCanvas );
-		BYTE * pbFrameBits = ::FreeImage_GetBits( _pbBitmapFrame );
-		_iFrameTop = (uBaseH) - (uFrameH + _iFrameTop);
-		for ( unsigned Y = 0; Y < uFrameH; ++Y ) {
-			if ( _iFrameTop + Y >= uBaseH ) { continue; }
-
-			BYTE * pbBaseRow = pbBaseBits + (_iFrameTop + Y) * uBasePitch;
-			BYTE * pbFrameRow = pbFrameBits + Y * uFramePitch;
-
-			for ( unsigned X = 0; X < uFrameW; ++X ) {
-				if ( _iFrameLeft + X >= uBaseW ) { continue; }
-
-				BYTE * pbBasePixel = pbBaseRow + (_iFrameLeft + X) * 4; // Assuming 32-bit images (RGBA)
-				BYTE * pbFramePixel = pbFrameRow + X * 4;
+	 * Composites a page into its array slice, one band of rows at a time.  The slice starts as a copy of the one before it, and only
+	 *	the rectangles of the previous page (for disposal) and the current page are touched after that.
+	 * 
+	 * \param _pctdData The shared state.
+	 **/
+	void CImage::CompositeFramesThread( SL2_COMPOSITE_THREAD_DATA * _pctdData ) {
+		CImage & iImage = (*_pctdData->piImage);
+		const SL2_PAGE_FRAME & pfFrame = (*_pctdData->ppfFrame);
+		const uint32_t ui32W = iImage.Width(), ui32H = iImage.Height();
+		const size_t sPitch = SL2_ROUND_UP( ui32W * sizeof( CFormat::SL2_RGBA_UNORM ), 4 );
+		const SL2_COMPOSITE_RECT crRect = CompositeRect( pfFrame, ui32W, ui32H );
+		const SL2_COMPOSITE_RECT crPrev = _pctdData->ppfPrev ? CompositeRect( (*_pctdData->ppfPrev), ui32W, ui32H ) : SL2_COMPOSITE_RECT();
+		const size_t sRowSize = size_t( crRect.ui32X1 - crRect.ui32X0 ) * sizeof( CFormat::SL2_RGBA_UNORM );
+		const size_t sPrevRowSize = size_t( crPrev.ui32X1 - crPrev.ui32X0 ) * sizeof( CFormat::SL2_RGBA_UNORM );
+		uint8_t * pui8Dst = iImage.Data( 0, 0, _pctdData->sSlice );
+		while ( true ) {
+			uint32_t ui32Y0 = _pctdData->paNext->fetch_add( 1, std::memory_order_relaxed ) * SL2_COMPOSITE_BAND;
+			if ( ui32Y0 >= ui32H ) { break; }
+			uint32_t ui32Y1 = std::min( ui32Y0 + SL2_COMPOSITE_BAND, ui32H );
+
+			if ( !_pctdData->ppfPrev ) {
+				std::memset( pui8Dst + sPitch * ui32Y0, 0, sPitch * (ui32Y1 - ui32Y0) );
+			}
+			else {
+				std::memcpy( pui8Dst + sPitch * ui32Y0, iImage.Data( 0, 0, _pctdData->sSlice - 1 ) + sPitch * ui32Y0, sPitch * (ui32Y1 - ui32Y0) );
+
+				// Disposal of the previous page.
+				uint8_t ui8Disposal = _pctdData->ppfPrev->ui8Disposal;
+				if ( ui8Disposal == 2 || ui8Disposal == 3 ) {		// GIF_DISPOSAL_BACKGROUND/GIF_DISPOSAL_PREVIOUS
+					uint32_t ui32Top = std::max( crPrev.ui32Y0, ui32Y0 ), ui32Bottom = std::min( crPrev.ui32Y1, ui32Y1 );
+					for ( uint32_t Y = ui32Top; Y < ui32Bottom && sPrevRowSize; ++Y ) {
+						uint8_t * pui8Row = pui8Dst + sPitch * Y + crPrev.ui32X0 * sizeof( CFormat::SL2_RGBA_UNORM );
+						if ( ui8Disposal == 2 ) {
+							std::memset( pui8Row, 0, sPrevRowSize );
+						}
+						else {
+							std::memcpy( pui8Row, _pctdData->pvPrevSaved->data() + size_t( crPrev.ui32X1 - crPrev.ui32X0 ) * (Y - crPrev.ui32Y0), sPrevRowSize );
+						}
+					}
+				}
+			}
 
-				BYTE bFrameAlpha = pbFramePixel[FI_RGBA_ALPHA];
-				float fAlpha = bFrameAlpha / 255.0f;
+			uint32_t ui32Top = std::max( crRect.ui32Y0, ui32Y0 ), ui32Bottom = std::min( crRect.ui32Y1, ui32Y1 );
+			if ( !sRowSize || ui32Top >= ui32Bottom ) { continue; }
+			if ( pfFrame.ui8Disposal == 3 ) {
+				for ( uint32_t Y = ui32Top; Y < ui32Bottom; ++Y ) {
+					std::memcpy( _pctdData->pvSaved->data() + size_t( crRect.ui32X1 - crRect.ui32X0 ) * (Y - crRect.ui32Y0),
+						pui8Dst + sPitch * Y + crRect.ui32X0 * sizeof( CFormat::SL2_RGBA_UNORM ), sRowSize );
+				}
+			}
 
-				pbBasePixel[FI_RGBA_RED] = static_cast<BYTE>((1 - fAlpha) * pbBasePixel[FI_RGBA_RED] + fAlpha * pbFramePixel[FI_RGBA_RED]);
-				pbBasePixel[FI_RGBA_GREEN] = static_cast<BYTE>((1 - fAlpha) * pbBasePixel[FI_RGBA_GREEN] + fAlpha * pbFramePixel[FI_RGBA_GREEN]);
-				pbBasePixel[FI_RGBA_BLUE] = static_cast<BYTE>((1 - fAlpha) * pbBasePixel[FI_RGBA_BLUE] + fAlpha * pbFramePixel[FI_RGBA_BLUE]);
-				pbBasePixel[FI_RGBA_ALPHA] = static_cast<BYTE>(std::max( pbBasePixel[FI_RGBA_ALPHA], bFrameAlpha ));
+			// Blend.
+			for ( uint32_t Y = ui32Top; Y < ui32Bottom; ++Y ) {
+				CFormat::SL2_RGBA_UNORM * pBase = reinterpret_cast<CFormat::SL2_RGBA_UNORM *>(pui8Dst + sPitch * Y);
+				const CFormat::SL2_RGBA_UNORM * pFrame = pfFrame.vTexels.data() + size_t( pfFrame.ui32Width ) * (Y - pfFrame.ui32Top);
+				for ( uint32_t X = crRect.ui32X0; X < crRect.ui32X1; ++X ) {
+					const CFormat::SL2_RGBA_UNORM & rgbaSrc = pFrame[X-pfFrame.ui32Left];
+					uint8_t ui8Alpha = rgbaSrc.ui8Rgba[SL2_PC_A];
+					if ( ui8Alpha == 255 ) { pBase[X] = rgbaSrc; }
+					else if ( ui8Alpha ) {
+						float fAlpha = ui8Alpha / 255.0f;
+						for ( size_t C = SL2_PC_R; C <= SL2_PC_B; ++C ) {
+							pBase[X].ui8Rgba[C] = static_cast<uint8_t>((1 - fAlpha) * pBase[X].ui8Rgba[C] + fAlpha * rgbaSrc.ui8Rgba[C]);
+						}
+						pBase[X].ui8Rgba[SL2_PC_A] = std::max( pBase[X].ui8Rgba[SL2_PC_A], ui8Alpha );
+					}
+				}
 			}
 		}
 	}
@@ -2279,7 +3105,47 @@ namespace sl2 {
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS CImage::LoadDds( const std::vector<uint8_t> &_vData ) {
-		CDds dFile;
+		std::unique_ptr<SL2_LAZY_SOURCE> plsLazy;
+		if ( !m_bLazyDecode ) { return LoadDds( _vData, plsLazy ); }
+		try {
+			// The surfaces point into the file, so a lazily decoded file keeps its own copy.
+			plsLazy = std::make_unique<SL2_LAZY_SOURCE>();
+			plsLazy->vFile = _vData;
+		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+		return LoadDds( plsLazy->vFile, plsLazy );
+	}
+
+	/**
+	 * Loads a DDS file from memory, taking the file if its surfaces are decoded lazily.
+	 * 
+	 * \param _vData The file to load.  Emptied if the file is taken, which happens only on success.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadDds( std::vector<uint8_t> &&_vData ) {
+		std::unique_ptr<SL2_LAZY_SOURCE> plsLazy;
+		if ( !m_bLazyDecode ) { return LoadDds( _vData, plsLazy ); }
+		try {
+			plsLazy = std::make_unique<SL2_LAZY_SOURCE>();
+		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+		// Moving the file keeps its buffer, so the surfaces can point into it.
+		plsLazy->vFile = std::move( _vData );
+		SL2_ERRORS eError = LoadDds( plsLazy->vFile, plsLazy );
+		if ( eError != SL2_E_SUCCESS ) { _vData = std::move( plsLazy->vFile ); }
+		return eError;
+	}
+
+	/**
+	 * Loads a DDS file from memory.
+	 * 
+	 * \param _vData The file to load.  If _plsLazy is not nullptr, this is _plsLazy->vFile.
+	 * \param _plsLazy The source of lazily decoded surfaces, or nullptr to decode every surface now.  Taken on success.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadDds( const std::vector<uint8_t> &_vData, std::unique_ptr<SL2_LAZY_SOURCE> &_plsLazy ) {
+		CDds dEager;
+		CDds & dFile = _plsLazy ? _plsLazy->dDds : dEager;
 		if ( !dFile.LoadDds( _vData ) ) { return SL2_E_INVALIDFILETYPE; }
 
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * aFmt = nullptr;
@@ -2309,91 +3175,29 @@ namespace sl2 {
 		if ( !aFmt ) { return SL2_E_INVALIDFILETYPE; }
 		if ( !AllocateTexture( aFmt,
 			dFile.Width(), dFile.Height(), dFile.Depth(),
-			dFile.Mips(), dFile.Array(), dFile.Faces() ) ) { return SL2_E_OUTOFMEMORY; }
-		if ( dFile.Faces() > 1 ) {
+			dFile.Mips(), dFile.Array(), dFile.Faces(), _plsLazy.get() != nullptr ) ) { return SL2_E_OUTOFMEMORY; }
+		// Lazily decoded surfaces are only checked here, so that Data() cannot fail on a short file.
+		for ( uint32_t A = 0; A < (dFile.Faces() > 1 ? 1 : dFile.Array()); ++A ) {
 			for ( uint32_t F = 0; F < dFile.Faces(); ++F ) {
 				for ( uint32_t M = 0; M < dFile.Mips(); ++M ) {
-					size_t sIdx = F * dFile.Mips() + M;
-					if ( sIdx >= dFile.Buffers().size() ) { return SL2_E_INVALIDDATA; }
-					uint32_t ui32Width = std::max( dFile.Width() >> M, static_cast<uint32_t>(1) );
-					uint32_t ui32Height = std::max( dFile.Height() >> M, static_cast<uint32_t>(1) );
-					uint32_t ui32Depth = std::max( dFile.Depth() >> M, static_cast<uint32_t>(1) );
-
-					if ( dFile.Header().ui32Flags & SL2_DF_LINEARSIZE ) {
-						// Compressed texture.
-						uint64_t ui64PageSize = CFormat::GetFormatSize( aFmt, ui32Width,
-							ui32Height,
-							1 );
-						if ( uint64_t( size_t( ui64PageSize ) ) != ui64PageSize ) { return SL2_E_UNSUPPORTEDSIZE; }
-						for ( uint32_t D = 0; D < ui32Depth; ++D ) {
-							if ( dFile.Buffers()[sIdx].vTexture.size() - (ui64PageSize * D) < ui64PageSize ) { return SL2_E_INVALIDDATA; }
-							std::memcpy( Data( M, D, 0, F ), dFile.Buffers()[sIdx].vTexture.data() + ui64PageSize * D, size_t( ui64PageSize ) );
-						}
-					}
-					else {
-						uint64_t ui64SrcPitch = CFormat::GetRowSize_NoPadding( aFmt, std::max( dFile.Width() >> M, static_cast<uint32_t>(1) ) );
-						if ( uint64_t( size_t( ui64SrcPitch ) ) != ui64SrcPitch ) { return SL2_E_UNSUPPORTEDSIZE; }
-						auto aPitch = CFormat::GetRowSize( aFmt, std::max( dFile.Width() >> M, static_cast<uint32_t>(1) ) );
-
-						for ( uint32_t D = 0; D < ui32Depth; ++D ) {
-							uint64_t ui64DstSliceOffset = D * ui32Height * aPitch;
-							uint64_t ui64SrcSliceOffset = D * ui32Height * ui64SrcPitch;
-
-							for ( uint32_t H = 0; H < ui32Height; ++H ) {
-								uint64_t ui64Dst = aPitch * H + ui64DstSliceOffset;
-								uint64_t ui64Src = ui64SrcPitch * H + ui64SrcSliceOffset;
-
-								if ( (dFile.Buffers()[sIdx].vTexture.size() - ui64Src) < ui64SrcPitch ) { return SL2_E_INVALIDDATA; }
-								std::memcpy( Data( M, 0, 0, F ) + ui64Dst, dFile.Buffers()[sIdx].vTexture.data() + ui64Src, size_t( ui64SrcPitch ) );
-							}
-						}
-					}
-					//std::memcpy( Data( M, 0, 0, F ), dFile.Buffers()[sIdx].vTexture.data(), dFile.Buffers()[sIdx].vTexture.size() );
+					SL2_ERRORS eError = CopyDdsSurface( dFile, M, A, F, _plsLazy ? nullptr : Data( M, 0, A, F ) );
+					if ( SL2_E_SUCCESS != eError ) { return eError; }
 				}
 			}
 		}
-		else {
-			for ( uint32_t A = 0; A < dFile.Array(); ++A ) {
-				for ( uint32_t M = 0; M < dFile.Mips(); ++M ) {
-					size_t sIdx = A * dFile.Mips() + M;
-					if ( sIdx >= dFile.Buffers().size() ) { return SL2_E_INVALIDDATA; }
-					
-					uint32_t ui32Width = std::max( dFile.Width() >> M, static_cast<uint32_t>(1) );
-					uint32_t ui32Height = std::max( dFile.Height() >> M, static_cast<uint32_t>(1) );
-					uint32_t ui32Depth = std::max( dFile.Depth() >> M, static_cast<uint32_t>(1) );
-
-					if ( dFile.Header().ui32Flags & SL2_DF_LINEARSIZE ) {
-						// Compressed texture.
-						uint64_t ui64PageSize = CFormat::GetFormatSize( aFmt, ui32Width,
-							ui32Height,
-							1 );
-						if ( uint64_t( size_t( ui64PageSize ) ) != ui64PageSize ) { return SL2_E_UNSUPPORTEDSIZE; }
-						for ( uint32_t D = 0; D < ui32Depth; ++D ) {
-							if ( dFile.Buffers()[sIdx].vTexture.size() - (ui64PageSize * D) < ui64PageSize ) { return SL2_E_INVALIDDATA; }
-							std::memcpy( Data( M, D, A, 0 ), dFile.Buffers()[sIdx].vTexture.data() + ui64PageSize * D, size_t( ui64PageSize ) );
-						}
-					}
-					else {
-						uint64_t ui64SrcPitch = CFormat::GetRowSize_NoPadding( aFmt, std::max( dFile.Width() >> M, static_cast<uint32_t>(1) ) );
-						if ( uint64_t( size_t( ui64SrcPitch ) ) != ui64SrcPitch ) { return SL2_E_UNSUPPORTEDSIZE; }
-						auto aPitch = CFormat::GetRowSize( aFmt, std::max( dFile.Width() >> M, static_cast<uint32_t>(1) ) );
-
-						for ( uint32_t D = 0; D < ui32Depth; ++D ) {
-							uint64_t ui64DstSliceOffset = D * ui32Height * aPitch;
-							uint64_t ui64SrcSliceOffset = D * ui32Height * ui64SrcPitch;
-							for ( uint32_t H = 0; H < ui32Height; ++H ) {
-								uint64_t ui64Dst = aPitch * H + ui64DstSliceOffset;
-								uint64_t ui64Src = ui64SrcPitch * H + ui64SrcSliceOffset;
-
-								if ( dFile.Buffers()[sIdx].vTexture.size() - ui64Src < ui64SrcPitch ) { return SL2_E_INVALIDDATA; }
-								std::memcpy( Data( M, 0, A, 0 ) + ui64Dst, dFile.Buffers()[sIdx].vTexture.data() + ui64Src, size_t( ui64SrcPitch ) );
-							}
-						}
-					}
-
-					//std::memcpy( Data( M, 0, 0, F ), dFile.Buffers()[sIdx].vTexture.data(), dFile.Buffers()[sIdx].vTexture.size() );
-				}
+		if ( _plsLazy ) {
+			try {
+				_plsLazy->vSurfaces.resize( Mipmaps() * ArraySize() * Faces() );
+				_plsLazy->vResidentPos.resize( _plsLazy->vSurfaces.size() );
+				_plsLazy->vPins.resize( _plsLazy->vSurfaces.size() );
+				_plsLazy->vHeld.resize( _plsLazy->vSurfaces.size() );
+			}
+			catch ( ... ) {
+				Reset();
+				return SL2_E_OUTOFMEMORY;
 			}
+			m_plsLazy = std::move( _plsLazy );
+			m_sLazyDecodes = 0;
 		}
 
 		if ( dFile.Header().ui32Caps2 & SL2_DDSCAPS2_CUBEMAP ) {
@@ -2433,6 +3237,205 @@ namespace sl2 {
 		return SL2_E_SUCCESS;
 	}
 
+	/**
+	 * Copies a surface of a loaded DDS file to a buffer laid out as Data() lays out one array slice and face, or only checks
+	 *	that the file holds all of the surface.
+	 * 
+	 * \param _dFile The loaded DDS file.
+	 * \param _sMip The mipmap level of the surface.
+	 * \param _sArray The array slice of the surface.
+	 * \param _sFace The face of the surface.
+	 * \param _pui8Dst The buffer to which to copy the surface, or nullptr to only check the file.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::CopyDdsSurface( const CDds &_dFile, size_t _sMip, size_t _sArray, size_t _sFace, uint8_t * _pui8Dst ) const {
+		// Only the first cube of a cube array is read.
+		if ( _dFile.Faces() > 1 && _sArray ) { return SL2_E_SUCCESS; }
+		size_t sIdx = (_dFile.Faces() > 1 ? _sFace : _sArray) * _dFile.Mips() + _sMip;
+		if ( sIdx >= _dFile.Buffers().size() ) { return SL2_E_INVALIDDATA; }
+		const CDds::SL2_TEX & tTex = _dFile.Buffers()[sIdx];
+
+		uint32_t ui32Width = std::max( _dFile.Width() >> _sMip, static_cast<uint32_t>(1) );
+		uint32_t ui32Height = std::max( _dFile.Height() >> _sMip, static_cast<uint32_t>(1) );
+		uint32_t ui32Depth = std::max( _dFile.Depth() >> _sMip, static_cast<uint32_t>(1) );
+
+		if ( _dFile.Header().ui32Flags & SL2_DF_LINEARSIZE ) {
+			// Compressed texture.
+			uint64_t ui64PageSize = CFormat::GetFormatSize( m_pkifFormat, ui32Width, ui32Height, 1 );
+			if ( uint64_t( size_t( ui64PageSize ) ) != ui64PageSize ) { return SL2_E_UNSUPPORTEDSIZE; }
+			if ( tTex.sSize < ui64PageSize * ui32Depth ) { return SL2_E_INVALIDDATA; }
+			if ( _pui8Dst ) {
+				for ( uint32_t D = 0; D < ui32Depth; ++D ) {
+					std::memcpy( _pui8Dst + CFormat::GetFormatSize( m_pkifFormat, ui32Width, ui32Height, D ), tTex.pui8Texels + ui64PageSize * D, size_t( ui64PageSize ) );
+				}
+			}
+			return SL2_E_SUCCESS;
+		}
+
+		uint64_t ui64SrcPitch = CFormat::GetRowSize_NoPadding( m_pkifFormat, ui32Width );
+		uint64_t ui64Size = ui64SrcPitch * ui32Height * ui32Depth;
+		if ( uint64_t( size_t( ui64Size ) ) != ui64Size ) { return SL2_E_UNSUPPORTEDSIZE; }
+		if ( tTex.sSize < ui64Size ) { return SL2_E_INVALIDDATA; }
+		if ( !_pui8Dst ) { return SL2_E_SUCCESS; }
+
+		auto aPitch = CFormat::GetRowSize( m_pkifFormat, ui32Width );
+		if ( aPitch == ui64SrcPitch ) {
+			// Rows are not padded, so the slices are copied at once.
+			std::memcpy( _pui8Dst, tTex.pui8Texels, size_t( ui64Size ) );
+			return SL2_E_SUCCESS;
+		}
+		for ( uint64_t H = 0; H < uint64_t( ui32Height ) * ui32Depth; ++H ) {
+			std::memcpy( _pui8Dst + aPitch * H, tTex.pui8Texels + ui64SrcPitch * H, size_t( ui64SrcPitch ) );
+		}
+		return SL2_E_SUCCESS;
+	}
+
+	/**
+	 * Gets the data buffer for a given mipmap, slice, face, and array index of a lazily decoded file, decoding the surface if
+	 *	it is not already decoded and releasing the least-recently used surfaces that are not in use if too many are decoded.
+	 * 
+	 * \param _sMip The mipmap level to retrieve.
+	 * \param _ui32Slice The 3D slice to access.
+	 * \param _sArray The array index.
+	 * \param _sFace The face index.
+	 * \param _bPin If true, the surface is pinned until UnpinLazy() is called.  Otherwise it is held until the image is reset.
+	 * \return Returns a pointer to the given 2D texture face or nullptr.
+	 **/
+	uint8_t * CImage::LazyData( size_t _sMip, uint32_t _ui32Slice, size_t _sArray, size_t _sFace, bool _bPin ) {
+		if ( _sArray >= m_sArraySize || _sFace >= m_sFaces ) { return nullptr; }
+		const CSurface & sLevel = (*m_vMipMaps[_sMip]);
+		uint64_t ui64Off = CFormat::GetFormatSize( m_pkifFormat, sLevel.Width(), sLevel.Height(), _ui32Slice );
+		if ( ui64Off >= sLevel.BaseSize() ) { return nullptr; }
+		size_t sIdx = (_sMip * m_sArraySize + _sArray) * m_sFaces + _sFace;
+
+		std::lock_guard<std::mutex> lgLock( m_mLazyMutex );
+		SL2_LAZY_SOURCE & lsLazy = (*m_plsLazy);
+		if ( lsLazy.vSurfaces[sIdx].get() ) {
+			lsLazy.lResident.splice( lsLazy.lResident.begin(), lsLazy.lResident, lsLazy.vResidentPos[sIdx] );
+		}
+		else {
+			if ( m_sLazyMaxResident ) { ReleaseLazy( m_sLazyMaxResident - 1 ); }
+			try {
+				auto pSurface = std::make_unique<CSurface>( sLevel.BaseSize(), sLevel.BaseSize(), sLevel.Width(), sLevel.Height(), sLevel.Depth() );
+				if ( SL2_E_SUCCESS != CopyDdsSurface( lsLazy.dDds, _sMip, _sArray, _sFace, pSurface->data() ) ) { return nullptr; }
+				lsLazy.lResident.push_front( sIdx );
+				lsLazy.vResidentPos[sIdx] = lsLazy.lResident.begin();
+				lsLazy.vSurfaces[sIdx] = std::move( pSurface );
+			}
+			catch ( ... ) { return nullptr; }
+			++m_sLazyDecodes;
+		}
+		// Only a surface that is not pinned or held is ever released, so the pointer stays valid for as long as the caller uses it.
+		if ( _bPin ) { ++lsLazy.vPins[sIdx]; }
+		else { lsLazy.vHeld[sIdx] = 1; }
+		return lsLazy.vSurfaces[sIdx]->data() + ui64Off;
+	}
+
+	/**
+	 * Unpins a surface pinned by LazyData() and releases decoded surfaces beyond the limit that are no longer in use.
+	 * 
+	 * \param _sIdx The index of the surface in SL2_LAZY_SOURCE::vSurfaces.
+	 **/
+	void CImage::UnpinLazy( size_t _sIdx ) {
+		std::lock_guard<std::mutex> lgLock( m_mLazyMutex );
+		--m_plsLazy->vPins[_sIdx];
+		if ( m_sLazyMaxResident ) { ReleaseLazy( m_sLazyMaxResident ); }
+	}
+
+	/**
+	 * Releases the least-recently used decoded surfaces that are neither pinned nor held until no more than _sMax are decoded or
+	 *	none can be released.  m_mLazyMutex must be locked.
+	 * 
+	 * \param _sMax The most surfaces to leave decoded.
+	 **/
+	void CImage::ReleaseLazy( size_t _sMax ) {
+		SL2_LAZY_SOURCE & lsLazy = (*m_plsLazy);
+		for ( auto aIt = lsLazy.lResident.end(); lsLazy.lResident.size() > _sMax && aIt != lsLazy.lResident.begin(); ) {
+			--aIt;
+			size_t sIdx = (*aIt);
+			if ( lsLazy.vPins[sIdx] || lsLazy.vHeld[sIdx] ) { continue; }
+			lsLazy.vSurfaces[sIdx].reset();
+			aIt = lsLazy.lResident.erase( aIt );
+		}
+	}
+
+	/**
+	 * Pins a surface for reading.
+	 * 
+	 * \param _iImage The image whose surface is read.
+	 * \param _sMip The mipmap level to read.
+	 * \param _sArray The array index.
+	 * \param _sFace The face index.
+	 **/
+	CImage::SL2_SURFACE_PIN::SL2_SURFACE_PIN( CImage &_iImage, size_t _sMip, size_t _sArray, size_t _sFace ) {
+		if ( !_iImage.m_plsLazy ) {
+			pui8Data = _iImage.Data( _sMip, 0, _sArray, _sFace );
+			return;
+		}
+		if ( _sMip >= _iImage.m_vMipMaps.size() || nullptr == _iImage.m_pkifFormat ) { return; }
+		pui8Data = _iImage.LazyData( _sMip, 0, _sArray, _sFace, true );
+		if ( pui8Data ) {
+			piImage = &_iImage;
+			sIdx = (_sMip * _iImage.m_sArraySize + _sArray) * _iImage.m_sFaces + _sFace;
+		}
+	}
+	CImage::SL2_SURFACE_PIN::~SL2_SURFACE_PIN() {
+		if ( piImage ) { piImage->UnpinLazy( sIdx ); }
+	}
+
+	/**
+	 * Gets the table for an ICC curve, creating it on the first request.  The parameter points into m_tfInColorSpaceTransferFunc or
+	 *	m_tfOutColorSpaceTransferFunc, so tables live until ResetIccLuts() is called when those change.  Thread-safe.
+	 * 
+	 * \param _pfFunc The ICC transfer function.
+	 * \param _pvParm The parameter for _pfFunc.
+	 * \return Returns the table for the given curve.  The table may not be Valid(), in which case it evaluates the exact function.
+	 **/
+	const CTransferLut & CImage::IccLut( CIcc::PfTransferFunc _pfFunc, const void * _pvParm ) {
+		std::lock_guard<std::mutex> lgLock( m_mIccLutMutex );
+		auto & upTable = m_mIccLuts[std::make_pair( _pfFunc, _pvParm )];
+		if ( !upTable ) {
+			upTable = std::make_unique<CTransferLut>();
+			upTable->CreateLut( _pfFunc, _pvParm );
+		}
+		return (*upTable);
+	}
+
+	/**
+	 * Releases the tables created by IccLut().  Must be called whenever m_tfInColorSpaceTransferFunc or m_tfOutColorSpaceTransferFunc change.
+	 **/
+	void CImage::ResetIccLuts() {
+		std::lock_guard<std::mutex> lgLock( m_mIccLutMutex );
+		m_mIccLuts.clear();
+	}
+
+	/**
+	 * Loads a raw YUV file using m_pkifdYuvFormat, m_ui32YuvW, and m_ui32YuvH.  Only the frames selected by SetYuvFrames() are read.
+	 * 
+	 * \param _sfFile The opened file to load.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadYuv( CStdFile &_sfFile ) {
+		if ( !m_ui32YuvW || !m_ui32YuvH ) { return SL2_E_UNSUPPORTEDSIZE; }
+		if ( !m_pkifdYuvFormat ) { return SL2_E_INVALIDFILETYPE; }
+		uint64_t ui64FrameSize = CFormat::GetFormatSize( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, 1 );
+		if ( !ui64FrameSize ) { return SL2_E_UNSUPPORTEDSIZE; }
+		m_ui64YuvFileFrames = _sfFile.Size() / ui64FrameSize;
+		if ( m_ui64YuvFileFrames * ui64FrameSize != _sfFile.Size() ) { return SL2_E_BADFORMAT; }
+		if ( m_ui64YuvFirstFrame >= m_ui64YuvFileFrames ) { return SL2_E_UNSUPPORTEDSIZE; }
+
+		// Only the selected frames are read, so a long sequence never needs to fit in memory at once.
+		uint64_t ui64Depth = m_ui64YuvFileFrames - m_ui64YuvFirstFrame;
+		if ( m_ui32YuvFrames ) { ui64Depth = std::min<uint64_t>( ui64Depth, m_ui32YuvFrames ); }
+		if ( uint64_t( uint32_t( ui64Depth ) ) != ui64Depth ) { return SL2_E_UNSUPPORTEDSIZE; }
+		if ( !AllocateTexture( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, uint32_t( ui64Depth ) ) ) { return SL2_E_OUTOFMEMORY; }
+
+		uint64_t ui64SrcSize = CFormat::GetFormatSize( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, uint32_t( ui64Depth ) );
+		if ( uint64_t( size_t( ui64SrcSize ) ) != ui64SrcSize ) { return SL2_E_UNSUPPORTEDSIZE; }
+		if ( !_sfFile.LoadToMemory( m_ui64YuvFirstFrame * ui64FrameSize, Data(), size_t( ui64SrcSize ) ) ) { return SL2_E_INVALIDDATA; }
+		return SL2_E_SUCCESS;
+	}
+
 	/**
 	 * Loads a BMP file from memory.
 	 * 
@@ -2804,6 +3807,18 @@ namespace sl2 {
 		return SL2_E_SUCCESS;
 	}
 
+	/**
+	 * Loads an OpenEXR file from memory.  Tiles and line buffers are decompressed on OpenEXR's thread pool, and every level of
+	 *	a tiled, mipmapped file is loaded.  Files CExr does not read, such as luminance/chroma files, fail so that FreeImage can
+	 *	load them.
+	 * 
+	 * \param _vData The file to load.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CImage::LoadExr( const std::vector<uint8_t> &_vData ) {
+		return CExr::Read( _vData, ExrLevelBuffer, this );
+	}
+
 	/**
 	 * Loads a Phoenix BMP file from memory.
 	 * 
@@ -2971,4 +3986,25 @@ namespace sl2 {
 		return ::KTX_SUCCESS;
 	}
 
+	/**
+	 * Callback to get the buffer into which to read each level of an OpenEXR file.  The texture is allocated when the base level is requested.
+	 *
+	 * \param _pvParm The image being loaded.
+	 * \param _hHeader The image in the file.
+	 * \param _sLevel The level to be read.
+	 * \param _sPitch Holds the distance in bytes from one row to the next.
+	 * \return Returns the first texel of the level, or nullptr if the texture could not be allocated.
+	 */
+	float * CImage::ExrLevelBuffer( void * _pvParm, const CExr::SL2_HEADER &_hHeader, size_t _sLevel, size_t &_sPitch ) {
+		CImage * piImage = reinterpret_cast<CImage *>(_pvParm);
+		if ( _sLevel == 0 ) {
+			SL2_VKFORMAT vfFormat = SL2_VK_FORMAT_R32G32B32A32_SFLOAT;
+			if ( _hHeader.ui32Channels == 1 ) { vfFormat = SL2_VK_FORMAT_R32_SFLOAT; }
+			else if ( _hHeader.ui32Channels == 3 ) { vfFormat = SL2_VK_FORMAT_R32G32B32_SFLOAT; }
+			if ( !piImage->AllocateTexture( CFormat::FindFormatDataByVulkan( vfFormat ), _hHeader.ui32Width, _hHeader.ui32Height, 1, _hHeader.sLevels ) ) { return nullptr; }
+		}
+		_sPitch = size_t( CFormat::GetRowSize( piImage->Format(), piImage->GetMipmaps()[_sLevel]->Width() ) );
+		return reinterpret_cast<float *>(piImage->Data( _sLevel ));
+	}
+
 }	// namespace sl2
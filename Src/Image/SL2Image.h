@@ -14,20 +14,29 @@
 
 #pragma once
 
+#include "../Files/SL2StdFile.h"
 #include "../Utilities/SL2Resampler.h"
+#include "../Utilities/SL2TransferLut.h"
+#include "DDS/SL2Dds.h"
 #include "ICC/SL2Icc.h"
 #include "ISPC/cielab_ispc.h"
 #include "PVRTexTool/PVRTexLib.hpp"
+#include "SL2Exr.h"
 #include "SL2Formats.h"
 #include "SL2Kernel.h"
 #include "SL2Palette.h"
 #include "SL2PaletteSet.h"
 #include "SL2Surface.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <FreeImage.h>
 #include <ktx.h>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 
@@ -90,8 +99,8 @@ namespace sl2 {
 
 		/** Wraps FreeImage_LoadFromMemory(). */
 		struct SL2_FREEIMAGE_LOAD_FROM_MEMORY {
-			SL2_FREEIMAGE_LOAD_FROM_MEMORY( SL2_FREE_IMAGE &_fiImage ) :
-				pbBitmap( ::FreeImage_LoadFromMemory( ::FreeImage_GetFileTypeFromMemory( _fiImage.pmMemory, 0 ), _fiImage.pmMemory, 0 ) ) {
+			SL2_FREEIMAGE_LOAD_FROM_MEMORY( SL2_FREE_IMAGE &_fiImage, FREE_IMAGE_FORMAT _fifFormat, int _iFlags FI_DEFAULT( 0 ) ) :
+				pbBitmap( ::FreeImage_LoadFromMemory( _fifFormat, _fiImage.pmMemory, _iFlags ) ) {
 			}
 			~SL2_FREEIMAGE_LOAD_FROM_MEMORY() {
 				::FreeImage_Unload( pbBitmap );
@@ -105,8 +114,8 @@ namespace sl2 {
 
 		/** Wraps FreeImage_LoadMultiBitmapFromMemory(). */
 		struct SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY {
-			SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY( SL2_FREE_IMAGE &_fiImage ) :
-				pbBitmap( ::FreeImage_LoadMultiBitmapFromMemory( ::FreeImage_GetFileTypeFromMemory( _fiImage.pmMemory, 0 ), _fiImage.pmMemory, 0 ) ) {
+			SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY( SL2_FREE_IMAGE &_fiImage, FREE_IMAGE_FORMAT _fifFormat ) :
+				pbBitmap( ::FreeImage_LoadMultiBitmapFromMemory( _fifFormat, _fiImage.pmMemory, 0 ) ) {
 			}
 			~SL2_FREEIMAGE_LOAD_MULTI_BIPMAP_FROM_MEMORY() {
 				::FreeImage_CloseMultiBitmap( pbBitmap );
@@ -430,6 +439,18 @@ namespace sl2 {
 			inline int64_t									Back() const { return i32Z + ui32D; }
 		};
 
+		/**
+		 * Gets the smallest size needed from an image of a given size.
+		 * 
+		 * \param _pvParm The parameter passed to SetDecodeSize().
+		 * \param _ui32Width The width of the image in the file.
+		 * \param _ui32Height The height of the image in the file.
+		 * \param _ui32NeededW Holds the smallest width needed, in the pixels of the file.
+		 * \param _ui32NeededH Holds the smallest height needed, in the pixels of the file.
+		 * \return Returns false if the image must be decoded at its full size.
+		 **/
+		typedef bool (*										PfDecodeSize)( void * _pvParm, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t &_ui32NeededW, uint32_t &_ui32NeededH );
+
 
 		// == Operators.
 		/**
@@ -497,7 +518,8 @@ namespace sl2 {
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *		Format() const;
 
 		/**
-		 * Gets the data buffer for a given mipmap, slice, face, and array index.
+		 * Gets the data buffer for a given mipmap, slice, face, and array index.  Surfaces of lazily decoded files are decoded
+		 *	here the first time they are accessed.
 		 * 
 		 * \param _sMip The mipmap level to retrieve.
 		 * \param _ui32Slice The 3D slice to access.
@@ -508,7 +530,8 @@ namespace sl2 {
 		inline uint8_t *									Data( size_t _sMip = 0, uint32_t _ui32Slice = 0, size_t _sArray = 0, size_t _sFace = 0 );
 
 		/**
-		 * Loads an image file.  All image slices, faces, and array slices will be loaded.
+		 * Loads an image file.  All image slices, faces, and array slices will be loaded.  Headerless formats are chosen by the
+		 *	format set with SetYuvSize() or by extension; all others are chosen by their signature.
 		 * 
 		 * \param _pcFile The name of the file to load.
 		 * \return Returns an error code.
@@ -516,13 +539,33 @@ namespace sl2 {
 		SL2_ERRORS											LoadFile( const char16_t * _pcFile );
 
 		/**
-		 * Loads an image file.  All image slices, faces, and array slices will be loaded.
+		 * Loads an image file that has already been read into memory.  The loader is chosen as it is by
+		 *	LoadFile( const char16_t * ), and loaders that stream from the file reopen it by name.
+		 * 
+		 * \param _pcFile The name of the file.
+		 * \param _vData The contents of the file.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadFile( const char16_t * _pcFile, const std::vector<uint8_t> &_vData );
+
+		/**
+		 * Loads an image file.  All image slices, faces, and array slices will be loaded.  The loader is chosen by the signature
+		 *	at the start of the file.
 		 * 
 		 * \param _vData The image file to load.
 		 * \return Returns an error code.
 		 **/
 		SL2_ERRORS											LoadFile( const std::vector<uint8_t> &_vData );
 
+		/**
+		 * Loads a raw YUV file that is already open, using the format and size set with SetYuvSize().  Only the frames selected by
+		 *	SetYuvFrames() are read, and the file is not reopened, so several images can take turns loading frames from one file.
+		 * 
+		 * \param _sfFile The opened file to load.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadFile( CStdFile &_sfFile );
+
 		/**
 		 * Loads an image format from the clipboard.  PNG is attempted first, the standard bitmap formats.
 		 * 
@@ -531,22 +574,22 @@ namespace sl2 {
 		SL2_ERRORS											LoadFromClipboard();
 
 		/**
-		 * Loads a basic YUV image file.  All image slices, faces, and array slices will be loaded.
+		 * Loads a basic YUV image file.  All frames are loaded as depth slices unless SetYuvFrames() has selected a range of frames.
 		 * 
-		 * \param _vData The image file to load.
+		 * \param _sfFile The opened image file to load.
 		 * \return Returns an error code.
 		 **/
 		template <unsigned _uFormat>
-		SL2_ERRORS											LoadYuv_Dgxi_Basic( const std::vector<uint8_t> &_vData );
+		SL2_ERRORS											LoadYuv_Dgxi_Basic( CStdFile &_sfFile );
 
 		/**
-		 * Loads a basic YUV image file.  All image slices, faces, and array slices will be loaded.
+		 * Loads a basic YUV image file.  All frames are loaded as depth slices unless SetYuvFrames() has selected a range of frames.
 		 * 
-		 * \param _vData The image file to load.
+		 * \param _sfFile The opened image file to load.
 		 * \return Returns an error code.
 		 **/
 		template <unsigned _uFormat>
-		SL2_ERRORS											LoadYuv_Vulkan_Basic( const std::vector<uint8_t> &_vData );
+		SL2_ERRORS											LoadYuv_Vulkan_Basic( CStdFile &_sfFile );
 
 		/**
 		 * Converts to another format.  _iDst holds the converted image.
@@ -816,6 +859,73 @@ namespace sl2 {
 			m_ui32YuvH = _ui32H;
 		}
 
+		/**
+		 * Selects a range of frames to load from a raw YUV file.  Only the selected frames are read from disk.
+		 * 
+		 * \param _ui64First The index of the first frame to load.
+		 * \param _ui32Total The number of frames to load, or 0 to load every frame in the file.
+		 **/
+		void												SetYuvFrames( uint64_t _ui64First, uint32_t _ui32Total ) {
+			m_ui64YuvFirstFrame = _ui64First;
+			m_ui32YuvFrames = _ui32Total;
+		}
+
+		/**
+		 * Gets the total number of frames in the last raw YUV file loaded.
+		 * 
+		 * \return Returns the total number of frames in the last raw YUV file loaded, regardless of how many were selected by SetYuvFrames().
+		 **/
+		inline uint64_t										YuvFileFrames() const { return m_ui64YuvFileFrames; }
+
+		/**
+		 * Allows JPEG and WebP files to be decoded at a reduced size.  Before decoding, the loader passes the size
+		 *	in the file to _pfFunc and has the decoder scale the image down by the largest power of 2 that keeps it at least
+		 *	as large as the size returned.  FullWidth() and FullHeight() then return the size in the file.
+		 * 
+		 * \param _pfFunc The function that gets the size needed, or nullptr to always decode at the full size.
+		 * \param _pvParm Passed to _pfFunc.
+		 **/
+		void												SetDecodeSize( PfDecodeSize _pfFunc, void * _pvParm ) {
+			m_pfDecodeSize = _pfFunc;
+			m_pvDecodeSizeParm = _pvParm;
+		}
+
+		/**
+		 * Gets the width of the image in the last file loaded, which is larger than Width() if it was decoded at a reduced size.
+		 * 
+		 * \return Returns the width of the image in the file.
+		 **/
+		inline uint32_t										FullWidth() const { return m_ui32FullWidth ? m_ui32FullWidth : Width(); }
+
+		/**
+		 * Gets the height of the image in the last file loaded, which is larger than Height() if it was decoded at a reduced size.
+		 * 
+		 * \return Returns the height of the image in the file.
+		 **/
+		inline uint32_t										FullHeight() const { return m_ui32FullHeight ? m_ui32FullHeight : Height(); }
+
+		/**
+		 * Has DDS files keep their surfaces in the file until they are first accessed, so that surfaces that are never used are
+		 *	never copied out.  ConvertToFormat() decodes each surface just before converting it and lets it go afterwards; when more
+		 *	than _sMaxResident surfaces are decoded, the least-recently used one that is not in use is released.  Surfaces returned
+		 *	by Data() may be written or held, so they stay decoded until the image is reset.
+		 * 
+		 * \param _bLazy Whether to decode surfaces when they are first accessed.
+		 * \param _sMaxResident The most surfaces (each mipmap, array slice, and face) kept decoded at once, or 0 for no limit.
+		 **/
+		void												SetLazyDecode( bool _bLazy, size_t _sMaxResident ) {
+			m_bLazyDecode = _bLazy;
+			m_sLazyMaxResident = _sMaxResident;
+		}
+
+		/**
+		 * Gets the number of surfaces of the last file loaded that have been decoded on first access, counting surfaces that were
+		 *	released and decoded again.
+		 * 
+		 * \return Returns the number of surfaces decoded by Data().
+		 **/
+		inline size_t										LazyDecodes() const { return m_sLazyDecodes; }
+
 		/**
 		 * Gets a reference to the palette.
 		 * 
@@ -833,6 +943,46 @@ namespace sl2 {
 			m_bGenPalette = _bGenNew;
 		}
 
+		/**
+		 * When set, one palette is generated from every mipmap, array slice, and face (animation frame) and every surface is
+		 *	mapped to it, instead of generating a palette per surface.
+		 * 
+		 * \param _bShared Whether to share one palette across all surfaces or not.
+		 **/
+		inline void											SetSharedPalette( bool _bShared ) {
+			m_bSharedPalette = _bShared;
+		}
+
+		/**
+		 * Gets the time spent generating palettes, including time carried over from the image from which this one was converted.
+		 * 
+		 * \return Returns the time spent generating palettes, in seconds.
+		 **/
+		inline double										PaletteTime() const { return m_dPaletteTime; }
+
+		/**
+		 * Gets the time spent mapping texels to palette indices, including time carried over from the image from which this one
+		 *	was converted.
+		 * 
+		 * \return Returns the time spent mapping texels to palette indices, in seconds.
+		 **/
+		inline double										IndexMapTime() const { return m_dIndexMapTime; }
+
+		/**
+		 * Gets the time the last LoadFile() spent choosing a loader, including identification by FreeImage and any loaders
+		 *	that were tried and failed.
+		 * 
+		 * \return Returns the time spent choosing a loader, in seconds.
+		 **/
+		inline double										LoaderTime() const { return m_dLoaderTime; }
+
+		/**
+		 * Gets the number of loaders the last LoadFile() tried before the one that loaded the file.
+		 * 
+		 * \return Returns the number of failed loads.
+		 **/
+		inline uint32_t										FailedProbes() const { return m_ui32FailedProbes; }
+
 		/**
 		 * Creates a CMYK verion of the given texture slice.
 		 * 
@@ -922,6 +1072,122 @@ namespace sl2 {
 
 
 	protected :
+		// == Types.
+		/** A band of rows for a normal-map thread to generate. */
+		struct SL2_NORMAL_MAP_THREAD_DATA {
+			const double *									pdHeight = nullptr;					/**< The height values of the slice. */
+			CFormat::SL2_RGBA64F *							prgbaDst = nullptr;					/**< The slice to which to write the normals. */
+			uint32_t										ui32W = 0, ui32H = 0;				/**< The dimensions of the slice. */
+			uint32_t										ui32RowStart = 0, ui32RowEnd = 0;	/**< The rows to generate. */
+			const std::vector<CKernel::SL2_SEPARABLE_TERM> *pvTerms = nullptr;					/**< The separable kernel terms, or nullptr to apply pkKernel/pkTransp directly. */
+			const CKernel *									pkKernel = nullptr;					/**< The X-derivative kernel. */
+			const CKernel *									pkTransp = nullptr;					/**< The Y-derivative kernel. */
+			SL2_TEXTURE_ADDRESSING							taW = SL2_TA_CLAMP;					/**< Texture-addressing for width. */
+			SL2_TEXTURE_ADDRESSING							taH = SL2_TA_CLAMP;					/**< Texture-addressing for height. */
+			double											dBorder = 0.0;						/**< The border height. */
+			double											dScale = 1.0;						/**< The Z value of the normal before normalization. */
+			double											dYAxis = 1.0;						/**< The Y-axis direction. */
+			bool											bRet = true;						/**< Set to false if an allocation fails. */
+		};
+
+		/** A page of a multi-page image, converted to RGBA and kept at the size of its own rectangle. */
+		struct SL2_PAGE_FRAME {
+			std::vector<CFormat::SL2_RGBA_UNORM>			vTexels;							/**< The texels, from the top row down. */
+			uint32_t										ui32Left = 0;						/**< The left of the rectangle on the canvas. */
+			uint32_t										ui32Top = 0;						/**< The top of the rectangle on the canvas. */
+			uint32_t										ui32Width = 0;						/**< The width of the rectangle. */
+			uint32_t										ui32Height = 0;						/**< The height of the rectangle. */
+			uint8_t											ui8Disposal = 0;					/**< The GIF disposal method.  2 clears the rectangle before the next frame and 3 restores what was under it. */
+			long											lFrameTime = 0;						/**< The time the page is shown, in milliseconds. */
+			SL2_ERRORS										eError = SL2_E_SUCCESS;				/**< The result of decoding the page. */
+			bool											bSkipped = false;					/**< Set if the page could not be read; it gets no array slice. */
+			bool											bDone = false;						/**< Set when the page has been decoded and not yet composited.  Guarded by SL2_PAGE_QUEUE::mMutex. */
+		};
+
+		/** The state shared by LoadFreeImage() and the threads decoding the pages of a multi-page image ahead of it. */
+		struct SL2_PAGE_QUEUE {
+			CImage *										piImage = nullptr;					/**< The image being loaded. */
+			const std::vector<uint8_t> *					pvData = nullptr;					/**< The file, which each thread opens on its own. */
+			FREE_IMAGE_FORMAT								fifFormat = FIF_UNKNOWN;			/**< The format of the file. */
+			std::vector<SL2_PAGE_FRAME>						vPages;								/**< Page P is decoded into vPages[P%vPages.size()]. */
+			int												iPages = 0;							/**< The number of pages in the file. */
+			int												iNext = 0;							/**< The next page to hand to a thread. */
+			int												iComposited = 0;					/**< The next page to composite; the slots of the pages before it can be reused. */
+			bool											bStop = false;						/**< Tells the threads to stop taking pages. */
+			std::mutex										mMutex;								/**< Guards the queue. */
+			std::condition_variable							cvChanged;							/**< Signalled when a page is taken, decoded, or composited. */
+		};
+
+		/** The rectangle of a page, clipped to the canvas. */
+		struct SL2_COMPOSITE_RECT {
+			uint32_t										ui32X0 = 0;							/**< The left column. */
+			uint32_t										ui32X1 = 0;							/**< The column after the right column. */
+			uint32_t										ui32Y0 = 0;							/**< The top row. */
+			uint32_t										ui32Y1 = 0;							/**< The row after the bottom row. */
+		};
+
+		/** A page for the compositing threads to composite into its array slice. */
+		struct SL2_COMPOSITE_THREAD_DATA {
+			CImage *										piImage = nullptr;					/**< The image whose array slices receive the pages. */
+			size_t											sSlice = 0;							/**< The array slice to fill. */
+			const SL2_PAGE_FRAME *							ppfFrame = nullptr;					/**< The page. */
+			const SL2_PAGE_FRAME *							ppfPrev = nullptr;					/**< The rectangle and disposal of the page before it, or nullptr for the first page.  Its texels are not kept. */
+			const std::vector<CFormat::SL2_RGBA_UNORM> *	pvPrevSaved = nullptr;				/**< What was under the page before it, if its disposal is 3. */
+			std::vector<CFormat::SL2_RGBA_UNORM> *			pvSaved = nullptr;					/**< Receives what is under the page, if its disposal is 3.  Sized by the caller. */
+			std::atomic<uint32_t> *							paNext = nullptr;					/**< The next band of rows to composite. */
+		};
+
+		/** A file whose surfaces are decoded when they are first accessed through Data(). */
+		struct SL2_LAZY_SOURCE {
+			std::vector<uint8_t>							vFile;								/**< The file, into which dDds points. */
+			CDds											dDds;								/**< The loaded DDS file. */
+			std::vector<std::unique_ptr<CSurface>>			vSurfaces;							/**< The decoded surfaces by mipmap, array slice, then face, or nullptr where not decoded. */
+			std::list<size_t>								lResident;							/**< The indices of the decoded surfaces, most recently used first. */
+			std::vector<std::list<size_t>::iterator>		vResidentPos;						/**< The position in lResident of each decoded surface. */
+			std::vector<uint32_t>							vPins;								/**< The number of SL2_SURFACE_PIN objects reading each surface. */
+			std::vector<uint8_t>							vHeld;								/**< 1 for each surface returned by Data(), which may be written or held, so it is never released. */
+		};
+
+		/** Reads a surface for as long as the object lives.  A lazily decoded surface is decoded if needed and not released until the object is destroyed. */
+		struct SL2_SURFACE_PIN {
+			SL2_SURFACE_PIN( CImage &_iImage, size_t _sMip, size_t _sArray, size_t _sFace );
+			~SL2_SURFACE_PIN();
+
+
+			// == Members.
+			const uint8_t *									pui8Data = nullptr;					/**< The surface, or nullptr if it could not be decoded. */
+			CImage *										piImage = nullptr;					/**< The image whose lazily decoded surface is pinned, or nullptr if none is. */
+			size_t											sIdx = 0;							/**< The index of the pinned surface in SL2_LAZY_SOURCE::vSurfaces. */
+		};
+
+		/** The number of rows in each band composited by CompositeFramesThread(). */
+		static constexpr uint32_t							SL2_COMPOSITE_BAND = 32;
+
+		/** A loader of files held in memory. */
+		typedef SL2_ERRORS (CImage::*						PfLoader)( const std::vector<uint8_t> & );
+
+		/** A loader of opened headerless files. */
+		typedef SL2_ERRORS (CImage::*						PfFileLoader)( CStdFile & );
+
+		/** A loader chosen by the bytes at the start of a file. */
+		struct SL2_SIGNATURE_LOADER {
+			const char *									pcMagic;							/**< The bytes that identify the format. */
+			size_t											sMagicSize;							/**< The number of bytes in pcMagic. */
+			size_t											sOffset;							/**< The offset in the file of pcMagic. */
+			PfLoader										pfLoader;							/**< The built-in loader, or nullptr to load with FreeImage. */
+			FREE_IMAGE_FORMAT								fifFormat;							/**< The FreeImage format to use without a built-in loader or when it fails. */
+		};
+
+		/** A loader chosen by file extension, for formats with no header. */
+		struct SL2_EXTENSION_LOADER {
+			const char16_t *								pcExtension;						/**< The lower-case extension. */
+			SL2_VKFORMAT									vfVulkanFormat;						/**< The YUV format, which also selects the loader when set with SetYuvSize(). */
+			SL2_DXGI_FORMAT									dfDxFormat;							/**< The YUV format, which also selects the loader when set with SetYuvSize(). */
+			PfFileLoader									pfLoader;							/**< The YUV loader, or nullptr to load with FreeImage. */
+			FREE_IMAGE_FORMAT								fifFormat;							/**< The FreeImage format when pfLoader is nullptr. */
+		};
+
+
 		// == Members.
 		double												m_dGamma;								/**< The gamma curve.  Negative values indicate the IEC 61966-2-1:1999 sRGB curve. */
 		double												m_dTargetGamma;							/**< The target gamma curve. */
@@ -969,15 +1235,41 @@ namespace sl2 {
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *		m_pkifdYuvFormat;						/**< The YUV file format. */
 		uint32_t											m_ui32YuvW;								/**< The width of a YUV image. */
 		uint32_t											m_ui32YuvH;								/**< The height of a YUV image. */
+		uint64_t											m_ui64YuvFirstFrame;					/**< The first YUV frame to load. */
+		uint32_t											m_ui32YuvFrames;						/**< The number of YUV frames to load, or 0 for all frames. */
+		uint64_t											m_ui64YuvFileFrames;					/**< The number of frames in the last YUV file loaded. */
 
 		CPaletteSet											m_pPalette;								/**< The palette. */
 		bool												m_bGenPalette;							/**< Generate a new palette? */
+		bool												m_bSharedPalette;						/**< Generate one palette for all surfaces? */
+		uint32_t											m_ui32SharedPaletteSize;				/**< The size for which m_pPalette was generated as a shared palette, or 0. */
+		double												m_dPaletteTime;							/**< Seconds spent generating palettes. */
+		double												m_dIndexMapTime;						/**< Seconds spent mapping texels to palette indices. */
+		std::mutex											m_mPaletteMutex;						/**< Serializes conversions that read or swap m_pPalette.  Indexed surfaces convert one at a time; the rest run in parallel. */
+		double												m_dLoaderTime;							/**< Seconds the last LoadFile() spent choosing a loader. */
+		uint32_t											m_ui32FailedProbes;						/**< Loaders the last LoadFile() tried before one succeeded. */
+		PfDecodeSize										m_pfDecodeSize;							/**< Gets the size needed from a file, or nullptr to decode at the full size. */
+		void *												m_pvDecodeSizeParm;						/**< Passed to m_pfDecodeSize. */
+		uint32_t											m_ui32FullWidth;						/**< The width in the file of an image decoded at a reduced size, or 0. */
+		uint32_t											m_ui32FullHeight;						/**< The height in the file of an image decoded at a reduced size, or 0. */
+		static const SL2_SIGNATURE_LOADER					m_slSignatureLoaders[];					/**< Loaders chosen by signature. */
+		static const SL2_EXTENSION_LOADER					m_elExtensionLoaders[];					/**< Loaders chosen by YUV format or extension, in priority order. */
 
 		SL2_WINDOW											m_wCroppingWindow;						/**< The cropping window. */
 		SL2_QUICK_ROTATION									m_qrQuickRotation;						/**< Quick rotation. */
 
 		std::vector<long>									m_vFrameTimes;							/**< Frame times, in milliseconds. */
 
+		std::unique_ptr<SL2_LAZY_SOURCE>					m_plsLazy;								/**< The file from which surfaces are decoded on first access, or nullptr if m_vMipMaps holds them. */
+		std::mutex											m_mLazyMutex;							/**< Guards m_plsLazy's surfaces, pins and residency list. */
+		bool												m_bLazyDecode;							/**< If true, DDS surfaces are decoded on first access. */
+		size_t												m_sLazyMaxResident;						/**< The most lazily decoded surfaces kept at once, or 0 for no limit. */
+		size_t												m_sLazyDecodes;							/**< Surfaces decoded on first access. */
+
+		std::map<std::pair<CIcc::PfTransferFunc, const void *>, std::unique_ptr<CTransferLut>>
+															m_mIccLuts;								/**< Tables for the curves in m_tfIn/OutColorSpaceTransferFunc, keyed on function and parameter. */
+		std::mutex											m_mIccLutMutex;							/**< Guards m_mIccLuts. */
+
 
 		// == Functions.
 		/**
@@ -990,9 +1282,53 @@ namespace sl2 {
 		 * \param _sMips Number of mipmaps.  Must be at least 1.  If 0, a full mipmap chain is allocated.
 		 * \param _sArray Number of array slices.  Must be at least 1.
 		 * \param _sFaces Number of faces.  Either 1 or 6.
+		 * \param _bLazy If true, only the sizes of the mipmaps are set, and their surfaces are decoded by LazyData().
 		 * \return Returns true if all mipmaps could be allocated and the texture size is valid (non-0) and a supported format.
 		 **/
-		bool												AllocateTexture( const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, size_t _sMips = 1, size_t _sArray = 1, size_t _sFaces = 1 );
+		bool												AllocateTexture( const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth, size_t _sMips = 1, size_t _sArray = 1, size_t _sFaces = 1, bool _bLazy = false );
+
+		/**
+		 * Gets the data buffer for a given mipmap, slice, face, and array index of a lazily decoded file, decoding the surface if
+		 *	it is not already decoded and releasing the least-recently used surfaces that are not in use if too many are decoded.
+		 * 
+		 * \param _sMip The mipmap level to retrieve.
+		 * \param _ui32Slice The 3D slice to access.
+		 * \param _sArray The array index.
+		 * \param _sFace The face index.
+		 * \param _bPin If true, the surface is pinned until UnpinLazy() is called.  Otherwise it is held until the image is reset.
+		 * \return Returns a pointer to the given 2D texture face or nullptr.
+		 **/
+		uint8_t *											LazyData( size_t _sMip, uint32_t _ui32Slice, size_t _sArray, size_t _sFace, bool _bPin );
+
+		/**
+		 * Unpins a surface pinned by LazyData() and releases decoded surfaces beyond the limit that are no longer in use.
+		 * 
+		 * \param _sIdx The index of the surface in SL2_LAZY_SOURCE::vSurfaces.
+		 **/
+		void												UnpinLazy( size_t _sIdx );
+
+		/**
+		 * Releases the least-recently used decoded surfaces that are neither pinned nor held until no more than _sMax are decoded or
+		 *	none can be released.  m_mLazyMutex must be locked.
+		 * 
+		 * \param _sMax The most surfaces to leave decoded.
+		 **/
+		void												ReleaseLazy( size_t _sMax );
+
+		/**
+		 * Gets the table for an ICC curve, creating it on the first request.  The parameter points into m_tfInColorSpaceTransferFunc or
+		 *	m_tfOutColorSpaceTransferFunc, so tables live until ResetIccLuts() is called when those change.  Thread-safe.
+		 * 
+		 * \param _pfFunc The ICC transfer function.
+		 * \param _pvParm The parameter for _pfFunc.
+		 * eturn Returns the table for the given curve.  The table may not be Valid(), in which case it evaluates the exact function.
+		 **/
+		const CTransferLut &								IccLut( CIcc::PfTransferFunc _pfFunc, const void * _pvParm );
+
+		/**
+		 * Releases the tables created by IccLut().  Must be called whenever m_tfInColorSpaceTransferFunc or m_tfOutColorSpaceTransferFunc change.
+		 **/
+		void												ResetIccLuts();
 
 		/**
 		 * Determines if any of the parameters change between this image and the given new image format.
@@ -1123,6 +1459,16 @@ namespace sl2 {
 		 **/
 		bool												GeneratePalette( const uint8_t * _pui8Buffer, uint64_t _ui64Total, uint32_t _ui32PalTotal );
 
+		/**
+		 * Generates one palette from every mipmap, array slice, and face of an image.  Large images are sampled at an even stride
+		 *	across all surfaces, so each sample stands for the same number of texels.
+		 * 
+		 * \param _iSrc The image whose surfaces are to be sampled.  Can be this image.
+		 * \param _ui32PalTotal The total number of entries to generate in the palette.
+		 * \return Returns true if all necessary allocations and conversions succeed.
+		 **/
+		bool												GenerateSharedPalette( CImage &_iSrc, uint32_t _ui32PalTotal );
+
 		/**
 		 * Sets alpha to _dValue.
 		 * 
@@ -1167,13 +1513,81 @@ namespace sl2 {
 		 **/
 		bool												ConvertToNormalMap( CFormat::SL2_RGBA64F * _prgbaData, uint32_t _ui32W, uint32_t _ui32H, uint32_t _ui32D );
 
+		/**
+		 * Generates a band of rows of a normal map.  When separable terms are supplied, the derivatives are made with 1-D passes over cached
+		 *	rows of horizontally filtered heights, otherwise the kernels are applied directly.  The derivatives are normalized and encoded in
+		 *	the same pass.
+		 * 
+		 * \param _pnmtdData The band to generate.
+		 **/
+		static void											NormalMapThread( SL2_NORMAL_MAP_THREAD_DATA * _pnmtdData );
+
+		/**
+		 * Composites a page into its array slice, one band of rows at a time.  The slice starts as a copy of the one before it, and only
+		 *	the rectangles of the previous page (for disposal) and the current page are touched after that.
+		 * 
+		 * \param _pctdData The shared state.
+		 **/
+		static void											CompositeFramesThread( SL2_COMPOSITE_THREAD_DATA * _pctdData );
+
+		/**
+		 * Clips the rectangle of a page to the canvas.
+		 * 
+		 * \param _pfFrame The page.
+		 * \param _ui32W The width of the canvas.
+		 * \param _ui32H The height of the canvas.
+		 * \return Returns the clipped rectangle, which may be empty.
+		 **/
+		static inline SL2_COMPOSITE_RECT					CompositeRect( const SL2_PAGE_FRAME &_pfFrame, uint32_t _ui32W, uint32_t _ui32H ) {
+			SL2_COMPOSITE_RECT crRect;
+			crRect.ui32X0 = std::min( _pfFrame.ui32Left, _ui32W );
+			crRect.ui32X1 = std::max( crRect.ui32X0, uint32_t( std::min<uint64_t>( uint64_t( _pfFrame.ui32Left ) + _pfFrame.ui32Width, _ui32W ) ) );
+			crRect.ui32Y0 = std::min( _pfFrame.ui32Top, _ui32H );
+			crRect.ui32Y1 = std::max( crRect.ui32Y0, uint32_t( std::min<uint64_t>( uint64_t( _pfFrame.ui32Top ) + _pfFrame.ui32Height, _ui32H ) ) );
+			return crRect;
+		}
+
+		/**
+		 * Loads an image file held in memory, choosing the loader by the signature at the start of the file.
+		 * 
+		 * \param _vData The image file to load.
+		 * \param _fifHint The FreeImage format to try first when the file has no known signature.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadFile( const std::vector<uint8_t> &_vData, FREE_IMAGE_FORMAT _fifHint );
+
+		/**
+		 * Finds the loader for a file by the signature at its start.
+		 * 
+		 * \param _vData The file.
+		 * \return Returns the loader, or nullptr if no signature matches.
+		 **/
+		static const SL2_SIGNATURE_LOADER *					FindSignatureLoader( const std::vector<uint8_t> &_vData );
+
+		/**
+		 * Finds the loader for a headerless file by its extension.
+		 * 
+		 * \param _u16Extension The file extension.
+		 * \return Returns the loader, or nullptr if no loader handles the extension.
+		 **/
+		static const SL2_EXTENSION_LOADER *					FindExtensionLoader( const std::u16string &_u16Extension );
+
+		/**
+		 * Finds the YUV loader for a format set with SetYuvSize().
+		 * 
+		 * \param _pkifdFormat The YUV format.
+		 * \return Returns the loader, or nullptr if no loader handles the format.
+		 **/
+		static const SL2_EXTENSION_LOADER *					FindYuvLoader( const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifdFormat );
+
 		/**
 		 * Loads using the FreeImage library.
 		 * 
 		 * \param _vData The file to load.
+		 * \param _fifFormat The format of the file, or FIF_UNKNOWN to have FreeImage identify it.
 		 * \return Returns an error code.
 		 **/
-		SL2_ERRORS											LoadFreeImage( const std::vector<uint8_t> &_vData );
+		SL2_ERRORS											LoadFreeImage( const std::vector<uint8_t> &_vData, FREE_IMAGE_FORMAT _fifFormat = FIF_UNKNOWN );
 
 		/**
 		 * Loads a page given a FreeImage FIBITMAP pointer and the page index.
@@ -1185,6 +1599,42 @@ namespace sl2 {
 		 **/
 		SL2_ERRORS											LoadFreeImagePage( FIBITMAP * _pbBitmap, size_t _sIdx = 0, size_t _sTotalIdx = 1 );
 
+		/**
+		 * Loads the ICC profile of a FreeImage bitmap and the transfer functions in it.
+		 * 
+		 * \param _pbBitmap The bitmap whose profile is to be loaded.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadFreeImageIcc( FIBITMAP * _pbBitmap );
+
+		/**
+		 * Decodes a page of a multi-page image to RGBA at the size of its own rectangle and reads its animation metadata.  No members are
+		 *	touched, so pages can be decoded on several threads at once, each from its own FIMULTIBITMAP.
+		 * 
+		 * \param _pbPage The locked page.
+		 * \param _pfFrame Holds the decoded page.
+		 **/
+		void												DecodeFreeImagePage( FIBITMAP * _pbPage, SL2_PAGE_FRAME &_pfFrame );
+
+		/**
+		 * A thread decoding pages of a multi-page image ahead of LoadFreeImage().  Takes pages in order until none remain or it is told to stop.
+		 * 
+		 * \param _ppqQueue The shared state of the load.
+		 **/
+		static void											DecodeFreeImagePagesThread( SL2_PAGE_QUEUE * _ppqQueue );
+
+		/**
+		 * Gets the FreeImage load flags that have the JPEG or WebP decoder scale an image down to the size
+		 *	returned by m_pfDecodeSize.  Only the header of the file is read.
+		 * 
+		 * \param _fiImage The file to load.
+		 * \param _fifFormat The format of the file.
+		 * \param _ui32FullW Holds the width of the image in the file.
+		 * \param _ui32FullH Holds the height of the image in the file.
+		 * \return Returns the flags to pass to FreeImage_LoadFromMemory(), or 0 if the image must be decoded at the full size.
+		 **/
+		int													ScaledDecodeFlags( SL2_FREE_IMAGE &_fiImage, FREE_IMAGE_FORMAT _fifFormat, uint32_t &_ui32FullW, uint32_t &_ui32FullH );
+
 		/**
 		 * \brief Converts a FreeImage bitmap to 32-bit RGBA.
 		 *
@@ -1203,16 +1653,6 @@ namespace sl2 {
 		 */
 		//FIBITMAP *											ConvertFromRGBA32( FIBITMAP * _pbBitmap, unsigned _uTargetBpp, bool _bIs565 = false );
 
-		/**
-		 * \brief Blends one image onto another with transparency support.
-		 *
-		 * \param _pbBaseCanvas The destination image.
-		 * \param _pbBitmapFrame The source image to blend onto the destination.
-		 * \param _iFrameLeft The left offset for the frame.
-		 * \param _iFrameTop The top offset for the frame.
-		 */
-		void												AlphaBlend( FIBITMAP * _pbBaseCanvas, FIBITMAP * _pbBitmapFrame, uint16_t _iFrameLeft, uint16_t _iFrameTop );
-
 		/**
 		 * Loads a KTX1 file from memory.
 		 * 
@@ -1237,6 +1677,44 @@ namespace sl2 {
 		 **/
 		SL2_ERRORS											LoadDds( const std::vector<uint8_t> &_vData );
 
+		/**
+		 * Loads a DDS file from memory, taking the file if its surfaces are decoded lazily.
+		 * 
+		 * \param _vData The file to load.  Emptied if the file is taken, which happens only on success.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadDds( std::vector<uint8_t> &&_vData );
+
+		/**
+		 * Loads a DDS file from memory.
+		 * 
+		 * \param _vData The file to load.  If _plsLazy is not nullptr, this is _plsLazy->vFile.
+		 * \param _plsLazy The source of lazily decoded surfaces, or nullptr to decode every surface now.  Taken on success.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadDds( const std::vector<uint8_t> &_vData, std::unique_ptr<SL2_LAZY_SOURCE> &_plsLazy );
+
+		/**
+		 * Copies a surface of a loaded DDS file to a buffer laid out as Data() lays out one array slice and face, or only checks
+		 *	that the file holds all of the surface.
+		 * 
+		 * \param _dFile The loaded DDS file.
+		 * \param _sMip The mipmap level of the surface.
+		 * \param _sArray The array slice of the surface.
+		 * \param _sFace The face of the surface.
+		 * \param _pui8Dst The buffer to which to copy the surface, or nullptr to only check the file.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											CopyDdsSurface( const CDds &_dFile, size_t _sMip, size_t _sArray, size_t _sFace, uint8_t * _pui8Dst ) const;
+
+		/**
+		 * Loads a raw YUV file using m_pkifdYuvFormat, m_ui32YuvW, and m_ui32YuvH.  Only the frames selected by SetYuvFrames() are read.
+		 * 
+		 * \param _sfFile The opened file to load.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadYuv( CStdFile &_sfFile );
+
 		/**
 		 * Loads a BMP file from memory.
 		 * 
@@ -1245,6 +1723,16 @@ namespace sl2 {
 		 **/
 		SL2_ERRORS											LoadBmp( const std::vector<uint8_t> &_vData );
 
+		/**
+		 * Loads an OpenEXR file from memory.  Tiles and line buffers are decompressed on OpenEXR's thread pool, and every level of
+		 *	a tiled, mipmapped file is loaded.  Files CExr does not read, such as luminance/chroma files, fail so that FreeImage can
+		 *	load them.
+		 * 
+		 * \param _vData The file to load.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											LoadExr( const std::vector<uint8_t> &_vData );
+
 		/**
 		 * Loads a Phoenix BMP file from memory.
 		 * 
@@ -1270,6 +1758,17 @@ namespace sl2 {
 			int _iWidth, int _iHeight, int _iDepth,
 			ktx_uint64_t _ui64FaceLodSize,
 			void * _pvPixels, void * _pvUserdata );
+
+		/**
+		 * Callback to get the buffer into which to read each level of an OpenEXR file.  The texture is allocated when the base level is requested.
+		 *
+		 * \param _pvParm The image being loaded.
+		 * \param _hHeader The image in the file.
+		 * \param _sLevel The level to be read.
+		 * \param _sPitch Holds the distance in bytes from one row to the next.
+		 * \return Returns the first texel of the level, or nullptr if the texture could not be allocated.
+		 */
+		static float *										ExrLevelBuffer( void * _pvParm, const CExr::SL2_HEADER &_hHeader, size_t _sLevel, size_t &_sPitch );
 	};
 	
 
@@ -1338,6 +1837,7 @@ namespace sl2 {
 	 **/
 	inline uint8_t * CImage::Data( size_t _sMip, uint32_t _ui32Slice, size_t _sArray, size_t _sFace ) {
 		if ( _sMip >= m_vMipMaps.size() || nullptr == m_pkifFormat ) { return nullptr; }
+		if ( m_plsLazy ) { return LazyData( _sMip, _ui32Slice, _sArray, _sFace, false ); }
 		uint64_t ui64Off = m_vMipMaps[_sMip]->BaseSize() * ((_sArray * m_sFaces) +
 			_sFace) +
 			CFormat::GetFormatSize( m_pkifFormat, m_vMipMaps[_sMip]->Width(), m_vMipMaps[_sMip]->Height(), _ui32Slice );
@@ -1358,76 +1858,33 @@ namespace sl2 {
 	}
 
 	/**
-	 * Loads a basic YUV image file.  All image slices, faces, and array slices will be loaded.
+	 * Loads a basic YUV image file.  All frames are loaded as depth slices unless SetYuvFrames() has selected a range of frames.
 	 * 
-	 * \param _vData The image file to load.
+	 * \param _sfFile The opened image file to load.
 	 * \return Returns an error code.
 	 **/
 	template <unsigned _uFormat>
-	SL2_ERRORS CImage::LoadYuv_Dgxi_Basic( const std::vector<uint8_t> &_vData ) {
-		if ( !m_ui32YuvW || !m_ui32YuvH ) { return SL2_E_UNSUPPORTEDSIZE; }
+	SL2_ERRORS CImage::LoadYuv_Dgxi_Basic( CStdFile &_sfFile ) {
 		if ( !m_pkifdYuvFormat ) {
 			m_pkifdYuvFormat = CFormat::FindFormatDataByDx( static_cast<SL2_DXGI_FORMAT>(_uFormat) );
 			if ( !m_pkifdYuvFormat ) { return SL2_E_INVALIDFILETYPE; }
 		}
-		uint64_t ui64SrcBaseSize = CFormat::GetFormatSize( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, 1 );
-		uint64_t ui64Depth = uint64_t( _vData.size() / ui64SrcBaseSize );
-		if ( uint64_t( uint32_t( ui64Depth ) ) != ui64Depth || ui64Depth == 0 ) { return SL2_E_UNSUPPORTEDSIZE; }
-		if ( !AllocateTexture( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, uint32_t( ui64Depth ) ) ) { return SL2_E_OUTOFMEMORY; }
-
-		ui64SrcBaseSize = CFormat::GetFormatSize( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, uint32_t( ui64Depth ) );
-		if ( uint64_t( size_t( ui64SrcBaseSize ) ) != ui64SrcBaseSize ) { return SL2_E_UNSUPPORTEDSIZE; }
-		if ( ui64SrcBaseSize != _vData.size() ) { return SL2_E_BADFORMAT; }
-		// Convert to NV12.
-		/*uint32_t ui32ChromaW = std::max( (m_ui32YuvW + 1U) / 2U, 1U );
-		uint32_t ui32ChromaH = std::max( (m_ui32YuvH + 1U) / 2U, 1U );
-		uint64_t ui64YSize = uint64_t( m_ui32YuvW ) * m_ui32YuvH;
-		uint64_t ui64Off2 = (ui32ChromaW * ui32ChromaH);
-		if ( uint64_t( size_t( ui64YSize ) ) != ui64YSize ) { return SL2_E_UNSUPPORTEDSIZE; }
-		const uint8_t * pui8Src = _vData.data();
-		uint8_t * pui8Dst = Data();
-		for ( uint32_t D = 0; D < uint32_t( ui64Depth ); ++D ) {
-			std::memcpy( pui8Dst, pui8Src, size_t( m_ui32YuvW * m_ui32YuvH ) );
-			pui8Dst += m_ui32YuvW * m_ui32YuvH;
-			pui8Src += m_ui32YuvW * m_ui32YuvH;
-			for ( uint32_t H = 0; H < ui32ChromaH; ++H ) {
-				for ( uint32_t W = 0; W < ui32ChromaW; ++W ) {
-					pui8Dst[(H*ui32ChromaW+W)*2+0] = pui8Src[(H*ui32ChromaW+W)];
-					pui8Dst[(H*ui32ChromaW+W)*2+1] = pui8Src[(H*ui32ChromaW+W)+ui64Off2];
-				}
-			}
-			pui8Dst += ui64Off2 * 2;
-			pui8Src += ui64Off2 * 2;
-		}*/
-
-		std::memcpy( Data(), _vData.data(), _vData.size() );
-		return SL2_E_SUCCESS;
+		return LoadYuv( _sfFile );
 	}
 
 	/**
-	 * Loads a basic YUV image file.  All image slices, faces, and array slices will be loaded.
+	 * Loads a basic YUV image file.  All frames are loaded as depth slices unless SetYuvFrames() has selected a range of frames.
 	 * 
-	 * \param _vData The image file to load.
+	 * \param _sfFile The opened image file to load.
 	 * \return Returns an error code.
 	 **/
 	template <unsigned _uFormat>
-	SL2_ERRORS CImage::LoadYuv_Vulkan_Basic( const std::vector<uint8_t> &_vData ) {
-		if ( !m_ui32YuvW || !m_ui32YuvH ) { return SL2_E_UNSUPPORTEDSIZE; }
+	SL2_ERRORS CImage::LoadYuv_Vulkan_Basic( CStdFile &_sfFile ) {
 		if ( !m_pkifdYuvFormat ) {
 			m_pkifdYuvFormat = CFormat::FindFormatDataByVulkan( static_cast<SL2_VKFORMAT>(_uFormat) );
 			if ( !m_pkifdYuvFormat ) { return SL2_E_INVALIDFILETYPE; }
 		}
-		uint64_t ui64SrcBaseSize = CFormat::GetFormatSize( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, 1 );
-		uint64_t ui64Depth = uint64_t( _vData.size() / ui64SrcBaseSize );
-		if ( uint64_t( uint32_t( ui64Depth ) ) != ui64Depth || ui64Depth == 0 ) { return SL2_E_UNSUPPORTEDSIZE; }
-		if ( !AllocateTexture( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, uint32_t( ui64Depth ) ) ) { return SL2_E_OUTOFMEMORY; }
-
-		ui64SrcBaseSize = CFormat::GetFormatSize( m_pkifdYuvFormat, m_ui32YuvW, m_ui32YuvH, uint32_t( ui64Depth ) );
-		if ( uint64_t( size_t( ui64SrcBaseSize ) ) != ui64SrcBaseSize ) { return SL2_E_UNSUPPORTEDSIZE; }
-		if ( ui64SrcBaseSize != _vData.size() ) { return SL2_E_BADFORMAT; }
-
-		std::memcpy( Data(), _vData.data(), _vData.size() );
-		return SL2_E_SUCCESS;
+		return LoadYuv( _sfFile );
 	}
 
 }	// namespace sl2
@@ -8,6 +8,9 @@
 
 #include "SL2Kernel.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 namespace sl2 {
 
@@ -102,4 +105,57 @@ namespace sl2 {
 		return true;
 	}
 
+	/**
+	 * Splits the kernel into a sum of separable (column * row) terms so that it can be applied as a series of 1-D passes.  The
+	 *	3x3 Sobel kernel is 1 term and the larger Sobel kernels are 2 terms.
+	 *
+	 * \param _vTerms Holds the returned terms.
+	 * \param _sMaxTerms The maximum number of terms allowed.  If the kernel can't be represented with this many terms, false is returned.
+	 * \return Returns true if the kernel could be split into no more than _sMaxTerms terms and all allocations succeeded.
+	 */
+	bool CKernel::Separate( std::vector<SL2_SEPARABLE_TERM> &_vTerms, size_t _sMaxTerms ) const {
+		_vTerms.clear();
+		if ( !m_ui32Size ) { return false; }
+		try {
+			// Peel off one rank-1 term at a time, pivoting on the largest remaining value (cross approximation).  For a kernel of
+			//	rank R this ends after exactly R terms.
+			std::vector<double> vResidual = m_vKernel;
+			double dMax = 0.0;
+			for ( auto I = vResidual.size(); I--; ) {
+				dMax = std::max( dMax, std::abs( vResidual[I] ) );
+			}
+			const double dTolerance = dMax * 1.0e-12;
+			while ( true ) {
+				size_t sPivot = 0;
+				for ( size_t I = 1; I < vResidual.size(); ++I ) {
+					if ( std::abs( vResidual[I] ) > std::abs( vResidual[sPivot] ) ) { sPivot = I; }
+				}
+				if ( std::abs( vResidual[sPivot] ) <= dTolerance ) { return true; }
+				if ( _vTerms.size() == _sMaxTerms ) {
+					_vTerms.clear();
+					return false;
+				}
+
+				size_t sP = sPivot / m_ui32Size, sQ = sPivot % m_ui32Size;
+				SL2_SEPARABLE_TERM stTerm;
+				stTerm.vCol.resize( m_ui32Size );
+				stTerm.vRow.resize( m_ui32Size );
+				for ( uint32_t I = 0; I < m_ui32Size; ++I ) {
+					stTerm.vCol[I] = vResidual[I*m_ui32Size+sQ] / vResidual[sPivot];
+					stTerm.vRow[I] = vResidual[sP*m_ui32Size+I];
+				}
+				for ( uint32_t Y = 0; Y < m_ui32Size; ++Y ) {
+					for ( uint32_t X = 0; X < m_ui32Size; ++X ) {
+						vResidual[Y*m_ui32Size+X] -= stTerm.vCol[Y] * stTerm.vRow[X];
+					}
+				}
+				_vTerms.push_back( std::move( stTerm ) );
+			}
+		}
+		catch ( ... ) {
+			_vTerms.clear();
+			return false;
+		}
+	}
+
 }	// namespace sl2
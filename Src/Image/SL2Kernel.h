@@ -53,6 +53,14 @@ namespace sl2 {
 		inline CKernel &										operator = ( const CKernel &_kOther );
 
 
+		// == Types.
+		/** One separable term of a kernel.  The term's contribution to the kernel is vCol[Y] * vRow[X]. */
+		struct SL2_SEPARABLE_TERM {
+			std::vector<double>									vCol;						/**< The vertical (column) weights. */
+			std::vector<double>									vRow;						/**< The horizontal (row) weights. */
+		};
+
+
 		// == Functions.
 		/**
 		 * Sets the size of the kernel.  The kernel is initialized to all 0's.
@@ -107,6 +115,16 @@ namespace sl2 {
 		 */
 		bool													CreateSobel9x9();
 
+		/**
+		 * Splits the kernel into a sum of separable (column * row) terms so that it can be applied as a series of 1-D passes.  The
+		 *	3x3 Sobel kernel is 1 term and the larger Sobel kernels are 2 terms.
+		 *
+		 * \param _vTerms Holds the returned terms.
+		 * \param _sMaxTerms The maximum number of terms allowed.  If the kernel can't be represented with this many terms, false is returned.
+		 * \return Returns true if the kernel could be split into no more than _sMaxTerms terms and all allocations succeeded.
+		 */
+		bool													Separate( std::vector<SL2_SEPARABLE_TERM> &_vTerms, size_t _sMaxTerms = 3 ) const;
+
 
 	protected :
 		// == Members.
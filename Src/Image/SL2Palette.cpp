@@ -8,6 +8,12 @@
 
 
 #include "SL2Palette.h"
+#include "SL2PaletteCache.h"
+#include "../Thread/SL2ParallelFor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace sl2 {
 
@@ -87,6 +93,42 @@ namespace sl2 {
 		return true;
 	}
 
+	/**
+	 * Saves a palette as a PAL file.  Colors are stored with 8 bits per channel and the ID follows them.
+	 *
+	 * \param _pPalette The palette to save.
+	 * \param _ui32Id The ID to save with the palette.
+	 * \param _sFile The stream to which to write the file.
+	 * \return Returns true if the palette fits in a PAL file and all allocations succeed.
+	 */
+	bool CPalette::SavePal( const CPal &_pPalette, uint32_t _ui32Id, CStream &_sFile ) {
+		if ( _pPalette.size() > 0xFFFF ) { return false; }
+		try {
+			SL2_PAL_HEADER phHeader;
+			uint32_t ui32Size = uint32_t( sizeof( phHeader ) + _pPalette.size() * sizeof( SL2_PALETTE_ENTRY ) + sizeof( uint32_t ) );
+			phHeader.ui32Riff = 0x46464952;							// RIFF.
+			phHeader.ui32FileSize = ui32Size - 8;
+			phHeader.ui64PalData = 0x61746164204C4150ULL;			// PAL data.
+			phHeader.ui32DataSize = ui32Size - 20;
+			phHeader.ui8Reserved[0] = 0;
+			phHeader.ui8Reserved[1] = 3;
+			phHeader.ui16PalEntries = uint16_t( _pPalette.size() );
+			if ( !_sFile.Write( phHeader ) ) { return false; }
+
+			auto Byte = []( double _dVal ) { return uint8_t( std::round( std::clamp( _dVal, 0.0, 1.0 ) * 255.0 ) ); };
+			for ( size_t I = 0; I < _pPalette.size(); ++I ) {
+				SL2_PALETTE_ENTRY peEntry;
+				peEntry.perRgba.ui8R = Byte( _pPalette[I][0] );
+				peEntry.perRgba.ui8G = Byte( _pPalette[I][1] );
+				peEntry.perRgba.ui8B = Byte( _pPalette[I][2] );
+				peEntry.perRgba.ui8A = Byte( _pPalette[I][3] );
+				if ( !_sFile.Write( peEntry ) ) { return false; }
+			}
+			return _sFile.WriteUi32( _ui32Id );
+		}
+		catch ( ... ) { return false; }
+	}
+
 	/**
 	 * Resets the palette back to scratch.
 	 **/
@@ -118,7 +160,8 @@ namespace sl2 {
 	}
 
 	/**
-	 * Generates a palette of a given size using K-Means.
+	 * Generates a palette of a given size using K-Means.  Identical colors are first gathered into a weighted histogram so that
+	 *	the clustering runs over the unique colors rather than over every texel.
 	 * 
 	 * \param _pcColors Input array of colors.
 	 * \param _sColorsSize Number of colors to which _pcColors points.
@@ -127,40 +170,542 @@ namespace sl2 {
 	 * \return Returns true if all internal allocations succeed.
 	 **/
 	bool CPalette::GenPalette_kMeans( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sIterations ) {
-		return kMeansColorQuantization( _pcColors, _sColorsSize, m_pPalette, _ui32Size, _sIterations );
+		CPal pUnique;
+		std::vector<size_t> vCounts;
+		if ( BuildHistogram( _pcColors, _sColorsSize, m_pkifFormat, pUnique, vCounts ) ) {
+			return kMeansColorQuantization( pUnique.data(), pUnique.size(), vCounts.data(), m_pPalette, _ui32Size, _sIterations );
+		}
+		return kMeansColorQuantization( _pcColors, _sColorsSize, nullptr, m_pPalette, _ui32Size, _sIterations );
+	}
+
+	/**
+	 * Generates a palette of a given size using Wu's variance-minimizing quantizer.  Colors are binned into a 5-bit-per-channel
+	 *	histogram (3 bits for alpha when alpha varies) whose boxes are split along the cut that removes the most variance.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _ui32Size Size of the palette to generate.
+	 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::GenPalette_Wu( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations ) {
+		return GenPalette_Quantizer( _pcColors, _sColorsSize, _ui32Size, _sRefineIterations, WuColorQuantization );
+	}
+
+	/**
+	 * Generates a palette of a given size using median cut.  The box with the largest squared channel range times weight is
+	 *	split at the weighted median of that channel until there are enough boxes.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _ui32Size Size of the palette to generate.
+	 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::GenPalette_MedianCut( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations ) {
+		return GenPalette_Quantizer( _pcColors, _sColorsSize, _ui32Size, _sRefineIterations, MedianCutColorQuantization );
 	}
 
 	/**
-	 * A better distruction of initial clusters.
+	 * Generates a palette of a given size using an octree.  Each level splits on 1 bit of red, green, blue, and alpha, and the
+	 *	least-used nodes at the deepest level are merged until there are few enough leaves.
 	 * 
 	 * \param _pcColors Input array of colors.
 	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _ui32Size Size of the palette to generate.
+	 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::GenPalette_Octree( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations ) {
+		return GenPalette_Quantizer( _pcColors, _sColorsSize, _ui32Size, _sRefineIterations, OctreeColorQuantization );
+	}
+
+	/**
+	 * Generates a palette of a given size using the generator selected by CFormat::m_pmPaletteMethod.  Generators other than
+	 *	K-Means are followed by CFormat::m_sPaletteRefineIterations K-Means iterations.  While CPaletteCache is enabled, the
+	 *	palette is loaded from the cache when possible and added to it otherwise.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _ui32Size Size of the palette to generate.
+	 * \param _sIterations Number of K-Means iterations when K-Means is selected.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::GenPalette( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sIterations ) {
+		CPaletteCache::SL2_KEY kKey;
+		if ( CPaletteCache::Enabled() ) {
+			kKey = CPaletteCache::Key( _pcColors, _sColorsSize, m_pkifFormat, _ui32Size, _sIterations );
+			// Quantizers return fewer colors than requested when there are few unique colors.
+			if ( CPaletteCache::Load( kKey, _ui32Size, m_pPalette ) ) { return true; }
+		}
+
+		bool bRet;
+		switch ( CFormat::m_pmPaletteMethod ) {
+			case SL2_PM_WU : {
+				bRet = GenPalette_Wu( _pcColors, _sColorsSize, _ui32Size, CFormat::m_sPaletteRefineIterations );
+				break;
+			}
+			case SL2_PM_MEDIAN_CUT : {
+				bRet = GenPalette_MedianCut( _pcColors, _sColorsSize, _ui32Size, CFormat::m_sPaletteRefineIterations );
+				break;
+			}
+			case SL2_PM_OCTREE : {
+				bRet = GenPalette_Octree( _pcColors, _sColorsSize, _ui32Size, CFormat::m_sPaletteRefineIterations );
+				break;
+			}
+			default : {
+				bRet = GenPalette_kMeans( _pcColors, _sColorsSize, _ui32Size, _sIterations );
+			}
+		}
+
+		if ( bRet && CPaletteCache::Enabled() ) {
+			// A failure to write the entry only means generating the palette again next time.
+			CPaletteCache::Store( kKey, m_pPalette );
+		}
+		return bRet;
+	}
+
+	/**
+	 * Creates a nearest-color search structure for a palette.
+	 * 
+	 * \param _pPalette The palette.
+	 * \param _nNearest Holds the returned search structure.
+	 * \param _cdDistance The color-distance metric by which to match colors.
+	 * \return Returns true if all allocations succeed.
+	 **/
+	bool CPalette::BuildNearest( const CPal &_pPalette, SL2_NEAREST &_nNearest, SL2_COLOR_DISTANCE _cdDistance ) {
+		try {
+			_nNearest.cdDistance = _cdDistance;
+			CPal pSpace;
+			const CPal * ppPalette = &_pPalette;
+			if ( CColorDistance::HasSpace( _cdDistance ) ) {
+				pSpace.resize( _pPalette.size() );
+				for ( size_t J = 0; J < _pPalette.size(); ++J ) {
+					pSpace[J] = CColorDistance::ToSpace( _cdDistance, _pPalette[J] );
+				}
+				ppPalette = &pSpace;
+			}
+			const CPal & pPalette = (*ppPalette);
+
+			// Sort along the channel with the widest range; it rules out the most entries.
+			_nNearest.sAxis = 0;
+			double dWidest = -1.0;
+			for ( size_t I = 0; I < 4; ++I ) {
+				double dMin = std::numeric_limits<double>::infinity(), dMax = -std::numeric_limits<double>::infinity();
+				for ( size_t J = 0; J < pPalette.size(); ++J ) {
+					dMin = std::min( dMin, pPalette[J].m_dElements[I] );
+					dMax = std::max( dMax, pPalette[J].m_dElements[I] );
+				}
+				if ( dMax - dMin > dWidest ) {
+					dWidest = dMax - dMin;
+					_nNearest.sAxis = I;
+				}
+			}
+
+			size_t sAxis = _nNearest.sAxis;
+			_nNearest.vIndices.resize( pPalette.size() );
+			for ( size_t J = 0; J < pPalette.size(); ++J ) {
+				_nNearest.vIndices[J] = uint32_t( J );
+			}
+			std::stable_sort( _nNearest.vIndices.begin(), _nNearest.vIndices.end(), [&]( uint32_t _ui32L, uint32_t _ui32R ) {
+				return pPalette[_ui32L].m_dElements[sAxis] < pPalette[_ui32R].m_dElements[sAxis];
+			} );
+			_nNearest.vSorted.resize( pPalette.size() );
+			_nNearest.vKeys.resize( pPalette.size() );
+			for ( size_t J = 0; J < pPalette.size(); ++J ) {
+				_nNearest.vSorted[J] = pPalette[_nNearest.vIndices[J]];
+				_nNearest.vKeys[J] = _nNearest.vSorted[J].m_dElements[sAxis];
+			}
+		}
+		catch ( ... ) { return false; }
+		return true;
+	}
+
+	/**
+	 * Finds the palette entry nearest to a color by the metric given to BuildNearest().  Ties go to the lowest palette index.
+	 * 
+	 * \param _nNearest The search structure created by BuildNearest().  Must not be empty.
+	 * \param _cColor The color to match.
+	 * \return Returns the index of the nearest palette entry.
+	 **/
+	size_t CPalette::FindNearest( const SL2_NEAREST &_nNearest, const CColor &_cColor ) {
+		const size_t sTotal = _nNearest.vKeys.size();
+		const CColor cColor = CColorDistance::HasSpace( _nNearest.cdDistance ) ? CColorDistance::ToSpace( _nNearest.cdDistance, _cColor ) : _cColor;
+		double dBest = std::numeric_limits<double>::infinity();
+		uint32_t ui32Best = ~uint32_t( 0 );
+		if ( !CColorDistance::IsEuclidean( _nNearest.cdDistance ) ) {
+			// No bound along a single channel holds for these, so every entry is checked.
+			for ( size_t I = 0; I < sTotal; ++I ) {
+				double dDist = CColorDistance::DistanceSq( _nNearest.cdDistance, cColor, _nNearest.vSorted[I] );
+				uint32_t ui32Idx = _nNearest.vIndices[I];
+				if ( dDist < dBest || (dDist == dBest && ui32Idx < ui32Best) ) {
+					dBest = dDist;
+					ui32Best = ui32Idx;
+				}
+			}
+			return (ui32Best == ~uint32_t( 0 )) ? 0 : ui32Best;
+		}
+
+		const double dKey = cColor.m_dElements[_nNearest.sAxis];
+		auto Test = [&]( size_t _sIdx ) {
+			double dDist = CColor::EuclideanDistanceSq( cColor, _nNearest.vSorted[_sIdx] );
+			uint32_t ui32Idx = _nNearest.vIndices[_sIdx];
+			if ( dDist < dBest || (dDist == dBest && ui32Idx < ui32Best) ) {
+				dBest = dDist;
+				ui32Best = ui32Idx;
+			}
+		};
+
+		// Walk outwards from the color's position along the sorted channel.  The squared difference along that channel never
+		//	exceeds the full squared distance, so each side stops once it alone is farther than the best match.  Stopping only
+		//	when strictly farther keeps every tie in play.
+		size_t sUp = size_t( std::lower_bound( _nNearest.vKeys.begin(), _nNearest.vKeys.end(), dKey ) - _nNearest.vKeys.begin() );
+		size_t sDown = sUp;
+		bool bUp = sUp < sTotal, bDown = sDown > 0;
+		while ( bUp || bDown ) {
+			if ( bUp ) {
+				double dAxis = _nNearest.vKeys[sUp] - dKey;
+				if ( dAxis * dAxis > dBest ) { bUp = false; }
+				else {
+					Test( sUp );
+					bUp = ++sUp < sTotal;
+				}
+			}
+			if ( bDown ) {
+				double dAxis = dKey - _nNearest.vKeys[sDown-1];
+				if ( dAxis * dAxis > dBest ) { bDown = false; }
+				else {
+					Test( sDown - 1 );
+					bDown = --sDown > 0;
+				}
+			}
+		}
+		// Only NaN colors match nothing.
+		return (ui32Best == ~uint32_t( 0 )) ? 0 : ui32Best;
+	}
+
+	/**
+	 * Error-diffusion dithering.  Rows are handed out in order to worker threads, each of which waits only for the texels its
+	 *	taps read from in the rows above, so several rows are in flight at once.  Each texel gathers its errors in the same order
+	 *	in which a serial raster pass would have scattered them, so the result matches a serial pass exactly.
+	 * 
+	 * \param _prgbaColors The in/out color buffer.
+	 * \param _ui32Width The width of the image.
+	 * \param _ui32Height The height of the image.
+	 * \param _pPalette The palette.
+	 * \param _pdtTaps The kernel's taps.  Each must point forward in raster order and at most SL2_MAX_DIFFUSION_ROWS rows down.
+	 * \param _sTaps The number of taps to which _pdtTaps points.
+	 * \param _cWeights The per-channel scale applied to each texel's error.
+	 * \return Returns true if all allocations succeed and the inputs are valid.
+	 **/
+	bool CPalette::DiffuseError( CFormat::SL2_RGBA64F * _prgbaColors, uint32_t _ui32Width, uint32_t _ui32Height, const CPal &_pPalette,
+		const SL2_DIFFUSION_TAP * _pdtTaps, size_t _sTaps, const CColor &_cWeights ) {
+		if ( !_pPalette.size() ) { return false; }
+		if ( !_ui32Width || !_ui32Height ) { return true; }
+		try {
+			SL2_NEAREST nNearest;
+			if ( !BuildNearest( _pPalette, nNearest, CFormat::m_cdColorDistance ) ) { return false; }
+
+			SL2_DIFFUSION dData;
+			dData.prgbaColors = _prgbaColors;
+			dData.ui32Width = _ui32Width;
+			dData.ui32Height = _ui32Height;
+			dData.ppPalette = &_pPalette;
+			dData.pnNearest = &nNearest;
+			dData.cWeights = _cWeights;
+			dData.ui32Rows = 0;
+			for ( size_t I = 0; I <= SL2_MAX_DIFFUSION_ROWS; ++I ) {
+				dData.ui32Reach[I] = 0;
+			}
+			for ( size_t T = 0; T < _sTaps; ++T ) {
+				const SL2_DIFFUSION_TAP & dtTap = _pdtTaps[T];
+				if ( dtTap.i32Y < 0 || dtTap.i32Y > SL2_MAX_DIFFUSION_ROWS || (dtTap.i32Y == 0 && dtTap.i32X <= 0) ) { return false; }
+				if ( dtTap.i32Y ) {
+					dData.ui32Rows = std::max( dData.ui32Rows, uint32_t( dtTap.i32Y ) );
+					// A tap pointing down and to the left reads a texel to the right when gathering.
+					dData.ui32Reach[dtTap.i32Y] = std::max( dData.ui32Reach[dtTap.i32Y], uint32_t( std::max( -dtTap.i32X, 0 ) ) );
+				}
+			}
+			// A serial pass visits sources in raster order, so a texel gathers from the lowest row first and from right to left
+			//	(by offset) within a row.
+			dData.vTaps.assign( _pdtTaps, _pdtTaps + _sTaps );
+			std::stable_sort( dData.vTaps.begin(), dData.vTaps.end(), []( const SL2_DIFFUSION_TAP &_dtL, const SL2_DIFFUSION_TAP &_dtR ) {
+				if ( _dtL.i32Y != _dtR.i32Y ) { return _dtL.i32Y > _dtR.i32Y; }
+				return _dtL.i32X > _dtR.i32X;
+			} );
+			dData.vErrors.resize( size_t( _ui32Width ) * _ui32Height );
+			dData.vProgress = std::vector<std::atomic<uint32_t>>( _ui32Height );
+			for ( auto & aThis : dData.vProgress ) {
+				aThis.store( 0, std::memory_order_relaxed );
+			}
+			dData.aNextRow.store( 0, std::memory_order_relaxed );
+
+			// Rows are taken in order, so any number of threads (including only this one) finishes.
+			CParallelFor::Run( CParallelFor::Workers( _ui32Height ), [&]( size_t ) { DiffuseErrorThread( &dData ); } );
+		}
+		catch ( ... ) { return false; }
+		return true;
+	}
+
+	/**
+	 * Ordered dithering.  Each texel is offset by its threshold-map entry and snapped to the nearest palette entry.  Texels
+	 *	do not depend on each other, so rows are split evenly across threads.
+	 * 
+	 * \param _prgbaColors The in/out color buffer.
+	 * \param _ui32Width The width of the image.
+	 * \param _ui32Height The height of the image.
+	 * \param _pPalette The palette.
+	 * \param _pdMap The threshold map, indexed [X*_ui32MapSize+Y] with values in [0, 1).
+	 * \param _ui32MapSize The side length of the threshold map.  Must be a power of 2.
+	 * \param _cScale The per-channel scale applied to each threshold.
+	 * \return Returns true if all allocations succeed and the inputs are valid.
+	 **/
+	bool CPalette::OrderedDither( CFormat::SL2_RGBA64F * _prgbaColors, uint32_t _ui32Width, uint32_t _ui32Height, const CPal &_pPalette,
+		const double * _pdMap, uint32_t _ui32MapSize, const CColor &_cScale ) {
+		if ( !_pPalette.size() || !_pdMap || !_ui32MapSize || (_ui32MapSize & (_ui32MapSize - 1)) ) { return false; }
+		if ( !_ui32Width || !_ui32Height ) { return true; }
+		try {
+			SL2_NEAREST nNearest;
+			if ( !BuildNearest( _pPalette, nNearest, CFormat::m_cdColorDistance ) ) { return false; }
+
+			size_t sThreads = CParallelFor::Workers( _ui32Height );
+			std::vector<SL2_ORDERED_DITHER> vData( sThreads );
+			for ( size_t T = 0; T < sThreads; ++T ) {
+				SL2_ORDERED_DITHER & odThis = vData[T];
+				odThis.prgbaColors = _prgbaColors;
+				odThis.ui32Width = _ui32Width;
+				odThis.ui32StartRow = uint32_t( uint64_t( _ui32Height ) * T / sThreads );
+				odThis.ui32EndRow = uint32_t( uint64_t( _ui32Height ) * (T + 1) / sThreads );
+				odThis.ppPalette = &_pPalette;
+				odThis.pnNearest = &nNearest;
+				odThis.pdMap = _pdMap;
+				odThis.ui32MapSize = _ui32MapSize;
+				odThis.cScale = _cScale;
+			}
+
+			CParallelFor::Run( sThreads, [&]( size_t _sWorker ) { OrderedDitherThread( &vData[_sWorker] ); } );
+		}
+		catch ( ... ) { return false; }
+		return true;
+	}
+
+	/**
+	 * A better distruction of initial clusters.  Uses k-means++ seeding, switching to k-means|| for large inputs.  Seeding is
+	 *	reproducible for a given CFormat::m_ui64kMeansSeed.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+	 * \param _vCentroids Input array of centroids.
+	 * \param _sK A pretty cool dude IMO.
+	 **/
+	void CPalette::InitializeCentroidsKMeansPlusPlus( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, std::vector<CColor> &_vCentroids, size_t _sK ) {
+		if ( !_sColorsSize ) { return; }
+		// k-means|| measures about sRounds * K candidates against every color instead of K centroids, so it only pays off on
+		//	large inputs.  The choice depends only on the input so that the palette is the same on every machine.
+		constexpr size_t sParallelMin = 1 << 18;
+		if ( _sColorsSize >= sParallelMin && _sK > 1 ) {
+			std::mt19937_64 mRand( CFormat::m_ui64kMeansSeed );
+			if ( SeedKMeansParallel( _pcColors, _sColorsSize, _psWeights, _vCentroids, _sK, mRand ) ) { return; }
+		}
+		std::mt19937_64 mRand( CFormat::m_ui64kMeansSeed );
+		SeedKMeansPlusPlus( _pcColors, _sColorsSize, _psWeights, _vCentroids, _sK, mRand );
+	}
+
+	/**
+	 * D^2-weighted k-means++ seeding.  Each color keeps its squared distance to the nearest chosen centroid, so each new
+	 *	centroid costs one pass over the colors.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
 	 * \param _vCentroids Input array of centroids.
 	 * \param _sK A pretty cool dude IMO.
+	 * \param _mRand The random-number generator.
 	 **/
-	void CPalette::InitializeCentroidsKMeansPlusPlus( const CColor * _pcColors, size_t _sColorsSize, std::vector<CColor> &_vCentroids, size_t _sK ) {
-		// Initialize first centroid randomly
-		_vCentroids[0] = _pcColors[rand() % _sColorsSize];
+	void CPalette::SeedKMeansPlusPlus( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, std::vector<CColor> &_vCentroids, size_t _sK, std::mt19937_64 &_mRand ) {
+		std::vector<double> vMinDist( _sColorsSize, std::numeric_limits<double>::infinity() );
+		std::uniform_real_distribution<double> udDist( 0.0, 1.0 );
+
+		// Picks the color at which the running sum of weight * cost passes _dTarget.
+		auto Pick = [&]( double _dTarget, bool _bUseDist ) {
+			size_t sLast = 0;
+			for ( size_t J = 0; J < _sColorsSize; ++J ) {
+				double dThis = (_psWeights ? static_cast<double>(_psWeights[J]) : 1.0) * (_bUseDist ? vMinDist[J] : 1.0);
+				if ( dThis > 0.0 ) {
+					sLast = J;
+					if ( _dTarget < dThis ) { return J; }
+					_dTarget -= dThis;
+				}
+			}
+			// Rounding in the running sum can step past the end.
+			return sLast;
+		};
 
-		// Initialize remaining centroids based on their distances from already chosen centroids
+		// The first centroid is a texel picked at random.
+		double dTotal = 0.0;
+		for ( size_t J = 0; J < _sColorsSize; ++J ) { dTotal += _psWeights ? static_cast<double>(_psWeights[J]) : 1.0; }
+		_vCentroids[0] = _pcColors[Pick( udDist( _mRand ) * dTotal, false )];
+
+		// Each following centroid is picked with a probability proportional to its squared distance from the nearest centroid so far.
 		for ( size_t I = 1; I < _sK; ++I ) {
-			double dMaxDist = 0.0;
-			size_t sBest = 0;
+			dTotal = 0.0;
 			for ( size_t J = 0; J < _sColorsSize; ++J ) {
-				double dMinDist = std::numeric_limits<double>::max();
-				for ( size_t C = 0; C < I; ++C ) {
-					double dDist = CColor::EuclideanDistanceSq( _pcColors[J], _vCentroids[C] );
-					if ( dDist < dMinDist ) {
-						dMinDist = dDist;
+				double dDist = CColor::EuclideanDistanceSq( _pcColors[J], _vCentroids[I-1] );
+				if ( dDist < vMinDist[J] ) {
+					vMinDist[J] = dDist;
+				}
+				dTotal += (_psWeights ? static_cast<double>(_psWeights[J]) : 1.0) * vMinDist[J];
+			}
+			if ( dTotal <= 0.0 ) {
+				// Every color is already a centroid.
+				_vCentroids[I] = _vCentroids[0];
+				continue;
+			}
+			_vCentroids[I] = _pcColors[Pick( udDist( _mRand ) * dTotal, true )];
+		}
+	}
+
+	/**
+	 * k-means|| seeding (Bahmani et al.)  A few rounds oversample candidates in parallel, then k-means++ over the candidates,
+	 *	weighted by how many colors each one is nearest, picks the centroids.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+	 * \param _vCentroids Input array of centroids.
+	 * \param _sK A pretty cool dude IMO.
+	 * \param _mRand The random-number generator.
+	 * \return Returns false if memory could not be allocated, in which case _vCentroids is not filled in.
+	 **/
+	bool CPalette::SeedKMeansParallel( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, std::vector<CColor> &_vCentroids, size_t _sK, std::mt19937_64 &_mRand ) {
+		try {
+			constexpr size_t sRounds = 5;
+			constexpr size_t sBlock = 4096;
+			const double dOversample = static_cast<double>(_sK);
+
+			std::vector<double> vMinDist( _sColorsSize, std::numeric_limits<double>::infinity() );
+			std::vector<uint32_t> vNearest( _sColorsSize, 0 );
+			std::vector<CColor> vCandidates;
+
+			// The first candidate is a texel picked at random.
+			{
+				std::vector<CColor> vFirst( 1 );
+				SeedKMeansPlusPlus( _pcColors, _sColorsSize, _psWeights, vFirst, 1, _mRand );
+				vCandidates.push_back( vFirst[0] );
+			}
+
+			// Split the colors into whole blocks per thread.
+			size_t sBlocks = (_sColorsSize + sBlock - 1) / sBlock;
+			size_t sThreads = std::min( std::max<size_t>( std::thread::hardware_concurrency(), 1 ), sBlocks );
+			std::vector<SL2_KMEANS_PARALLEL> vData( sThreads );
+			for ( size_t T = 0; T < sThreads; ++T ) {
+				vData[T].pcColors = _pcColors;
+				vData[T].psWeights = _psWeights;
+				vData[T].sStart = std::min( (sBlocks * T / sThreads) * sBlock, _sColorsSize );
+				vData[T].sEnd = std::min( (sBlocks * (T + 1) / sThreads) * sBlock, _sColorsSize );
+				vData[T].pvCandidates = &vCandidates;
+				vData[T].pdMinDist = vMinDist.data();
+				vData[T].pui32Nearest = vNearest.data();
+				vData[T].bFailed = false;
+			}
+			// The split does not follow the thread budget, so the summed costs do not depend on what else is running.
+			auto Run = [&]() {
+				CParallelFor::Run( sThreads, [&]( size_t _sWorker ) { KMeansParallelThread( &vData[_sWorker] ); } );
+			};
+			// Brings distances up to date with the candidates added since the last update and returns the total cost.
+			size_t sUpdated = 0;
+			auto Update = [&]() {
+				double dCost = 0.0;
+				for ( auto & kpThis : vData ) {
+					kpThis.sNewCandidates = sUpdated;
+					kpThis.dSampleScale = 0.0;
+				}
+				Run();
+				for ( auto & kpThis : vData ) { dCost += kpThis.dCost; }
+				sUpdated = vCandidates.size();
+				return dCost;
+			};
+
+			for ( size_t R = 0; R < sRounds; ++R ) {
+				double dCost = Update();
+				if ( dCost <= 0.0 ) { break; }
+				uint64_t ui64Seed = _mRand();
+				for ( auto & kpThis : vData ) {
+					kpThis.dSampleScale = dOversample / dCost;
+					kpThis.ui64Seed = ui64Seed;
+					kpThis.vSampled.clear();
+				}
+				Run();
+				// Threads are in color order, so the candidates do not depend on timing.  A round that lost candidates would not
+				//	be reproducible, so seeding starts over with k-means++ instead.
+				for ( auto & kpThis : vData ) {
+					if ( kpThis.bFailed ) { return false; }
+				}
+				for ( auto & kpThis : vData ) {
+					for ( auto sIdx : kpThis.vSampled ) {
+						vCandidates.push_back( _pcColors[sIdx] );
 					}
 				}
-				if ( dMinDist > dMaxDist ) {
-					dMaxDist = dMinDist;
-					sBest = J;
+				if ( vCandidates.size() > size_t( ~uint32_t( 0 ) ) ) { break; }
+			}
+			Update();
+
+			// Weigh each candidate by the colors nearest to it and cluster the candidates.
+			std::vector<size_t> vCandidateWeights( vCandidates.size() );
+			for ( size_t J = 0; J < _sColorsSize; ++J ) {
+				vCandidateWeights[vNearest[J]] += _psWeights ? _psWeights[J] : 1;
+			}
+			SeedKMeansPlusPlus( vCandidates.data(), vCandidates.size(), vCandidateWeights.data(), _vCentroids, _sK, _mRand );
+			return true;
+		}
+		catch ( ... ) { return false; }
+	}
+
+	/**
+	 * A k-means|| worker thread.  Either brings each color's nearest-candidate distance up to date with the new candidates or
+	 *	samples new candidates.  Sampling uses one generator per fixed block of colors so that the result does not depend on
+	 *	the thread count.
+	 * 
+	 * \param _pkpData The thread's data.
+	 **/
+	void CPalette::KMeansParallelThread( SL2_KMEANS_PARALLEL * _pkpData ) {
+		constexpr size_t sBlock = 4096;
+		const std::vector<CColor> & vCandidates = (*_pkpData->pvCandidates);
+		if ( _pkpData->dSampleScale == 0.0 ) {
+			double dCost = 0.0;
+			for ( size_t J = _pkpData->sStart; J < _pkpData->sEnd; ++J ) {
+				double dMin = _pkpData->pdMinDist[J];
+				uint32_t ui32Nearest = _pkpData->pui32Nearest[J];
+				for ( size_t C = _pkpData->sNewCandidates; C < vCandidates.size(); ++C ) {
+					double dDist = CColor::EuclideanDistanceSq( _pkpData->pcColors[J], vCandidates[C] );
+					if ( dDist < dMin ) {
+						dMin = dDist;
+						ui32Nearest = uint32_t( C );
+					}
+				}
+				_pkpData->pdMinDist[J] = dMin;
+				_pkpData->pui32Nearest[J] = ui32Nearest;
+				dCost += (_pkpData->psWeights ? static_cast<double>(_pkpData->psWeights[J]) : 1.0) * dMin;
+			}
+			_pkpData->dCost = dCost;
+			return;
+		}
+
+		std::uniform_real_distribution<double> udDist( 0.0, 1.0 );
+		try {
+			for ( size_t B = _pkpData->sStart; B < _pkpData->sEnd; B += sBlock ) {
+				std::mt19937_64 mRand( _pkpData->ui64Seed ^ (0x9E3779B97F4A7C15ULL * (B / sBlock + 1)) );
+				size_t sEnd = std::min( B + sBlock, _pkpData->sEnd );
+				for ( size_t J = B; J < sEnd; ++J ) {
+					double dP = (_pkpData->psWeights ? static_cast<double>(_pkpData->psWeights[J]) : 1.0) * _pkpData->pdMinDist[J] * _pkpData->dSampleScale;
+					if ( udDist( mRand ) < dP ) {
+						_pkpData->vSampled.push_back( J );
+					}
 				}
 			}
-			_vCentroids[I] = _pcColors[sBest];
 		}
+		catch ( ... ) { _pkpData->bFailed = true; }
 	}
 
 	/**
@@ -181,93 +726,825 @@ namespace sl2 {
 	}
 
 	/**
-	 * Cluster assignment.  It's pretty cool.
+	 * Cluster assignment.  It's pretty cool.  Runs across threads, using Hamerly's bounds to skip colors whose centroid cannot
+	 *	have changed, and gathers per-block sums for UpdateCentroids().
 	 * 
-	 * \param _pcColors Input array of colors.
-	 * \param _sColorsSize Number of colors to which _pcColors points.
-	 * \param _vCentroids Input array of centroids.
-	 * \param _vClusterAssignment Output cluster-assignment results.
-	 * \param _sK A pretty cool dude IMO.
+	 * \param _lLloyd The k-means state.
+	 **/
+	void CPalette::AssignClusters( SL2_LLOYD &_lLloyd ) {
+		// A color closer to its centroid than half the gap to that centroid's nearest neighbor cannot be closer to any other.
+		size_t sK = _lLloyd.vCentroids.size();
+		for ( size_t C = 0; C < sK; ++C ) {
+			double dMin = std::numeric_limits<double>::infinity();
+			for ( size_t J = 0; J < sK; ++J ) {
+				if ( J != C ) {
+					dMin = std::min( dMin, CColor::EuclideanDistanceSq( _lLloyd.vCentroids[C], _lLloyd.vCentroids[J] ) );
+				}
+			}
+			_lLloyd.vHalfGap[C] = 0.5 * std::sqrt( dMin );
+		}
+
+		size_t sThreads = CParallelFor::Workers( _lLloyd.sBlocks );
+		std::vector<SL2_LLOYD_THREAD> vData( sThreads );
+		for ( size_t T = 0; T < sThreads; ++T ) {
+			vData[T].plLloyd = &_lLloyd;
+			vData[T].sStartBlock = _lLloyd.sBlocks * T / sThreads;
+			vData[T].sEndBlock = _lLloyd.sBlocks * (T + 1) / sThreads;
+		}
+		CParallelFor::Run( sThreads, [&]( size_t _sWorker ) { AssignClustersThread( &vData[_sWorker] ); } );
+	}
+
+	/**
+	 * A cluster-assignment worker thread.
+	 * 
+	 * \param _pltData The blocks to assign.
 	 **/
-	void CPalette::AssignClusters( const CColor * _pcColors, size_t _sColorsSize, const std::vector<CColor> & _vCentroids, std::vector<size_t> & _vClusterAssignment, size_t _sK ) {
-		auto aImgSize = _sColorsSize;
-		for ( size_t C = 0; C < aImgSize; ++C ) {
-			double dBestDist = CColor::EuclideanDistanceSq( _pcColors[C], _vCentroids[0] );
-			size_t sBest = 0;
+	void CPalette::AssignClustersThread( SL2_LLOYD_THREAD * _pltData ) {
+		SL2_LLOYD & lLloyd = (*_pltData->plLloyd);
+		size_t sK = lLloyd.vCentroids.size();
+		const CColor * pcCentroids = lLloyd.vCentroids.data();
+		for ( size_t B = _pltData->sStartBlock; B < _pltData->sEndBlock; ++B ) {
+			CColor * pcSums = &lLloyd.vSums[B*sK];
+			size_t * psCounts = &lLloyd.vCounts[B*sK];
+			for ( size_t C = 0; C < sK; ++C ) {
+				pcSums[C].Zero();
+				psCounts[C] = 0;
+			}
+
+			size_t sEnd = std::min( (B + 1) * lLloyd.sBlockSize, lLloyd.sTotal );
+			for ( size_t J = B * lLloyd.sBlockSize; J < sEnd; ++J ) {
+				const CColor & cThis = lLloyd.pcColors[J];
+				uint32_t ui32Cluster = lLloyd.vAssignment[J];
+				// Account for how far the centroids moved in the last update.
+				double dUpper = lLloyd.vUpper[J] + lLloyd.vMoved[ui32Cluster];
+				double dLower = lLloyd.vLower[J] - ((ui32Cluster == lLloyd.sMaxMoved) ? lLloyd.dSecondMoved : lLloyd.dMaxMoved);
+				double dBound = std::max( lLloyd.vHalfGap[ui32Cluster], dLower );
+				if ( dUpper >= dBound ) {
+					dUpper = std::sqrt( CColor::EuclideanDistanceSq( cThis, pcCentroids[ui32Cluster] ) );
+					if ( dUpper >= dBound ) {
+						// The bounds could not rule anything out; check every centroid.
+						double dBest = std::numeric_limits<double>::infinity(), dSecond = std::numeric_limits<double>::infinity();
+						uint32_t ui32Best = 0;
+						for ( size_t C = 0; C < sK; ++C ) {
+							double dDist = CColor::EuclideanDistanceSq( cThis, pcCentroids[C] );
+							if ( dDist < dBest ) {
+								dSecond = dBest;
+								dBest = dDist;
+								ui32Best = uint32_t( C );
+							}
+							else if ( dDist < dSecond ) {
+								dSecond = dDist;
+							}
+						}
+						ui32Cluster = ui32Best;
+						dUpper = std::sqrt( dBest );
+						dLower = std::sqrt( dSecond );
+					}
+				}
+				lLloyd.vAssignment[J] = ui32Cluster;
+				lLloyd.vUpper[J] = dUpper;
+				lLloyd.vLower[J] = dLower;
 
-			for ( size_t J = 1; J < _sK; ++J ) {
-				double dDist = CColor::EuclideanDistanceSq( _pcColors[C], _vCentroids[J] );
-				if ( dDist < dBestDist ) {
-					dBestDist = dDist;
-					sBest = J;
+				if ( lLloyd.psWeights ) {
+					pcSums[ui32Cluster] += cThis * static_cast<double>(lLloyd.psWeights[J]);
+					psCounts[ui32Cluster] += lLloyd.psWeights[J];
 				}
+				else {
+					pcSums[ui32Cluster] += cThis;
+					++psCounts[ui32Cluster];
+				}
+			}
+		}
+	}
+
+	/**
+	 * Updates centroids like a BOSS.  Per-block sums are merged in block order, so the result is the same for any thread count.
+	 * 
+	 * \param _lLloyd The k-means state.
+	 **/
+	void CPalette::UpdateCentroids( SL2_LLOYD &_lLloyd ) {
+		size_t sK = _lLloyd.vCentroids.size();
+		_lLloyd.dMaxMoved = _lLloyd.dSecondMoved = 0.0;
+		_lLloyd.sMaxMoved = 0;
+		for ( size_t C = 0; C < sK; ++C ) {
+			CColor cSum( 0.0, 0.0, 0.0, 0.0 );
+			size_t sCount = 0;
+			for ( size_t B = 0; B < _lLloyd.sBlocks; ++B ) {
+				cSum += _lLloyd.vSums[B*sK+C];
+				sCount += _lLloyd.vCounts[B*sK+C];
 			}
 
-			_vClusterAssignment[C] = sBest;
+			double dMoved = 0.0;
+			if ( sCount > 0 ) {
+				CColor cNew = cSum / static_cast<double>(sCount);
+				dMoved = std::sqrt( CColor::EuclideanDistanceSq( _lLloyd.vCentroids[C], cNew ) );
+				_lLloyd.vCentroids[C] = cNew;
+			}
+			_lLloyd.vMoved[C] = dMoved;
+			if ( dMoved > _lLloyd.dMaxMoved ) {
+				_lLloyd.dSecondMoved = _lLloyd.dMaxMoved;
+				_lLloyd.dMaxMoved = dMoved;
+				_lLloyd.sMaxMoved = C;
+			}
+			else if ( dMoved > _lLloyd.dSecondMoved ) {
+				_lLloyd.dSecondMoved = dMoved;
+			}
 		}
 	}
 
 	/**
-	 * Updates centroids like a BOSS.
+	 * Implements K-Means color quantization to generate a palette.  Clustering runs in the space of
+	 *	CFormat::m_cdColorDistance.
 	 * 
 	 * \param _pcColors Input array of colors.
 	 * \param _sColorsSize Number of colors to which _pcColors points.
-	 * \param _vCentroids Input array of centroids.
-	 * \param _vClusterAssignment Output cluster-assignment results.
-	 * \param _vClusterSize Output cluster-size results.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+	 * \param _pPalette The palette to generate.
 	 * \param _sK A pretty cool dude IMO.
+	 * \param _sIterations Number of iterations.
+	 * \param _bSeeded If true, _pPalette holds the initial centroids and _sK must match its size.
+	 * \return Returns true if all internal allocations succeed.
 	 **/
-	void CPalette::UpdateCentroids( const CColor * _pcColors, size_t _sColorsSize, std::vector<CColor> & _vCentroids, std::vector<size_t> & _vClusterAssignment, std::vector<size_t> & _vClusterSize, size_t _sK ) {
-		std::vector<CColor> vNewCentroids( _sK, { 0.0, 0.0, 0.0, 0.0 } );
-		_vClusterSize.assign( _sK, 0 );
-
-		size_t sImageSize = _sColorsSize;
-		for ( size_t C = 0; C < sImageSize; ++C ) {
-			size_t sCluster = _vClusterAssignment[C];
-			vNewCentroids[sCluster] += _pcColors[C];
-			_vClusterSize[sCluster]++;
+	bool CPalette::kMeansColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK, size_t _sIterations, bool _bSeeded ) {
+		SL2_COLOR_DISTANCE cdDistance = CFormat::m_cdColorDistance;
+		if ( !CColorDistance::HasSpace( cdDistance ) ) {
+			return LloydColorQuantization( _pcColors, _sColorsSize, _psWeights, _pPalette, _sK, _sIterations, _bSeeded );
 		}
-
-		for ( size_t J = 0; J < _sK; ++J ) {
-			if ( _vClusterSize[J] > 0 ) {
-				_vCentroids[J] = (vNewCentroids[J] / static_cast<double>(_vClusterSize[J]));
+		// Centroids are means, which only minimize squared Euclidean distance, so CIE94 and CIEDE2000 cluster by CIE76 in the
+		//	CIELAB space they share.
+		try {
+			std::vector<CColor> vSpace( _sColorsSize );
+			for ( size_t J = 0; J < _sColorsSize; ++J ) {
+				vSpace[J] = CColorDistance::ToSpace( cdDistance, _pcColors[J] );
 			}
+			CPal pSpace;
+			if ( _bSeeded ) {
+				pSpace.resize( _pPalette.size() );
+				for ( size_t J = 0; J < _pPalette.size(); ++J ) {
+					pSpace[J] = CColorDistance::ToSpace( cdDistance, _pPalette[J] );
+				}
+			}
+			if ( !LloydColorQuantization( vSpace.data(), _sColorsSize, _psWeights, pSpace, _sK, _sIterations, _bSeeded ) ) { return false; }
+			_pPalette.resize( pSpace.size() );
+			for ( size_t J = 0; J < pSpace.size(); ++J ) {
+				_pPalette[J] = CColorDistance::FromSpace( cdDistance, pSpace[J] );
+			}
+			return true;
 		}
+		catch ( ... ) { return false; }
 	}
 
 	/**
-	 * Implements K-Means color quantization to generate a palette.
+	 * Runs K-Means on colors as given, by squared Euclidean distance.
 	 * 
 	 * \param _pcColors Input array of colors.
 	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
 	 * \param _pPalette The palette to generate.
-	 * \param _sK A pretty cool dude IMO.
+	 * \param _sK The number of clusters.
 	 * \param _sIterations Number of iterations.
+	 * \param _bSeeded If true, _pPalette holds the initial centroids and _sK must match its size.
 	 * \return Returns true if all internal allocations succeed.
 	 **/
-	bool CPalette::kMeansColorQuantization( const CColor * _pcColors, size_t _sColorsSize, CPal & _pPalette, size_t _sK, size_t _sIterations ) {
+	bool CPalette::LloydColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK, size_t _sIterations, bool _bSeeded ) {
 		try {
-			std::vector<CColor> vCentroids( _sK );
-			std::vector<size_t> vClsterAssignment( _sColorsSize );
-			std::vector<size_t> vClstSize( _sK );
+			SL2_LLOYD lLloyd;
+			lLloyd.pcColors = _pcColors;
+			lLloyd.psWeights = _psWeights;
+			lLloyd.sTotal = _sColorsSize;
+			if ( _bSeeded ) {
+				lLloyd.vCentroids = _pPalette;
+			}
+			else {
+				lLloyd.vCentroids.resize( _sK );
+
+				// Initialize centroids using k-means++ instead of random initialization
+				InitializeCentroidsKMeansPlusPlus( _pcColors, _sColorsSize, _psWeights, lLloyd.vCentroids, _sK );
+			}
 
-			// Initialize centroids using k-means++ instead of random initialization
-			InitializeCentroidsKMeansPlusPlus( _pcColors, _sColorsSize, vCentroids, _sK );
+			// At most 256 blocks keeps the per-block sums small.
+			constexpr size_t sMinBlock = 4096;
+			constexpr size_t sMaxBlocks = 256;
+			lLloyd.sBlockSize = std::max( sMinBlock, (_sColorsSize + sMaxBlocks - 1) / sMaxBlocks );
+			lLloyd.sBlocks = (_sColorsSize + lLloyd.sBlockSize - 1) / lLloyd.sBlockSize;
+			lLloyd.vHalfGap.resize( _sK );
+			lLloyd.vMoved.assign( _sK, 0.0 );
+			lLloyd.dMaxMoved = lLloyd.dSecondMoved = 0.0;
+			lLloyd.sMaxMoved = 0;
+			// An infinite upper bound forces a full search the first time.
+			lLloyd.vAssignment.assign( _sColorsSize, 0 );
+			lLloyd.vUpper.assign( _sColorsSize, std::numeric_limits<double>::infinity() );
+			lLloyd.vLower.assign( _sColorsSize, 0.0 );
+			lLloyd.vSums.resize( lLloyd.sBlocks * _sK );
+			lLloyd.vCounts.resize( lLloyd.sBlocks * _sK );
 
-			std::vector<CColor> vOldCentroids(vCentroids);
+			std::vector<CColor> vOldCentroids( lLloyd.vCentroids );
 
 			for ( size_t sIter = 0; sIter < _sIterations; ++sIter ) {
-				AssignClusters( _pcColors, _sColorsSize, vCentroids, vClsterAssignment, _sK );
-				UpdateCentroids( _pcColors, _sColorsSize, vCentroids, vClsterAssignment, vClstSize, _sK );
+				AssignClusters( lLloyd );
+				UpdateCentroids( lLloyd );
+
+				if ( HasConverged( vOldCentroids, lLloyd.vCentroids, 1e-5 ) ) { break; }
+				vOldCentroids = lLloyd.vCentroids;
+			}
+
+			_pPalette = lLloyd.vCentroids;
+			return true;
+		}
+		catch ( ... ) { return false; }
+	}
+
+	/**
+	 * Wu's variance-minimizing color quantization.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+	 * \param _pPalette The palette to generate.  It can end up with fewer than _sK colors.
+	 * \param _sK The maximum number of colors to generate.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::WuColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK ) {
+		try {
+			_pPalette.clear();
+			if ( !_sColorsSize || !_sK ) { return true; }
+
+			bool bAlpha = false;
+			for ( size_t J = 1; J < _sColorsSize; ++J ) {
+				if ( _pcColors[J].m_dElements[3] != _pcColors[0].m_dElements[3] ) {
+					bAlpha = true;
+					break;
+				}
+			}
+			// Alpha gets a single bin when it never changes.  Each channel also gets a leading empty bin so that the cumulative
+			//	moments need no edge cases.
+			const uint32_t ui32Bits[4] = { 5, 5, 5, bAlpha ? 3U : 0U };
+			int32_t i32Side[4];
+			for ( size_t I = 0; I < 4; ++I ) {
+				i32Side[I] = (1 << ui32Bits[I]) + 1;
+			}
+			size_t sStrides[4];
+			sStrides[3] = 1;
+			for ( size_t I = 3; I--; ) {
+				sStrides[I] = sStrides[I+1] * size_t( i32Side[I+1] );
+			}
+			std::vector<SL2_WU_MOMENT> vMoments( sStrides[0] * size_t( i32Side[0] ) );
+
+			for ( size_t J = 0; J < _sColorsSize; ++J ) {
+				const CColor & cThis = _pcColors[J];
+				size_t sIdx = 0;
+				double dLenSq = 0.0;
+				for ( size_t I = 0; I < 4; ++I ) {
+					int32_t i32Max = (1 << ui32Bits[I]) - 1;
+					int32_t i32Bin = std::min( int32_t( std::clamp( cThis.m_dElements[I], 0.0, 1.0 ) * (i32Max + 1) ), i32Max );
+					sIdx += size_t( i32Bin + 1 ) * sStrides[I];
+					dLenSq += cThis.m_dElements[I] * cThis.m_dElements[I];
+				}
+				double dW = _psWeights ? static_cast<double>(_psWeights[J]) : 1.0;
+				SL2_WU_MOMENT & wmThis = vMoments[sIdx];
+				wmThis.dW += dW;
+				for ( size_t I = 0; I < 4; ++I ) {
+					wmThis.dC[I] += dW * cThis.m_dElements[I];
+				}
+				wmThis.dM2 += dW * dLenSq;
+			}
+
+			// Accumulate along each channel in turn so that each cell holds the moments of every cell at or below it.
+			for ( size_t I = 0; I < 4; ++I ) {
+				for ( size_t J = 0; J < vMoments.size(); ++J ) {
+					if ( (J / sStrides[I]) % size_t( i32Side[I] ) ) {
+						SL2_WU_MOMENT & wmThis = vMoments[J];
+						const SL2_WU_MOMENT & wmPrev = vMoments[J-sStrides[I]];
+						wmThis.dW += wmPrev.dW;
+						for ( size_t C = 0; C < 4; ++C ) {
+							wmThis.dC[C] += wmPrev.dC[C];
+						}
+						wmThis.dM2 += wmPrev.dM2;
+					}
+				}
+			}
+
+			std::vector<SL2_WU_BOX> vBoxes;
+			std::vector<double> vVariance;
+			vBoxes.reserve( _sK );
+			vVariance.reserve( _sK );
+			SL2_WU_BOX wbAll;
+			for ( size_t I = 0; I < 4; ++I ) {
+				wbAll.i32Lo[I] = 0;
+				wbAll.i32Hi[I] = i32Side[I] - 1;
+			}
+			vBoxes.push_back( wbAll );
+			vVariance.push_back( WuVariance( vMoments.data(), sStrides, wbAll ) );
+
+			while ( vBoxes.size() < _sK ) {
+				// Split the box with the most variance.
+				size_t sNext = 0;
+				for ( size_t B = 1; B < vBoxes.size(); ++B ) {
+					if ( vVariance[B] > vVariance[sNext] ) { sNext = B; }
+				}
+				if ( vVariance[sNext] <= 0.0 ) { break; }
+
+				// The best cut leaves the most of the box's squared sum in its 2 halves, which is the same as removing the most variance.
+				const SL2_WU_BOX wbBox = vBoxes[sNext];
+				SL2_WU_MOMENT wmWhole = WuVolume( vMoments.data(), sStrides, wbBox );
+				double dBest = -1.0;
+				size_t sAxis = 0;
+				int32_t i32Cut = -1;
+				for ( size_t I = 0; I < 4; ++I ) {
+					SL2_WU_BOX wbBottom = wbBox;
+					for ( int32_t C = wbBox.i32Lo[I] + 1; C < wbBox.i32Hi[I]; ++C ) {
+						wbBottom.i32Hi[I] = C;
+						SL2_WU_MOMENT wmBottom = WuVolume( vMoments.data(), sStrides, wbBottom );
+						double dTopW = wmWhole.dW - wmBottom.dW;
+						if ( wmBottom.dW <= 0.0 || dTopW <= 0.0 ) { continue; }
+						double dScore = 0.0;
+						for ( size_t J = 0; J < 4; ++J ) {
+							double dTop = wmWhole.dC[J] - wmBottom.dC[J];
+							dScore += wmBottom.dC[J] * wmBottom.dC[J] / wmBottom.dW + dTop * dTop / dTopW;
+						}
+						if ( dScore > dBest ) {
+							dBest = dScore;
+							sAxis = I;
+							i32Cut = C;
+						}
+					}
+				}
+				if ( i32Cut < 0 ) {
+					// All of the box's colors are in 1 bin.
+					vVariance[sNext] = 0.0;
+					continue;
+				}
+
+				SL2_WU_BOX wbTop = wbBox;
+				vBoxes[sNext].i32Hi[sAxis] = i32Cut;
+				wbTop.i32Lo[sAxis] = i32Cut;
+				vBoxes.push_back( wbTop );
+				vVariance[sNext] = WuVariance( vMoments.data(), sStrides, vBoxes[sNext] );
+				vVariance.push_back( WuVariance( vMoments.data(), sStrides, wbTop ) );
+			}
+
+			_pPalette.reserve( vBoxes.size() );
+			for ( size_t B = 0; B < vBoxes.size(); ++B ) {
+				SL2_WU_MOMENT wmBox = WuVolume( vMoments.data(), sStrides, vBoxes[B] );
+				if ( wmBox.dW > 0.0 ) {
+					_pPalette.push_back( CColor( wmBox.dC[0] / wmBox.dW, wmBox.dC[1] / wmBox.dW, wmBox.dC[2] / wmBox.dW, wmBox.dC[3] / wmBox.dW ) );
+				}
+			}
+			return true;
+		}
+		catch ( ... ) { return false; }
+	}
+
+	/**
+	 * Median-cut color quantization.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+	 * \param _pPalette The palette to generate.  It can end up with fewer than _sK colors.
+	 * \param _sK The maximum number of colors to generate.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::MedianCutColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK ) {
+		try {
+			_pPalette.clear();
+			if ( !_sColorsSize || !_sK ) { return true; }
 
-				if ( HasConverged( vOldCentroids, vCentroids, 1e-5 ) ) { break; }
-				vOldCentroids = vCentroids;
+			std::vector<size_t> vIndices( _sColorsSize );
+			for ( size_t J = 0; J < _sColorsSize; ++J ) {
+				vIndices[J] = J;
 			}
+			auto Weight = [&]( size_t _sIdx ) { return _psWeights ? static_cast<double>(_psWeights[_sIdx]) : 1.0; };
+			auto Measure = [&]( SL2_MEDIAN_CUT_BOX &_mcbBox ) {
+				double dMin[4], dMax[4];
+				for ( size_t I = 0; I < 4; ++I ) {
+					dMin[I] = std::numeric_limits<double>::infinity();
+					dMax[I] = -std::numeric_limits<double>::infinity();
+				}
+				_mcbBox.dWeight = 0.0;
+				for ( size_t J = _mcbBox.sStart; J < _mcbBox.sEnd; ++J ) {
+					const CColor & cThis = _pcColors[vIndices[J]];
+					for ( size_t I = 0; I < 4; ++I ) {
+						dMin[I] = std::min( dMin[I], cThis.m_dElements[I] );
+						dMax[I] = std::max( dMax[I], cThis.m_dElements[I] );
+					}
+					_mcbBox.dWeight += Weight( vIndices[J] );
+				}
+				_mcbBox.sAxis = 0;
+				_mcbBox.dRange = 0.0;
+				for ( size_t I = 0; I < 4; ++I ) {
+					if ( dMax[I] - dMin[I] > _mcbBox.dRange ) {
+						_mcbBox.dRange = dMax[I] - dMin[I];
+						_mcbBox.sAxis = I;
+					}
+				}
+			};
+
+			std::vector<SL2_MEDIAN_CUT_BOX> vBoxes;
+			vBoxes.reserve( _sK );
+			vBoxes.push_back( { 0, _sColorsSize, 0, 0.0, 0.0 } );
+			Measure( vBoxes[0] );
+
+			while ( vBoxes.size() < _sK ) {
+				// Splitting by range alone spends entries on sparse outliers, so weight it by how much the box is used.
+				size_t sNext = 0;
+				double dPriority = 0.0;
+				for ( size_t B = 0; B < vBoxes.size(); ++B ) {
+					double dThis = vBoxes[B].dRange * vBoxes[B].dRange * vBoxes[B].dWeight;
+					if ( dThis > dPriority ) {
+						dPriority = dThis;
+						sNext = B;
+					}
+				}
+				if ( dPriority <= 0.0 ) { break; }
+
+				const SL2_MEDIAN_CUT_BOX mcbBox = vBoxes[sNext];
+				size_t sAxis = mcbBox.sAxis;
+				std::sort( vIndices.begin() + mcbBox.sStart, vIndices.begin() + mcbBox.sEnd, [&]( size_t _sL, size_t _sR ) {
+					return _pcColors[_sL].m_dElements[sAxis] < _pcColors[_sR].m_dElements[sAxis];
+				} );
+				// Split at the weighted median, leaving at least 1 color on each side.
+				double dHalf = mcbBox.dWeight * 0.5, dRunning = 0.0;
+				size_t sSplit = mcbBox.sStart + 1;
+				for ( size_t J = mcbBox.sStart; J < mcbBox.sEnd - 1; ++J ) {
+					dRunning += Weight( vIndices[J] );
+					sSplit = J + 1;
+					if ( dRunning >= dHalf ) { break; }
+				}
 
-			_pPalette = vCentroids;
+				SL2_MEDIAN_CUT_BOX mcbTop = { sSplit, mcbBox.sEnd, 0, 0.0, 0.0 };
+				vBoxes[sNext].sEnd = sSplit;
+				Measure( vBoxes[sNext] );
+				Measure( mcbTop );
+				vBoxes.push_back( mcbTop );
+			}
+
+			_pPalette.reserve( vBoxes.size() );
+			for ( size_t B = 0; B < vBoxes.size(); ++B ) {
+				CColor cSum( 0.0, 0.0, 0.0, 0.0 );
+				for ( size_t J = vBoxes[B].sStart; J < vBoxes[B].sEnd; ++J ) {
+					cSum += _pcColors[vIndices[J]] * Weight( vIndices[J] );
+				}
+				_pPalette.push_back( cSum / vBoxes[B].dWeight );
+			}
 			return true;
 		}
 		catch ( ... ) { return false; }
 	}
 
+	/**
+	 * Octree color quantization.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+	 * \param _pPalette The palette to generate.  It can end up with fewer than _sK colors.
+	 * \param _sK The maximum number of colors to generate.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::OctreeColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK ) {
+		try {
+			_pPalette.clear();
+			if ( !_sColorsSize || !_sK ) { return true; }
+
+			// 5 levels resolve 5 bits per channel, which bounds the tree at 32^4 leaves.  Leaves hold the mean of their actual colors.
+			constexpr uint32_t ui32Depth = 5;
+			std::vector<SL2_OCTREE_NODE> vNodes;
+			// The internal nodes at each level.
+			std::vector<std::vector<int32_t>> vLevels( ui32Depth );
+			auto NewNode = [&]( uint32_t _ui32Level ) {
+				SL2_OCTREE_NODE onNode;
+				onNode.cSum = CColor( 0.0, 0.0, 0.0, 0.0 );
+				onNode.sCount = 0;
+				for ( size_t I = 0; I < 16; ++I ) {
+					onNode.i32Children[I] = -1;
+				}
+				onNode.bLeaf = _ui32Level == ui32Depth;
+				vNodes.push_back( onNode );
+				int32_t i32Idx = int32_t( vNodes.size() - 1 );
+				if ( !onNode.bLeaf ) { vLevels[_ui32Level].push_back( i32Idx ); }
+				return i32Idx;
+			};
+
+			NewNode( 0 );
+			size_t sLeaves = 0;
+			for ( size_t J = 0; J < _sColorsSize; ++J ) {
+				const CColor & cThis = _pcColors[J];
+				uint32_t ui32Q[4];
+				for ( size_t I = 0; I < 4; ++I ) {
+					ui32Q[I] = uint32_t( std::clamp( cThis.m_dElements[I], 0.0, 1.0 ) * 255.0 + 0.5 );
+				}
+				int32_t i32Node = 0;
+				for ( uint32_t L = 0; L < ui32Depth; ++L ) {
+					uint32_t ui32Child = 0;
+					for ( uint32_t I = 0; I < 4; ++I ) {
+						ui32Child |= ((ui32Q[I] >> (7 - L)) & 1) << I;
+					}
+					int32_t i32Next = vNodes[i32Node].i32Children[ui32Child];
+					if ( i32Next < 0 ) {
+						i32Next = NewNode( L + 1 );
+						vNodes[i32Node].i32Children[ui32Child] = i32Next;
+						if ( L + 1 == ui32Depth ) { ++sLeaves; }
+					}
+					i32Node = i32Next;
+				}
+				size_t sWeight = _psWeights ? _psWeights[J] : 1;
+				vNodes[i32Node].cSum += cThis * static_cast<double>(sWeight);
+				vNodes[i32Node].sCount += sWeight;
+			}
+
+			// Fold the deepest level first.  By the time a level is reached, all of its nodes' children are leaves.
+			for ( uint32_t L = ui32Depth; L-- && sLeaves > _sK; ) {
+				std::vector<int32_t> & vLevel = vLevels[L];
+				for ( size_t N = 0; N < vLevel.size(); ++N ) {
+					SL2_OCTREE_NODE & onNode = vNodes[vLevel[N]];
+					for ( size_t I = 0; I < 16; ++I ) {
+						if ( onNode.i32Children[I] >= 0 ) {
+							onNode.cSum += vNodes[onNode.i32Children[I]].cSum;
+							onNode.sCount += vNodes[onNode.i32Children[I]].sCount;
+						}
+					}
+				}
+				// Least-used nodes go first.
+				std::stable_sort( vLevel.begin(), vLevel.end(), [&]( int32_t _i32L, int32_t _i32R ) {
+					return vNodes[_i32L].sCount < vNodes[_i32R].sCount;
+				} );
+				for ( size_t N = 0; N < vLevel.size() && sLeaves > _sK; ++N ) {
+					SL2_OCTREE_NODE & onNode = vNodes[vLevel[N]];
+					for ( size_t I = 0; I < 16; ++I ) {
+						if ( onNode.i32Children[I] >= 0 ) {
+							--sLeaves;
+							onNode.i32Children[I] = -1;
+						}
+					}
+					onNode.bLeaf = true;
+					++sLeaves;
+				}
+			}
+
+			_pPalette.reserve( sLeaves );
+			std::vector<int32_t> vStack;
+			vStack.push_back( 0 );
+			while ( vStack.size() ) {
+				const SL2_OCTREE_NODE & onNode = vNodes[vStack.back()];
+				vStack.pop_back();
+				if ( onNode.bLeaf ) {
+					if ( onNode.sCount ) { _pPalette.push_back( onNode.cSum / static_cast<double>(onNode.sCount) ); }
+					continue;
+				}
+				for ( size_t I = 16; I--; ) {
+					if ( onNode.i32Children[I] >= 0 ) { vStack.push_back( onNode.i32Children[I] ); }
+				}
+			}
+			return true;
+		}
+		catch ( ... ) { return false; }
+	}
+
+	/**
+	 * Runs a quantizer over the weighted histogram of the colors and optionally refines the result with K-Means.  The palette
+	 *	has fewer than _ui32Size entries if there are fewer unique colors.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _ui32Size Size of the palette to generate.
+	 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+	 * \param _pfQuantizer The quantizer.
+	 * \return Returns true if all internal allocations succeed.
+	 **/
+	bool CPalette::GenPalette_Quantizer( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations, PfQuantizer _pfQuantizer ) {
+		CPal pUnique;
+		std::vector<size_t> vCounts;
+		const CColor * pcColors = _pcColors;
+		size_t sTotal = _sColorsSize;
+		const size_t * psWeights = nullptr;
+		if ( BuildHistogram( _pcColors, _sColorsSize, m_pkifFormat, pUnique, vCounts ) ) {
+			pcColors = pUnique.data();
+			sTotal = pUnique.size();
+			psWeights = vCounts.data();
+		}
+
+		if ( !_pfQuantizer( pcColors, sTotal, psWeights, m_pPalette, _ui32Size ) ) { return false; }
+		if ( _sRefineIterations && m_pPalette.size() ) {
+			if ( !kMeansColorQuantization( pcColors, sTotal, psWeights, m_pPalette, m_pPalette.size(), _sRefineIterations, true ) ) { return false; }
+		}
+		// Fewer colors than requested come back when there are few unique colors; the palette is left at that size.
+		return true;
+	}
+
+	/**
+	 * Gets the moments of a box in Wu's cumulative histogram.
+	 * 
+	 * \param _pwmMoments The cumulative moments.
+	 * \param _psStrides The stride of each channel.
+	 * \param _wbBox The box.
+	 * \return Returns the moments of the box.
+	 **/
+	CPalette::SL2_WU_MOMENT CPalette::WuVolume( const SL2_WU_MOMENT * _pwmMoments, const size_t * _psStrides, const SL2_WU_BOX &_wbBox ) {
+		// Inclusion-exclusion over the box's 16 corners.
+		SL2_WU_MOMENT wmRet = {};
+		for ( uint32_t M = 0; M < 16; ++M ) {
+			size_t sIdx = 0;
+			bool bNeg = false;
+			for ( uint32_t I = 0; I < 4; ++I ) {
+				if ( M & (1 << I) ) {
+					sIdx += size_t( _wbBox.i32Hi[I] ) * _psStrides[I];
+				}
+				else {
+					sIdx += size_t( _wbBox.i32Lo[I] ) * _psStrides[I];
+					bNeg = !bNeg;
+				}
+			}
+			const SL2_WU_MOMENT & wmThis = _pwmMoments[sIdx];
+			double dSign = bNeg ? -1.0 : 1.0;
+			wmRet.dW += dSign * wmThis.dW;
+			for ( size_t C = 0; C < 4; ++C ) {
+				wmRet.dC[C] += dSign * wmThis.dC[C];
+			}
+			wmRet.dM2 += dSign * wmThis.dM2;
+		}
+		return wmRet;
+	}
+
+	/**
+	 * Gets the weighted variance of a box in Wu's cumulative histogram.
+	 * 
+	 * \param _pwmMoments The cumulative moments.
+	 * \param _psStrides The stride of each channel.
+	 * \param _wbBox The box.
+	 * \return Returns the weighted sum of squared distances from the box's mean.
+	 **/
+	double CPalette::WuVariance( const SL2_WU_MOMENT * _pwmMoments, const size_t * _psStrides, const SL2_WU_BOX &_wbBox ) {
+		SL2_WU_MOMENT wmBox = WuVolume( _pwmMoments, _psStrides, _wbBox );
+		if ( wmBox.dW <= 0.0 ) { return 0.0; }
+		double dSq = 0.0;
+		for ( size_t C = 0; C < 4; ++C ) {
+			dSq += wmBox.dC[C] * wmBox.dC[C];
+		}
+		return std::max( wmBox.dM2 - dSq / wmBox.dW, 0.0 );
+	}
+
+	/**
+	 * Gathers the unique colors in an array along with the number of times each appears.  Unique colors are listed in the order
+	 *	in which they first appear, so k-means over the histogram visits them in the same order as it would visit the texels.
+	 *	When a palette format is given, its bit depths are used to pack each color into its hash key.
+	 * 
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _pkifFormat The palette format to which the colors have been quantized, or nullptr.
+	 * \param _vUnique Holds the returned unique colors.
+	 * \param _vCounts Holds the returned number of times each unique color appears.
+	 * \return Returns true if all allocations succeed and colors repeat often enough for the histogram to pay off.
+	 **/
+	bool CPalette::BuildHistogram( const CColor * _pcColors, size_t _sColorsSize, const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, CPal &_vUnique, std::vector<size_t> &_vCounts ) {
+		// Past this many unique colors, building the histogram costs more than it saves.
+		size_t sMaxUnique = std::min<size_t>( _sColorsSize / 2, ~uint32_t( 0 ) - 1 );
+		if ( !sMaxUnique ) { return false; }
+
+		uint32_t ui32Bits[4] = { 0, 0, 0, 0 };
+		if ( _pkifFormat && (uint32_t( _pkifFormat->ui8RBits ) + _pkifFormat->ui8GBits + _pkifFormat->ui8BBits + _pkifFormat->ui8ABits) <= 64 ) {
+			ui32Bits[0] = _pkifFormat->ui8RBits;
+			ui32Bits[1] = _pkifFormat->ui8GBits;
+			ui32Bits[2] = _pkifFormat->ui8BBits;
+			ui32Bits[3] = _pkifFormat->ui8ABits;
+		}
+		bool bPacked = (ui32Bits[0] | ui32Bits[1] | ui32Bits[2] | ui32Bits[3]) != 0;
+		auto Key = [&]( const CColor &_cColor ) {
+			uint64_t ui64Key = 0;
+			if ( bPacked ) {
+				// Colors are quantized to the palette format, so packing at its bit depth is nearly a perfect hash.
+				for ( size_t I = 0; I < 4; ++I ) {
+					if ( ui32Bits[I] ) {
+						double dMax = double( (1ULL << ui32Bits[I]) - 1 );
+						ui64Key = (ui64Key << ui32Bits[I]) | uint64_t( std::clamp( std::round( _cColor.m_dElements[I] * dMax ), 0.0, dMax ) );
+					}
+				}
+			}
+			else {
+				for ( size_t I = 0; I < 4; ++I ) {
+					uint64_t ui64Bits;
+					std::memcpy( &ui64Bits, &_cColor.m_dElements[I], sizeof( ui64Bits ) );
+					ui64Key = (ui64Key ^ ui64Bits) * 0x9E3779B97F4A7C15ULL;
+				}
+			}
+			return ui64Key;
+		};
+
+		// Open addressing with linear probing.  Slots store the key and the index of the unique color.
+		struct SL2_SLOT {
+			uint64_t										ui64Key;
+			uint32_t										ui32Index;
+		};
+		constexpr uint32_t ui32Empty = ~uint32_t( 0 );
+		std::vector<SL2_SLOT> vTable;
+		size_t sMask = 0;
+		auto Slot = [&]( uint64_t _ui64Key ) { return size_t( (_ui64Key * 0x9E3779B97F4A7C15ULL) >> 24 ) & sMask; };
+		auto Rehash = [&]( size_t _sSize ) {
+			vTable.assign( _sSize, { 0, ui32Empty } );
+			sMask = _sSize - 1;
+			for ( size_t I = 0; I < _vUnique.size(); ++I ) {
+				uint64_t ui64Key = Key( _vUnique[I] );
+				size_t sSlot = Slot( ui64Key );
+				while ( vTable[sSlot].ui32Index != ui32Empty ) { sSlot = (sSlot + 1) & sMask; }
+				vTable[sSlot] = { ui64Key, uint32_t( I ) };
+			}
+		};
+
+		try {
+			_vUnique.clear();
+			_vCounts.clear();
+			Rehash( 4096 );
+			for ( size_t C = 0; C < _sColorsSize; ++C ) {
+				uint64_t ui64Key = Key( _pcColors[C] );
+				size_t sSlot = Slot( ui64Key );
+				while ( true ) {
+					SL2_SLOT & sThis = vTable[sSlot];
+					if ( sThis.ui32Index == ui32Empty ) {
+						if ( _vUnique.size() == sMaxUnique ) { return false; }
+						sThis = { ui64Key, uint32_t( _vUnique.size() ) };
+						_vUnique.push_back( _pcColors[C] );
+						_vCounts.push_back( 1 );
+						if ( _vUnique.size() * 2 > vTable.size() ) { Rehash( vTable.size() * 2 ); }
+						break;
+					}
+					// The key only narrows the search; entries must match exactly.
+					if ( sThis.ui64Key == ui64Key && std::memcmp( _vUnique[sThis.ui32Index].m_dElements, _pcColors[C].m_dElements, sizeof( _pcColors[C].m_dElements ) ) == 0 ) {
+						++_vCounts[sThis.ui32Index];
+						break;
+					}
+					sSlot = (sSlot + 1) & sMask;
+				}
+			}
+		}
+		catch ( ... ) { return false; }
+		return true;
+	}
+
+	/**
+	 * An error-diffusion worker thread.  Takes rows in order until none remain.
+	 * 
+	 * \param _pdData The shared state.
+	 **/
+	void CPalette::DiffuseErrorThread( SL2_DIFFUSION * _pdData ) {
+		SL2_DIFFUSION & dData = (*_pdData);
+		const uint32_t ui32Width = dData.ui32Width;
+		// Progress is published every this many texels.
+		constexpr uint32_t ui32Publish = 16;
+		while ( true ) {
+			uint32_t H = dData.aNextRow.fetch_add( 1, std::memory_order_relaxed );
+			if ( H >= dData.ui32Height ) { break; }
+
+			// The number of texels known to be finished in each earlier row.
+			uint32_t ui32Known[SL2_MAX_DIFFUSION_ROWS+1] = {};
+			uint32_t ui32Rows = std::min( dData.ui32Rows, H );
+			for ( uint32_t W = 0; W < ui32Width; ++W ) {
+				for ( uint32_t R = 1; R <= ui32Rows; ++R ) {
+					uint32_t ui32Need = uint32_t( std::min<uint64_t>( uint64_t( W ) + dData.ui32Reach[R] + 1, ui32Width ) );
+					while ( ui32Known[R] < ui32Need ) {
+						ui32Known[R] = dData.vProgress[H-R].load( std::memory_order_acquire );
+						if ( ui32Known[R] < ui32Need ) { std::this_thread::yield(); }
+					}
+				}
+
+				size_t sIdx = size_t( H ) * ui32Width + W;
+				CColor cValue = reinterpret_cast<const CColor &>(dData.prgbaColors[sIdx]);
+				for ( size_t T = 0; T < dData.vTaps.size(); ++T ) {
+					const SL2_DIFFUSION_TAP & dtTap = dData.vTaps[T];
+					int64_t i64X = int64_t( W ) - dtTap.i32X;
+					if ( uint32_t( dtTap.i32Y ) > H || i64X < 0 || i64X >= int64_t( ui32Width ) ) { continue; }
+					cValue += dData.vErrors[size_t( H - uint32_t( dtTap.i32Y ) )*ui32Width+size_t( i64X )] * dtTap.dFactor;
+				}
+
+				const CColor & cPal = (*dData.ppPalette)[FindNearest( (*dData.pnNearest), cValue )];
+				reinterpret_cast<CColor &>(dData.prgbaColors[sIdx]) = cPal;
+				dData.vErrors[sIdx] = (cValue - cPal) * dData.cWeights;
+
+				if ( (W + 1) % ui32Publish == 0 ) {
+					dData.vProgress[H].store( W + 1, std::memory_order_release );
+				}
+			}
+			dData.vProgress[H].store( ui32Width, std::memory_order_release );
+		}
+	}
+
+	/**
+	 * An ordered-dithering worker thread.
+	 * 
+	 * \param _podData The rows to dither.
+	 **/
+	void CPalette::OrderedDitherThread( const SL2_ORDERED_DITHER * _podData ) {
+		const SL2_ORDERED_DITHER & odData = (*_podData);
+		const uint32_t ui32Mask = odData.ui32MapSize - 1;
+		// The map is indexed by X first, so each row walks a column of it.
+		for ( uint32_t H = odData.ui32StartRow; H < odData.ui32EndRow; ++H ) {
+			const double * pdColumn = odData.pdMap + (H & ui32Mask);
+			CColor * pcRow = reinterpret_cast<CColor *>(odData.prgbaColors + size_t( H ) * odData.ui32Width);
+			for ( uint32_t W = 0; W < odData.ui32Width; ++W ) {
+				double dThresh = (pdColumn[(W&ui32Mask)*odData.ui32MapSize] - 0.5) * (1.0 / 32.0);
+				CColor cValue = (pcRow[W] + (odData.cScale * dThresh)).Clamp( 0.0, 1.0 );
+				pcRow[W] = (*odData.ppPalette)[FindNearest( (*odData.pnNearest), cValue )];
+			}
+		}
+	}
+
 }	// namespace sl2
@@ -10,10 +10,17 @@
 
 #include "../Utilities/SL2Stream.h"
 #include "../Utilities/SL2Vector4.h"
+#include "SL2ColorDistance.h"
 #include "SL2Formats.h"
 
+#include <atomic>
+#include <cstring>
+#include <random>
 #include <vector>
 
+/** The most rows down an error-diffusion tap can reach. */
+#define SL2_MAX_DIFFUSION_ROWS								4
+
 
 namespace sl2 {
 
@@ -66,6 +73,24 @@ namespace sl2 {
 			uint8_t											ui8Vals[4];								/**< Array access into the RGBA values. 0 = red, 3 = alpha. */
 		};
 
+		/** An error-diffusion tap.  Error from a texel is spread to the texel i32X across and i32Y down from it. */
+		struct SL2_DIFFUSION_TAP {
+			int32_t											i32X;									/**< The horizontal offset to the receiving texel. */
+			int32_t											i32Y;									/**< The vertical offset to the receiving texel. */
+			double											dFactor;								/**< The fraction of the error given to the receiving texel. */
+		};
+
+		/** A nearest-color search structure.  Entries are moved into the space of the color-distance metric and sorted along the
+		 *	channel with the widest range so that, for Euclidean metrics, a search can stop once the distance along that channel
+		 *	alone exceeds the best distance found. */
+		struct SL2_NEAREST {
+			std::vector<CColor>								vSorted;								/**< The palette entries in the metric's space, sorted along sAxis. */
+			std::vector<double>								vKeys;									/**< Each sorted entry's value along sAxis. */
+			std::vector<uint32_t>							vIndices;								/**< Each sorted entry's index in the palette. */
+			size_t											sAxis;									/**< The channel along which entries are sorted. */
+			SL2_COLOR_DISTANCE								cdDistance;								/**< The color-distance metric. */
+		};
+
 
 		// == Functions.
 		/**
@@ -87,6 +112,16 @@ namespace sl2 {
 		 */
 		bool												LoadPpl( const CStream &_sFile, const std::u16string &_sFileName );
 
+		/**
+		 * Saves a palette as a PAL file.  Colors are stored with 8 bits per channel and the ID follows them.
+		 *
+		 * \param _pPalette The palette to save.
+		 * \param _ui32Id The ID to save with the palette.
+		 * \param _sFile The stream to which to write the file.
+		 * \return Returns true if the palette fits in a PAL file and all allocations succeed.
+		 */
+		static bool											SavePal( const CPal &_pPalette, uint32_t _ui32Id, CStream &_sFile );
+
 		/**
 		 * Gets the ID.
 		 * 
@@ -144,7 +179,8 @@ namespace sl2 {
 		inline CColor *										Data();
 
 		/**
-		 * Generates a palette of a given size using K-Means.
+		 * Generates a palette of a given size using K-Means.  Identical colors are first gathered into a weighted histogram so that
+		 *	the clustering runs over the unique colors rather than over every texel.
 		 * 
 		 * \param _pcColors Input array of colors.
 		 * \param _sColorsSize Number of colors to which _pcColors points.
@@ -154,6 +190,107 @@ namespace sl2 {
 		 **/
 		bool												GenPalette_kMeans( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sIterations = 10 );
 
+		/**
+		 * Generates a palette of a given size using Wu's variance-minimizing quantizer.  Colors are binned into a 5-bit-per-channel
+		 *	histogram (3 bits for alpha when alpha varies) whose boxes are split along the cut that removes the most variance.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _ui32Size Size of the palette to generate.
+		 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		bool												GenPalette_Wu( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations = 0 );
+
+		/**
+		 * Generates a palette of a given size using median cut.  The box with the largest squared channel range times weight is
+		 *	split at the weighted median of that channel until there are enough boxes.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _ui32Size Size of the palette to generate.
+		 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		bool												GenPalette_MedianCut( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations = 0 );
+
+		/**
+		 * Generates a palette of a given size using an octree.  Each level splits on 1 bit of red, green, blue, and alpha, and the
+		 *	least-used nodes at the deepest level are merged until there are few enough leaves.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _ui32Size Size of the palette to generate.
+		 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		bool												GenPalette_Octree( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations = 0 );
+
+		/**
+		 * Generates a palette of a given size using the generator selected by CFormat::m_pmPaletteMethod.  Generators other than
+		 *	K-Means are followed by CFormat::m_sPaletteRefineIterations K-Means iterations.  While CPaletteCache is enabled, the
+		 *	palette is loaded from the cache when possible and added to it otherwise.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _ui32Size Size of the palette to generate.
+		 * \param _sIterations Number of K-Means iterations when K-Means is selected.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		bool												GenPalette( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sIterations = 10 );
+
+		/**
+		 * Creates a nearest-color search structure for a palette.
+		 * 
+		 * \param _pPalette The palette.
+		 * \param _nNearest Holds the returned search structure.
+		 * \param _cdDistance The color-distance metric by which to match colors.
+		 * \return Returns true if all allocations succeed.
+		 **/
+		static bool											BuildNearest( const CPal &_pPalette, SL2_NEAREST &_nNearest, SL2_COLOR_DISTANCE _cdDistance );
+
+		/**
+		 * Finds the palette entry nearest to a color by the metric given to BuildNearest().  Ties go to the lowest palette index.
+		 * 
+		 * \param _nNearest The search structure created by BuildNearest().  Must not be empty.
+		 * \param _cColor The color to match.
+		 * \return Returns the index of the nearest palette entry.
+		 **/
+		static size_t										FindNearest( const SL2_NEAREST &_nNearest, const CColor &_cColor );
+
+		/**
+		 * Error-diffusion dithering.  Rows are handed out in order to worker threads, each of which waits only for the texels its
+		 *	taps read from in the rows above, so several rows are in flight at once.  Each texel gathers its errors in the same order
+		 *	in which a serial raster pass would have scattered them, so the result matches a serial pass exactly.
+		 * 
+		 * \param _prgbaColors The in/out color buffer.
+		 * \param _ui32Width The width of the image.
+		 * \param _ui32Height The height of the image.
+		 * \param _pPalette The palette.
+		 * \param _pdtTaps The kernel's taps.  Each must point forward in raster order and at most SL2_MAX_DIFFUSION_ROWS rows down.
+		 * \param _sTaps The number of taps to which _pdtTaps points.
+		 * \param _cWeights The per-channel scale applied to each texel's error.
+		 * \return Returns true if all allocations succeed and the inputs are valid.
+		 **/
+		static bool											DiffuseError( CFormat::SL2_RGBA64F * _prgbaColors, uint32_t _ui32Width, uint32_t _ui32Height, const CPal &_pPalette,
+			const SL2_DIFFUSION_TAP * _pdtTaps, size_t _sTaps, const CColor &_cWeights );
+
+		/**
+		 * Ordered dithering.  Each texel is offset by its threshold-map entry and snapped to the nearest palette entry.  Texels
+		 *	do not depend on each other, so rows are split evenly across threads.
+		 * 
+		 * \param _prgbaColors The in/out color buffer.
+		 * \param _ui32Width The width of the image.
+		 * \param _ui32Height The height of the image.
+		 * \param _pPalette The palette.
+		 * \param _pdMap The threshold map, indexed [X*_ui32MapSize+Y] with values in [0, 1).
+		 * \param _ui32MapSize The side length of the threshold map.  Must be a power of 2.
+		 * \param _cScale The per-channel scale applied to each threshold.
+		 * \return Returns true if all allocations succeed and the inputs are valid.
+		 **/
+		static bool											OrderedDither( CFormat::SL2_RGBA64F * _prgbaColors, uint32_t _ui32Width, uint32_t _ui32Height, const CPal &_pPalette,
+			const double * _pdMap, uint32_t _ui32MapSize, const CColor &_cScale );
+
 		/**
 		 * Gets the loaded file path.
 		 * 
@@ -162,44 +299,173 @@ namespace sl2 {
 		const std::u16string &								Path() const { return m_sFilePath; }
 
 		/**
-		 * RGBA32F -> Indexed conversion (worker thread).
+		 * RGBA32F -> Indexed conversion (worker thread).  Rows are converted to LAB and matched against the palette a row at a time.
 		 * 
 		 * \param _ptDst The destination image.
 		 * \param _ui32Start The row at which to begin.
 		 * \param _ui32Stop The row at which to stop.
 		 * \param _ui32Width The width of the image.
-		 * \param _cLabBuffer The input LAB color buffer.
-		 * \param _pLabPalette The palette in LAB.
-		 * \param _pRgbPalette The palette in RGB.
-		 * \param _sCore The core to which to assign the thread.
+		 * \param _pcrgbaSrc The input RGBA64F colors.
+		 * \param _pclLabPalette The palette in LAB.
+		 * \param _ui32PalSize The number of entries in _pclLabPalette to search.
+		 * \param _sCore The core to which to assign the thread, or ~size_t( 0 ) to leave the affinity unchanged.
 		 * \param _bRet Holds the return value.
 		 **/
-		template<typename _tType = uint8_t, unsigned _uBits = 8>
-		static void											IndexedFromRgba64F_Thread( _tType * _ptDst, uint32_t _ui32Start, uint32_t _ui32Stop, uint32_t _ui32Width, const std::vector<ispc::ColorLABA> &_cLabBuffer, const std::vector<ispc::ColorLABA> &_pLabPalette, const CPalette::CPal &_pRgbPalette, size_t _sCore, bool &_bRet ) {
-			::SetThreadAffinity( _sCore );
-			constexpr uint32_t ui32Mask = (1 << _uBits) - 1;
+		template<typename _tType = uint8_t>
+		static void											IndexedFromRgba64F_Thread( _tType * _ptDst, uint32_t _ui32Start, uint32_t _ui32Stop, uint32_t _ui32Width, const ispc::ColorRGBA * _pcrgbaSrc, const ispc::ColorLABA * _pclLabPalette, uint32_t _ui32PalSize, size_t _sCore, bool &_bRet ) {
+			if ( _sCore != ~size_t( 0 ) ) {
+				::SetThreadAffinity( _sCore );
+			}
+			std::vector<uint32_t> vRow;
+			try {
+				vRow.resize( _ui32Width );
+			}
+			catch ( ... ) { _bRet = false; return; }
 			for ( uint32_t H = _ui32Start; H < _ui32Stop; ++H ) {
+				size_t sIdx = size_t( H ) * _ui32Width;
+				if ( !ispc::ispc_nearest_CIEDE2000( _pcrgbaSrc + sIdx, vRow.data(), _ui32Width, _pclLabPalette, _ui32PalSize ) ) { _bRet = false; return; }
 				for ( uint32_t W = 0; W < _ui32Width; ++W ) {
-					size_t sIdx = size_t( H * _ui32Width + W );
-					size_t sWinner = _pRgbPalette.size();
-					double dDist = std::numeric_limits<double>::infinity();
-					for ( auto I = _pRgbPalette.size(); I--; ) {
-						double dThisDist = ispc::ispc_deltaE_CIEDE2000( _cLabBuffer[sIdx].l, _cLabBuffer[sIdx].a, _cLabBuffer[sIdx].b, _cLabBuffer[sIdx].alpha,
-							_pLabPalette[I&ui32Mask].l, _pLabPalette[I&ui32Mask].a, _pLabPalette[I&ui32Mask].b, _pLabPalette[I&ui32Mask].alpha );
-						if ( dThisDist <= dDist ) {
-							dDist = dThisDist;
-							sWinner = I & ui32Mask;
-						}
+					_ptDst[sIdx+W] = _tType( vRow[W] );
+				}
+			}
+		}
+
+		/**
+		 * RGBA32F -> Indexed conversion by the metric of a nearest-color search structure (worker thread).
+		 * 
+		 * \param _ptDst The destination image.
+		 * \param _ui32Start The row at which to begin.
+		 * \param _ui32Stop The row at which to stop.
+		 * \param _ui32Width The width of the image.
+		 * \param _prgbaSrc The input RGBA64F colors.
+		 * \param _pnNearest The search structure created by BuildNearest().
+		 **/
+		template<typename _tType = uint8_t>
+		static void											IndexedFromRgba64F_NearestThread( _tType * _ptDst, uint32_t _ui32Start, uint32_t _ui32Stop, uint32_t _ui32Width, const CFormat::SL2_RGBA64F * _prgbaSrc, const SL2_NEAREST * _pnNearest ) {
+			for ( uint32_t H = _ui32Start; H < _ui32Stop; ++H ) {
+				size_t sIdx = size_t( H ) * _ui32Width;
+				for ( uint32_t W = 0; W < _ui32Width; ++W ) {
+					// Runs of identical texels are common and the non-Euclidean metrics scan the whole palette.
+					if ( W && std::memcmp( _prgbaSrc[sIdx+W].dRgba, _prgbaSrc[sIdx+W-1].dRgba, sizeof( _prgbaSrc[sIdx+W].dRgba ) ) == 0 ) {
+						_ptDst[sIdx+W] = _ptDst[sIdx+W-1];
+						continue;
 					}
-					if ( sWinner == _pRgbPalette.size() ) { _bRet = false; return; }
-					_ptDst[sIdx] = _tType( sWinner );
+					_ptDst[sIdx+W] = _tType( FindNearest( (*_pnNearest), CColor( _prgbaSrc[sIdx+W].dRgba ) ) );
 				}
 			}
-			
 		}
 
 
 	protected :
+		// == Types.
+		/** Data for a k-means|| worker thread. */
+		struct SL2_KMEANS_PARALLEL {
+			const CColor *									pcColors;								/**< The input colors. */
+			const size_t *									psWeights;								/**< The number of times each color appears, or nullptr. */
+			size_t											sStart;									/**< The first color handled by the thread. */
+			size_t											sEnd;									/**< One past the last color handled by the thread. */
+			const std::vector<CColor> *						pvCandidates;							/**< The candidate centers chosen so far. */
+			size_t											sNewCandidates;							/**< The first candidate not yet accounted for in pdMinDist. */
+			double *										pdMinDist;								/**< Each color's squared distance to its nearest candidate. */
+			uint32_t *										pui32Nearest;							/**< Each color's nearest candidate. */
+			double											dSampleScale;							/**< The oversampling factor divided by the total cost, or 0.0 to update distances instead of sampling. */
+			uint64_t										ui64Seed;								/**< The seed for this round of sampling. */
+			double											dCost;									/**< Output: the weighted sum of the range's squared distances. */
+			std::vector<size_t>								vSampled;								/**< Output: the colors sampled this round. */
+			bool											bFailed;								/**< Output: set if the colors sampled this round could not all be recorded. */
+		};
+
+		/** Lloyd-iteration state shared by the k-means worker threads.  Bounds follow Hamerly's algorithm. */
+		struct SL2_LLOYD {
+			const CColor *									pcColors;								/**< The input colors. */
+			const size_t *									psWeights;								/**< The number of times each color appears, or nullptr. */
+			size_t											sTotal;									/**< The number of input colors. */
+			size_t											sBlockSize;								/**< Colors per block.  Sums are kept per block so that they do not depend on the thread count. */
+			size_t											sBlocks;								/**< The number of blocks. */
+			std::vector<CColor>								vCentroids;								/**< The centroids. */
+			std::vector<double>								vHalfGap;								/**< Half the distance from each centroid to its nearest other centroid. */
+			std::vector<double>								vMoved;									/**< How far each centroid moved in the last update. */
+			double											dMaxMoved;								/**< The largest value in vMoved. */
+			double											dSecondMoved;							/**< The second-largest value in vMoved. */
+			size_t											sMaxMoved;								/**< The centroid that moved the farthest. */
+			std::vector<uint32_t>							vAssignment;							/**< The centroid assigned to each color. */
+			std::vector<double>								vUpper;									/**< An upper bound on each color's distance to its centroid. */
+			std::vector<double>								vLower;									/**< A lower bound on each color's distance to every other centroid. */
+			std::vector<CColor>								vSums;									/**< Per-block sums of the colors assigned to each centroid. */
+			std::vector<size_t>								vCounts;								/**< Per-block counts of the colors assigned to each centroid. */
+		};
+
+		/** A range of blocks for a k-means worker thread. */
+		struct SL2_LLOYD_THREAD {
+			SL2_LLOYD *										plLloyd;								/**< The shared state. */
+			size_t											sStartBlock;							/**< The first block handled by the thread. */
+			size_t											sEndBlock;								/**< One past the last block handled by the thread. */
+		};
+
+		/** The moments of one cell of Wu's histogram. */
+		struct SL2_WU_MOMENT {
+			double											dW;										/**< The total weight. */
+			double											dC[4];									/**< The weighted sum of each channel. */
+			double											dM2;									/**< The weighted sum of the squared lengths. */
+		};
+
+		/** A box in Wu's histogram.  Bins i32Lo[N]+1 through i32Hi[N] are inside the box. */
+		struct SL2_WU_BOX {
+			int32_t											i32Lo[4];								/**< The bin before the first bin inside the box. */
+			int32_t											i32Hi[4];								/**< The last bin inside the box. */
+		};
+
+		/** A median-cut box. */
+		struct SL2_MEDIAN_CUT_BOX {
+			size_t											sStart;									/**< The first index inside the box. */
+			size_t											sEnd;									/**< One past the last index inside the box. */
+			size_t											sAxis;									/**< The channel with the widest range. */
+			double											dRange;									/**< The range of that channel. */
+			double											dWeight;								/**< The total weight of the colors in the box. */
+		};
+
+		/** An octree node.  Each level splits on 1 bit of each of the 4 channels. */
+		struct SL2_OCTREE_NODE {
+			CColor											cSum;									/**< The weighted sum of the colors in the node. */
+			size_t											sCount;									/**< The total weight of the colors in the node. */
+			int32_t											i32Children[16];						/**< The child nodes, or -1. */
+			bool											bLeaf;									/**< True if the node is a leaf. */
+		};
+
+		/** Error-diffusion state shared by the dithering worker threads. */
+		struct SL2_DIFFUSION {
+			CFormat::SL2_RGBA64F *							prgbaColors;							/**< The in/out color buffer. */
+			uint32_t										ui32Width;								/**< The width of the image. */
+			uint32_t										ui32Height;								/**< The height of the image. */
+			const CPal *									ppPalette;								/**< The palette. */
+			const SL2_NEAREST *								pnNearest;								/**< The palette search structure. */
+			std::vector<SL2_DIFFUSION_TAP>					vTaps;									/**< The taps, sorted into the order in which a texel gathers them. */
+			uint32_t										ui32Reach[SL2_MAX_DIFFUSION_ROWS+1];	/**< How far right of a texel each earlier row is read. */
+			uint32_t										ui32Rows;								/**< The number of earlier rows read. */
+			CColor											cWeights;								/**< The per-channel error scale. */
+			std::vector<CColor>								vErrors;								/**< Each finished texel's scaled error. */
+			std::vector<std::atomic<uint32_t>>				vProgress;								/**< The number of finished texels in each row. */
+			std::atomic<uint32_t>							aNextRow;								/**< The next row to hand out. */
+		};
+
+		/** A range of rows for an ordered-dithering worker thread. */
+		struct SL2_ORDERED_DITHER {
+			CFormat::SL2_RGBA64F *							prgbaColors;							/**< The in/out color buffer. */
+			uint32_t										ui32Width;								/**< The width of the image. */
+			uint32_t										ui32StartRow;							/**< The first row handled by the thread. */
+			uint32_t										ui32EndRow;								/**< One past the last row handled by the thread. */
+			const CPal *									ppPalette;								/**< The palette. */
+			const SL2_NEAREST *								pnNearest;								/**< The palette search structure. */
+			const double *									pdMap;									/**< The threshold map. */
+			uint32_t										ui32MapSize;							/**< The side length of the threshold map. */
+			CColor											cScale;									/**< The per-channel threshold scale. */
+		};
+
+		/** A quantizer over weighted colors. */
+		typedef bool (*											PfQuantizer)( const CColor *, size_t, const size_t *, CPal &, size_t );
+
+
+		// == Members.
 		CPal												m_pPalette;								/**< The actual palette. */
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *		m_pkifFormat = nullptr;					/**< The palette format. */
 		uint32_t											m_ui32Id = ~uint32_t( 0 );				/**< The ID of the palette. */
@@ -209,14 +475,52 @@ namespace sl2 {
 
 		// == Functions.
 		/**
-		 * A better distruction of initial clusters.
+		 * A better distruction of initial clusters.  Uses k-means++ seeding, switching to k-means|| for large inputs.  Seeding is
+		 *	reproducible for a given CFormat::m_ui64kMeansSeed.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+		 * \param _vCentroids Input array of centroids.
+		 * \param _sK A pretty cool dude IMO.
+		 **/
+		static void											InitializeCentroidsKMeansPlusPlus( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, std::vector<CColor> &_vCentroids, size_t _sK );
+
+		/**
+		 * D^2-weighted k-means++ seeding.  Each color keeps its squared distance to the nearest chosen centroid, so each new
+		 *	centroid costs one pass over the colors.
 		 * 
 		 * \param _pcColors Input array of colors.
 		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
 		 * \param _vCentroids Input array of centroids.
 		 * \param _sK A pretty cool dude IMO.
+		 * \param _mRand The random-number generator.
+		 **/
+		static void											SeedKMeansPlusPlus( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, std::vector<CColor> &_vCentroids, size_t _sK, std::mt19937_64 &_mRand );
+
+		/**
+		 * k-means|| seeding (Bahmani et al.)  A few rounds oversample candidates in parallel, then k-means++ over the candidates,
+		 *	weighted by how many colors each one is nearest, picks the centroids.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+		 * \param _vCentroids Input array of centroids.
+		 * \param _sK A pretty cool dude IMO.
+		 * \param _mRand The random-number generator.
+		 * \return Returns false if memory could not be allocated, in which case _vCentroids is not filled in.
+		 **/
+		static bool											SeedKMeansParallel( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, std::vector<CColor> &_vCentroids, size_t _sK, std::mt19937_64 &_mRand );
+
+		/**
+		 * A k-means|| worker thread.  Either brings each color's nearest-candidate distance up to date with the new candidates or
+		 *	samples new candidates.  Sampling uses one generator per fixed block of colors so that the result does not depend on
+		 *	the thread count.
+		 * 
+		 * \param _pkpData The thread's data.
 		 **/
-		static void											InitializeCentroidsKMeansPlusPlus( const CColor * _pcColors, size_t _sColorsSize, std::vector<CColor> &_vCentroids, size_t _sK );
+		static void											KMeansParallelThread( SL2_KMEANS_PARALLEL * _pkpData );
 
 		/**
 		 * Checks for convergence between 2 centroid lists.
@@ -229,39 +533,152 @@ namespace sl2 {
 		static bool											HasConverged( const std::vector<CColor> &_vOldCentroids, const std::vector<CColor> &_vNewCentroids, double _dTolerance );
 
 		/**
-		 * Cluster assignment.  It's pretty cool.
+		 * Cluster assignment.  It's pretty cool.  Runs across threads, using Hamerly's bounds to skip colors whose centroid cannot
+		 *	have changed, and gathers per-block sums for UpdateCentroids().
 		 * 
-		 * \param _pcColors Input array of colors.
-		 * \param _sColorsSize Number of colors to which _pcColors points.
-		 * \param _vCentroids Input array of centroids.
-		 * \param _vClusterAssignment Output cluster-assignment results.
-		 * \param _sK A pretty cool dude IMO.
+		 * \param _lLloyd The k-means state.
+		 **/
+		static void											AssignClusters( SL2_LLOYD &_lLloyd );
+
+		/**
+		 * A cluster-assignment worker thread.
+		 * 
+		 * \param _pltData The blocks to assign.
 		 **/
-		static void											AssignClusters( const CColor * _pcColors, size_t _sColorsSize, const std::vector<CColor> & _vCentroids, std::vector<size_t> & _vClusterAssignment, size_t _sK );
+		static void											AssignClustersThread( SL2_LLOYD_THREAD * _pltData );
 
 		/**
-		 * Updates centroids like a BOSS.
+		 * Updates centroids like a BOSS.  Per-block sums are merged in block order, so the result is the same for any thread count.
+		 * 
+		 * \param _lLloyd The k-means state.
+		 **/
+		static void											UpdateCentroids( SL2_LLOYD &_lLloyd );
+
+		/**
+		 * Implements K-Means color quantization to generate a palette.  Clustering runs in the space of
+		 *	CFormat::m_cdColorDistance.
 		 * 
 		 * \param _pcColors Input array of colors.
 		 * \param _sColorsSize Number of colors to which _pcColors points.
-		 * \param _vCentroids Output array of centroids.
-		 * \param _vClusterAssignment Output cluster-assignment results.
-		 * \param _vClusterSize Output cluster-size results.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+		 * \param _pPalette The palette to generate.
 		 * \param _sK A pretty cool dude IMO.
+		 * \param _sIterations Number of iterations.
+		 * \param _bSeeded If true, _pPalette holds the initial centroids and _sK must match its size.
+		 * \return Returns true if all internal allocations succeed.
 		 **/
-		static void											UpdateCentroids( const CColor * _pcColors, size_t _sColorsSize, std::vector<CColor> & _vCentroids, std::vector<size_t> & _vClusterAssignment, std::vector<size_t> & _vClusterSize, size_t _sK );
+		static bool											kMeansColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK, size_t _sIterations, bool _bSeeded = false );
 
 		/**
-		 * Implements K-Means color quantization to generate a palette.
+		 * Runs K-Means on colors as given, by squared Euclidean distance.
 		 * 
 		 * \param _pcColors Input array of colors.
 		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
 		 * \param _pPalette The palette to generate.
-		 * \param _sK A pretty cool dude IMO.
+		 * \param _sK The number of clusters.
 		 * \param _sIterations Number of iterations.
+		 * \param _bSeeded If true, _pPalette holds the initial centroids and _sK must match its size.
 		 * \return Returns true if all internal allocations succeed.
 		 **/
-		static bool											kMeansColorQuantization( const CColor * _pcColors, size_t _sColorsSize, CPal & _pPalette, size_t _sK, size_t _sIterations );
+		static bool											LloydColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK, size_t _sIterations, bool _bSeeded );
+
+		/**
+		 * Wu's variance-minimizing color quantization.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+		 * \param _pPalette The palette to generate.  It can end up with fewer than _sK colors.
+		 * \param _sK The maximum number of colors to generate.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		static bool											WuColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK );
+
+		/**
+		 * Median-cut color quantization.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+		 * \param _pPalette The palette to generate.  It can end up with fewer than _sK colors.
+		 * \param _sK The maximum number of colors to generate.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		static bool											MedianCutColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK );
+
+		/**
+		 * Octree color quantization.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _psWeights The number of times each color appears, or nullptr if each appears once.
+		 * \param _pPalette The palette to generate.  It can end up with fewer than _sK colors.
+		 * \param _sK The maximum number of colors to generate.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		static bool											OctreeColorQuantization( const CColor * _pcColors, size_t _sColorsSize, const size_t * _psWeights, CPal & _pPalette, size_t _sK );
+
+		/**
+		 * Runs a quantizer over the weighted histogram of the colors and optionally refines the result with K-Means.  The palette
+		 *	has fewer than _ui32Size entries if there are fewer unique colors.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _ui32Size Size of the palette to generate.
+		 * \param _sRefineIterations Number of K-Means iterations to run using the result as the initial centroids.
+		 * \param _pfQuantizer The quantizer.
+		 * \return Returns true if all internal allocations succeed.
+		 **/
+		bool												GenPalette_Quantizer( const CColor * _pcColors, size_t _sColorsSize, uint32_t _ui32Size, size_t _sRefineIterations, PfQuantizer _pfQuantizer );
+
+		/**
+		 * Gets the moments of a box in Wu's cumulative histogram.
+		 * 
+		 * \param _pwmMoments The cumulative moments.
+		 * \param _psStrides The stride of each channel.
+		 * \param _wbBox The box.
+		 * \return Returns the moments of the box.
+		 **/
+		static SL2_WU_MOMENT								WuVolume( const SL2_WU_MOMENT * _pwmMoments, const size_t * _psStrides, const SL2_WU_BOX &_wbBox );
+
+		/**
+		 * Gets the weighted variance of a box in Wu's cumulative histogram.
+		 * 
+		 * \param _pwmMoments The cumulative moments.
+		 * \param _psStrides The stride of each channel.
+		 * \param _wbBox The box.
+		 * \return Returns the weighted sum of squared distances from the box's mean.
+		 **/
+		static double										WuVariance( const SL2_WU_MOMENT * _pwmMoments, const size_t * _psStrides, const SL2_WU_BOX &_wbBox );
+
+		/**
+		 * Gathers the unique colors in an array along with the number of times each appears.  Unique colors are listed in the order
+		 *	in which they first appear, so k-means over the histogram visits them in the same order as it would visit the texels.
+		 *	When a palette format is given, its bit depths are used to pack each color into its hash key.
+		 * 
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _pkifFormat The palette format to which the colors have been quantized, or nullptr.
+		 * \param _vUnique Holds the returned unique colors.
+		 * \param _vCounts Holds the returned number of times each unique color appears.
+		 * \return Returns true if all allocations succeed and colors repeat often enough for the histogram to pay off.
+		 **/
+		static bool											BuildHistogram( const CColor * _pcColors, size_t _sColorsSize, const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat, CPal &_vUnique, std::vector<size_t> &_vCounts );
+
+		/**
+		 * An error-diffusion worker thread.  Takes rows in order until none remain.
+		 * 
+		 * \param _pdData The shared state.
+		 **/
+		static void											DiffuseErrorThread( SL2_DIFFUSION * _pdData );
+
+		/**
+		 * An ordered-dithering worker thread.
+		 * 
+		 * \param _podData The rows to dither.
+		 **/
+		static void											OrderedDitherThread( const SL2_ORDERED_DITHER * _podData );
 	};
 
 
@@ -0,0 +1,249 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: An on-disk cache of generated palettes, keyed by the colors they were generated from and the settings used.
+ */
+
+#include "SL2PaletteCache.h"
+#include "../Files/SL2StdFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <thread>
+
+
+namespace sl2 {
+
+	// == Members.
+	/** The cache directory.  The cache is disabled while this is empty. */
+	std::filesystem::path CPaletteCache::m_pDirectory;
+
+	/** The size past which Trim() removes the least-recently used entries. */
+	uint64_t CPaletteCache::m_ui64MaxBytes = 64ULL * 1024ULL * 1024ULL;
+
+	/** Cache hits. */
+	std::atomic<uint64_t> CPaletteCache::m_aHits = 0;
+
+	/** Cache misses. */
+	std::atomic<uint64_t> CPaletteCache::m_aMisses = 0;
+
+	// == Functions.
+	/**
+	 * Creates the key for a palette.  Each color is hashed as its code in the palette format when it holds exactly that code,
+	 *	so equal quantized images give equal keys however their doubles were computed.  Colors are hashed in order, since the
+	 *	generators visit them in order.  The palette format, size, and every setting that changes the output of
+	 *	CPalette::GenPalette() are hashed with them.
+	 *
+	 * \param _pcColors Input array of colors.
+	 * \param _sColorsSize Number of colors to which _pcColors points.
+	 * \param _pkifFormat The palette format.
+	 * \param _ui32Size Size of the palette to generate.
+	 * \param _sIterations Number of K-Means iterations.
+	 * \return Returns the key.
+	 **/
+	CPaletteCache::SL2_KEY CPaletteCache::Key( const CPalette::CColor * _pcColors, size_t _sColorsSize, const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat,
+		uint32_t _ui32Size, size_t _sIterations ) {
+		// The same packing CPalette::BuildHistogram() uses.  A channel that is not exactly one of the format's codes is hashed by its
+		//	bits instead, so colors that would give the generators different input never share a key.
+		uint32_t ui32Bits[4] = { 0, 0, 0, 0 };
+		if ( _pkifFormat && !_pkifFormat->bFloatFormat ) {
+			ui32Bits[0] = _pkifFormat->ui8RBits;
+			ui32Bits[1] = _pkifFormat->ui8GBits;
+			ui32Bits[2] = _pkifFormat->ui8BBits;
+			ui32Bits[3] = _pkifFormat->ui8ABits;
+		}
+		auto Code = [&]( double _dVal, size_t _sChannel ) {
+			if ( ui32Bits[_sChannel] && ui32Bits[_sChannel] < 32 ) {
+				double dMax = double( (1ULL << ui32Bits[_sChannel]) - 1 );
+				double dCode = std::round( _dVal * dMax );
+				if ( dCode >= 0.0 && dCode <= dMax && dCode / dMax == _dVal ) { return uint64_t( dCode ); }
+			}
+			uint64_t ui64Bits;
+			std::memcpy( &ui64Bits, &_dVal, sizeof( _dVal ) );
+			return uint64_t( ui64Bits ^ 0x8000000000000000ULL );
+		};
+
+		// 2 independent chains make a 128-bit key.
+		uint64_t ui64H0 = 0, ui64H1 = 0x9E3779B97F4A7C15ULL;
+		for ( size_t I = 0; I < _sColorsSize; ++I ) {
+			uint64_t ui64C = Code( _pcColors[I][0], 0 );
+			ui64C = Mix( ui64C ^ Code( _pcColors[I][1], 1 ) );
+			ui64C = Mix( ui64C ^ Code( _pcColors[I][2], 2 ) );
+			ui64C = Mix( ui64C ^ Code( _pcColors[I][3], 3 ) );
+			ui64H0 = Mix( ui64H0 ^ ui64C );
+			ui64H1 = Mix( ui64H1 + ui64C );
+		}
+
+		// SL2_CD_WEIGHTED_RGB measures distances with the luma coefficients.
+		uint64_t ui64Luma[3];
+		for ( size_t I = 0; I < 3; ++I ) {
+			double dTmp = CFormat::Luma().dRgb[I];
+			std::memcpy( &ui64Luma[I], &dTmp, sizeof( dTmp ) );
+		}
+		// Bump the version whenever the generators change their output for the same settings.
+		const uint64_t ui64Settings[] = {
+			3,
+			_sColorsSize,
+			_pkifFormat ? uint64_t( _pkifFormat->kifInternalFormat ) : ~uint64_t( 0 ),
+			_ui32Size,
+			_sIterations,
+			uint64_t( CFormat::m_pmPaletteMethod ),
+			CFormat::m_sPaletteRefineIterations,
+			CFormat::m_ui64kMeansSeed,
+			uint64_t( CFormat::m_cdColorDistance ),
+			ui64Luma[0],
+			ui64Luma[1],
+			ui64Luma[2],
+		};
+		SL2_KEY kRet = { { ui64H0, ui64H1 } };
+		for ( size_t I = 0; I < sizeof( ui64Settings ) / sizeof( ui64Settings[0] ); ++I ) {
+			kRet.ui64Hash[0] = Mix( kRet.ui64Hash[0] ^ ui64Settings[I] );
+			kRet.ui64Hash[1] = Mix( kRet.ui64Hash[1] + ui64Settings[I] );
+		}
+		return kRet;
+	}
+
+	/**
+	 * Loads a palette from the cache.  A hit marks the entry as recently used.  An entry that is empty, larger than
+	 *	_ui32MaxSize, or without the full-precision colors written by Store() counts as a miss.
+	 *
+	 * \param _kKey The key of the palette.
+	 * \param _ui32MaxSize The largest palette to accept.
+	 * \param _pPalette Holds the returned palette.
+	 * \return Returns true if the palette was found and loaded.
+	 **/
+	bool CPaletteCache::Load( const SL2_KEY &_kKey, uint32_t _ui32MaxSize, CPalette::CPal &_pPalette ) {
+		try {
+			std::filesystem::path pPath = Path( _kKey );
+			std::vector<uint8_t> vFile;
+			if ( CStdFile::LoadToMemory( pPath.u16string().c_str(), vFile ) ) {
+				CStream sStream( vFile );
+				CPalette pTmp;
+				CPalette::CPal pFull;
+				// The ID holds part of the key so that a damaged or renamed file is not mistaken for a hit.
+				if ( pTmp.LoadPal( sStream, pPath.u16string() ) && pTmp.Id() == uint32_t( _kKey.ui64Hash[0] ) &&
+					pTmp.Palette().size() && pTmp.Palette().size() <= _ui32MaxSize &&
+					ReadFullPrecision( sStream, pFull = pTmp.Palette() ) ) {
+					_pPalette = std::move( pFull );
+					std::error_code ecError;
+					std::filesystem::last_write_time( pPath, std::filesystem::file_time_type::clock::now(), ecError );
+					++m_aHits;
+					return true;
+				}
+			}
+		}
+		catch ( ... ) {}
+		++m_aMisses;
+		return false;
+	}
+
+	/**
+	 * Adds a palette to the cache.  Entries are written to a temporary file and renamed so that concurrent builds never read
+	 *	a partial file.  The colors are written with 8 bits per channel for LoadPal() and again at full precision after the ID,
+	 *	so that a hit gives back exactly the palette that was generated.
+	 *
+	 * \param _kKey The key of the palette.
+	 * \param _pPalette The palette to add.
+	 * \return Returns true if the entry was written.
+	 **/
+	bool CPaletteCache::Store( const SL2_KEY &_kKey, const CPalette::CPal &_pPalette ) {
+		try {
+			std::vector<uint8_t> vFile;
+			CStream sStream( vFile );
+			if ( !CPalette::SavePal( _pPalette, uint32_t( _kKey.ui64Hash[0] ), sStream ) ) { return false; }
+			if ( !sStream.WriteUi32( SL2_FULL_PRECISION ) ) { return false; }
+			for ( size_t I = 0; I < _pPalette.size(); ++I ) {
+				for ( size_t J = 0; J < 4; ++J ) {
+					if ( !sStream.Write( _pPalette[I][J] ) ) { return false; }
+				}
+			}
+
+			std::error_code ecError;
+			std::filesystem::create_directories( m_pDirectory, ecError );
+			std::filesystem::path pPath = Path( _kKey );
+			std::filesystem::path pTmpPath = pPath;
+			pTmpPath += std::format( ".{}.tmp", std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+			if ( !CStdFile::WriteToFile( pTmpPath.u16string().c_str(), vFile ) ) { return false; }
+			std::filesystem::rename( pTmpPath, pPath, ecError );
+			if ( ecError ) {
+				std::filesystem::remove( pTmpPath, ecError );
+				return false;
+			}
+			return true;
+		}
+		catch ( ... ) { return false; }
+	}
+
+	/**
+	 * Removes the least-recently used entries until the cache is no larger than m_ui64MaxBytes.
+	 *
+	 * \return Returns the number of entries removed.
+	 **/
+	size_t CPaletteCache::Trim() {
+		if ( !Enabled() ) { return 0; }
+		struct SL2_ENTRY {
+			std::filesystem::path							pPath;
+			std::filesystem::file_time_type					fttTime;
+			uint64_t										ui64Size;
+		};
+		size_t sRemoved = 0;
+		try {
+			std::vector<SL2_ENTRY> vEntries;
+			uint64_t ui64Total = 0;
+			std::error_code ecError;
+			for ( const auto & deEntry : std::filesystem::directory_iterator( m_pDirectory, ecError ) ) {
+				if ( !deEntry.is_regular_file( ecError ) || deEntry.path().extension() != u".pal" ) { continue; }
+				SL2_ENTRY eEntry = { deEntry.path(), deEntry.last_write_time( ecError ), deEntry.file_size( ecError ) };
+				if ( ecError ) { continue; }
+				ui64Total += eEntry.ui64Size;
+				vEntries.push_back( eEntry );
+			}
+			if ( ui64Total <= m_ui64MaxBytes ) { return 0; }
+
+			std::sort( vEntries.begin(), vEntries.end(), []( const SL2_ENTRY &_eA, const SL2_ENTRY &_eB ) { return _eA.fttTime < _eB.fttTime; } );
+			for ( size_t I = 0; I < vEntries.size() && ui64Total > m_ui64MaxBytes; ++I ) {
+				if ( std::filesystem::remove( vEntries[I].pPath, ecError ) ) {
+					ui64Total -= vEntries[I].ui64Size;
+					++sRemoved;
+				}
+			}
+		}
+		catch ( ... ) {}
+		return sRemoved;
+	}
+
+	/**
+	 * Reads the full-precision colors that follow the ID of an entry over the 8-bit colors loaded by LoadPal().
+	 *
+	 * \param _sFile The entry, positioned after the ID.
+	 * \param _pPalette The palette loaded by LoadPal(), whose colors are replaced.
+	 * \return Returns true if the entry holds full-precision colors for every entry of the palette.
+	 **/
+	bool CPaletteCache::ReadFullPrecision( const CStream &_sFile, CPalette::CPal &_pPalette ) {
+		uint32_t ui32Tag;
+		if ( !_sFile.ReadUi32( ui32Tag ) || ui32Tag != SL2_FULL_PRECISION ) { return false; }
+		if ( _sFile.Remaining() != _pPalette.size() * 4 * sizeof( double ) ) { return false; }
+		for ( size_t I = 0; I < _pPalette.size(); ++I ) {
+			for ( size_t J = 0; J < 4; ++J ) {
+				double dVal;
+				if ( !_sFile.Read( dVal ) ) { return false; }
+				_pPalette[I].m_dElements[J] = dVal;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Gets the path of an entry.
+	 *
+	 * \param _kKey The key of the entry.
+	 * \return Returns the path to the entry's .pal file.
+	 **/
+	std::filesystem::path CPaletteCache::Path( const SL2_KEY &_kKey ) {
+		return m_pDirectory / std::format( "{:016X}{:016X}.pal", _kKey.ui64Hash[0], _kKey.ui64Hash[1] );
+	}
+
+}	// namespace sl2
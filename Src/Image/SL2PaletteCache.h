@@ -0,0 +1,155 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: An on-disk cache of generated palettes, keyed by the colors they were generated from and the settings used.
+ */
+
+#pragma once
+
+#include "SL2Palette.h"
+
+#include <atomic>
+#include <filesystem>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CPaletteCache
+	 * \brief An on-disk cache of generated palettes.
+	 *
+	 * Description: An on-disk cache of generated palettes, keyed by the colors they were generated from and the settings used.
+	 *	Each entry is a .pal file named after its key, readable by CPalette::LoadPal().  The least-recently used entries are
+	 *	removed by Trim() once the directory grows past m_ui64MaxBytes.
+	 */
+	class CPaletteCache {
+	public :
+		// == Types.
+		/** A cache key. */
+		struct SL2_KEY {
+			uint64_t										ui64Hash[2];							/**< 128-bit hash of the color histogram and settings. */
+		};
+
+
+		// == Members.
+		/** The cache directory.  The cache is disabled while this is empty. */
+		static std::filesystem::path						m_pDirectory;
+
+		/** The size past which Trim() removes the least-recently used entries. */
+		static uint64_t										m_ui64MaxBytes;
+
+
+		// == Functions.
+		/**
+		 * Determines whether the cache is enabled.
+		 *
+		 * \return Returns true if a cache directory has been set.
+		 **/
+		static inline bool									Enabled() { return !m_pDirectory.empty(); }
+
+		/**
+		 * Creates the key for a palette.  Each color is hashed as its code in the palette format when it holds exactly that code,
+		 *	so equal quantized images give equal keys however their doubles were computed.  Colors are hashed in order, since the
+		 *	generators visit them in order.  The palette format, size, and every setting that changes the output of
+		 *	CPalette::GenPalette(), including the color-distance metric and the luma coefficients, are hashed with them.
+		 *
+		 * \param _pcColors Input array of colors.
+		 * \param _sColorsSize Number of colors to which _pcColors points.
+		 * \param _pkifFormat The palette format.
+		 * \param _ui32Size Size of the palette to generate.
+		 * \param _sIterations Number of K-Means iterations.
+		 * \return Returns the key.
+		 **/
+		static SL2_KEY										Key( const CPalette::CColor * _pcColors, size_t _sColorsSize, const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifFormat,
+			uint32_t _ui32Size, size_t _sIterations );
+
+		/**
+		 * Loads a palette from the cache.  A hit marks the entry as recently used.  An entry that is empty, larger than
+		 *	_ui32MaxSize, or without the full-precision colors written by Store() counts as a miss.
+		 *
+		 * \param _kKey The key of the palette.
+		 * \param _ui32MaxSize The largest palette to accept.
+		 * \param _pPalette Holds the returned palette.
+		 * \return Returns true if the palette was found and loaded.
+		 **/
+		static bool											Load( const SL2_KEY &_kKey, uint32_t _ui32MaxSize, CPalette::CPal &_pPalette );
+
+		/**
+		 * Adds a palette to the cache.  Entries are written to a temporary file and renamed so that concurrent builds never read
+		 *	a partial file.  The colors are written with 8 bits per channel for LoadPal() and again at full precision after the ID,
+		 *	so that a hit gives back exactly the palette that was generated.
+		 *
+		 * \param _kKey The key of the palette.
+		 * \param _pPalette The palette to add.
+		 * \return Returns true if the entry was written.
+		 **/
+		static bool											Store( const SL2_KEY &_kKey, const CPalette::CPal &_pPalette );
+
+		/**
+		 * Removes the least-recently used entries until the cache is no larger than m_ui64MaxBytes.
+		 *
+		 * \return Returns the number of entries removed.
+		 **/
+		static size_t										Trim();
+
+		/**
+		 * Gets the number of palettes loaded from the cache.
+		 *
+		 * \return Returns the number of cache hits.
+		 **/
+		static inline uint64_t								Hits() { return m_aHits; }
+
+		/**
+		 * Gets the number of palettes that had to be generated.
+		 *
+		 * \return Returns the number of cache misses.
+		 **/
+		static inline uint64_t								Misses() { return m_aMisses; }
+
+
+	protected :
+		// == Members.
+		/** The tag in front of the full-precision colors of an entry ("F64 "). */
+		static constexpr uint32_t							SL2_FULL_PRECISION = 0x20343646;
+
+		/** Cache hits. */
+		static std::atomic<uint64_t>						m_aHits;
+
+		/** Cache misses. */
+		static std::atomic<uint64_t>						m_aMisses;
+
+
+		// == Functions.
+		/**
+		 * Reads the full-precision colors that follow the ID of an entry over the 8-bit colors loaded by LoadPal().
+		 *
+		 * \param _sFile The entry, positioned after the ID.
+		 * \param _pPalette The palette loaded by LoadPal(), whose colors are replaced.
+		 * \return Returns true if the entry holds full-precision colors for every entry of the palette.
+		 **/
+		static bool											ReadFullPrecision( const CStream &_sFile, CPalette::CPal &_pPalette );
+
+		/**
+		 * Gets the path of an entry.
+		 *
+		 * \param _kKey The key of the entry.
+		 * \return Returns the path to the entry's .pal file.
+		 **/
+		static std::filesystem::path						Path( const SL2_KEY &_kKey );
+
+		/**
+		 * The SplitMix64 finalizer.
+		 *
+		 * \param _ui64Val The value to mix.
+		 * \return Returns the mixed value.
+		 **/
+		static inline uint64_t								Mix( uint64_t _ui64Val ) {
+			_ui64Val = (_ui64Val ^ (_ui64Val >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			_ui64Val = (_ui64Val ^ (_ui64Val >> 27)) * 0x94D049BB133111EBULL;
+			return _ui64Val ^ (_ui64Val >> 31);
+		}
+	};
+
+}	// namespace sl2
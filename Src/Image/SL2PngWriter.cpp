@@ -0,0 +1,343 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: A PNG writer with per-row adaptive filtering, selectable zlib strategies, and multi-threaded deflate.
+ */
+
+#include "SL2PngWriter.h"
+#include "../Thread/SL2ParallelFor.h"
+
+#include <ZLib/zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+
+namespace sl2 {
+
+	// == Functions.
+	/**
+	 * Writes a non-interlaced PNG file to memory.  Rows are in PNG order: the components are in the order of the color type, and
+	 *	16-bit components are big-endian.
+	 *
+	 * \param _pui8Rows The first row of the image.
+	 * \param _sPitch The distance in bytes from one row to the next.
+	 * \param _ui32Width The width of the image.
+	 * \param _ui32Height The height of the image.
+	 * \param _ui8BitDepth The bits per component, 8 or 16.
+	 * \param _ctColorType The color type.
+	 * \param _pui8Icc An optional ICC profile to embed in an iCCP chunk.
+	 * \param _sIccSize The size of the ICC profile.
+	 * \param _sSettings Compression settings.
+	 * \param _vOut Holds the returned file.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CPngWriter::Write( const uint8_t * _pui8Rows, size_t _sPitch, uint32_t _ui32Width, uint32_t _ui32Height,
+		uint8_t _ui8BitDepth, SL2_COLOR_TYPE _ctColorType, const uint8_t * _pui8Icc, size_t _sIccSize, const SL2_SETTINGS &_sSettings, std::vector<uint8_t> &_vOut ) {
+		if ( !_ui32Width || !_ui32Height || _ui32Width > 0x7FFFFFFF || _ui32Height > 0x7FFFFFFF ) { return SL2_E_UNSUPPORTEDSIZE; }
+		if ( _ui8BitDepth != 8 && _ui8BitDepth != 16 ) { return SL2_E_BADFORMAT; }
+		size_t sChannels;
+		switch ( _ctColorType ) {
+			case SL2_CT_GRAY : { sChannels = 1; break; }
+			case SL2_CT_RGB : { sChannels = 3; break; }
+			case SL2_CT_GRAY_ALPHA : { sChannels = 2; break; }
+			case SL2_CT_RGBA : { sChannels = 4; break; }
+			default : { return SL2_E_BADFORMAT; }
+		}
+		const size_t sBpp = sChannels * (_ui8BitDepth / 8);
+		const size_t sRowBytes = sBpp * _ui32Width;
+		const size_t sFilteredRow = sRowBytes + 1;
+
+		try {
+			std::vector<uint8_t> vFiltered( sFilteredRow * _ui32Height );
+
+			// Bands of at least 256 kilobytes, one per thread, each small enough for the 32-bit sizes zlib takes.
+			size_t sThreads = _sSettings.ui32Threads ? _sSettings.ui32Threads : std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+			size_t sBands = std::clamp<size_t>( vFiltered.size() / (256 * 1024), 1, sThreads );
+			sBands = std::max<size_t>( sBands, (vFiltered.size() + (1 << 30) - 1) >> 30 );
+			sBands = std::min<size_t>( sBands, _ui32Height );
+			const uint32_t ui32RowsPerBand = uint32_t( (_ui32Height + sBands - 1) / sBands );
+			std::vector<SL2_BAND> vBands;
+			for ( uint32_t I = 0; I < _ui32Height; I += ui32RowsPerBand ) {
+				SL2_BAND bBand = {};
+				bBand.ui32FirstRow = I;
+				bBand.ui32Rows = std::min( ui32RowsPerBand, _ui32Height - I );
+				bBand.sOffset = sFilteredRow * I;
+				bBand.sSize = sFilteredRow * bBand.ui32Rows;
+				vBands.push_back( std::move( bBand ) );
+			}
+
+			// Runs a function over every band, on up to sThreads threads.
+			auto RunBands = [&]( auto _fFunc ) {
+				std::atomic<size_t> aNext = 0;
+				auto Work = [&]() {
+					for ( size_t I = aNext++; I < vBands.size(); I = aNext++ ) {
+						_fFunc( I );
+					}
+				};
+				CParallelFor::Run( CParallelFor::Workers( std::min( sThreads, vBands.size() ) ), [&]( size_t ) { Work(); } );
+			};
+
+			// Filtering reads only the unfiltered rows, so every band can be filtered before any is deflated, which lets each band be
+			//	primed with the filtered tail of the band before it.
+			RunBands( [&]( size_t _sIdx ) {
+				FilterBand( vBands[_sIdx], _pui8Rows, _sPitch, sRowBytes, sBpp, _sSettings.fFilter, vFiltered.data() );
+			} );
+			RunBands( [&]( size_t _sIdx ) {
+				DeflateBand( vBands[_sIdx], vFiltered.data(), _sSettings, _sIdx == vBands.size() - 1 );
+			} );
+
+			// Join the bands into one zlib stream.
+			std::vector<uint8_t> vStream;
+			size_t sStreamSize = 2 + 4;
+			for ( const auto & bBand : vBands ) {
+				if ( !bBand.bSuccess ) { return SL2_E_OUTOFMEMORY; }
+				sStreamSize += bBand.vDeflated.size();
+			}
+			vStream.reserve( sStreamSize );
+			// CMF: deflate with a 32-kilobyte window.  FLG: the level hint, with FCHECK making the header a multiple of 31.
+			const uint8_t ui8Cmf = 0x78;
+			uint8_t ui8Flg = uint8_t( (_sSettings.iLevel < 2 ? 0 : _sSettings.iLevel < 6 ? 1 : _sSettings.iLevel == 6 ? 2 : 3) << 6 );
+			ui8Flg |= uint8_t( 31 - ((ui8Cmf * 256 + ui8Flg) % 31) ) % 31;
+			vStream.push_back( ui8Cmf );
+			vStream.push_back( ui8Flg );
+			uint32_t ui32Adler = 1;
+			for ( auto & bBand : vBands ) {
+				vStream.insert( vStream.end(), bBand.vDeflated.begin(), bBand.vDeflated.end() );
+				ui32Adler = uint32_t( ::adler32_combine( ui32Adler, bBand.ui32Adler, z_off_t( bBand.sSize ) ) );
+				bBand.vDeflated = std::vector<uint8_t>();
+			}
+			AppendBe32( vStream, ui32Adler );
+
+			// Write the file.
+			_vOut.clear();
+			_vOut.reserve( vStream.size() + _sIccSize + 256 );
+			const uint8_t ui8Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			_vOut.insert( _vOut.end(), ui8Signature, ui8Signature + sizeof( ui8Signature ) );
+
+			std::vector<uint8_t> vChunk;
+			AppendBe32( vChunk, _ui32Width );
+			AppendBe32( vChunk, _ui32Height );
+			vChunk.push_back( _ui8BitDepth );
+			vChunk.push_back( uint8_t( _ctColorType ) );
+			vChunk.push_back( 0 );												// Deflate.
+			vChunk.push_back( 0 );												// Adaptive filtering.
+			vChunk.push_back( 0 );												// Not interlaced.
+			AppendChunk( _vOut, "IHDR", vChunk.data(), vChunk.size() );
+
+			if ( _pui8Icc && _sIccSize ) {
+				const char szName[] = "ICC Profile";
+				vChunk.assign( szName, szName + sizeof( szName ) );					// Includes the terminating NULL.
+				vChunk.push_back( 0 );												// Deflate.
+				uLongf ulSize = ::compressBound( uLong( _sIccSize ) );
+				size_t sStart = vChunk.size();
+				vChunk.resize( sStart + ulSize );
+				if ( ::compress2( vChunk.data() + sStart, &ulSize, _pui8Icc, uLong( _sIccSize ), Z_BEST_COMPRESSION ) != Z_OK ) { return SL2_E_INTERNALERROR; }
+				vChunk.resize( sStart + ulSize );
+				AppendChunk( _vOut, "iCCP", vChunk.data(), vChunk.size() );
+			}
+
+			const size_t sMaxIdat = 1024 * 1024;
+			for ( size_t I = 0; I < vStream.size(); I += sMaxIdat ) {
+				AppendChunk( _vOut, "IDAT", vStream.data() + I, std::min( sMaxIdat, vStream.size() - I ) );
+			}
+			AppendChunk( _vOut, "IEND", nullptr, 0 );
+		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+		return SL2_E_SUCCESS;
+	}
+
+	/**
+	 * Filters a row.
+	 *
+	 * \param _fFilter The filter to apply.  Must not be SL2_F_ADAPTIVE.
+	 * \param _pui8Row The row to filter.
+	 * \param _pui8Prev The row above it, or nullptr for the first row.
+	 * \param _sBytes The number of bytes in the row.
+	 * \param _sBpp The number of bytes per pixel, at least 1.
+	 * \param _pui8Dst Holds the filtered row, without the filter-type byte.
+	 **/
+	void CPngWriter::FilterRow( SL2_FILTER _fFilter, const uint8_t * _pui8Row, const uint8_t * _pui8Prev, size_t _sBytes, size_t _sBpp,
+		uint8_t * _pui8Dst ) {
+		// The row above the first row is all zeros.  Up and Average then reduce to None and a halved Sub, and Paeth to Sub.
+		if ( !_pui8Prev ) {
+			switch ( _fFilter ) {
+				case SL2_F_UP : { _fFilter = SL2_F_NONE; break; }
+				case SL2_F_PAETH : { _fFilter = SL2_F_SUB; break; }
+				case SL2_F_AVERAGE : {
+					std::memcpy( _pui8Dst, _pui8Row, std::min( _sBpp, _sBytes ) );
+					for ( size_t I = _sBpp; I < _sBytes; ++I ) {
+						_pui8Dst[I] = uint8_t( _pui8Row[I] - (_pui8Row[I-_sBpp] >> 1) );
+					}
+					return;
+				}
+				default : {}
+			}
+		}
+		switch ( _fFilter ) {
+			case SL2_F_SUB : {
+				std::memcpy( _pui8Dst, _pui8Row, std::min( _sBpp, _sBytes ) );
+				for ( size_t I = _sBpp; I < _sBytes; ++I ) {
+					_pui8Dst[I] = uint8_t( _pui8Row[I] - _pui8Row[I-_sBpp] );
+				}
+				break;
+			}
+			case SL2_F_UP : {
+				for ( size_t I = 0; I < _sBytes; ++I ) {
+					_pui8Dst[I] = uint8_t( _pui8Row[I] - _pui8Prev[I] );
+				}
+				break;
+			}
+			case SL2_F_AVERAGE : {
+				for ( size_t I = 0; I < _sBpp && I < _sBytes; ++I ) {
+					_pui8Dst[I] = uint8_t( _pui8Row[I] - (_pui8Prev[I] >> 1) );
+				}
+				for ( size_t I = _sBpp; I < _sBytes; ++I ) {
+					_pui8Dst[I] = uint8_t( _pui8Row[I] - ((uint32_t( _pui8Row[I-_sBpp] ) + _pui8Prev[I]) >> 1) );
+				}
+				break;
+			}
+			case SL2_F_PAETH : {
+				for ( size_t I = 0; I < _sBpp && I < _sBytes; ++I ) {
+					_pui8Dst[I] = uint8_t( _pui8Row[I] - _pui8Prev[I] );
+				}
+				for ( size_t I = _sBpp; I < _sBytes; ++I ) {
+					int32_t i32A = _pui8Row[I-_sBpp], i32B = _pui8Prev[I], i32C = _pui8Prev[I-_sBpp];
+					int32_t i32Pa = std::abs( i32B - i32C );
+					int32_t i32Pb = std::abs( i32A - i32C );
+					int32_t i32Pc = std::abs( i32A + i32B - i32C - i32C );
+					int32_t i32Pred = (i32Pa <= i32Pb && i32Pa <= i32Pc) ? i32A : (i32Pb <= i32Pc ? i32B : i32C);
+					_pui8Dst[I] = uint8_t( _pui8Row[I] - i32Pred );
+				}
+				break;
+			}
+			default : {
+				std::memcpy( _pui8Dst, _pui8Row, _sBytes );
+			}
+		}
+	}
+
+	/**
+	 * Filters the rows of a band.
+	 *
+	 * \param _bBand The band to filter.
+	 * \param _pui8Rows The first row of the image.
+	 * \param _sPitch The distance in bytes from one row to the next.
+	 * \param _sRowBytes The number of bytes in each row.
+	 * \param _sBpp The number of bytes per pixel, at least 1.
+	 * \param _fFilter The filter to apply.
+	 * \param _pui8Filtered The filtered buffer.
+	 **/
+	void CPngWriter::FilterBand( const SL2_BAND &_bBand, const uint8_t * _pui8Rows, size_t _sPitch, size_t _sRowBytes, size_t _sBpp,
+		SL2_FILTER _fFilter, uint8_t * _pui8Filtered ) {
+		std::vector<uint8_t> vTmp;
+		if ( _fFilter == SL2_F_ADAPTIVE ) {
+			try {
+				vTmp.resize( _sRowBytes );
+			}
+			catch ( ... ) { _fFilter = SL2_F_PAETH; }
+		}
+		uint8_t * pui8Dst = _pui8Filtered + _bBand.sOffset;
+		for ( uint32_t Y = _bBand.ui32FirstRow; Y < _bBand.ui32FirstRow + _bBand.ui32Rows; ++Y ) {
+			const uint8_t * pui8Row = _pui8Rows + _sPitch * Y;
+			const uint8_t * pui8Prev = Y ? pui8Row - _sPitch : nullptr;
+			if ( _fFilter == SL2_F_ADAPTIVE ) {
+				// Keep the filter whose output has the smallest sum of absolute values as signed bytes (the libpng heuristic).  The
+				//	best so far stays in the destination row and each other candidate is built in vTmp.
+				uint64_t ui64Best = ~0ULL;
+				for ( uint8_t F = SL2_F_NONE; F < SL2_F_ADAPTIVE; ++F ) {
+					uint8_t * pui8Try = ui64Best == ~0ULL ? pui8Dst + 1 : vTmp.data();
+					FilterRow( SL2_FILTER( F ), pui8Row, pui8Prev, _sRowBytes, _sBpp, pui8Try );
+					// Summed in blocks so the inner loop vectorizes; a candidate is abandoned once a block puts it past the best.
+					uint64_t ui64Sum = 0;
+					for ( size_t I = 0; I < _sRowBytes && ui64Sum < ui64Best; I += 1024 ) {
+						uint32_t ui32Sum = 0;
+						for ( size_t J = I, sEnd = std::min<size_t>( I + 1024, _sRowBytes ); J < sEnd; ++J ) {
+							ui32Sum += uint8_t( std::abs( int8_t( pui8Try[J] ) ) );
+						}
+						ui64Sum += ui32Sum;
+					}
+					if ( ui64Sum < ui64Best ) {
+						if ( pui8Try != pui8Dst + 1 ) { std::memcpy( pui8Dst + 1, pui8Try, _sRowBytes ); }
+						pui8Dst[0] = F;
+						ui64Best = ui64Sum;
+					}
+				}
+			}
+			else {
+				pui8Dst[0] = uint8_t( _fFilter );
+				FilterRow( _fFilter, pui8Row, pui8Prev, _sRowBytes, _sBpp, pui8Dst + 1 );
+			}
+			pui8Dst += _sRowBytes + 1;
+		}
+	}
+
+	/**
+	 * Deflates the filtered rows of a band.
+	 *
+	 * \param _bBand The band to compress.
+	 * \param _pui8Filtered The filtered buffer.
+	 * \param _sSettings Compression settings.
+	 * \param _bLast True for the last band, which finishes the deflate stream.
+	 **/
+	void CPngWriter::DeflateBand( SL2_BAND &_bBand, const uint8_t * _pui8Filtered, const SL2_SETTINGS &_sSettings, bool _bLast ) {
+		_bBand.bSuccess = false;
+		const int iStrategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED, Z_RLE, Z_HUFFMAN_ONLY };
+		int iLevel = std::clamp( _sSettings.iLevel, 0, 9 );
+		int iStrategy = iStrategies[std::min<size_t>( _sSettings.sStrategy, SL2_ELEMENTS( iStrategies ) - 1 )];
+
+		const uint8_t * pui8Src = _pui8Filtered + _bBand.sOffset;
+		_bBand.ui32Adler = uint32_t( ::adler32( 1, pui8Src, uInt( _bBand.sSize ) ) );
+
+		z_stream zsStream = {};
+		// A raw stream (negative window bits): the zlib header and Adler-32 are written once for the whole image.  The default memory
+		//	level, as libpng uses; level 9 made deflate about 40% slower for a 0.2% smaller file.
+		if ( ::deflateInit2( &zsStream, iLevel, Z_DEFLATED, -15, 8, iStrategy ) != Z_OK ) { return; }
+		if ( _bBand.sOffset && iLevel ) {
+			// Let the first rows of the band match against the end of the band before it.
+			size_t sDict = std::min<size_t>( _bBand.sOffset, 32 * 1024 );
+			::deflateSetDictionary( &zsStream, _pui8Filtered + _bBand.sOffset - sDict, uInt( sDict ) );
+		}
+		try {
+			// deflateBound() covers Z_FINISH; a sync flush adds at most an empty stored block.
+			_bBand.vDeflated.resize( ::deflateBound( &zsStream, uLong( _bBand.sSize ) ) + 16 );
+		}
+		catch ( ... ) {
+			::deflateEnd( &zsStream );
+			return;
+		}
+		zsStream.next_in = const_cast<Bytef *>(pui8Src);
+		zsStream.avail_in = uInt( _bBand.sSize );
+		zsStream.next_out = _bBand.vDeflated.data();
+		zsStream.avail_out = uInt( _bBand.vDeflated.size() );
+		// Every band but the last ends on a byte boundary with the final-block bit clear, so the next band's blocks can follow it.
+		int iRet = ::deflate( &zsStream, _bLast ? Z_FINISH : Z_SYNC_FLUSH );
+		bool bDone = _bLast ? iRet == Z_STREAM_END : (iRet == Z_OK && zsStream.avail_in == 0 && zsStream.avail_out != 0);
+		_bBand.vDeflated.resize( _bBand.vDeflated.size() - zsStream.avail_out );
+		::deflateEnd( &zsStream );
+		_bBand.bSuccess = bDone;
+	}
+
+	/**
+	 * Appends a chunk to a PNG file.
+	 *
+	 * \param _vOut The file to which to append the chunk.
+	 * \param _pcType The 4-character chunk type.
+	 * \param _pui8Data The chunk data.
+	 * \param _sSize The size of the chunk data.
+	 **/
+	void CPngWriter::AppendChunk( std::vector<uint8_t> &_vOut, const char * _pcType, const uint8_t * _pui8Data, size_t _sSize ) {
+		AppendBe32( _vOut, uint32_t( _sSize ) );
+		size_t sStart = _vOut.size();
+		_vOut.insert( _vOut.end(), _pcType, _pcType + 4 );
+		if ( _sSize ) { _vOut.insert( _vOut.end(), _pui8Data, _pui8Data + _sSize ); }
+		// The CRC covers the type and the data.
+		AppendBe32( _vOut, uint32_t( ::crc32( 0, _vOut.data() + sStart, uInt( _vOut.size() - sStart ) ) ) );
+	}
+
+}	// namespace sl2
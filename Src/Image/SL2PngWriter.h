@@ -0,0 +1,164 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: A PNG writer with per-row adaptive filtering, selectable zlib strategies, and multi-threaded deflate.
+ */
+
+#pragma once
+
+#include "SL2Formats.h"
+
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CPngWriter
+	 * \brief A PNG writer with per-row adaptive filtering, selectable zlib strategies, and multi-threaded deflate.
+	 *
+	 * Description: A PNG writer with per-row adaptive filtering, selectable zlib strategies, and multi-threaded deflate.  The image is
+	 *	split into bands of rows that are filtered and deflated on their own threads.  Each band but the last ends with a sync flush, so
+	 *	the raw deflate streams are byte-aligned and can be joined into one zlib stream whose Adler-32 is combined from the bands.  Each
+	 *	band after the first is primed with the last 32 kilobytes of the band before it, so splitting costs little compression.
+	 */
+	class CPngWriter {
+	public :
+		// == Enumerations.
+		/** Row filters.  The first 5 are the PNG filter types. */
+		enum SL2_FILTER : uint8_t {
+			SL2_F_NONE,																			/**< No filter. */
+			SL2_F_SUB,																			/**< Difference from the pixel to the left. */
+			SL2_F_UP,																			/**< Difference from the pixel above. */
+			SL2_F_AVERAGE,																		/**< Difference from the average of the pixels to the left and above. */
+			SL2_F_PAETH,																		/**< Difference from the Paeth predictor. */
+			SL2_F_ADAPTIVE,																		/**< Each row uses the filter with the smallest sum of absolute differences. */
+		};
+
+		/** zlib strategies. */
+		enum SL2_STRATEGY : uint8_t {
+			SL2_S_DEFAULT,																		/**< Z_DEFAULT_STRATEGY. */
+			SL2_S_FILTERED,																		/**< Z_FILTERED. */
+			SL2_S_RLE,																			/**< Z_RLE.  Only matches the previous pixel; much faster and close to the default on filtered rows. */
+			SL2_S_HUFFMAN,																		/**< Z_HUFFMAN_ONLY.  No matches at all; the fastest. */
+		};
+
+		/** PNG color types. */
+		enum SL2_COLOR_TYPE : uint8_t {
+			SL2_CT_GRAY																			= 0,
+			SL2_CT_RGB																			= 2,
+			SL2_CT_GRAY_ALPHA																	= 4,
+			SL2_CT_RGBA																			= 6,
+		};
+
+
+		// == Types.
+		/** Compression settings. */
+		struct SL2_SETTINGS {
+			int																					iLevel = 6;							/**< The zlib level, 0-9. */
+			SL2_STRATEGY																		sStrategy = SL2_S_FILTERED;			/**< The zlib strategy.  libpng also uses Z_FILTERED for filtered rows. */
+			SL2_FILTER																			fFilter = SL2_F_ADAPTIVE;			/**< The row filter. */
+			uint32_t																			ui32Threads = 0;					/**< The number of threads, or 0 for one per core. */
+		};
+
+
+		// == Functions.
+		/**
+		 * Writes a non-interlaced PNG file to memory.  Rows are in PNG order: the components are in the order of the color type, and
+		 *	16-bit components are big-endian.
+		 *
+		 * \param _pui8Rows The first row of the image.
+		 * \param _sPitch The distance in bytes from one row to the next.
+		 * \param _ui32Width The width of the image.
+		 * \param _ui32Height The height of the image.
+		 * \param _ui8BitDepth The bits per component, 8 or 16.
+		 * \param _ctColorType The color type.
+		 * \param _pui8Icc An optional ICC profile to embed in an iCCP chunk.
+		 * \param _sIccSize The size of the ICC profile.
+		 * \param _sSettings Compression settings.
+		 * \param _vOut Holds the returned file.
+		 * \return Returns an error code.
+		 **/
+		static SL2_ERRORS																		Write( const uint8_t * _pui8Rows, size_t _sPitch, uint32_t _ui32Width, uint32_t _ui32Height,
+			uint8_t _ui8BitDepth, SL2_COLOR_TYPE _ctColorType, const uint8_t * _pui8Icc, size_t _sIccSize, const SL2_SETTINGS &_sSettings, std::vector<uint8_t> &_vOut );
+
+
+	protected :
+		// == Types.
+		/** A band of rows compressed on its own thread. */
+		struct SL2_BAND {
+			uint32_t																			ui32FirstRow;						/**< The first row in the band. */
+			uint32_t																			ui32Rows;							/**< The number of rows in the band. */
+			size_t																				sOffset;							/**< The offset of the band's filtered rows in the filtered buffer. */
+			size_t																				sSize;								/**< The size of the band's filtered rows. */
+			std::vector<uint8_t>																vDeflated;							/**< The band's raw deflate stream. */
+			uint32_t																			ui32Adler;							/**< The Adler-32 of the band's filtered rows. */
+			bool																				bSuccess;							/**< Set once the band has been compressed. */
+		};
+
+
+		// == Functions.
+		/**
+		 * Filters a row.
+		 *
+		 * \param _fFilter The filter to apply.  Must not be SL2_F_ADAPTIVE.
+		 * \param _pui8Row The row to filter.
+		 * \param _pui8Prev The row above it, or nullptr for the first row.
+		 * \param _sBytes The number of bytes in the row.
+		 * \param _sBpp The number of bytes per pixel, at least 1.
+		 * \param _pui8Dst Holds the filtered row, without the filter-type byte.
+		 **/
+		static void																				FilterRow( SL2_FILTER _fFilter, const uint8_t * _pui8Row, const uint8_t * _pui8Prev, size_t _sBytes, size_t _sBpp,
+			uint8_t * _pui8Dst );
+
+		/**
+		 * Filters the rows of a band.
+		 *
+		 * \param _bBand The band to filter.
+		 * \param _pui8Rows The first row of the image.
+		 * \param _sPitch The distance in bytes from one row to the next.
+		 * \param _sRowBytes The number of bytes in each row.
+		 * \param _sBpp The number of bytes per pixel, at least 1.
+		 * \param _fFilter The filter to apply.
+		 * \param _pui8Filtered The filtered buffer.
+		 **/
+		static void																				FilterBand( const SL2_BAND &_bBand, const uint8_t * _pui8Rows, size_t _sPitch, size_t _sRowBytes, size_t _sBpp,
+			SL2_FILTER _fFilter, uint8_t * _pui8Filtered );
+
+		/**
+		 * Deflates the filtered rows of a band.
+		 *
+		 * \param _bBand The band to compress.
+		 * \param _pui8Filtered The filtered buffer.
+		 * \param _sSettings Compression settings.
+		 * \param _bLast True for the last band, which finishes the deflate stream.
+		 **/
+		static void																				DeflateBand( SL2_BAND &_bBand, const uint8_t * _pui8Filtered, const SL2_SETTINGS &_sSettings, bool _bLast );
+
+		/**
+		 * Appends a chunk to a PNG file.
+		 *
+		 * \param _vOut The file to which to append the chunk.
+		 * \param _pcType The 4-character chunk type.
+		 * \param _pui8Data The chunk data.
+		 * \param _sSize The size of the chunk data.
+		 **/
+		static void																				AppendChunk( std::vector<uint8_t> &_vOut, const char * _pcType, const uint8_t * _pui8Data, size_t _sSize );
+
+		/**
+		 * Appends a big-endian 32-bit value.
+		 *
+		 * \param _vOut The buffer to which to append the value.
+		 * \param _ui32Val The value to append.
+		 **/
+		static inline void																		AppendBe32( std::vector<uint8_t> &_vOut, uint32_t _ui32Val ) {
+			_vOut.push_back( uint8_t( _ui32Val >> 24 ) );
+			_vOut.push_back( uint8_t( _ui32Val >> 16 ) );
+			_vOut.push_back( uint8_t( _ui32Val >> 8 ) );
+			_vOut.push_back( uint8_t( _ui32Val ) );
+		}
+	};
+
+}	// namespace sl2
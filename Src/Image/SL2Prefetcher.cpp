@@ -0,0 +1,138 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Reads, and optionally decodes, the next few input files on background threads while the current one is converted.
+ */
+
+#include "SL2Prefetcher.h"
+#include "../Files/SL2StdFile.h"
+#include "../Time/SL2Clock.h"
+
+#include <algorithm>
+#include <filesystem>
+
+
+namespace sl2 {
+
+	CPrefetcher::CPrefetcher( std::vector<SL2_INPUT> &_vInputs, size_t _sAhead, uint64_t _ui64MaxBytes, bool _bDecode ) :
+		m_vEntries( _vInputs.size() ),
+		m_sAhead( _sAhead ),
+		m_ui64MaxBytes( _ui64MaxBytes ),
+		m_bDecode( _bDecode ) {
+		for ( size_t I = 0; I < _vInputs.size(); ++I ) {
+			m_vEntries[I].iInput = _vInputs[I];
+		}
+		size_t sThreads = std::min<size_t>( std::min<size_t>( _sAhead, std::max<size_t>( std::thread::hardware_concurrency(), 1 ) ), m_vEntries.size() );
+		m_vThreads.reserve( sThreads );
+		for ( size_t T = 0; T < sThreads; ++T ) {
+			try {
+				m_vThreads.push_back( std::thread( PrefetchThread, this ) );
+			}
+			catch ( ... ) { break; }	// Inputs no thread reaches are loaded by Load().
+		}
+	}
+	CPrefetcher::~CPrefetcher() {
+		{
+			std::lock_guard<std::mutex> lgLock( m_mMutex );
+			m_bStop = true;
+		}
+		m_cvSignal.notify_all();
+		for ( auto & tThread : m_vThreads ) {
+			tThread.join();
+		}
+	}
+
+	// == Functions.
+	/**
+	 * Loads an input, waiting for it if it is being prefetched.  Inputs must be loaded in order.  _iImage should be set up as
+	 *	it would be for CImage::LoadFile(); prefetched files that were only read are decoded into it here.
+	 *
+	 * \param _sIdx The index of the input to load.
+	 * \param _iImage Holds the loaded image.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS CPrefetcher::Load( size_t _sIdx, CImage &_iImage ) {
+		if ( _sIdx >= m_vEntries.size() ) { return SL2_E_INVALIDCALL; }
+		SL2_ENTRY & eEntry = m_vEntries[_sIdx];
+		bool bStarted;
+		{
+			std::unique_lock<std::mutex> ulLock( m_mMutex );
+			bStarted = eEntry.sState != SL2_S_PENDING;
+			if ( bStarted ) {
+				++m_sPrefetched;
+				if ( eEntry.sState == SL2_S_LOADING ) {
+					CClock cClock;
+					m_cvSignal.wait( ulLock, [&]() { return eEntry.sState == SL2_S_DONE; } );
+					m_dWaitTime += (cClock.GetRealTick() - cClock.GetStartTick()) / double( cClock.GetResolution() );
+				}
+			}
+			else {
+				// The background threads have not reached it; they move on to the inputs after it.
+				m_sNext = std::max( m_sNext, _sIdx + 1 );
+			}
+			eEntry.sState = SL2_S_TAKEN;
+			m_sTaken = std::max( m_sTaken, _sIdx + 1 );
+			m_ui64Held -= eEntry.ui64Bytes;
+			eEntry.ui64Bytes = 0;
+		}
+		m_cvSignal.notify_all();
+
+		if ( bStarted && m_bDecode ) {
+			_iImage = std::move( eEntry.iImage );
+			return eEntry.eError;
+		}
+		if ( bStarted && eEntry.bRead ) {
+			std::vector<uint8_t> vData = std::move( eEntry.vData );
+			return _iImage.LoadFile( eEntry.iInput.u16Path.c_str(), vData );
+		}
+		// Failed reads are repeated here so that the error is the same as without prefetching.
+		return _iImage.LoadFile( eEntry.iInput.u16Path.c_str() );
+	}
+
+	/**
+	 * A background thread.  Starts inputs in order until told to stop.
+	 *
+	 * \param _ppThis The prefetcher.
+	 **/
+	void CPrefetcher::PrefetchThread( CPrefetcher * _ppThis ) {
+		std::unique_lock<std::mutex> ulLock( _ppThis->m_mMutex );
+		while ( true ) {
+			_ppThis->m_cvSignal.wait( ulLock, [&]() { return _ppThis->m_bStop || _ppThis->CanStart(); } );
+			if ( _ppThis->m_bStop ) { break; }
+
+			SL2_ENTRY & eEntry = _ppThis->m_vEntries[_ppThis->m_sNext++];
+			if ( eEntry.iInput.bSkip ) { continue; }
+			eEntry.sState = SL2_S_LOADING;
+			// Count the file against the budget while it is being loaded.
+			std::error_code ecError;
+			uint64_t ui64Estimate = std::filesystem::file_size( std::filesystem::path( eEntry.iInput.u16Path ), ecError );
+			if ( ecError ) { ui64Estimate = 0; }
+			_ppThis->m_ui64Held += ui64Estimate;
+			ulLock.unlock();
+
+			uint64_t ui64Bytes = 0;
+			if ( _ppThis->m_bDecode ) {
+				eEntry.iImage.SetYuvSize( eEntry.iInput.pkifdYuvFormat, eEntry.iInput.ui32YuvW, eEntry.iInput.ui32YuvH );
+				eEntry.eError = eEntry.iImage.LoadFile( eEntry.iInput.u16Path.c_str() );
+				for ( const auto & pMip : eEntry.iImage.GetMipmaps() ) {
+					ui64Bytes += pMip->size();
+				}
+			}
+			else if ( !eEntry.iInput.pkifdYuvFormat ) {
+				// YUV files are streamed by their loaders, so reading them here would only read them twice.
+				eEntry.bRead = CStdFile::LoadToMemory( eEntry.iInput.u16Path.c_str(), eEntry.vData );
+				if ( !eEntry.bRead ) { eEntry.vData = std::vector<uint8_t>(); }
+				ui64Bytes = eEntry.vData.size();
+			}
+
+			ulLock.lock();
+			_ppThis->m_ui64Held = _ppThis->m_ui64Held - ui64Estimate + ui64Bytes;
+			eEntry.ui64Bytes = ui64Bytes;
+			eEntry.sState = SL2_S_DONE;
+			_ppThis->m_cvSignal.notify_all();
+		}
+	}
+
+}	// namespace sl2
@@ -0,0 +1,157 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Reads, and optionally decodes, the next few input files on background threads while the current one is converted.
+ */
+
+#pragma once
+
+#include "SL2Image.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CPrefetcher
+	 * \brief Reads, and optionally decodes, the next few input files on background threads.
+	 *
+	 * Description: Reads, and optionally decodes, the next few input files on background threads while the current one is converted.
+	 *	Inputs are taken in order, no more than a given number ahead of the one last passed to Load(), and no new input is started
+	 *	while those held in memory exceed the memory budget.  An input that has not been started by the time it is needed is
+	 *	loaded by Load() itself.
+	 */
+	class CPrefetcher {
+	public :
+		// == Types.
+		/** An input file. */
+		struct SL2_INPUT {
+			std::u16string									u16Path;							/**< The path to the file. */
+			const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *	pkifdYuvFormat = nullptr;			/**< The YUV format passed to CImage::SetYuvSize(). */
+			uint32_t										ui32YuvW = 0;						/**< The YUV width passed to CImage::SetYuvSize(). */
+			uint32_t										ui32YuvH = 0;						/**< The YUV height passed to CImage::SetYuvSize(). */
+			bool											bSkip = false;						/**< If true, the input is not loaded through Load() and is not prefetched. */
+		};
+
+
+		CPrefetcher( std::vector<SL2_INPUT> &_vInputs, size_t _sAhead, uint64_t _ui64MaxBytes, bool _bDecode );
+		~CPrefetcher();
+
+
+		// == Functions.
+		/**
+		 * Loads an input, waiting for it if it is being prefetched.  Inputs must be loaded in order.  _iImage should be set up as
+		 *	it would be for CImage::LoadFile(); prefetched files that were only read are decoded into it here.
+		 *
+		 * \param _sIdx The index of the input to load.
+		 * \param _iImage Holds the loaded image.
+		 * \return Returns an error code.
+		 **/
+		SL2_ERRORS											Load( size_t _sIdx, CImage &_iImage );
+
+		/**
+		 * Gets the time Load() spent waiting for inputs still being prefetched.
+		 *
+		 * \return Returns the time spent waiting, in seconds.
+		 **/
+		inline double										WaitTime() const { return m_dWaitTime; }
+
+		/**
+		 * Gets the number of inputs that were ready, or being prefetched, by the time they were needed.
+		 *
+		 * \return Returns the number of prefetched inputs.
+		 **/
+		inline size_t										Prefetched() const { return m_sPrefetched; }
+
+
+	protected :
+		// == Enumerations.
+		/** The state of an input. */
+		enum SL2_STATE {
+			SL2_S_PENDING,																		/**< Not yet started. */
+			SL2_S_LOADING,																		/**< Being read or decoded by a background thread. */
+			SL2_S_DONE,																			/**< Read or decoded. */
+			SL2_S_TAKEN,																		/**< Passed to Load(). */
+		};
+
+
+		// == Types.
+		/** An input and what has been read from it. */
+		struct SL2_ENTRY {
+			SL2_INPUT										iInput;								/**< The input. */
+			SL2_STATE										sState = SL2_S_PENDING;				/**< How far along the input is. */
+			std::vector<uint8_t>							vData;								/**< The file, when only read. */
+			CImage											iImage;								/**< The image, when decoded. */
+			SL2_ERRORS										eError = SL2_E_SUCCESS;				/**< The result of decoding. */
+			bool											bRead = false;						/**< Set if vData holds the file. */
+			uint64_t										ui64Bytes = 0;						/**< The memory held for the input. */
+		};
+
+
+		// == Members.
+		/** The inputs. */
+		std::vector<SL2_ENTRY>								m_vEntries;
+
+		/** Guards everything below. */
+		std::mutex											m_mMutex;
+
+		/** Signalled when an input is started, finished, or taken, or when the threads are to stop. */
+		std::condition_variable								m_cvSignal;
+
+		/** The next input for a background thread to start. */
+		size_t												m_sNext = 0;
+
+		/** The number of inputs, starting from the first, that have been passed to Load(). */
+		size_t												m_sTaken = 0;
+
+		/** How far ahead of m_sTaken inputs can be started. */
+		size_t												m_sAhead;
+
+		/** The memory held by inputs that have not been taken. */
+		uint64_t											m_ui64Held = 0;
+
+		/** The size past which no new input is started. */
+		uint64_t											m_ui64MaxBytes;
+
+		/** If true, inputs are decoded on the background threads instead of only read. */
+		bool												m_bDecode;
+
+		/** Tells the background threads to stop. */
+		bool												m_bStop = false;
+
+		/** Time spent waiting in Load(). */
+		double												m_dWaitTime = 0.0;
+
+		/** Inputs that had been started by a background thread when they were needed. */
+		size_t												m_sPrefetched = 0;
+
+		/** The background threads. */
+		std::vector<std::thread>							m_vThreads;
+
+
+		// == Functions.
+		/**
+		 * A background thread.  Starts inputs in order until told to stop.
+		 *
+		 * \param _ppThis The prefetcher.
+		 **/
+		static void											PrefetchThread( CPrefetcher * _ppThis );
+
+		/**
+		 * Determines whether a background thread can start the next input.
+		 *
+		 * \return Returns true if an input is waiting within the read-ahead distance and the memory budget allows it.
+		 **/
+		inline bool											CanStart() const {
+			return m_sNext < m_vEntries.size() && m_sNext < m_sTaken + m_sAhead && (m_ui64Held < m_ui64MaxBytes || !m_ui64Held);
+		}
+	};
+
+}	// namespace sl2
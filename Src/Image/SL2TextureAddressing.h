@@ -64,7 +64,7 @@ namespace sl2 {
 			if ( (_i32Idx / _ui32TextureSize) % 2 == 0 ) {
 				return _i32Idx % _ui32TextureSize;
 			}
-			return _ui32TextureSize - (_i32Idx % _ui32TextureSize - 1);
+			return _ui32TextureSize - (_i32Idx % _ui32TextureSize) - 1;
 		}
 
 		/**
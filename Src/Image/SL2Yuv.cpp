@@ -0,0 +1,305 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Fast paths for the YUV formats.  Colour conversions are done with precomputed matrices a row at a time
+ *	and chroma planes are resampled with cached contribution lists.
+ */
+
+#include "SL2Yuv.h"
+#include "../Utilities/SL2Utilities.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+
+// The largest 32-bit sample, as used by the CFormat YUV routines.
+#define SL2_YUV_MAX32								4294967295.0
+// The scale from 32-bit samples to 8-bit-range values (2^(32-8)).
+#define SL2_YUV_MULT32								16777216.0
+
+namespace sl2 {
+
+	CYuv::CYuv() :
+		m_ui32SrcW( 0 ),
+		m_ui32SrcH( 0 ),
+		m_ui32DstW( 0 ),
+		m_ui32DstH( 0 ) {
+	}
+	CYuv::~CYuv() {
+	}
+
+	// == Functions.
+	/**
+	 * Creates the matrix used by YuvToRgbRow().  The matrix reproduces CFormat::YuvToRgb() with 32-bit samples.
+	 *
+	 * \param _dKr Kr.
+	 * \param _dKb Kb.
+	 * \param _dBlack The black level (0-1).
+	 * \param _dS The scale (0-1).
+	 * \return Returns the matrix mapping 32-bit YUV samples to RGB.
+	 **/
+	CYuv::SL2_YUV_MATRIX CYuv::DecodeMatrix( double _dKr, double _dKb, double _dBlack, double _dS ) {
+		// Same quantization of the options as the callers of CFormat::YuvToRgb().
+		double dZ = double( uint32_t( std::round( _dBlack * SL2_YUV_MAX32 ) ) ) / SL2_YUV_MAX32;
+		double dS = double( uint32_t( std::round( _dS * SL2_YUV_MAX32 ) ) ) / SL2_YUV_MAX32;
+
+		// L = Z + (S / 219) * (Y - 16)
+		// B = L + (U - 128) * (1 - Kb) * S / 112
+		// R = L + (V - 128) * (1 - Kr) * S / 112
+		// G = (L - Kr * R - Kb * B) / (1 - Kr - Kb) = L - (Kr * Cr / Kg) * (V - 128) - (Kb * Cb / Kg) * (U - 128)
+		double dL = dS / 219.0;
+		double dL0 = dZ - dL * 16.0;
+		double dCb = (1.0 - _dKb) * dS / 112.0;
+		double dCr = (1.0 - _dKr) * dS / 112.0;
+		double dKg = 1.0 - _dKr - _dKb;
+		double dGr = _dKr * dCr / dKg;
+		double dGb = _dKb * dCb / dKg;
+
+		constexpr double dInvMult = 1.0 / SL2_YUV_MULT32;
+		SL2_YUV_MATRIX ymRet = {
+			{
+				{ dL * dInvMult,	0.0,					dCr * dInvMult,			dL0 - 128.0 * dCr },
+				{ dL * dInvMult,	-dGb * dInvMult,		-dGr * dInvMult,		dL0 + 128.0 * (dGr + dGb) },
+				{ dL * dInvMult,	dCb * dInvMult,			0.0,					dL0 - 128.0 * dCb },
+			}
+		};
+		return ymRet;
+	}
+
+	/**
+	 * Creates the matrix used by RgbToYuvRow().  The matrix reproduces CFormat::RgbToYuv() with 32-bit samples.
+	 *
+	 * \param _dKr Kr.
+	 * \param _dKb Kb.
+	 * \param _dBlack The black level (0-1).
+	 * \param _dS The scale (0-1).
+	 * \return Returns the matrix mapping RGB to unrounded 32-bit YUV samples.
+	 **/
+	CYuv::SL2_YUV_MATRIX CYuv::EncodeMatrix( double _dKr, double _dKb, double _dBlack, double _dS ) {
+		double dZ = double( uint32_t( std::round( _dBlack * SL2_YUV_MAX32 ) ) ) / SL2_YUV_MAX32 * 255.0;
+		double dS = double( uint32_t( std::round( _dS * SL2_YUV_MAX32 ) ) ) / SL2_YUV_MAX32 * 255.0;
+		double dKg = 1.0 - _dKr - _dKb;
+		// L is computed with the original values, the denominators with the clamped ones.
+		double dKrD = std::min( _dKr, 1.0 - FLT_EPSILON );
+		double dKbD = std::min( _dKb, 1.0 - FLT_EPSILON );
+		dS = std::max( dS, double( FLT_EPSILON ) );
+
+		// Y = 2^24 * (219 * (L - Z) / S + 16)
+		// U = 2^24 * (112 * (B - L) / ((1 - Kb) * S) + 128)
+		// V = 2^24 * (112 * (R - L) / ((1 - Kr) * S) + 128)
+		double dY = SL2_YUV_MULT32 * 219.0 * 255.0 / dS;
+		double dU = SL2_YUV_MULT32 * 112.0 * 255.0 / ((1.0 - dKbD) * dS);
+		double dV = SL2_YUV_MULT32 * 112.0 * 255.0 / ((1.0 - dKrD) * dS);
+		SL2_YUV_MATRIX ymRet = {
+			{
+				{ dY * _dKr,		dY * dKg,				dY * _dKb,				SL2_YUV_MULT32 * (16.0 - 219.0 * dZ / dS) },
+				{ -dU * _dKr,		-dU * dKg,				dU * (1.0 - _dKb),		SL2_YUV_MULT32 * 128.0 },
+				{ dV * (1.0 - _dKr),-dV * dKg,				-dV * _dKb,				SL2_YUV_MULT32 * 128.0 },
+			}
+		};
+		return ymRet;
+	}
+
+	/**
+	 * Converts a row of normalized YUV samples to RGBA64F.  Alpha is set to 1.
+	 *
+	 * \param _pdY The normalized Y samples.
+	 * \param _pdU The normalized U samples.
+	 * \param _pdV The normalized V samples.
+	 * \param _pdRgba The output RGBA64F texels.
+	 * \param _sTotal The number of texels to convert.
+	 * \param _ymMatrix The matrix returned by DecodeMatrix().
+	 **/
+	void CYuv::YuvToRgbRow( const double * _pdY, const double * _pdU, const double * _pdV, double * _pdRgba, size_t _sTotal, const SL2_YUV_MATRIX &_ymMatrix ) {
+		const auto & mM = _ymMatrix.dM;
+#ifdef __AVX__
+		if ( CUtilities::IsAvxSupported() ) {
+			const __m256d mMax = _mm256_set1_pd( SL2_YUV_MAX32 );
+			const __m256d mHalf = _mm256_set1_pd( 0.5 );
+			const __m256d mZero = _mm256_setzero_pd();
+			const __m256d mOne = _mm256_set1_pd( 1.0 );
+			while ( _sTotal >= sizeof( __m256d ) / sizeof( double ) ) {
+				// Quantize to 32 bits.  Filtered chroma can overshoot, so clamp.
+				__m256d mY = _mm256_min_pd( _mm256_max_pd( _mm256_floor_pd( _mm256_add_pd( _mm256_mul_pd( _mm256_loadu_pd( _pdY ), mMax ), mHalf ) ), mZero ), mMax );
+				__m256d mU = _mm256_min_pd( _mm256_max_pd( _mm256_floor_pd( _mm256_add_pd( _mm256_mul_pd( _mm256_loadu_pd( _pdU ), mMax ), mHalf ) ), mZero ), mMax );
+				__m256d mV = _mm256_min_pd( _mm256_max_pd( _mm256_floor_pd( _mm256_add_pd( _mm256_mul_pd( _mm256_loadu_pd( _pdV ), mMax ), mHalf ) ), mZero ), mMax );
+
+				__m256d mRgb[3];
+				for ( size_t C = 0; C < 3; ++C ) {
+					mRgb[C] = _mm256_add_pd( _mm256_add_pd( _mm256_add_pd(
+						_mm256_mul_pd( mY, _mm256_set1_pd( mM[C][0] ) ),
+						_mm256_mul_pd( mU, _mm256_set1_pd( mM[C][1] ) ) ),
+						_mm256_mul_pd( mV, _mm256_set1_pd( mM[C][2] ) ) ),
+						_mm256_set1_pd( mM[C][3] ) );
+				}
+
+				// Transpose from RRRR GGGG BBBB AAAA to RGBA RGBA RGBA RGBA.
+				__m256d mRg0 = _mm256_unpacklo_pd( mRgb[0], mRgb[1] );		// R0 G0 R2 G2
+				__m256d mRg1 = _mm256_unpackhi_pd( mRgb[0], mRgb[1] );		// R1 G1 R3 G3
+				__m256d mBa0 = _mm256_unpacklo_pd( mRgb[2], mOne );			// B0 A0 B2 A2
+				__m256d mBa1 = _mm256_unpackhi_pd( mRgb[2], mOne );			// B1 A1 B3 A3
+				_mm256_storeu_pd( _pdRgba + 0, _mm256_permute2f128_pd( mRg0, mBa0, 0x20 ) );
+				_mm256_storeu_pd( _pdRgba + 4, _mm256_permute2f128_pd( mRg1, mBa1, 0x20 ) );
+				_mm256_storeu_pd( _pdRgba + 8, _mm256_permute2f128_pd( mRg0, mBa0, 0x31 ) );
+				_mm256_storeu_pd( _pdRgba + 12, _mm256_permute2f128_pd( mRg1, mBa1, 0x31 ) );
+
+				_pdY += sizeof( __m256d ) / sizeof( double );
+				_pdU += sizeof( __m256d ) / sizeof( double );
+				_pdV += sizeof( __m256d ) / sizeof( double );
+				_pdRgba += sizeof( __m256d ) / sizeof( double ) * 4;
+				_sTotal -= sizeof( __m256d ) / sizeof( double );
+			}
+		}
+#endif	// #ifdef __AVX__
+
+		while ( _sTotal-- ) {
+			double dY = std::clamp( std::floor( (*_pdY++) * SL2_YUV_MAX32 + 0.5 ), 0.0, SL2_YUV_MAX32 );
+			double dU = std::clamp( std::floor( (*_pdU++) * SL2_YUV_MAX32 + 0.5 ), 0.0, SL2_YUV_MAX32 );
+			double dV = std::clamp( std::floor( (*_pdV++) * SL2_YUV_MAX32 + 0.5 ), 0.0, SL2_YUV_MAX32 );
+			for ( size_t C = 0; C < 3; ++C ) {
+				_pdRgba[C] = dY * mM[C][0] + dU * mM[C][1] + dV * mM[C][2] + mM[C][3];
+			}
+			_pdRgba[3] = 1.0;
+			_pdRgba += 4;
+		}
+	}
+
+	/**
+	 * Converts a row of RGBA64F texels to normalized YUV samples.  The samples are quantized to 32 bits exactly as CFormat::RgbToYuv() does.
+	 *
+	 * \param _pdRgba The input RGBA64F texels.
+	 * \param _pdY The output normalized Y samples.
+	 * \param _pdU The output normalized U samples.
+	 * \param _pdV The output normalized V samples.
+	 * \param _sTotal The number of texels to convert.
+	 * \param _ymMatrix The matrix returned by EncodeMatrix().
+	 **/
+	void CYuv::RgbToYuvRow( const double * _pdRgba, double * _pdY, double * _pdU, double * _pdV, size_t _sTotal, const SL2_YUV_MATRIX &_ymMatrix ) {
+		const auto & mM = _ymMatrix.dM;
+#ifdef __AVX__
+		if ( CUtilities::IsAvxSupported() ) {
+			const __m256d mMax = _mm256_set1_pd( SL2_YUV_MAX32 );
+			const __m256d mHalf = _mm256_set1_pd( 0.5 );
+			const __m256d mZero = _mm256_setzero_pd();
+			while ( _sTotal >= sizeof( __m256d ) / sizeof( double ) ) {
+				// Transpose from RGBA RGBA RGBA RGBA to RRRR GGGG BBBB.
+				__m256d mP0 = _mm256_loadu_pd( _pdRgba + 0 );
+				__m256d mP1 = _mm256_loadu_pd( _pdRgba + 4 );
+				__m256d mP2 = _mm256_loadu_pd( _pdRgba + 8 );
+				__m256d mP3 = _mm256_loadu_pd( _pdRgba + 12 );
+				__m256d mRb0 = _mm256_unpacklo_pd( mP0, mP1 );				// R0 R1 B0 B1
+				__m256d mGa0 = _mm256_unpackhi_pd( mP0, mP1 );				// G0 G1 A0 A1
+				__m256d mRb1 = _mm256_unpacklo_pd( mP2, mP3 );				// R2 R3 B2 B3
+				__m256d mGa1 = _mm256_unpackhi_pd( mP2, mP3 );				// G2 G3 A2 A3
+				__m256d mR = _mm256_permute2f128_pd( mRb0, mRb1, 0x20 );
+				__m256d mG = _mm256_permute2f128_pd( mGa0, mGa1, 0x20 );
+				__m256d mB = _mm256_permute2f128_pd( mRb0, mRb1, 0x31 );
+
+				double * pdOut[3] = { _pdY, _pdU, _pdV };
+				for ( size_t C = 0; C < 3; ++C ) {
+					__m256d mVal = _mm256_add_pd( _mm256_add_pd( _mm256_add_pd(
+						_mm256_mul_pd( mR, _mm256_set1_pd( mM[C][0] ) ),
+						_mm256_mul_pd( mG, _mm256_set1_pd( mM[C][1] ) ) ),
+						_mm256_mul_pd( mB, _mm256_set1_pd( mM[C][2] ) ) ),
+						_mm256_set1_pd( mM[C][3] ) );
+					mVal = _mm256_min_pd( _mm256_max_pd( _mm256_floor_pd( _mm256_add_pd( mVal, mHalf ) ), mZero ), mMax );
+					_mm256_storeu_pd( pdOut[C], _mm256_div_pd( mVal, mMax ) );
+				}
+
+				_pdRgba += sizeof( __m256d ) / sizeof( double ) * 4;
+				_pdY += sizeof( __m256d ) / sizeof( double );
+				_pdU += sizeof( __m256d ) / sizeof( double );
+				_pdV += sizeof( __m256d ) / sizeof( double );
+				_sTotal -= sizeof( __m256d ) / sizeof( double );
+			}
+		}
+#endif	// #ifdef __AVX__
+
+		while ( _sTotal-- ) {
+			double * pdOut[3] = { _pdY++, _pdU++, _pdV++ };
+			for ( size_t C = 0; C < 3; ++C ) {
+				double dVal = _pdRgba[0] * mM[C][0] + _pdRgba[1] * mM[C][1] + _pdRgba[2] * mM[C][2] + mM[C][3];
+				(*pdOut[C]) = std::clamp( std::floor( dVal + 0.5 ), 0.0, SL2_YUV_MAX32 ) / SL2_YUV_MAX32;
+			}
+			_pdRgba += 4;
+		}
+	}
+
+	/**
+	 * Prepares the chroma resampler.  The contribution lists are created once here and reused by every call to ResampleChroma().
+	 *
+	 * \param _ui32SrcW The width of the source chroma plane.
+	 * \param _ui32SrcH The height of the source chroma plane.
+	 * \param _ui32DstW The width of the destination chroma plane.
+	 * \param _ui32DstH The height of the destination chroma plane.
+	 * \return Returns true if all allocations succeeded.
+	 **/
+	bool CYuv::SetChromaSize( uint32_t _ui32SrcW, uint32_t _ui32SrcH, uint32_t _ui32DstW, uint32_t _ui32DstH ) {
+		m_ui32SrcW = std::max( 1U, _ui32SrcW );
+		m_ui32SrcH = std::max( 1U, _ui32SrcH );
+		m_ui32DstW = std::max( 1U, _ui32DstW );
+		m_ui32DstH = std::max( 1U, _ui32DstH );
+		const CResampler::SL2_FILTER & fFilter = CResampler::m_fFilter[CResampler::SL2_FF_CATMULLROM];
+		if ( !m_rW.CreateContribList( m_ui32SrcW, m_ui32DstW, SL2_TA_NULL_BORDER, fFilter.pfFunc, fFilter.dfSupport, 1.0f ) ) { return false; }
+		if ( !m_rH.CreateContribList( m_ui32SrcH, m_ui32DstH, SL2_TA_NULL_BORDER, fFilter.pfFunc, fFilter.dfSupport, 1.0f ) ) { return false; }
+		try {
+			m_vTmp.resize( size_t( m_ui32DstW ) * m_ui32SrcH );
+		}
+		catch ( ... ) { return false; }
+		return true;
+	}
+
+	/**
+	 * Resamples a chroma plane with a Catmull-Rom filter.  Matches CResampler::Resample_1Channel_2d() with a 0 border.
+	 *
+	 * \param _pdIn The source plane.
+	 * \param _pdOut The destination plane.
+	 **/
+	void CYuv::ResampleChroma( const double * _pdIn, double * _pdOut ) {
+		// Horizontal pass.  The taps are few (4 up, 8 down) so they are done directly rather than through a vectorized convolve.
+		const std::vector<CResampler::SL2_CONTRIBUTIONS> & vW = m_rW.Contributions();
+		for ( uint32_t H = 0; H < m_ui32SrcH; ++H ) {
+			const double * pdRow = _pdIn + size_t( H ) * m_ui32SrcW;
+			double * pdDst = m_vTmp.data() + size_t( H ) * m_ui32DstW;
+			for ( uint32_t W = 0; W < m_ui32DstW; ++W ) {
+				const CResampler::SL2_CONTRIBUTIONS & cContrib = vW[W];
+				const double * pdWeights = cContrib.dContributions.data();
+				const int32_t * pi32Idx = cContrib.i32Indices.data();
+				size_t sTaps = cContrib.dContributions.size();
+				double dSum = 0.0;
+				if ( cContrib.bInsideBounds ) {
+					const double * pdSrc = pdRow + pi32Idx[0];
+					for ( size_t I = 0; I < sTaps; ++I ) {
+						dSum += pdWeights[I] * pdSrc[I];
+					}
+				}
+				else {
+					for ( size_t I = 0; I < sTaps; ++I ) {
+						// -1 is the border, which is 0.
+						if ( pi32Idx[I] >= 0 ) { dSum += pdWeights[I] * pdRow[pi32Idx[I]]; }
+					}
+				}
+				pdDst[W] = dSum;
+			}
+		}
+
+		// Vertical pass, a row at a time.
+		const std::vector<CResampler::SL2_CONTRIBUTIONS> & vH = m_rH.Contributions();
+		for ( uint32_t H = 0; H < m_ui32DstH; ++H ) {
+			double * pdDst = _pdOut + size_t( H ) * m_ui32DstW;
+			std::memset( pdDst, 0, sizeof( double ) * m_ui32DstW );
+			const CResampler::SL2_CONTRIBUTIONS & cContrib = vH[H];
+			for ( size_t I = 0; I < cContrib.dContributions.size(); ++I ) {
+				if ( cContrib.i32Indices[I] >= 0 ) {
+					CResampler::AddWeightedRow( pdDst, m_vTmp.data() + size_t( cContrib.i32Indices[I] ) * m_ui32DstW, cContrib.dContributions[I], m_ui32DstW );
+				}
+			}
+		}
+	}
+
+}	// namespace sl2
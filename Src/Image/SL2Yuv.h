@@ -0,0 +1,128 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Fast paths for the YUV formats.  Colour conversions are done with precomputed matrices a row at a time
+ *	and chroma planes are resampled with cached contribution lists.
+ */
+
+
+#pragma once
+
+#include "../OS/SL2Os.h"
+#include "../Utilities/SL2AlignmentAllocator.h"
+#include "../Utilities/SL2Resampler.h"
+
+#include <cstdint>
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CYuv
+	 * \brief Fast paths for the YUV formats.
+	 *
+	 * Description: Fast paths for the YUV formats.  Colour conversions are done with precomputed matrices a row at a time
+	 *	and chroma planes are resampled with cached contribution lists.
+	 */
+	class CYuv {
+	public :
+		CYuv();
+		~CYuv();
+
+
+		// == Types.
+		/** Precomputed conversion coefficients.  Output channel C is dM[C][0]*In0 + dM[C][1]*In1 + dM[C][2]*In2 + dM[C][3]. */
+		struct SL2_YUV_MATRIX {
+			double												dM[3][4];
+		};
+
+
+		// == Functions.
+		/**
+		 * Creates the matrix used by YuvToRgbRow().  The matrix reproduces CFormat::YuvToRgb() with 32-bit samples.
+		 *
+		 * \param _dKr Kr.
+		 * \param _dKb Kb.
+		 * \param _dBlack The black level (0-1).
+		 * \param _dS The scale (0-1).
+		 * \return Returns the matrix mapping 32-bit YUV samples to RGB.
+		 **/
+		static SL2_YUV_MATRIX									DecodeMatrix( double _dKr, double _dKb, double _dBlack, double _dS );
+
+		/**
+		 * Creates the matrix used by RgbToYuvRow().  The matrix reproduces CFormat::RgbToYuv() with 32-bit samples.
+		 *
+		 * \param _dKr Kr.
+		 * \param _dKb Kb.
+		 * \param _dBlack The black level (0-1).
+		 * \param _dS The scale (0-1).
+		 * \return Returns the matrix mapping RGB to unrounded 32-bit YUV samples.
+		 **/
+		static SL2_YUV_MATRIX									EncodeMatrix( double _dKr, double _dKb, double _dBlack, double _dS );
+
+		/**
+		 * Converts a row of normalized YUV samples to RGBA64F.  Alpha is set to 1.
+		 *
+		 * \param _pdY The normalized Y samples.
+		 * \param _pdU The normalized U samples.
+		 * \param _pdV The normalized V samples.
+		 * \param _pdRgba The output RGBA64F texels.
+		 * \param _sTotal The number of texels to convert.
+		 * \param _ymMatrix The matrix returned by DecodeMatrix().
+		 **/
+		static void												YuvToRgbRow( const double * _pdY, const double * _pdU, const double * _pdV, double * _pdRgba, size_t _sTotal, const SL2_YUV_MATRIX &_ymMatrix );
+
+		/**
+		 * Converts a row of RGBA64F texels to normalized YUV samples.  The samples are quantized to 32 bits exactly as CFormat::RgbToYuv() does.
+		 *
+		 * \param _pdRgba The input RGBA64F texels.
+		 * \param _pdY The output normalized Y samples.
+		 * \param _pdU The output normalized U samples.
+		 * \param _pdV The output normalized V samples.
+		 * \param _sTotal The number of texels to convert.
+		 * \param _ymMatrix The matrix returned by EncodeMatrix().
+		 **/
+		static void												RgbToYuvRow( const double * _pdRgba, double * _pdY, double * _pdU, double * _pdV, size_t _sTotal, const SL2_YUV_MATRIX &_ymMatrix );
+
+		/**
+		 * Prepares the chroma resampler.  The contribution lists are created once here and reused by every call to ResampleChroma().
+		 *
+		 * \param _ui32SrcW The width of the source chroma plane.
+		 * \param _ui32SrcH The height of the source chroma plane.
+		 * \param _ui32DstW The width of the destination chroma plane.
+		 * \param _ui32DstH The height of the destination chroma plane.
+		 * \return Returns true if all allocations succeeded.
+		 **/
+		bool													SetChromaSize( uint32_t _ui32SrcW, uint32_t _ui32SrcH, uint32_t _ui32DstW, uint32_t _ui32DstH );
+
+		/**
+		 * Resamples a chroma plane with a Catmull-Rom filter.  Matches CResampler::Resample_1Channel_2d() with a 0 border.
+		 *
+		 * \param _pdIn The source plane.
+		 * \param _pdOut The destination plane.
+		 **/
+		void													ResampleChroma( const double * _pdIn, double * _pdOut );
+
+
+	protected :
+		// == Members.
+		/** The horizontal contributions. */
+		CResampler												m_rW;
+		/** The vertical contributions. */
+		CResampler												m_rH;
+		/** The horizontally resampled plane. */
+		std::vector<double, CAlignmentAllocator<double, 64>>	m_vTmp;
+		/** The source chroma width. */
+		uint32_t												m_ui32SrcW;
+		/** The source chroma height. */
+		uint32_t												m_ui32SrcH;
+		/** The destination chroma width. */
+		uint32_t												m_ui32DstW;
+		/** The destination chroma height. */
+		uint32_t												m_ui32DstH;
+	};
+
+}	// namespace sl2
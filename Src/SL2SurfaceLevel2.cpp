@@ -12,14 +12,23 @@
 #include "Files/SL2StdFile.h"
 #include "Image/detex/misc.h"
 #include "Image/DDS/SL2Dds.h"
+#include "Image/SL2ColorDistance.h"
 #include "Image/SL2Image.h"
 #include "Image/SL2KtxTexture.h"
+#include "Image/SL2PaletteCache.h"
+#include "Image/SL2Yuv.h"
+#include "Thread/SL2ParallelFor.h"
 #include "Time/SL2Clock.h"
 #include "Utilities/SL2Stream.h"
+#include "Utilities/SL2TransferLut.h"
 
+#include <atomic>
 #include <filesystem>
 #include <format>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <thread>
 
 void FreeImageErrorHandler(FREE_IMAGE_FORMAT fif, const char* message) {
 	std::cerr << "FreeImage error: " << message << std::endl;
@@ -33,6 +42,8 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
     ::FreeImage_SetOutputMessage( ::FreeImageErrorHandler );
     sl2::CFormat::Init();
     sl2::SL2_OPTIONS oOptions;
+	std::unique_ptr<sl2::CPrefetcher> pPrefetcher;
+	std::unique_ptr<sl2::CWriteBehind> pWriteBehind;
 
     /*double dVal = 0.0;
     while ( dVal <= 1.0 ) {
@@ -42,7 +53,17 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
     }*/
 
 #define SL2_ERRORT( TXT, CODE )					sl2::PrintError( reinterpret_cast<const char16_t *>(TXT), (CODE) );						\
+												if ( pWriteBehind ) {                                                                   \
+													/* Files queued before the error are still written. */                              \
+													std::u16string u16WriteFailed;                                                      \
+													if ( !pWriteBehind->Finish( u16WriteFailed ) ) {                                    \
+														u16WriteFailed = u"Failed to save file: \"" + u16WriteFailed + u"\".";          \
+														sl2::PrintError( u16WriteFailed.c_str(), sl2::SL2_E_FILEWRITEERROR );           \
+													}                                                                                   \
+												}                                                                                       \
 												if ( oOptions.bPause ) { ::system( "pause" ); }	                                        \
+												pPrefetcher.reset();                                                                    \
+												pWriteBehind.reset();                                                                   \
 												::FreeImage_DeInitialise();                                                             \
 												::detexFreeErrorMessage();                                                              \
 												return int( CODE )
@@ -120,6 +141,26 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 				catch ( ... ) { SL2_ERROR( sl2::SL2_E_OUTOFMEMORY ); }
 				SL2_ADV( 4 );
 			}
+			if ( SL2_CHECK( 2, yuv_frames ) ) {
+				if ( !oOptions.vInputs.size() || oOptions.vInputs.back().bFromClipBoard ) {
+					SL2_ERRORT( L"\"yuv_frames\" must follow a \"yuv_file\" command.", sl2::SL2_E_INVALIDCALL );
+				}
+				oOptions.vInputs.back().bYuvStream = true;
+				oOptions.vInputs.back().ui32YuvFrames = uint32_t( ::_wtoi( _wcpArgV[1] ) );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, yuv_frames_in_flight ) ) {
+				oOptions.ui32YuvFramesInFlight = uint32_t( ::_wtoi( _wcpArgV[1] ) );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, export_threads ) ) {
+				oOptions.ui32ExportThreads = uint32_t( ::_wtoi( _wcpArgV[1] ) );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 1, yuv_concat ) || SL2_CHECK( 1, yuv_concatenate ) ) {
+				oOptions.bYuvConcatenate = true;
+				SL2_ADV( 1 );
+			}
 			if ( SL2_CHECK( 1, from_clipboard ) || SL2_CHECK( 1, from_cb ) || SL2_CHECK( 1, clipboard_in ) || SL2_CHECK( 1, cb_in ) ) {
 				try {
 					sl2::SL2_OPEN_FILE ofFile = { .bFromClipBoard = true };
@@ -532,6 +573,12 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 				sl2::CFormat::PrintFormats_List();
 				SL2_ADV( 1 );
 			}
+			if ( SL2_CHECK( 1, selftest ) || SL2_CHECK( 1, self_test ) ) {
+				if ( !sl2::SelfTest() ) {
+					SL2_ERRORT( L"Self-test failed.", sl2::SL2_E_INTERNALERROR );
+				}
+				SL2_ADV( 1 );
+			}
             
 			if ( SL2_CHECK( 2, format ) ) {
 				std::string sString = sl2::CUtilities::Utf16ToUtf8( reinterpret_cast<const char16_t *>((_wcpArgV[1])) );
@@ -857,6 +904,32 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 				oOptions.ui32ClampD = ::_wtoi( _wcpArgV[3] );
 				SL2_ADV( 4 );
 			}
+			if ( SL2_CHECK( 1, scaled_decode ) ) {
+				oOptions.bScaledDecode = true;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 2, prefetch ) ) {
+				oOptions.sPrefetch = size_t( std::max( ::_wtoi( _wcpArgV[1] ), 0 ) );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 1, prefetch_decode ) ) {
+				oOptions.bPrefetchDecode = true;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 1, write_behind ) ) {
+				oOptions.bWriteBehind = true;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 2, io_memory ) ) {
+				// In MiB.
+				oOptions.ui64IoMemory = ::_wcstoui64( _wcpArgV[1], nullptr, 0 ) * 1024ULL * 1024ULL;
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, lazy_decode ) ) {
+				oOptions.bLazyDecode = true;
+				oOptions.sLazySurfaces = size_t( std::max( ::_wtoi( _wcpArgV[1] ), 0 ) );
+				SL2_ADV( 2 );
+			}
 
 			if ( SL2_CHECK( 2, textureaddressing ) || SL2_CHECK( 2, ta ) ) {
 				if ( ::_wcsicmp( _wcpArgV[1], L"clamp" ) == 0 ) {
@@ -1309,6 +1382,74 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 				sl2::CFormat::m_skMeansIterations = ::_wtoi( _wcpArgV[1] );
 				SL2_ADV( 2 );
 			}
+			if ( SL2_CHECK( 2, gen_pal_seed ) ) {
+				sl2::CFormat::m_ui64kMeansSeed = ::_wcstoui64( _wcpArgV[1], nullptr, 0 );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, gen_pal_method ) ) {
+				if ( ::_wcsicmp( _wcpArgV[1], L"kmeans" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"k-means" ) == 0 ) {
+					sl2::CFormat::m_pmPaletteMethod = sl2::SL2_PM_KMEANS;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"wu" ) == 0 ) {
+					sl2::CFormat::m_pmPaletteMethod = sl2::SL2_PM_WU;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"median_cut" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"mediancut" ) == 0 ) {
+					sl2::CFormat::m_pmPaletteMethod = sl2::SL2_PM_MEDIAN_CUT;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"octree" ) == 0 ) {
+					sl2::CFormat::m_pmPaletteMethod = sl2::SL2_PM_OCTREE;
+				}
+				else {
+					SL2_ERRORT( std::format( L"Invalid \"gen_pal_method\": \"{}\". Must be kmeans, wu, median_cut or octree.",
+						_wcpArgV[1] ).c_str(), sl2::SL2_E_INVALIDCALL );
+				}
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, gen_pal_refine ) ) {
+				sl2::CFormat::m_sPaletteRefineIterations = ::_wtoi( _wcpArgV[1] );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 1, shared_pal ) || SL2_CHECK( 1, shared_palette ) ) {
+				oOptions.bSharedPalette = true;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 2, pal_cache ) ) {
+				sl2::CPaletteCache::m_pDirectory = std::filesystem::path( _wcpArgV[1] );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, pal_cache_size ) ) {
+				// In MiB.
+				sl2::CPaletteCache::m_ui64MaxBytes = ::_wcstoui64( _wcpArgV[1], nullptr, 0 ) * 1024ULL * 1024ULL;
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, pal_distance ) ) {
+				if ( ::_wcsicmp( _wcpArgV[1], L"default" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_DEFAULT;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"rgb" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_RGB;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"weighted_rgb" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"luma" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_WEIGHTED_RGB;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"oklab" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_OKLAB;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"cie76" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_CIE76;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"cie94" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_CIE94;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"ciede2000" ) == 0 ) {
+					sl2::CFormat::m_cdColorDistance = sl2::SL2_CD_CIEDE2000;
+				}
+				else {
+					SL2_ERRORT( std::format( L"Invalid \"pal_distance\": \"{}\". Must be default, rgb, weighted_rgb, oklab, cie76, cie94 or ciede2000.",
+						_wcpArgV[1] ).c_str(), sl2::SL2_E_INVALIDCALL );
+				}
+				SL2_ADV( 2 );
+			}
 			if ( SL2_CHECK( 2, pal_dither ) ) {
 				if ( ::_wcsicmp( _wcpArgV[1], L"floyd" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"floyd-steinburg" ) == 0 ) {
 					sl2::CFormat::m_dDither = sl2::SL2_D_FLOYD_STEINBERG;
@@ -1340,8 +1481,14 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 				else if ( ::_wcsicmp( _wcpArgV[1], L"bayer8" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"bayer8x8" ) == 0 ) {
 					sl2::CFormat::m_dDither = sl2::SL2_D_BAYER_8X8;
 				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"bayer16" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"bayer16x16" ) == 0 ) {
+					sl2::CFormat::m_dDither = sl2::SL2_D_BAYER_16X16;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"bluenoise" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"blue_noise" ) == 0 ) {
+					sl2::CFormat::m_dDither = sl2::SL2_D_BLUE_NOISE;
+				}
 				else {
-					SL2_ERRORT( std::format( L"Invalid \"pal_dither\": \"{}\". Must be floyd, jjn, stucki, burkes, sierra, sierra2row, sierralite, atkinson, bayer4 or bayer8.",
+					SL2_ERRORT( std::format( L"Invalid \"pal_dither\": \"{}\". Must be floyd, jjn, stucki, burkes, sierra, sierra2row, sierralite, atkinson, bayer4, bayer8, bayer16 or bluenoise.",
 						_wcpArgV[1] ).c_str(), sl2::SL2_E_INVALIDCALL );
 				}
 				SL2_ADV( 2 );
@@ -1456,6 +1603,57 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 				oOptions.iPngSaveOption |= PNG_INTERLACED;
 				SL2_ADV( 1 );
 			}
+			if ( SL2_CHECK( 2, png_filter ) ) {
+				if ( ::_wcsicmp( _wcpArgV[1], L"adaptive" ) == 0 ) {
+					oOptions.psPngSettings.fFilter = sl2::CPngWriter::SL2_F_ADAPTIVE;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"none" ) == 0 ) {
+					oOptions.psPngSettings.fFilter = sl2::CPngWriter::SL2_F_NONE;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"sub" ) == 0 ) {
+					oOptions.psPngSettings.fFilter = sl2::CPngWriter::SL2_F_SUB;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"up" ) == 0 ) {
+					oOptions.psPngSettings.fFilter = sl2::CPngWriter::SL2_F_UP;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"average" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"avg" ) == 0 ) {
+					oOptions.psPngSettings.fFilter = sl2::CPngWriter::SL2_F_AVERAGE;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"paeth" ) == 0 ) {
+					oOptions.psPngSettings.fFilter = sl2::CPngWriter::SL2_F_PAETH;
+				}
+				else {
+					SL2_ERRORT( std::format( L"Invalid \"png_filter\": \"{}\". Must be adaptive, none, sub, up, average or paeth.",
+						_wcpArgV[1] ).c_str(), sl2::SL2_E_INVALIDCALL );
+				}
+				oOptions.bPngWriter = true;
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, png_strategy ) ) {
+				if ( ::_wcsicmp( _wcpArgV[1], L"default" ) == 0 ) {
+					oOptions.psPngSettings.sStrategy = sl2::CPngWriter::SL2_S_DEFAULT;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"filtered" ) == 0 ) {
+					oOptions.psPngSettings.sStrategy = sl2::CPngWriter::SL2_S_FILTERED;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"rle" ) == 0 ) {
+					oOptions.psPngSettings.sStrategy = sl2::CPngWriter::SL2_S_RLE;
+				}
+				else if ( ::_wcsicmp( _wcpArgV[1], L"huffman" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"huffman_only" ) == 0 ) {
+					oOptions.psPngSettings.sStrategy = sl2::CPngWriter::SL2_S_HUFFMAN;
+				}
+				else {
+					SL2_ERRORT( std::format( L"Invalid \"png_strategy\": \"{}\". Must be default, filtered, rle or huffman.",
+						_wcpArgV[1] ).c_str(), sl2::SL2_E_INVALIDCALL );
+				}
+				oOptions.bPngWriter = true;
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 2, png_threads ) ) {
+				oOptions.psPngSettings.ui32Threads = uint32_t( std::max( ::_wtoi( _wcpArgV[1] ), 0 ) );
+				oOptions.bPngWriter = true;
+				SL2_ADV( 2 );
+			}
 			if ( SL2_CHECK( 2, png_format ) ) {
 				if ( ::_wcsicmp( _wcpArgV[1], L"RGB24" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"RGB" ) == 0 || ::_wcsicmp( _wcpArgV[1], L"R8G8B8" ) == 0 ) {
 					oOptions.pkifdPngFormat = sl2::CFormat::FindFormatDataByVulkan( sl2::SL2_VK_FORMAT_R8G8B8_UNORM );
@@ -1590,32 +1788,67 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 
 			if ( SL2_CHECK( 1, exr_float ) ) {
 				oOptions.iExrSaveOption |= EXR_FLOAT;
+				oOptions.esExrSettings.bFloat = true;
 				SL2_ADV( 1 );
 			}
 			if ( SL2_CHECK( 1, exr_none ) || SL2_CHECK( 1, exr_nocompression ) ) {
 				oOptions.iExrSaveOption |= EXR_NONE;
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_NONE;
 				SL2_ADV( 1 );
 			}
 			if ( SL2_CHECK( 1, exr_zip ) ) {
 				oOptions.iExrSaveOption |= EXR_ZIP;
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_ZIP;
 				SL2_ADV( 1 );
 			}
 			if ( SL2_CHECK( 1, exr_piz ) ) {
 				oOptions.iExrSaveOption |= EXR_PIZ;
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_PIZ;
 				SL2_ADV( 1 );
 			}
 			if ( SL2_CHECK( 1, exr_pxr24 ) ) {
 				oOptions.iExrSaveOption |= EXR_PXR24;
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_PXR24;
 				SL2_ADV( 1 );
 			}
 			if ( SL2_CHECK( 1, exr_b44 ) ) {
 				oOptions.iExrSaveOption |= EXR_B44;
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_B44;
 				SL2_ADV( 1 );
 			}
 			if ( SL2_CHECK( 1, exr_lc ) ) {
 				oOptions.iExrSaveOption |= EXR_LC;
 				SL2_ADV( 1 );
 			}
+			if ( SL2_CHECK( 1, exr_rle ) ) {
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_RLE;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 1, exr_zips ) ) {
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_ZIPS;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 1, exr_b44a ) ) {
+				oOptions.esExrSettings.cCompression = sl2::CExr::SL2_C_B44A;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 2, exr_tiled ) ) {
+				int iSize = ::_wtoi( _wcpArgV[1] );
+				if ( iSize < 1 || iSize > 4096 ) {
+					SL2_ERRORT( std::format( L"Invalid \"exr_tiled\": \"{}\". Must be between 1 and 4096.",
+						_wcpArgV[1] ).c_str(), sl2::SL2_E_INVALIDCALL );
+				}
+				oOptions.esExrSettings.ui32TileSize = uint32_t( iSize );
+				SL2_ADV( 2 );
+			}
+			if ( SL2_CHECK( 1, exr_mipmaps ) ) {
+				oOptions.bExrMipmaps = true;
+				SL2_ADV( 1 );
+			}
+			if ( SL2_CHECK( 2, exr_threads ) ) {
+				oOptions.ui32ExrThreads = uint32_t( std::max( ::_wtoi( _wcpArgV[1] ), 0 ) );
+				SL2_ADV( 2 );
+			}
 
 			if ( SL2_CHECK( 2, j2k_comp ) || SL2_CHECK( 2, j2k_compression ) ) {
 				oOptions.iJ2kSaveOption = ::_wtoi( _wcpArgV[1] );
@@ -2285,8 +2518,55 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 #undef SL2_ADV
 #undef SL2_CHECK
 
+	sl2::CExr::SetThreads( oOptions.ui32ExrThreads );
+	if ( oOptions.bWriteBehind ) {
+		try {
+			pWriteBehind = std::make_unique<sl2::CWriteBehind>( oOptions.ui64IoMemory );
+			oOptions.pwbWriteBehind = pWriteBehind.get();
+		}
+		catch ( ... ) {}	// Files are written as they are exported instead.
+	}
+	if ( oOptions.sPrefetch ) {
+		try {
+			std::vector<sl2::CPrefetcher::SL2_INPUT> vPrefetch( oOptions.vInputs.size() );
+			for ( size_t I = 0; I < oOptions.vInputs.size(); ++I ) {
+				vPrefetch[I].u16Path = oOptions.vInputs[I].u16Path;
+				vPrefetch[I].pkifdYuvFormat = oOptions.vInputs[I].pkifduvFormat;
+				vPrefetch[I].ui32YuvW = oOptions.vInputs[I].ui32YuvW;
+				vPrefetch[I].ui32YuvH = oOptions.vInputs[I].ui32YuvH;
+				vPrefetch[I].bSkip = oOptions.vInputs[I].bYuvStream || oOptions.vInputs[I].bFromClipBoard;
+			}
+			// Scaled and lazy decoding depend on the options as they are set for each image, so those files are only read ahead.
+			pPrefetcher = std::make_unique<sl2::CPrefetcher>( vPrefetch, oOptions.sPrefetch, oOptions.ui64IoMemory,
+				oOptions.bPrefetchDecode && !oOptions.bScaledDecode && !oOptions.bLazyDecode );
+		}
+		catch ( ... ) {}	// Files are loaded as they are reached instead.
+	}
 	const sl2::CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * pkifdFormat = oOptions.pkifdFinalFormat;
 	for ( size_t I = 0; I < oOptions.vInputs.size(); ++I ) {
+		if ( oOptions.vInputs[I].bYuvStream ) {
+			sl2::CClock cClock;
+			uint64_t ui64Frames = 0;
+			// Applied here, as for other images, so that the codec settings are only read while the frames are converted.
+			if ( pkifdFormat ) {
+				sl2::CFormat::ApplySettings( pkifdFormat->ui8ABits != 0, pkifdFormat->ui32BlockWidth, pkifdFormat->ui32BlockHeight );
+			}
+			sl2::SL2_ERRORS eError = sl2::ConvertYuvFrames( oOptions.vInputs[I], oOptions.vOutputs[I], oOptions, pkifdFormat, ui64Frames );
+			if ( eError != sl2::SL2_E_SUCCESS ) {
+				SL2_ERRORT( std::format( L"Failed to convert YUV frames: \"{}\".",
+					reinterpret_cast<const wchar_t *>(oOptions.vInputs[I].u16Path.c_str()) ).c_str(), eError );
+			}
+			uint64_t ui64Time = cClock.GetRealTick() - cClock.GetStartTick();
+			if ( oOptions.bShowTime ) {
+				::printf( "Conversion time: %.13f seconds.\r\n", ui64Time / static_cast<double>(cClock.GetResolution()) );
+			}
+			auto sStr = std::format( L"Saved {} frames: \"{}\".\r\n", ui64Frames, reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) );
+			::OutputDebugStringW( sStr.c_str() );
+			::wprintf( sStr.c_str() );
+			continue;
+		}
+		// FixResampling() fills in the crop window and output size from the image, so each image starts from the options as given.
+		sl2::SL2_OPTIONS oImageOptions = oOptions;
 		sl2::CImage iImage;
         
 		iImage.SetYuvSize( oOptions.vInputs[I].pkifduvFormat, oOptions.vInputs[I].ui32YuvW, oOptions.vInputs[I].ui32YuvH );
@@ -2298,45 +2578,46 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 			}
 		}
 		else {
-			eError = iImage.LoadFile( oOptions.vInputs[I].u16Path.c_str() );
+			if ( oOptions.bScaledDecode ) {
+				iImage.SetDecodeSize( sl2::DecodeSize, &oImageOptions );
+			}
+			iImage.SetLazyDecode( oOptions.bLazyDecode, oOptions.sLazySurfaces );
+			eError = pPrefetcher ? pPrefetcher->Load( I, iImage ) : iImage.LoadFile( oOptions.vInputs[I].u16Path.c_str() );
 			if ( eError != sl2::SL2_E_SUCCESS ) {
 				SL2_ERRORT( std::format( L"Failed to load file: \"{}\".",
 					reinterpret_cast<const wchar_t *>(oOptions.vInputs[I].u16Path.c_str()) ).c_str(), eError );
 			}
+			char szLoader[128];
+			::sprintf_s( szLoader, "Loader-selection time: %.13f seconds (%u failed probes).\r\n", iImage.LoaderTime(), iImage.FailedProbes() );
+			::OutputDebugStringA( szLoader );
+			if ( oOptions.bShowTime ) {
+				::printf( "%s", szLoader );
+			}
+			if ( iImage.FullWidth() != iImage.Width() || iImage.FullHeight() != iImage.Height() ) {
+				::sprintf_s( szLoader, "Decoded at %ux%u instead of %ux%u.\r\n", iImage.Width(), iImage.Height(), iImage.FullWidth(), iImage.FullHeight() );
+				::OutputDebugStringA( szLoader );
+				if ( oOptions.bShowTime ) {
+					::printf( "%s", szLoader );
+				}
+			}
 		}
 		
-		iImage.SetCrop( oOptions.wCropWindow );
-		iImage.SetQuickRotate( oOptions.qrQuickRot );
-		FixResampling( oOptions, iImage );
-		iImage.Resampling() = oOptions.rResample;
-		iImage.MipResampling() = oOptions.rMipResample;
-		iImage.SetNeedsPreMultiply( oOptions.bNeedsPreMultiply );
-		iImage.SetIgnoreColorspaceGamma( oOptions.bIgnoreSourceColorspaceGamma );
-		if ( oOptions.bManuallySetGamma == true ) {
-			iImage.SetGamma( oOptions.dGamma );
-		}
-		if ( oOptions.bManuallySetTargetGamma == true ) {
-			iImage.SetTargetGamma( oOptions.dTargetGamma );
-		}
-		iImage.SetRenderingIntents( oOptions.i32InRenderingIntent, oOptions.i32OutRenderingIntent );
-		iImage.SetColorSpace( oOptions.cgcInputGammaCurve, oOptions.cgcOutputGammaCurve );
-		iImage.SetInputColorSpace( oOptions.vInColorProfile );
-		iImage.SetOutputColorSpace( oOptions.vOutColorProfile );
-		iImage.SetSwizzle( oOptions.sSwizzle );
-		iImage.SetSwap( oOptions.bSwap );
-		iImage.SetFlip( oOptions.bFlipX, oOptions.bFlipY, oOptions.bFlipZ );
-		iImage.SetMipParms( oOptions.mhMipHandling, oOptions.sTotalMips );
-		iImage.SetIgnoreAlpha( oOptions.bIgnoreAlpha );
-		iImage.SetNormalMapParms( oOptions.kKernel, oOptions.dNormalScale, oOptions.caChannelAccess, oOptions.dNormalYAxis );
-		oOptions.pkifdFinalFormat = pkifdFormat;
-		if ( !oOptions.pkifdFinalFormat ) {
-			oOptions.pkifdFinalFormat = iImage.Format();
-		}
-		sl2::CFormat::ApplySettings( oOptions.pkifdFinalFormat->ui8ABits != 0, oOptions.pkifdFinalFormat->ui32BlockWidth, oOptions.pkifdFinalFormat->ui32BlockHeight );
+		sl2::FixResampling( oImageOptions, iImage );
+		sl2::ApplyOptions( oImageOptions, iImage );
+		if ( !oImageOptions.pkifdFinalFormat ) {
+			oImageOptions.pkifdFinalFormat = iImage.Format();
+		}
+		sl2::CFormat::ApplySettings( oImageOptions.pkifdFinalFormat->ui8ABits != 0, oImageOptions.pkifdFinalFormat->ui32BlockWidth, oImageOptions.pkifdFinalFormat->ui32BlockHeight );
 		sl2::CImage iConverted;
 		sl2::CClock cClock;
-		iImage.ConvertToFormat( oOptions.pkifdFinalFormat, iConverted );
+		eError = iImage.ConvertToFormat( oImageOptions.pkifdFinalFormat, iConverted );
+		if ( sl2::SL2_E_SUCCESS != eError ) {
+			SL2_ERRORT( std::format( L"Failed to convert file: \"{}\".",
+				oOptions.vInputs[I].bFromClipBoard ? L"<clipboard>" : reinterpret_cast<const wchar_t *>(oOptions.vInputs[I].u16Path.c_str()) ).c_str(), eError );
+		}
 		uint64_t ui64Time = cClock.GetRealTick() - cClock.GetStartTick();
+		size_t sLazyDecodes = iImage.LazyDecodes();
+		size_t sSurfaces = iImage.Mipmaps() * iImage.ArraySize() * iImage.Faces();
 		iImage.Reset();
 		char szPrintfMe[128];
 		::sprintf_s( szPrintfMe, "Conversion time: %.13f seconds.\r\n", ui64Time / static_cast<double>(cClock.GetResolution()) );
@@ -2344,191 +2625,19 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 		if ( oOptions.bShowTime ) {
 			::printf( "Conversion time: %.13f seconds.\r\n", ui64Time / static_cast<double>(cClock.GetResolution()) );
 		}
-		cClock.SetStartingTick();
-#define SL2_CHECKEXT( EXT )     sl2::CFileBase::CmpFileExtension( oOptions.vOutputs[I], u ## #EXT )
-		if ( SL2_CHECKEXT( png ) || !oOptions.vOutputs[I].size() ) {
-			eError = sl2::ExportAsPng( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( bmp ) ) {
-			eError = sl2::ExportAsBmp( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( exr ) ) {
-			eError = sl2::ExportAsExr( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( j2k ) ) {
-			eError = sl2::ExportAsJ2k( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( jp2 ) ) {
-			eError = sl2::ExportAsJp2( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( jpg ) || SL2_CHECKEXT( jpeg ) ) {
-			eError = sl2::ExportAsJpg( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( dds ) ) {
-			eError = sl2::ExportAsDds( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( ktx ) ) {
-			eError = sl2::ExportAsKtx1( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( ktx2 ) || SL2_CHECKEXT( pvr ) || SL2_CHECKEXT( astc ) || SL2_CHECKEXT( h ) ) {
-			eError = sl2::ExportAsPvr( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( tga ) ) {
-			eError = sl2::ExportAsTga( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( pbm ) ) {
-			eError = sl2::ExportAsPbm( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
-		}
-		else if ( SL2_CHECKEXT( pgm ) ) {
-			eError = sl2::ExportAsPgm( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
+		if ( sLazyDecodes ) {
+			::sprintf_s( szPrintfMe, "Lazy decoding: %zu decodes of %zu surfaces.\r\n", sLazyDecodes, sSurfaces );
+			::OutputDebugStringA( szPrintfMe );
+			if ( oOptions.bShowTime ) {
+				::printf( "%s", szPrintfMe );
 			}
 		}
-		else if ( SL2_CHECKEXT( ico ) ) {
-			eError = sl2::ExportAsIco( iConverted, oOptions.vOutputs[I], oOptions );
-			if ( sl2::SL2_E_SUCCESS != eError ) {
-				SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
-					reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
-			}
+		cClock.SetStartingTick();
+		eError = sl2::ExportImage( iConverted, oOptions.vOutputs[I], oImageOptions );
+		if ( sl2::SL2_E_SUCCESS != eError ) {
+			SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
+				reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );
 		}
-#define SL2_YUV_FILE( FMT, EXT )                                                                                                                                \
-	else if ( ((oOptions.pkifdYuvFormat && oOptions.pkifdYuvFormat->vfVulkanFormat == sl2::SL2_ ## FMT && (SL2_CHECKEXT( EXT ) || SL2_CHECKEXT( yuv ))) ||      \
-		(!oOptions.pkifdYuvFormat && SL2_CHECKEXT( EXT ))) ) {                                                                                                  \
-		if ( !oOptions.pkifdYuvFormat ) { oOptions.pkifdYuvFormat = sl2::CFormat::FindFormatDataByVulkan( sl2::SL2_ ## FMT ); }                                 \
-		eError = sl2::ExportAsYuv( iConverted, oOptions.vOutputs[I], oOptions );                                                                                \
-		if ( sl2::SL2_E_SUCCESS != eError ) {                                                                                                                   \
-			SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",                                                                                           \
-				reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );                                                            \
-		}                                                                                                                                                       \
-	}
-		SL2_YUV_FILE( VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM, yuv444p16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16, yuv444p12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16, yuv444p10le )
-		SL2_YUV_FILE( VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM, yuv444p )
-
-		SL2_YUV_FILE( VK_FORMAT_G16_B16R16_2PLANE_444_UNORM, yuv444y16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_444_UNORM_3PACK16, yuv444y12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_444_UNORM_3PACK16, yuv444y10le )
-		SL2_YUV_FILE( VK_FORMAT_G8_B8R8_2PLANE_444_UNORM, yuv444y )
-
-		SL2_YUV_FILE( VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM, yuv422p16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16, yuv422p12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16, yuv422p10le )
-		SL2_YUV_FILE( VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM, yuv422p )
-
-		SL2_YUV_FILE( VK_FORMAT_G16_B16R16_2PLANE_422_UNORM, yuv422y16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16, yuv422y12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16, yuv422y10le )
-		SL2_YUV_FILE( VK_FORMAT_G8_B8R8_2PLANE_422_UNORM, yuv422y )
-
-		SL2_YUV_FILE( VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM, yuv420p16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16, yuv420p12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16, yuv420p10le )
-		SL2_YUV_FILE( VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM, yuv420p )
-
-		SL2_YUV_FILE( VK_FORMAT_G16_B16R16_2PLANE_420_UNORM, yuv420y16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16, yuv420y12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16, yuv420y10le )
-		SL2_YUV_FILE( VK_FORMAT_G8_B8R8_2PLANE_420_UNORM, yuv420y )
-
-		SL2_YUV_FILE( VK_FORMAT_G16B16G16R16_422_UNORM, yuyv16 )
-		SL2_YUV_FILE( VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16, yuyv12le )
-		SL2_YUV_FILE( VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16, yuyv10le )
-		SL2_YUV_FILE( VK_FORMAT_G8B8G8R8_422_UNORM, yuy2 )
-
-		SL2_YUV_FILE( VK_FORMAT_B16G16R16G16_422_UNORM, uyvy16 )
-		SL2_YUV_FILE( VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16, uyvy12le )
-		SL2_YUV_FILE( VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16, uyvy10le )
-		SL2_YUV_FILE( VK_FORMAT_B8G8R8G8_422_UNORM, uyvy )
-
-		SL2_YUV_FILE( VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16, yuva12le )
-		SL2_YUV_FILE( VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16, yuva10le )
-        
-#undef SL2_YUV_FILE
-
-#define SL2_YUV_FILE( FMT, EXT )                                                                                                                                \
-    else if ( ((oOptions.pkifdYuvFormat && oOptions.pkifdYuvFormat->dfDxFormat == sl2::SL2_ ## FMT && (SL2_CHECKEXT( EXT ) || SL2_CHECKEXT( yuv ))) ||          \
-        (!oOptions.pkifdYuvFormat && SL2_CHECKEXT( EXT ))) ) {                                                                                                  \
-        if ( !oOptions.pkifdYuvFormat ) { oOptions.pkifdYuvFormat = sl2::CFormat::FindFormatDataByDx( sl2::SL2_ ## FMT ); }                                     \
-        eError = sl2::ExportAsYuv( iConverted, oOptions.vOutputs[I], oOptions );                                                                                \
-        if ( sl2::SL2_E_SUCCESS != eError ) {                                                                                                                   \
-            SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",                                                                                           \
-                reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) ).c_str(), eError );                                                            \
-        }                                                                                                                                                       \
-    }
-
-        SL2_YUV_FILE( DXGI_FORMAT_P216, p216 )
-        SL2_YUV_FILE( DXGI_FORMAT_P210, p210 )
-        SL2_YUV_FILE( DXGI_FORMAT_P208, p208 )
-
-        SL2_YUV_FILE( DXGI_FORMAT_420_OPAQUE, yv12 )
-        SL2_YUV_FILE( DXGI_FORMAT_YV12, yv12 )
-
-        SL2_YUV_FILE( DXGI_FORMAT_P016, p016 )
-        SL2_YUV_FILE( DXGI_FORMAT_P010, p010 )
-        SL2_YUV_FILE( DXGI_FORMAT_NV12, nv12 )
-
-        SL2_YUV_FILE( DXGI_FORMAT_NV21, nv21 )
-
-        SL2_YUV_FILE( DXGI_FORMAT_Y216, y216 )
-        SL2_YUV_FILE( DXGI_FORMAT_Y210, y210 )
-        SL2_YUV_FILE( DXGI_FORMAT_G8R8_G8B8_UNORM, yuy2 )
-        SL2_YUV_FILE( DXGI_FORMAT_YUY2, yuy2 )
-
-        SL2_YUV_FILE( DXGI_FORMAT_R8G8_B8G8_UNORM, uyv2 )
-
-        SL2_YUV_FILE( DXGI_FORMAT_Y416, y416 )
-        SL2_YUV_FILE( DXGI_FORMAT_Y410, y410 )
-        SL2_YUV_FILE( DXGI_FORMAT_AYUV, ayuv )
-
-#undef SL2_YUV_FILE
-#undef SL2_CHECKEXT
         
 		ui64Time = cClock.GetRealTick() - cClock.GetStartTick();
 		::sprintf_s( szPrintfMe, "Save time: %.13f seconds.\r\n", ui64Time / static_cast<double>(cClock.GetResolution()) );
@@ -2536,10 +2645,58 @@ int wmain( int _iArgC, wchar_t const * _wcpArgV[] ) {
 		if ( oOptions.bShowTime ) {
 			::printf( "Save time: %.13f seconds.\r\n", ui64Time / static_cast<double>(cClock.GetResolution()) );
 		}
+		if ( iConverted.PaletteTime() || iConverted.IndexMapTime() ) {
+			// Included in the times above, but reported separately so that palette generation can be told apart from mapping.
+			::sprintf_s( szPrintfMe, "Palette time: %.13f seconds.\r\nIndex-map time: %.13f seconds.\r\n", iConverted.PaletteTime(), iConverted.IndexMapTime() );
+			::OutputDebugStringA( szPrintfMe );
+			if ( oOptions.bShowTime ) {
+				::printf( "Palette time: %.13f seconds.\r\nIndex-map time: %.13f seconds.\r\n", iConverted.PaletteTime(), iConverted.IndexMapTime() );
+			}
+		}
 		auto sStr = std::format( L"Saved file: \"{}\".\r\n", oOptions.vOutputs[I].size() ? reinterpret_cast<const wchar_t *>(oOptions.vOutputs[I].c_str()) : L"<clipboard>" );
 		::OutputDebugStringW( sStr.c_str() );
 		::wprintf( sStr.c_str() );
 	}
+	if ( pWriteBehind ) {
+		std::u16string u16Failed;
+		if ( !pWriteBehind->Finish( u16Failed ) ) {
+			pWriteBehind.reset();		// Already finished; SL2_ERRORT would report the same file again.
+			SL2_ERRORT( std::format( L"Failed to save file: \"{}\".",
+				reinterpret_cast<const wchar_t *>(u16Failed.c_str()) ).c_str(), sl2::SL2_E_FILEWRITEERROR );
+		}
+	}
+	if ( pPrefetcher ) {
+		auto sStr = std::format( L"Prefetch: {} of {} files ready ahead, wait time: {:.13f} seconds.\r\n",
+			pPrefetcher->Prefetched(), oOptions.vInputs.size(), pPrefetcher->WaitTime() );
+		::OutputDebugStringW( sStr.c_str() );
+		if ( oOptions.bShowTime ) {
+			::wprintf( sStr.c_str() );
+		}
+	}
+	if ( pWriteBehind ) {
+		auto sStr = std::format( L"Write-behind: write time: {:.13f} seconds, wait time: {:.13f} seconds.\r\n",
+			pWriteBehind->WriteTime(), pWriteBehind->WaitTime() );
+		::OutputDebugStringW( sStr.c_str() );
+		if ( oOptions.bShowTime ) {
+			::wprintf( sStr.c_str() );
+		}
+	}
+	if ( sl2::CPaletteCache::Enabled() ) {
+		uint64_t ui64Hits = sl2::CPaletteCache::Hits(), ui64Total = ui64Hits + sl2::CPaletteCache::Misses();
+		size_t sEvicted = sl2::CPaletteCache::Trim();
+		auto sStr = std::format( L"Palette cache: {} hits, {} misses ({:.1f}% hit rate), {} evicted.\r\n",
+			ui64Hits, ui64Total - ui64Hits, ui64Total ? ui64Hits * 100.0 / ui64Total : 0.0, sEvicted );
+		::OutputDebugStringW( sStr.c_str() );
+		::wprintf( sStr.c_str() );
+	}
+	if ( sl2::CExr::ReadTime() || sl2::CExr::WriteTime() ) {
+		auto sStr = std::format( L"OpenEXR: {} threads, read time: {:.13f} seconds, write time: {:.13f} seconds.\r\n",
+			sl2::CExr::Threads(), sl2::CExr::ReadTime(), sl2::CExr::WriteTime() );
+		::OutputDebugStringW( sStr.c_str() );
+		if ( oOptions.bShowTime ) {
+			::wprintf( sStr.c_str() );
+		}
+	}
 
 
 	SL2_ERROR( sl2::SL2_E_SUCCESS );
@@ -2640,49 +2797,313 @@ namespace sl2 {
 		}
 	}
 
-    /**
-	 * Fix up the resampling parameters.
+	/**
+	 * Runs the self-tests, which check the fast paths of the library against the exact or generic code they replace.  Each
+	 *	result is printed to the console.
 	 * 
-	 * \param _oOptions The options to fix up.
-     * \param _iImage The image off of which to base the adjustments.
+	 * \return Returns true if every test passed.
 	 **/
-	void FixResampling( SL2_OPTIONS &_oOptions, CImage &_iImage ) {
-		if ( _oOptions.ui32BakedW ) {
-			_oOptions.wCropWindow.i32X = -static_cast<int32_t>(_iImage.Width() * _oOptions.ui32BakedW);
-			_oOptions.wCropWindow.ui32W = (1 + _oOptions.ui32BakedW * 2) * _iImage.Width();
-		}
-		if ( _oOptions.ui32BakedH ) {
-			_oOptions.wCropWindow.i32Y = -static_cast<int32_t>(_iImage.Height() * _oOptions.ui32BakedH);
-			_oOptions.wCropWindow.ui32H = (1 + _oOptions.ui32BakedH * 2) * _iImage.Height();
-		}
-		if ( _oOptions.ui32BakedD ) {
-			_oOptions.wCropWindow.i32Z = -static_cast<int32_t>(_iImage.Depth() * _oOptions.ui32BakedD);
-			_oOptions.wCropWindow.ui32D = (1 + _oOptions.ui32BakedD * 2) * _iImage.Depth();
-		}
+	bool SelfTest() {
+		bool bPassed = true;
+		auto Report = [&]( const std::wstring &_wsName, double _dError, double _dAllowed ) {
+			// Written so that NaN fails.
+			bool bPass = _dError <= _dAllowed;
+			auto sStr = std::format( L"{}: {}: max error {:g} (allowed {:g}).\r\n", bPass ? L"Passed" : L"FAILED", _wsName, _dError, _dAllowed );
+			::OutputDebugStringW( sStr.c_str() );
+			::wprintf( sStr.c_str() );
+			bPassed = bPassed && bPass;
+		};
 
-		if ( !_oOptions.wCropWindow.ui32W ) {
-			_oOptions.wCropWindow.i32X = 0;
-			_oOptions.wCropWindow.ui32W = _iImage.Width();
-		}
-		if ( !_oOptions.wCropWindow.ui32H ) {
-			_oOptions.wCropWindow.i32Y = 0;
-			_oOptions.wCropWindow.ui32H = _iImage.Height();
+		// Transfer-function tables against the exact functions, at every 16-bit input and between the points Build() validated.  Invalid
+		//	tables call the exact function and so must match it exactly.
+		auto TestTable = [&]( const std::wstring &_wsName, const CTransferLut &_tlTable ) {
+			Report( std::format( L"{} table ({} intervals, {} exact, low {:g})", _wsName, _tlTable.Intervals(), _tlTable.ExactIntervals(), _tlTable.Low() ),
+				_tlTable.MaxError(), _tlTable.Valid() ? CTransferLut::m_dMaxError * 2.0 : 0.0 );
+		};
+		for ( size_t I = 0; I <= SL2_CGC_APPLE_ITU_BT_2020; ++I ) {
+			const CFormat::SL2_TRANSFER_FUNCS & tfFuncs = CFormat::TransferFunc( SL2_COLORSPACE_GAMMA_CURVES( I ) );
+			TestTable( std::format( L"{} to linear", tfFuncs.pwcDesc ), CTransferLut::Cached( tfFuncs.pfXtoLinear ) );
+			TestTable( std::format( L"Linear to {}", tfFuncs.pwcDesc ), CTransferLut::Cached( tfFuncs.pfLinearToX ) );
 		}
-		if ( !_oOptions.wCropWindow.ui32D ) {
-			_oOptions.wCropWindow.i32Z = 0;
-			_oOptions.wCropWindow.ui32D = _iImage.Depth();
+		TestTable( L"Gamma 1/2.2", CTransferLut::CachedPow( 1.0 / 2.2 ) );
+		TestTable( L"Gamma 2.2", CTransferLut::CachedPow( 2.2 ) );
+		{
+			// A different table per channel.
+			const CTransferLut & tlR = CTransferLut::Cached( CFormat::TransferFunc( SL2_CGC_sRGB_PRECISE ).pfXtoLinear );
+			const CTransferLut & tlG = CTransferLut::CachedPow( 2.2 );
+			const CTransferLut & tlB = CTransferLut::Cached( CFormat::TransferFunc( SL2_CGC_ITU_BT_709 ).pfLinearToX );
+			Report( L"Per-channel tables", CTransferLut::MaxError( tlR, tlG, tlB ),
+				(tlR.Valid() && tlG.Valid() && tlB.Valid()) ? CTransferLut::m_dMaxError * 2.0 : 0.0 );
 		}
 
-		// Determine the resampling size.
-		uint32_t ui32NewWidth = _oOptions.rResample.ui32NewW;
-		uint32_t ui32NewHeight = _oOptions.rResample.ui32NewH;
-		uint32_t ui32NewDepth = _oOptions.rResample.ui32NewD;
-		if ( _oOptions.i32ScaleDims == 2 ) {
-			if ( ui32NewWidth && !ui32NewHeight ) {
-				ui32NewHeight = static_cast<uint32_t>(std::round( double( ui32NewWidth ) / _oOptions.wCropWindow.ui32W * _oOptions.wCropWindow.ui32H ));
-			}
-			else if ( !ui32NewWidth && ui32NewHeight ) {
-				ui32NewWidth = static_cast<uint32_t>(std::round( double( ui32NewHeight ) / _oOptions.wCropWindow.ui32H * _oOptions.wCropWindow.ui32W ));
+		// Integer-ratio resampling runs against the general convolution, over odd and even sizes, every addressing mode, and
+		//	both the 4-channel (width) and 1-channel (height/depth) strides.  Only the summation order differs.
+		{
+			const CResampler::SL2_FILTER_FUNCS ffFilters[] = {
+				CResampler::SL2_FF_POINT, CResampler::SL2_FF_LINEAR, CResampler::SL2_FF_KAISER, CResampler::SL2_FF_LANCZOS3,
+				CResampler::SL2_FF_MITCHELL, CResampler::SL2_FF_ROBIDOUXSHARP, CResampler::SL2_FF_GAUSSIAN,
+			};
+			const SL2_TEXTURE_ADDRESSING taModes[] = { SL2_TA_WRAP, SL2_TA_MIRROR, SL2_TA_CLAMP, SL2_TA_BORDER, SL2_TA_MIRROR_ONCE, SL2_TA_NULL_BORDER };
+			const uint32_t ui32Dsts[] = { 1, 2, 7, 8, 9, 16, 33, 100, 257 };
+			auto TestRatio = [&]( const std::wstring &_wsName, uint32_t _ui32Num, uint32_t _ui32Den, bool _bExpectRuns ) {
+				double dMax = 0.0;
+				size_t sRunTexels = 0;
+				for ( auto ui32Dst : ui32Dsts ) {
+					uint32_t ui32Src = ui32Dst * _ui32Num / _ui32Den;
+					if ( !ui32Src ) { continue; }
+					for ( auto ffFilter : ffFilters ) {
+						for ( auto taMode : taModes ) {
+							for ( size_t sStride = 1; sStride <= 4; sStride += 3 ) {
+								size_t sThisRun;
+								double dErr = CResampler::PeriodicMaxError( ui32Src, ui32Dst, taMode, CResampler::m_fFilter[ffFilter], sStride, sThisRun );
+								if ( !(dErr <= dMax) ) { dMax = dErr; }
+								sRunTexels += sThisRun;
+							}
+						}
+					}
+				}
+				// A ratio that should use runs but never does is not testing anything.
+				if ( _bExpectRuns && !sRunTexels ) { dMax = std::numeric_limits<double>::infinity(); }
+				Report( std::format( L"Resampler {} ({} periodic texels)", _wsName, sRunTexels ), dMax, 1.0e-12 );
+			};
+			TestRatio( L"2:1", 2, 1, true );
+			TestRatio( L"3:1", 3, 1, true );
+			TestRatio( L"4:1", 4, 1, true );
+			TestRatio( L"5:1", 5, 1, true );
+			TestRatio( L"8:1", 8, 1, true );
+			TestRatio( L"1:1", 1, 1, true );
+			TestRatio( L"3:2", 3, 2, false );
+			TestRatio( L"1:2", 1, 2, false );
+		}
+
+		// The YUV row converters against the per-texel CFormat::RgbToYuv()/YuvToRgb() they replaced, for the BT.601, BT.709 and
+		//	BT.2020 weights at computer and studio ranges.  The inputs are a 17x17x17 grid plus pseudo-random colors, some out of
+		//	range, for a row length that exercises both the vectorized and the scalar tail.
+		[&]() {
+			std::vector<double> vRgba, vY, vU, vV, vOut;
+			try {
+				constexpr size_t sGrid = 17;
+				for ( size_t R = 0; R < sGrid; ++R ) {
+					for ( size_t G = 0; G < sGrid; ++G ) {
+						for ( size_t B = 0; B < sGrid; ++B ) {
+							vRgba.insert( vRgba.end(), { R / (sGrid - 1.0), G / (sGrid - 1.0), B / (sGrid - 1.0), 1.0 } );
+						}
+					}
+				}
+				uint32_t ui32Seed = 1;
+				for ( size_t I = 0; I < 20001; ++I ) {
+					for ( size_t C = 0; C < 3; ++C ) {
+						ui32Seed = ui32Seed * 1664525 + 1013904223;
+						vRgba.push_back( (ui32Seed >> 8) * (1.2 / 16777216.0) - 0.1 );
+					}
+					vRgba.push_back( 1.0 );
+				}
+				vY.resize( vRgba.size() / 4 );
+				vU.resize( vRgba.size() / 4 );
+				vV.resize( vRgba.size() / 4 );
+				vOut.resize( vRgba.size() );
+			}
+			catch ( ... ) {
+				Report( L"YUV (out of memory)", std::numeric_limits<double>::infinity(), 0.0 );
+				return;
+			}
+			size_t sTotal = vRgba.size() / 4;
+
+			const double dWeights[][2] = { { 0.299, 0.114 }, { 0.2126, 0.0722 }, { 0.2627, 0.0593 } };
+			const double dRanges[][2] = { { 0.0, 1.0 }, { 16.0 / 255.0, 219.0 / 255.0 } };
+			double dCodeErr = 0.0, dDecodeErr = 0.0, dRoundTripErr = 0.0;
+			size_t sMismatches = 0;
+			auto Max = []( double &_dMax, double _dErr ) { if ( !(_dErr <= _dMax) ) { _dMax = std::isnan( _dErr ) ? std::numeric_limits<double>::infinity() : _dErr; } };
+			for ( auto & dK : dWeights ) {
+				for ( auto & dR : dRanges ) {
+					CYuv::RgbToYuvRow( vRgba.data(), vY.data(), vU.data(), vV.data(), sTotal, CYuv::EncodeMatrix( dK[0], dK[1], dR[0], dR[1] ) );
+					CYuv::YuvToRgbRow( vY.data(), vU.data(), vV.data(), vOut.data(), sTotal, CYuv::DecodeMatrix( dK[0], dK[1], dR[0], dR[1] ) );
+					uint32_t ui32Black = uint32_t( std::round( dR[0] * 0xFFFFFFFFU ) ), ui32S = uint32_t( std::round( dR[1] * 0xFFFFFFFFU ) );
+					for ( size_t I = 0; I < sTotal; ++I ) {
+						const double * pdIn = &vRgba[I*4];
+						uint32_t ui32Old[3];
+						CFormat::RgbToYuv( pdIn[0], pdIn[1], pdIn[2], ui32Old[0], ui32Old[1], ui32Old[2], dK[0], dK[1], 32, ui32Black, ui32S );
+						double dNew[3] = { std::round( vY[I] * 0xFFFFFFFFU ), std::round( vU[I] * 0xFFFFFFFFU ), std::round( vV[I] * 0xFFFFFFFFU ) };
+						for ( size_t C = 0; C < 3; ++C ) {
+							Max( dCodeErr, std::fabs( dNew[C] - ui32Old[C] ) );
+							// The codes actually written to files, truncated as Yuv444PFromRgba64F() and friends do.
+							for ( double dBits : { 255.0, 1023.0, 65535.0 } ) {
+								double dMul = (1.0 / 0xFFFFFFFFU) * dBits;
+								if ( uint32_t( dNew[C] * dMul ) != uint32_t( ui32Old[C] * dMul ) ) { ++sMismatches; }
+							}
+						}
+
+						// Decoding the same codes, then the full round trip.
+						double dOld[3], dOldTrip[3];
+						CFormat::YuvToRgb( uint32_t( dNew[0] ), uint32_t( dNew[1] ), uint32_t( dNew[2] ), dOld[0], dOld[1], dOld[2], dK[0], dK[1], 32, ui32Black, ui32S );
+						CFormat::YuvToRgb( ui32Old[0], ui32Old[1], ui32Old[2], dOldTrip[0], dOldTrip[1], dOldTrip[2], dK[0], dK[1], 32, ui32Black, ui32S );
+						for ( size_t C = 0; C < 3; ++C ) {
+							Max( dDecodeErr, std::fabs( vOut[I*4+C] - dOld[C] ) );
+							Max( dRoundTripErr, std::fabs( vOut[I*4+C] - dOldTrip[C] ) );
+						}
+						Max( dDecodeErr, std::fabs( vOut[I*4+3] - 1.0 ) );
+					}
+				}
+			}
+			// Reassociating the matrix can move a 32-bit sample that lands on a rounding tie by 1, which must never reach the
+			//	8-, 10- or 16-bit codes.  One 32-bit step decodes to about 2.7e-10.
+			Report( L"YUV encode, 32-bit codes", dCodeErr, 1.0 );
+			Report( std::format( L"YUV encode, 8/10/16-bit codes ({} mismatches)", sMismatches ), double( sMismatches ), 0.0 );
+			Report( L"YUV decode", dDecodeErr, 1.0e-12 );
+			Report( L"YUV round trip", dRoundTripErr, 1.0e-9 );
+		}();
+
+		// The ISPC nearest-color search used for indexed formats against a brute-force search with the scalar CIEDE2000 in
+		//	CColorDistance, on the LAB values ispc_rgb2lab() produces.  Palette sizes cover partial gangs, a single entry, and
+		//	duplicate entries; the colors include every palette entry exactly.  The ISPC kernel avoids pow(), so a different index
+		//	is allowed only where the two distances agree to rounding.
+		[&]() {
+			const uint32_t ui32Sizes[] = { 1, 2, 7, 16, 17, 255, 256 };
+			double dExcess = 0.0;
+			size_t sMismatches = 0, sTotal = 0, sLaterDuplicates = 0;
+			bool bFound = true;
+			uint32_t ui32Seed = 7;
+			auto Rand = [&]() {
+				ui32Seed = ui32Seed * 1664525 + 1013904223;
+				return (ui32Seed >> 8) * (1.0 / 16777216.0);
+			};
+			// ispc_rgb2lab() takes channels over 0-255; alpha passes through unscaled.
+			auto RandRgb = [&]( double _dAlpha ) {
+				return ispc::ColorRGBA{ Rand() * 255.0, Rand() * 255.0, Rand() * 255.0, _dAlpha };
+			};
+			for ( auto ui32Size : ui32Sizes ) {
+				std::vector<ispc::ColorRGBA> vPalRgb, vRgb;
+				std::vector<ispc::ColorLABA> vPalLab, vLab;
+				std::vector<uint32_t> vIndices;
+				std::vector<uint8_t> vRepeats;
+				try {
+					vPalRgb.resize( ui32Size );
+					for ( uint32_t I = 0; I < ui32Size; ++I ) {
+						// Every 5th entry repeats an earlier one so that ties must resolve to the lowest index.
+						vPalRgb[I] = (I % 5 == 4) ? vPalRgb[I/2] : RandRgb( (I & 1) ? Rand() : 1.0 );
+					}
+					vRgb = vPalRgb;
+					for ( size_t I = 0; I < 4099; ++I ) {
+						vRgb.push_back( RandRgb( (I & 3) ? 1.0 : Rand() ) );
+					}
+					vPalLab.resize( vPalRgb.size() );
+					vLab.resize( vRgb.size() );
+					vIndices.resize( vRgb.size() );
+					vRepeats.resize( ui32Size );
+				}
+				catch ( ... ) {
+					Report( L"CIEDE2000 nearest (out of memory)", std::numeric_limits<double>::infinity(), 0.0 );
+					return;
+				}
+				ispc::ispc_rgb2lab( vPalRgb.data(), vPalLab.data(), vPalRgb.size() );
+				ispc::ispc_rgb2lab( vRgb.data(), vLab.data(), vRgb.size() );
+				bFound = ispc::ispc_nearest_CIEDE2000( vRgb.data(), vIndices.data(), vRgb.size(), vPalLab.data(), ui32Size ) && bFound;
+				// Flag entries that repeat an earlier one; the search must never return them.
+				for ( uint32_t J = 0; J < ui32Size; ++J ) {
+					for ( uint32_t K = 0; K < J && !vRepeats[J]; ++K ) {
+						vRepeats[J] = vPalLab[K].l == vPalLab[J].l && vPalLab[K].a == vPalLab[J].a &&
+							vPalLab[K].b == vPalLab[J].b && vPalLab[K].alpha == vPalLab[J].alpha;
+					}
+				}
+
+				auto Dist = [&]( size_t _sColor, uint32_t _ui32Entry ) {
+					const ispc::ColorLABA & clA = vLab[_sColor];
+					const ispc::ColorLABA & clB = vPalLab[_ui32Entry];
+					return std::sqrt( CColorDistance::DistanceSq( SL2_CD_CIEDE2000, CColorDistance::CColor( clA.l, clA.a, clA.b, clA.alpha ),
+						CColorDistance::CColor( clB.l, clB.a, clB.b, clB.alpha ) ) );
+				};
+				for ( size_t I = 0; I < vRgb.size(); ++I ) {
+					uint32_t ui32Best = 0;
+					double dBest = Dist( I, 0 );
+					for ( uint32_t J = 1; J < ui32Size; ++J ) {
+						double dThis = Dist( I, J );
+						if ( dThis < dBest ) {
+							dBest = dThis;
+							ui32Best = J;
+						}
+					}
+					++sTotal;
+					if ( vIndices[I] < ui32Size && vRepeats[vIndices[I]] ) { ++sLaterDuplicates; }
+					if ( vIndices[I] == ui32Best ) { continue; }
+					++sMismatches;
+					double dErr = vIndices[I] < ui32Size ? Dist( I, vIndices[I] ) - dBest : std::numeric_limits<double>::infinity();
+					if ( !(dErr <= dExcess) ) { dExcess = std::isnan( dErr ) ? std::numeric_limits<double>::infinity() : dErr; }
+				}
+			}
+			if ( !bFound ) { dExcess = std::numeric_limits<double>::infinity(); }
+			Report( std::format( L"CIEDE2000 nearest, {} colors ({} different indices)", sTotal, sMismatches ), dExcess, 1.0e-9 );
+			Report( L"CIEDE2000 nearest, ties to the lowest index", double( sLaterDuplicates ), 0.0 );
+		}();
+
+		return bPassed;
+	}
+
+    /**
+	 * Fix up the resampling parameters.
+	 * 
+	 * \param _oOptions The options to fix up.
+     * \param _iImage The image off of which to base the adjustments.
+	 **/
+	void FixResampling( SL2_OPTIONS &_oOptions, CImage &_iImage ) {
+		// The output size is chosen from the size in the file even if the image was decoded at a reduced size.
+		FixResampling( _oOptions, _iImage.FullWidth(), _iImage.FullHeight(), _iImage.Depth() );
+		// The window is then moved to the pixels that were decoded.  DecodeSize() allows a reduced size only when the window
+		//	is derived from the size of the image, so this is exact.
+		if ( _iImage.FullWidth() != _iImage.Width() ) {
+			_oOptions.wCropWindow.i32X = static_cast<int32_t>(int64_t( _oOptions.wCropWindow.i32X ) * _iImage.Width() / _iImage.FullWidth());
+			_oOptions.wCropWindow.ui32W = static_cast<uint32_t>(uint64_t( _oOptions.wCropWindow.ui32W ) * _iImage.Width() / _iImage.FullWidth());
+		}
+		if ( _iImage.FullHeight() != _iImage.Height() ) {
+			_oOptions.wCropWindow.i32Y = static_cast<int32_t>(int64_t( _oOptions.wCropWindow.i32Y ) * _iImage.Height() / _iImage.FullHeight());
+			_oOptions.wCropWindow.ui32H = static_cast<uint32_t>(uint64_t( _oOptions.wCropWindow.ui32H ) * _iImage.Height() / _iImage.FullHeight());
+		}
+	}
+
+	/**
+	 * Fix up the resampling parameters for an image of a given size.
+	 * 
+	 * \param _oOptions The options to fix up.
+	 * \param _ui32Width The width of the image.
+	 * \param _ui32Height The height of the image.
+	 * \param _ui32Depth The depth of the image.
+	 **/
+	void FixResampling( SL2_OPTIONS &_oOptions, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth ) {
+		if ( _oOptions.ui32BakedW ) {
+			_oOptions.wCropWindow.i32X = -static_cast<int32_t>(_ui32Width * _oOptions.ui32BakedW);
+			_oOptions.wCropWindow.ui32W = (1 + _oOptions.ui32BakedW * 2) * _ui32Width;
+		}
+		if ( _oOptions.ui32BakedH ) {
+			_oOptions.wCropWindow.i32Y = -static_cast<int32_t>(_ui32Height * _oOptions.ui32BakedH);
+			_oOptions.wCropWindow.ui32H = (1 + _oOptions.ui32BakedH * 2) * _ui32Height;
+		}
+		if ( _oOptions.ui32BakedD ) {
+			_oOptions.wCropWindow.i32Z = -static_cast<int32_t>(_ui32Depth * _oOptions.ui32BakedD);
+			_oOptions.wCropWindow.ui32D = (1 + _oOptions.ui32BakedD * 2) * _ui32Depth;
+		}
+
+		if ( !_oOptions.wCropWindow.ui32W ) {
+			_oOptions.wCropWindow.i32X = 0;
+			_oOptions.wCropWindow.ui32W = _ui32Width;
+		}
+		if ( !_oOptions.wCropWindow.ui32H ) {
+			_oOptions.wCropWindow.i32Y = 0;
+			_oOptions.wCropWindow.ui32H = _ui32Height;
+		}
+		if ( !_oOptions.wCropWindow.ui32D ) {
+			_oOptions.wCropWindow.i32Z = 0;
+			_oOptions.wCropWindow.ui32D = _ui32Depth;
+		}
+
+		// Determine the resampling size.
+		uint32_t ui32NewWidth = _oOptions.rResample.ui32NewW;
+		uint32_t ui32NewHeight = _oOptions.rResample.ui32NewH;
+		uint32_t ui32NewDepth = _oOptions.rResample.ui32NewD;
+		if ( _oOptions.i32ScaleDims == 2 ) {
+			if ( ui32NewWidth && !ui32NewHeight ) {
+				ui32NewHeight = static_cast<uint32_t>(std::round( double( ui32NewWidth ) / _oOptions.wCropWindow.ui32W * _oOptions.wCropWindow.ui32H ));
+			}
+			else if ( !ui32NewWidth && ui32NewHeight ) {
+				ui32NewWidth = static_cast<uint32_t>(std::round( double( ui32NewHeight ) / _oOptions.wCropWindow.ui32H * _oOptions.wCropWindow.ui32W ));
 			}
 		}
 		else if ( _oOptions.i32ScaleDims == 3 ) {
@@ -2746,7 +3167,7 @@ namespace sl2 {
 				if ( dScale != 0.0 ) {
 					ui32NewWidth = uint32_t( std::round( ui32NewWidth * dScale ) );
 					ui32NewHeight = uint32_t( std::round( ui32NewHeight * dScale ) );
-					if ( _oOptions.ui32FitD || _iImage.Depth() != 1 ) {
+					if ( _oOptions.ui32FitD || _ui32Depth != 1 ) {
 						ui32NewDepth = uint32_t( std::round( ui32NewDepth * dScale ) );
 					}
 				}
@@ -2786,6 +3207,71 @@ namespace sl2 {
 		_oOptions.rMipResample.fAlphaFilterD = CResampler::m_fFilter[_oOptions.fMipAlphaFilterFuncD];
 	}
 
+	/**
+	 * Gets the smallest size needed from an image file to produce the size selected by the options.  Passed to
+	 *	CImage::SetDecodeSize() when -scaled_decode is used.
+	 * 
+	 * \param _pvParm Points to the SL2_OPTIONS.
+	 * \param _ui32Width The width of the image in the file.
+	 * \param _ui32Height The height of the image in the file.
+	 * \param _ui32NeededW Holds the smallest width needed, in the pixels of the file.
+	 * \param _ui32NeededH Holds the smallest height needed, in the pixels of the file.
+	 * \return Returns false if the image must be decoded at its full size.
+	 **/
+	bool DecodeSize( void * _pvParm, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t &_ui32NeededW, uint32_t &_ui32NeededH ) {
+		const SL2_OPTIONS * poOptions = static_cast<const SL2_OPTIONS *>(_pvParm);
+		// A cropping window is given in the pixels of the file.
+		if ( poOptions->wCropWindow.ui32W || poOptions->wCropWindow.ui32H || poOptions->wCropWindow.ui32D ) { return false; }
+		try {
+			SL2_OPTIONS oOptions = (*poOptions);
+			FixResampling( oOptions, _ui32Width, _ui32Height, 1 );
+			if ( !oOptions.wCropWindow.ui32W || !oOptions.wCropWindow.ui32H ) { return false; }
+			// Baked images are resampled as a window larger than the image, so scale the size back to the image.
+			_ui32NeededW = static_cast<uint32_t>((uint64_t( oOptions.rResample.ui32NewW ) * _ui32Width + oOptions.wCropWindow.ui32W - 1) / oOptions.wCropWindow.ui32W);
+			_ui32NeededH = static_cast<uint32_t>((uint64_t( oOptions.rResample.ui32NewH ) * _ui32Height + oOptions.wCropWindow.ui32H - 1) / oOptions.wCropWindow.ui32H);
+			if ( oOptions.qrQuickRot == SL2_QR_ROT_90 || oOptions.qrQuickRot == SL2_QR_ROT_270 ) {
+				_ui32NeededW = _ui32NeededH = std::max( _ui32NeededW, _ui32NeededH );
+			}
+			return true;
+		}
+		catch ( ... ) { return false; }
+	}
+
+	/**
+	 * Applies the conversion options to a loaded image.  FixResampling() must already have been called on the options for the image.
+	 * 
+	 * \param _oOptions The options to apply.
+	 * \param _iImage The image to which to apply the options.
+	 **/
+	void ApplyOptions( const SL2_OPTIONS &_oOptions, CImage &_iImage ) {
+		_iImage.SetCrop( _oOptions.wCropWindow );
+		_iImage.SetQuickRotate( _oOptions.qrQuickRot );
+		_iImage.Resampling() = _oOptions.rResample;
+		_iImage.MipResampling() = _oOptions.rMipResample;
+		_iImage.SetNeedsPreMultiply( _oOptions.bNeedsPreMultiply );
+		_iImage.SetIgnoreColorspaceGamma( _oOptions.bIgnoreSourceColorspaceGamma );
+		if ( _oOptions.bManuallySetGamma == true ) {
+			_iImage.SetGamma( _oOptions.dGamma );
+		}
+		if ( _oOptions.bManuallySetTargetGamma == true ) {
+			_iImage.SetTargetGamma( _oOptions.dTargetGamma );
+		}
+		_iImage.SetRenderingIntents( _oOptions.i32InRenderingIntent, _oOptions.i32OutRenderingIntent );
+		_iImage.SetColorSpace( _oOptions.cgcInputGammaCurve, _oOptions.cgcOutputGammaCurve );
+		// The image takes the profiles it is given, so it gets copies and the options stay intact for the next image.
+		std::vector<uint8_t> vProfile = _oOptions.vInColorProfile;
+		_iImage.SetInputColorSpace( vProfile );
+		vProfile = _oOptions.vOutColorProfile;
+		_iImage.SetOutputColorSpace( vProfile );
+		_iImage.SetSwizzle( _oOptions.sSwizzle );
+		_iImage.SetSwap( _oOptions.bSwap );
+		_iImage.SetFlip( _oOptions.bFlipX, _oOptions.bFlipY, _oOptions.bFlipZ );
+		_iImage.SetMipParms( _oOptions.mhMipHandling, _oOptions.sTotalMips );
+		_iImage.SetIgnoreAlpha( _oOptions.bIgnoreAlpha );
+		_iImage.SetSharedPalette( _oOptions.bSharedPalette );
+		_iImage.SetNormalMapParms( _oOptions.kKernel, _oOptions.dNormalScale, _oOptions.caChannelAccess, _oOptions.dNormalYAxis );
+	}
+
     /**
 	 * Prints a given error code to the console.
 	 * 
@@ -2795,25 +3281,354 @@ namespace sl2 {
 		PrintError( nullptr, _eError );
 	}
 
-    /**
-	 * Exports as PNG.
+	/**
+	 * Converts a raw YUV file one frame at a time.  Frames are converted in parallel on up to _oOptions.ui32ExportThreads threads, with at most
+	 *	_oOptions.ui32YuvFramesInFlight frames in memory at once.
+	 *	Each frame is saved to its own file unless _oOptions.bYuvConcatenate is set, in which case the frames are written in order to a single raw YUV stream.
+	 * 
+	 * \param _ofFile The YUV file to convert.
+	 * \param _sPath The path to which to export the frames.
+	 * \param _oOptions Conversion and export options.
+	 * \param _pkifdFinalFormat The requested final format, or nullptr to keep the format of each frame.
+	 * \param _ui64Frames Holds the number of frames converted.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS ConvertYuvFrames( const SL2_OPEN_FILE &_ofFile, const std::u16string &_sPath, const SL2_OPTIONS &_oOptions,
+		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifdFinalFormat, uint64_t &_ui64Frames ) {
+		_ui64Frames = 0;
+		if ( !_sPath.size() ) { return SL2_E_MULTIFILECLIPBOARD; }
+
+		// The file is opened once and the workers take turns reading their frames from it.
+		CStdFile sfFile;
+		if ( !sfFile.Open( _ofFile.u16Path.c_str() ) ) { return SL2_E_FILENOTFOUND; }
+
+		try {
+			// Every frame has the same size, so the options are fixed up once, from the first frame, and then only read.
+			SL2_OPTIONS oFrameOptions = _oOptions;
+			SL2_YUV_STREAM ysStream;
+			{
+				CImage iImage;
+				iImage.SetYuvSize( _ofFile.pkifduvFormat, _ofFile.ui32YuvW, _ofFile.ui32YuvH );
+				iImage.SetYuvFrames( 0, 1 );
+				SL2_ERRORS eError = iImage.LoadFile( sfFile );
+				if ( eError != SL2_E_SUCCESS ) { return eError; }
+				ysStream.ui64Frames = iImage.YuvFileFrames();
+				FixResampling( oFrameOptions, iImage );
+			}
+			if ( _ofFile.ui32YuvFrames ) { ysStream.ui64Frames = std::min<uint64_t>( ysStream.ui64Frames, _ofFile.ui32YuvFrames ); }
+
+			CStdFile sfStream;
+			if ( _oOptions.bYuvConcatenate ) {
+				if ( !sfStream.Create( _sPath.c_str() ) ) { return SL2_E_INVALIDWRITEPERMISSIONS; }
+			}
+
+			size_t sThreads = _oOptions.ui32ExportThreads ? _oOptions.ui32ExportThreads : std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+			size_t sInFlight = _oOptions.ui32YuvFramesInFlight ? _oOptions.ui32YuvFramesInFlight : sThreads;
+			ysStream.pofFile = &_ofFile;
+			ysStream.psfFile = &sfFile;
+			ysStream.poOptions = &oFrameOptions;
+			ysStream.pkifdFinalFormat = _pkifdFinalFormat;
+			ysStream.u16Path = _sPath;
+			ysStream.u16Root = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
+			ysStream.u16Ext = CUtilities::GetFileExtension( _sPath );
+			ysStream.vFrames.resize( sInFlight );
+
+			// At most sInFlight frames are converted and not yet consumed at once, so memory stays bounded no matter how long the sequence is.
+			sThreads = size_t( std::min<uint64_t>( std::min( sThreads, sInFlight ), ysStream.ui64Frames ) );
+
+			SL2_ERRORS eRet = SL2_E_SUCCESS;
+			auto Stop = [&]() {
+				{
+					std::lock_guard<std::mutex> lgLock( ysStream.mMutex );
+					ysStream.bStop = true;
+				}
+				ysStream.cvChanged.notify_all();
+			};
+			// Frames are consumed in order so that a single stream is written in order.
+			auto Consume = [&]() {
+				try {
+					// The workers read oFrameOptions, so this thread gives the exporters its own copy.
+					SL2_OPTIONS oOptions = oFrameOptions;
+					for ( uint64_t F = 0; F < ysStream.ui64Frames; ++F ) {
+						SL2_YUV_FRAME & yfFrame = ysStream.vFrames[size_t( F % ysStream.vFrames.size() )];
+						{
+							std::unique_lock<std::mutex> ulLock( ysStream.mMutex );
+							if ( ysStream.ui64Next <= F ) {
+								// No worker has taken this frame (or none is running); convert it on this thread.
+								yfFrame.ui64Frame = ysStream.ui64Next++;
+								ulLock.unlock();
+								ConvertYuvFrame( ysStream, oOptions, yfFrame );
+							}
+							else {
+								ysStream.cvChanged.wait( ulLock, [&]() { return yfFrame.bDone; } );
+							}
+						}
+						if ( yfFrame.eError != SL2_E_SUCCESS ) {
+							eRet = yfFrame.eError;
+							break;
+						}
+						if ( _oOptions.bYuvConcatenate ) {
+							if ( !sfStream.WriteToFile( yfFrame.vData ) ) {
+								eRet = SL2_E_FILEWRITEERROR;
+								break;
+							}
+							yfFrame.vData = std::vector<uint8_t>();
+						}
+						{
+							std::lock_guard<std::mutex> lgLock( ysStream.mMutex );
+							yfFrame.bDone = false;
+							++ysStream.ui64Consumed;
+						}
+						ysStream.cvChanged.notify_all();
+						++_ui64Frames;
+					}
+				}
+				catch ( ... ) { eRet = SL2_E_OUTOFMEMORY; }
+				Stop();
+			};
+
+			// Worker 0 is this thread and consumes the frames; the rest convert them.  Workers the thread budget can't start run after the
+			//	consumer has finished and find nothing left to take, and conversions inside each frame only add threads the workers leave free.
+			CParallelFor::Run( CParallelFor::Workers( sThreads ), [&]( size_t _sWorker ) {
+				if ( _sWorker ) { YuvFrameThread( &ysStream ); }
+				else { Consume(); }
+			} );
+			return eRet;
+		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+	}
+
+	/**
+	 * A worker converting a streamed YUV file.  Takes frames from the queue in _pysStream until none remain or it is told to stop.
+	 * 
+	 * \param _pysStream The shared state of the conversion.
+	 **/
+	void YuvFrameThread( SL2_YUV_STREAM * _pysStream ) {
+		SL2_YUV_STREAM & ysStream = (*_pysStream);
+		std::unique_ptr<SL2_OPTIONS> upOptions;
+		for ( ;; ) {
+			SL2_YUV_FRAME * pyfFrame;
+			{
+				std::unique_lock<std::mutex> ulLock( ysStream.mMutex );
+				ysStream.cvChanged.wait( ulLock, [&]() {
+					return ysStream.bStop || ysStream.ui64Next == ysStream.ui64Frames ||
+						ysStream.ui64Next - ysStream.ui64Consumed < ysStream.vFrames.size();
+				} );
+				if ( ysStream.bStop || ysStream.ui64Next == ysStream.ui64Frames ) { return; }
+				pyfFrame = &ysStream.vFrames[size_t( ysStream.ui64Next % ysStream.vFrames.size() )];
+				pyfFrame->ui64Frame = ysStream.ui64Next++;
+			}
+
+			try {
+				// The exporters record per-call state in the options they are given, so each worker gives them its own copy, made once.
+				if ( !upOptions ) { upOptions = std::make_unique<SL2_OPTIONS>( (*ysStream.poOptions) ); }
+				ConvertYuvFrame( ysStream, (*upOptions), (*pyfFrame) );
+			}
+			catch ( ... ) { pyfFrame->eError = SL2_E_OUTOFMEMORY; }
+			{
+				std::lock_guard<std::mutex> lgLock( ysStream.mMutex );
+				pyfFrame->bDone = true;
+			}
+			ysStream.cvChanged.notify_all();
+		}
+	}
+
+	/**
+	 * Loads, converts, and exports a single frame of a streamed YUV file.
+	 * 
+	 * \param _ysStream The shared state of the conversion.
+	 * \param _oOptions The options to pass to the exporters, which may modify them.
+	 * \param _yfFrame The frame to convert.
+	 **/
+	void ConvertYuvFrame( SL2_YUV_STREAM &_ysStream, SL2_OPTIONS &_oOptions, SL2_YUV_FRAME &_yfFrame ) {
+		try {
+			_yfFrame.vData.clear();
+			CImage iImage;
+			iImage.SetYuvSize( _ysStream.pofFile->pkifduvFormat, _ysStream.pofFile->ui32YuvW, _ysStream.pofFile->ui32YuvH );
+			iImage.SetYuvFrames( _yfFrame.ui64Frame, 1 );
+			{
+				std::lock_guard<std::mutex> lgLock( _ysStream.mFileMutex );
+				_yfFrame.eError = iImage.LoadFile( (*_ysStream.psfFile) );
+			}
+			if ( _yfFrame.eError != SL2_E_SUCCESS ) { return; }
+
+			ApplyOptions( (*_ysStream.poOptions), iImage );
+			const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * pkifdFinal = _ysStream.pkifdFinalFormat ? _ysStream.pkifdFinalFormat : iImage.Format();
+			CImage iConverted;
+			_yfFrame.eError = iImage.ConvertToFormat( pkifdFinal, iConverted );
+			if ( _yfFrame.eError != SL2_E_SUCCESS ) { return; }
+			iImage.Reset();
+
+			_oOptions.pkifdFinalFormat = pkifdFinal;
+			if ( _oOptions.bYuvConcatenate ) {
+				_oOptions.pvYuvStream = &_yfFrame.vData;
+				bool bIsYuv;
+				_yfFrame.eError = ExportImageAsYuv( iConverted, _ysStream.u16Path, _oOptions, bIsYuv );
+				_oOptions.pvYuvStream = nullptr;
+				// Only raw YUV can be concatenated into a single stream.
+				if ( _yfFrame.eError == SL2_E_SUCCESS && !bIsYuv ) { _yfFrame.eError = SL2_E_INVALIDCALL; }
+			}
+			else {
+				wchar_t szBuffer[32];
+				::wsprintfW( szBuffer, L"_%.5I64u.", _yfFrame.ui64Frame );
+				std::u16string u16Path = CUtilities::Append( _ysStream.u16Root, szBuffer );
+				u16Path.append( _ysStream.u16Ext );
+				_yfFrame.eError = ExportImage( iConverted, u16Path, _oOptions );
+			}
+		}
+		catch ( ... ) { _yfFrame.eError = SL2_E_OUTOFMEMORY; }
+	}
+
+	/**
+	 * Exports an image to a file whose type is determined by the extension of _sPath.  An empty path sends the image to the clipboard as PNG.
 	 * 
 	 * \param _iImage The image to export.
 	 * \param _sPath The path to which to export _iImage.
 	 * \param _oOptions Export options.
 	 * \return Returns an error code.
 	 **/
-	SL2_ERRORS ExportAsPng( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
-		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
-			return ExportAsPng( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
+	SL2_ERRORS ExportImage( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
+#define SL2_CHECKEXT( EXT )     CFileBase::CmpFileExtension( _sPath, u ## #EXT )
+		if ( SL2_CHECKEXT( png ) || !_sPath.size() ) { return ExportAsPng( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( bmp ) ) { return ExportAsBmp( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( exr ) ) { return ExportAsExr( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( j2k ) ) { return ExportAsJ2k( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( jp2 ) ) { return ExportAsJp2( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( jpg ) || SL2_CHECKEXT( jpeg ) ) { return ExportAsJpg( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( dds ) ) { return ExportAsDds( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( ktx ) ) { return ExportAsKtx1( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( ktx2 ) || SL2_CHECKEXT( pvr ) || SL2_CHECKEXT( astc ) || SL2_CHECKEXT( h ) ) { return ExportAsPvr( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( tga ) ) { return ExportAsTga( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( pbm ) ) { return ExportAsPbm( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( pgm ) ) { return ExportAsPgm( _iImage, _sPath, _oOptions ); }
+		if ( SL2_CHECKEXT( ico ) ) { return ExportAsIco( _iImage, _sPath, _oOptions ); }
+#undef SL2_CHECKEXT
+		bool bIsYuv;
+		return ExportImageAsYuv( _iImage, _sPath, _oOptions, bIsYuv );
+	}
+
+	/**
+	 * Exports an image as YUV if the extension of _sPath or _oOptions.pkifdYuvFormat names a YUV format.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \param _bIsYuv Set to false if _sPath does not name a YUV file, in which case nothing is exported.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS ExportImageAsYuv( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, bool &_bIsYuv ) {
+		_bIsYuv = true;
+#define SL2_CHECKEXT( EXT )     CFileBase::CmpFileExtension( _sPath, u ## #EXT )
+#define SL2_YUV_FILE( FMT, EXT )                                                                                                                        \
+	if ( ((_oOptions.pkifdYuvFormat && _oOptions.pkifdYuvFormat->vfVulkanFormat == SL2_ ## FMT && (SL2_CHECKEXT( EXT ) || SL2_CHECKEXT( yuv ))) ||         \
+		(!_oOptions.pkifdYuvFormat && SL2_CHECKEXT( EXT ))) ) {                                                                                               \
+		if ( !_oOptions.pkifdYuvFormat ) { _oOptions.pkifdYuvFormat = CFormat::FindFormatDataByVulkan( SL2_ ## FMT ); }                                       \
+		return ExportAsYuv( _iImage, _sPath, _oOptions );                                                                                                     \
+	}
+		SL2_YUV_FILE( VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM, yuv444p16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16, yuv444p12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16, yuv444p10le )
+		SL2_YUV_FILE( VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM, yuv444p )
+
+		SL2_YUV_FILE( VK_FORMAT_G16_B16R16_2PLANE_444_UNORM, yuv444y16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_444_UNORM_3PACK16, yuv444y12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_444_UNORM_3PACK16, yuv444y10le )
+		SL2_YUV_FILE( VK_FORMAT_G8_B8R8_2PLANE_444_UNORM, yuv444y )
+
+		SL2_YUV_FILE( VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM, yuv422p16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16, yuv422p12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16, yuv422p10le )
+		SL2_YUV_FILE( VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM, yuv422p )
+
+		SL2_YUV_FILE( VK_FORMAT_G16_B16R16_2PLANE_422_UNORM, yuv422y16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16, yuv422y12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16, yuv422y10le )
+		SL2_YUV_FILE( VK_FORMAT_G8_B8R8_2PLANE_422_UNORM, yuv422y )
+
+		SL2_YUV_FILE( VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM, yuv420p16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16, yuv420p12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16, yuv420p10le )
+		SL2_YUV_FILE( VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM, yuv420p )
+
+		SL2_YUV_FILE( VK_FORMAT_G16_B16R16_2PLANE_420_UNORM, yuv420y16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16, yuv420y12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16, yuv420y10le )
+		SL2_YUV_FILE( VK_FORMAT_G8_B8R8_2PLANE_420_UNORM, yuv420y )
+
+		SL2_YUV_FILE( VK_FORMAT_G16B16G16R16_422_UNORM, yuyv16 )
+		SL2_YUV_FILE( VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16, yuyv12le )
+		SL2_YUV_FILE( VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16, yuyv10le )
+		SL2_YUV_FILE( VK_FORMAT_G8B8G8R8_422_UNORM, yuy2 )
+
+		SL2_YUV_FILE( VK_FORMAT_B16G16R16G16_422_UNORM, uyvy16 )
+		SL2_YUV_FILE( VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16, uyvy12le )
+		SL2_YUV_FILE( VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16, uyvy10le )
+		SL2_YUV_FILE( VK_FORMAT_B8G8R8G8_422_UNORM, uyvy )
+
+		SL2_YUV_FILE( VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16, yuva12le )
+		SL2_YUV_FILE( VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16, yuva10le )
+
+#undef SL2_YUV_FILE
+#define SL2_YUV_FILE( FMT, EXT )                                                                                                                        \
+	if ( ((_oOptions.pkifdYuvFormat && _oOptions.pkifdYuvFormat->dfDxFormat == SL2_ ## FMT && (SL2_CHECKEXT( EXT ) || SL2_CHECKEXT( yuv ))) ||             \
+		(!_oOptions.pkifdYuvFormat && SL2_CHECKEXT( EXT ))) ) {                                                                                               \
+		if ( !_oOptions.pkifdYuvFormat ) { _oOptions.pkifdYuvFormat = CFormat::FindFormatDataByDx( SL2_ ## FMT ); }                                           \
+		return ExportAsYuv( _iImage, _sPath, _oOptions );                                                                                                     \
+	}
+		SL2_YUV_FILE( DXGI_FORMAT_P216, p216 )
+		SL2_YUV_FILE( DXGI_FORMAT_P210, p210 )
+		SL2_YUV_FILE( DXGI_FORMAT_P208, p208 )
+
+		SL2_YUV_FILE( DXGI_FORMAT_420_OPAQUE, yv12 )
+		SL2_YUV_FILE( DXGI_FORMAT_YV12, yv12 )
+
+		SL2_YUV_FILE( DXGI_FORMAT_P016, p016 )
+		SL2_YUV_FILE( DXGI_FORMAT_P010, p010 )
+		SL2_YUV_FILE( DXGI_FORMAT_NV12, nv12 )
+
+		SL2_YUV_FILE( DXGI_FORMAT_NV21, nv21 )
+
+		SL2_YUV_FILE( DXGI_FORMAT_Y216, y216 )
+		SL2_YUV_FILE( DXGI_FORMAT_Y210, y210 )
+		SL2_YUV_FILE( DXGI_FORMAT_G8R8_G8B8_UNORM, yuy2 )
+		SL2_YUV_FILE( DXGI_FORMAT_YUY2, yuy2 )
+
+		SL2_YUV_FILE( DXGI_FORMAT_R8G8_B8G8_UNORM, uyv2 )
+
+		SL2_YUV_FILE( DXGI_FORMAT_Y416, y416 )
+		SL2_YUV_FILE( DXGI_FORMAT_Y410, y410 )
+		SL2_YUV_FILE( DXGI_FORMAT_AYUV, ayuv )
+
+#undef SL2_YUV_FILE
+#undef SL2_CHECKEXT
+		_bIsYuv = false;
+		return SL2_E_SUCCESS;
+	}
+
+	/**
+	 * Exports every mipmap, array slice, face, and depth slice of an image to its own file.  Up to _oOptions.ui32ExportThreads surfaces are converted and
+	 *	encoded at once, and each thread holds only the surface it is exporting.  File names are decided before any thread starts, so they do not depend on
+	 *	the order in which the surfaces finish.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.  The indices of each surface are appended to its name.
+	 * \param _oOptions Export options.
+	 * \param _pfExport The function that exports a single surface.
+	 * \param _pcExt The extension of each file, or nullptr to use the extension of _sPath.
+	 * \return Returns an error code.  If more than one surface fails, the error of the first in export order is returned.
+	 **/
+	SL2_ERRORS ExportSurfaces( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, PfExportSurface _pfExport,
+		const char16_t * _pcExt ) {
+		if ( _sPath.size() == 0 ) {
+			// Only individual files can be output to the clipboard.
+			return SL2_E_MULTIFILECLIPBOARD;
 		}
-		else {
-			if ( _sPath.size() == 0 ) {
-				// Only individual files can be output to the clipboard.
-				return SL2_E_MULTIFILECLIPBOARD;
-			}
+		try {
+			std::vector<SL2_EXPORT_SURFACE> vSurfaces;
+			vSurfaces.reserve( size_t( _iImage.Mipmaps() ) * _iImage.ArraySize() * _iImage.Faces() * _iImage.Depth() );
 			wchar_t szBuffer[64];
 			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
+			std::u16string u16Ext = _pcExt ? std::u16string( _pcExt ) : CUtilities::GetFileExtension( _sPath );
 			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
 				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
 					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
@@ -2823,18 +3638,215 @@ namespace sl2 {
 							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
 							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
 							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L".png" );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsPng( _iImage, CUtilities::Append( sRoot, szBuffer ), _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
+							pwcBuf += ::wsprintfW( pwcBuf, L"." );
+							SL2_EXPORT_SURFACE esSurface;
+							esSurface.u16Path = CUtilities::Append( sRoot, szBuffer ) + u16Ext;
+							esSurface.ui32Mip = M;
+							esSurface.ui32Array = A;
+							esSurface.ui32Face = F;
+							esSurface.ui32Slice = D;
+							vSurfaces.push_back( std::move( esSurface ) );
 						}
 					}
 				}
 			}
+
+			size_t sThreads = _oOptions.ui32ExportThreads ? _oOptions.ui32ExportThreads : std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+			sThreads = std::min( sThreads, vSurfaces.size() );
+			// Surfaces are claimed in order, so when one fails every surface before it has already been claimed and will finish.
+			std::atomic<size_t> aNext = 0;
+			std::atomic<bool> aFailed = false;
+			auto Export = [&]() {
+				try {
+					// Each thread gets its own copy of the options.
+					SL2_OPTIONS oOptions = _oOptions;
+					while ( !aFailed ) {
+						size_t I = aNext++;
+						if ( I >= vSurfaces.size() ) { break; }
+						SL2_EXPORT_SURFACE & esSurface = vSurfaces[I];
+						esSurface.eError = _pfExport( _iImage, esSurface.u16Path, oOptions, esSurface.ui32Mip, esSurface.ui32Array, esSurface.ui32Face, esSurface.ui32Slice );
+						if ( esSurface.eError != SL2_E_SUCCESS ) { aFailed = true; }
+					}
+				}
+				catch ( ... ) { aFailed = true; }
+			};
+
+			// Conversions inside each export draw on the same thread budget, so they only add threads the exports leave free.
+			CParallelFor::Run( CParallelFor::Workers( sThreads ), [&]( size_t ) { Export(); } );
+
+			for ( const auto & esSurface : vSurfaces ) {
+				if ( esSurface.eError != SL2_E_SUCCESS ) { return esSurface.eError; }
+			}
+		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+		return SL2_E_SUCCESS;
+	}
+
+	/**
+	 * Writes surfaces to a file in order.  A single thread packs the rows of up to SL2_PACK_QUEUE::sAhead surfaces ahead of the one being written, and each
+	 *	packed surface is released once it has been written.
+	 * 
+	 * \param _sfFile The file to which to write.
+	 * \param _vSurfaces The surfaces to write, in file order.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS WriteSurfaces( CStdFile &_sfFile, std::vector<SL2_STREAM_SURFACE> &_vSurfaces ) {
+		SL2_PACK_QUEUE pqQueue;
+		pqQueue.pvSurfaces = &_vSurfaces;
+		bool bPack = false;
+		for ( const auto & ssSurface : _vSurfaces ) {
+			bPack = bPack || NeedsPacking( ssSurface );
+		}
+
+		SL2_ERRORS eRet = SL2_E_SUCCESS;
+		auto Write = [&]() {
+			for ( size_t I = 0; I < _vSurfaces.size(); ++I ) {
+				SL2_STREAM_SURFACE & ssSurface = _vSurfaces[I];
+				{
+					std::unique_lock<std::mutex> ulLock( pqQueue.mMutex );
+					if ( pqQueue.sNext <= I ) {
+						// The packer has not reached this surface (or is not running); pack it on this thread.
+						pqQueue.sNext = I + 1;
+						ulLock.unlock();
+						PackSurface( &ssSurface );
+					}
+					else {
+						pqQueue.cvChanged.wait( ulLock, [&]() { return ssSurface.bPacked; } );
+					}
+				}
+
+				SL2_ERRORS eError = ssSurface.eError;
+				if ( eError == SL2_E_SUCCESS ) {
+					if ( ssSurface.bPrefix && !_sfFile.WriteToFile( reinterpret_cast<const uint8_t *>(&ssSurface.ui32Prefix), sizeof( ssSurface.ui32Prefix ) ) ) {
+						eError = SL2_E_FILEWRITEERROR;
+					}
+					else if ( NeedsPacking( ssSurface ) ) {
+						if ( ssSurface.vPacked.size() && !_sfFile.WriteToFile( ssSurface.vPacked ) ) { eError = SL2_E_FILEWRITEERROR; }
+					}
+					else if ( ssSurface.sRows && !_sfFile.WriteToFile( ssSurface.pui8Src, ssSurface.sRowSize * ssSurface.sRows ) ) {
+						eError = SL2_E_FILEWRITEERROR;
+					}
+				}
+				ssSurface.vPacked = std::vector<uint8_t>();
+				{
+					std::lock_guard<std::mutex> lgLock( pqQueue.mMutex );
+					++pqQueue.sWritten;
+					if ( eError != SL2_E_SUCCESS ) { pqQueue.bStop = true; }
+				}
+				pqQueue.cvChanged.notify_all();
+				if ( eError != SL2_E_SUCCESS ) {
+					eRet = eError;
+					return;
+				}
+			}
+		};
+
+		// Worker 0 writes and worker 1 packs.  If the packer gets no thread it runs after the writer and finds nothing left to take.
+		CParallelFor::Run( bPack ? 2 : 1, [&]( size_t _sWorker ) {
+			if ( _sWorker ) { PackSurfacesThread( &pqQueue ); }
+			else { Write(); }
+		} );
+		return eRet;
+	}
+
+	/**
+	 * Writes a whole file.  If writing behind, the file is queued and written on a background thread, and failures are reported when the queue
+	 *	is finished.
+	 * 
+	 * \param _sPath The path of the file to create.
+	 * \param _vData The contents of the file.  Emptied if the file is queued.
+	 * \param _oOptions Options, including the write-behind queue.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS SaveFile( const std::u16string &_sPath, std::vector<uint8_t> &_vData, SL2_OPTIONS &_oOptions ) {
+		if ( _oOptions.pwbWriteBehind && _oOptions.pwbWriteBehind->Write( _sPath, _vData ) ) { return SL2_E_SUCCESS; }
+
+		CStdFile sfFile;
+		if ( !sfFile.Create( _sPath.c_str() ) ) {
+			return SL2_E_INVALIDWRITEPERMISSIONS;
+		}
+		if ( !sfFile.WriteToFile( _vData ) ) {
+			return SL2_E_FILEWRITEERROR;
 		}
 		return SL2_E_SUCCESS;
 	}
 
+	/**
+	 * Determines whether the rows of a surface must be packed before they are written.  Surfaces whose rows are contiguous and unpadded are written
+	 *	straight from the image.
+	 * 
+	 * \param _ssSurface The surface to check.
+	 * \return Returns true if the rows of the surface must be packed.
+	 **/
+	bool NeedsPacking( const SL2_STREAM_SURFACE &_ssSurface ) {
+		return _ssSurface.sRowPadding != 0 || (_ssSurface.sRows > 1 && _ssSurface.sSrcPitch != _ssSurface.sRowSize);
+	}
+
+	/**
+	 * Packs the rows of a surface that can't be written straight from the image.
+	 * 
+	 * \param _pssSurface The surface to pack.
+	 **/
+	void PackSurface( SL2_STREAM_SURFACE * _pssSurface ) {
+		if ( !NeedsPacking( (*_pssSurface) ) ) { return; }
+		try {
+			size_t sDstPitch = _pssSurface->sRowSize + _pssSurface->sRowPadding;
+			_pssSurface->vPacked.resize( sDstPitch * _pssSurface->sRows );
+			uint8_t * pui8Dst = _pssSurface->vPacked.data();
+			const uint8_t * pui8Src = _pssSurface->pui8Src;
+			for ( size_t H = 0; H < _pssSurface->sRows; ++H ) {
+				std::memcpy( pui8Dst, pui8Src, _pssSurface->sRowSize );
+				pui8Dst += sDstPitch;
+				pui8Src += _pssSurface->sSrcPitch;
+			}
+		}
+		catch ( ... ) { _pssSurface->eError = SL2_E_OUTOFMEMORY; }
+	}
+
+	/**
+	 * The thread packing surfaces ahead of WriteSurfaces().  Takes surfaces in order until none remain or it is told to stop.
+	 * 
+	 * \param _ppqQueue The shared state of the write.
+	 **/
+	void PackSurfacesThread( SL2_PACK_QUEUE * _ppqQueue ) {
+		SL2_PACK_QUEUE & pqQueue = (*_ppqQueue);
+		std::vector<SL2_STREAM_SURFACE> & vSurfaces = (*pqQueue.pvSurfaces);
+		for ( ;; ) {
+			SL2_STREAM_SURFACE * pssSurface;
+			{
+				std::unique_lock<std::mutex> ulLock( pqQueue.mMutex );
+				pqQueue.cvChanged.wait( ulLock, [&]() {
+					return pqQueue.bStop || pqQueue.sNext == vSurfaces.size() ||
+						pqQueue.sNext <= pqQueue.sWritten + pqQueue.sAhead;
+				} );
+				if ( pqQueue.bStop || pqQueue.sNext == vSurfaces.size() ) { return; }
+				pssSurface = &vSurfaces[pqQueue.sNext++];
+			}
+
+			PackSurface( pssSurface );
+			{
+				std::lock_guard<std::mutex> lgLock( pqQueue.mMutex );
+				pssSurface->bPacked = true;
+			}
+			pqQueue.cvChanged.notify_all();
+		}
+	}
+
+    /**
+	 * Exports as PNG.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS ExportAsPng( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
+		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
+			return ExportAsPng( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
+		}
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsPng, u"png" );
+	}
+
     /**
 	 * Exports as PNG.
 	 * 
@@ -2939,6 +3951,30 @@ namespace sl2 {
 		if ( SL2_GET_IDX_FLAG( pbifUseMe->pkifdFormat->ui32Flags ) ) {
 			return ExportAsPng_Indexed( _iImage, _sPath, _oOptions, _sMip, _sArray, _sFace, _sSlice, pbifUseMe );
 		}
+		if ( _oOptions.bPngWriter && !(_oOptions.iPngSaveOption & PNG_INTERLACED) ) {
+			switch ( pbifUseMe->pkifdFormat->kifInternalFormat ) {
+				case SL2_GL_LUMINANCE8 : {}
+				case SL2_GL_LUMINANCE16 : {
+					return ExportAsPng_Writer( _iImage, _sPath, _oOptions, _sMip, _sArray, _sFace, _sSlice, pbifUseMe, CPngWriter::SL2_CT_GRAY );
+				}
+				case SL2_GL_LUMINANCE8_ALPHA8 : {}
+				case SL2_GL_LUMINANCE16_ALPHA16 : {
+					return ExportAsPng_Writer( _iImage, _sPath, _oOptions, _sMip, _sArray, _sFace, _sSlice, pbifUseMe, CPngWriter::SL2_CT_GRAY_ALPHA );
+				}
+				default : {
+					switch ( pbifUseMe->pkifdFormat->ui32BlockSizeInBits ) {
+						case 8 * 3 : {}
+						case 16 * 3 : {
+							return ExportAsPng_Writer( _iImage, _sPath, _oOptions, _sMip, _sArray, _sFace, _sSlice, pbifUseMe, CPngWriter::SL2_CT_RGB );
+						}
+						case 8 * 4 : {}
+						case 16 * 4 : {
+							return ExportAsPng_Writer( _iImage, _sPath, _oOptions, _sMip, _sArray, _sFace, _sSlice, pbifUseMe, CPngWriter::SL2_CT_RGBA );
+						}
+					}
+				}
+			}
+		}
 		CImage::SL2_FREEIMAGE_ALLOCATET fiImage( fitType, _iImage.GetMipmaps()[_sMip]->Width(), _iImage.GetMipmaps()[_sMip]->Height(), pbifUseMe->pkifdFormat->ui32BlockSizeInBits );
 		if ( !fiImage.pbBitmap ) { return SL2_E_OUTOFMEMORY; }
 
@@ -3055,15 +4091,8 @@ namespace sl2 {
 		std::memcpy( vConverted.data(), pbData, dwSize );
         
 		if ( _sPath.size() ) {
-			{
-				CStdFile sfFile;
-				if ( !sfFile.Create( _sPath.c_str() ) ) {
-					return SL2_E_INVALIDWRITEPERMISSIONS;
-				}
-				if ( !sfFile.WriteToFile( vConverted ) ) {
-					return SL2_E_FILEWRITEERROR;
-				}
-			}
+			SL2_ERRORS eWrite = SaveFile( _sPath, vConverted, _oOptions );
+			if ( eWrite != SL2_E_SUCCESS ) { return eWrite; }
 		}
 		else {
 			// Save to the clipboard.
@@ -3193,13 +4222,77 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
+		return SaveFile( _sPath, vConverted, _oOptions );
+	}
+
+	/**
+	 * Exports as PNG using CPngWriter.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \param _sMip The mipmap level to export.
+	 * \param _sArray The array index to export.
+	 * \param _sFace The face to export.
+	 * \param _sSlice The slice to export.
+	 * \param _pbifFormat The target format.
+	 * \param _ctColorType The PNG color type of _pbifFormat.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS ExportAsPng_Writer( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sArray, size_t _sFace, size_t _sSlice,
+		const CFormat::SL2_BEST_INTERNAL_FORMAT * _pbifFormat, CPngWriter::SL2_COLOR_TYPE _ctColorType ) {
+		std::vector<uint8_t> vConverted;
+		// PNG rows run from the top down, unlike the FreeImage bitmaps the other exporters fill.
+		SL2_ERRORS eError = _iImage.ConvertToFormat( _pbifFormat->pkifdFormat, _sMip, _sArray, _sFace, vConverted );
+		if ( eError != SL2_E_SUCCESS ) { return eError; }
+
+		const uint32_t ui32Width = _iImage.GetMipmaps()[_sMip]->Width();
+		const uint32_t ui32Height = _iImage.GetMipmaps()[_sMip]->Height();
+		size_t sPitch = CFormat::GetRowSize( _pbifFormat->pkifdFormat, ui32Width );
+		uint8_t * pui8Rows = vConverted.data() + sPitch * ui32Height * _sSlice;
+		uint8_t ui8Depth = 8;
+		if ( _pbifFormat->pkifdFormat->kifInternalFormat == SL2_GL_LUMINANCE16 || _pbifFormat->pkifdFormat->kifInternalFormat == SL2_GL_LUMINANCE16_ALPHA16 ||
+			_pbifFormat->pkifdFormat->ui32BlockSizeInBits == 16 * 3 || _pbifFormat->pkifdFormat->ui32BlockSizeInBits == 16 * 4 ) {
+			ui8Depth = 16;
+			// PNG stores 16-bit components big-endian.
+			size_t sComponents = sPitch * ui32Height / sizeof( uint16_t );
+			uint16_t * pui16Data = reinterpret_cast<uint16_t *>(pui8Rows);
+			for ( size_t I = 0; I < sComponents; ++I ) {
+				pui16Data[I] = uint16_t( (pui16Data[I] >> 8) | (pui16Data[I] << 8) );
+			}
+		}
+
+		// The components are already in R, G, B, A (or L, A) order.
+		CPngWriter::SL2_SETTINGS sSettings = _oOptions.psPngSettings;
+		int iLevel = _oOptions.iPngSaveOption & 0x0F;
+		sSettings.iLevel = (iLevel >= 1 && iLevel <= 9) ? iLevel : ((_oOptions.iPngSaveOption & PNG_Z_NO_COMPRESSION) ? 0 : 6);
+		const uint8_t * pui8Icc = nullptr;
+		size_t sIccSize = 0;
+		if ( _oOptions.bEmbedColorProfile && _iImage.OutputColorSpace().size() ) {
+			pui8Icc = _iImage.OutputColorSpace().data();
+			sIccSize = _iImage.OutputColorSpace().size();
+		}
+		std::vector<uint8_t> vFile;
+		eError = CPngWriter::Write( pui8Rows, sPitch, ui32Width, ui32Height, ui8Depth, _ctColorType, pui8Icc, sIccSize, sSettings, vFile );
+		if ( eError != SL2_E_SUCCESS ) { return eError; }
+		vConverted = std::vector<uint8_t>();
+
+		if ( _sPath.size() ) {
+			SL2_ERRORS eWrite = SaveFile( _sPath, vFile, _oOptions );
+			if ( eWrite != SL2_E_SUCCESS ) { return eWrite; }
+		}
+		else {
+			// Save to the clipboard.
+			try {
+#ifdef _WIN32
+				if ( !CUtilities::ImageToClipBoard( CUtilities::SL2_CF_PNG, vFile ) ) { return SL2_E_UNAVAILABLECLIPBOARD; }
+				else {
+					return SL2_E_PNGUNAVAILABLE;
+				}
+#endif	// #ifdef _WIN32
 			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
+			catch ( ... ) {
+				return SL2_E_OUTOFMEMORY;
 			}
 		}
 
@@ -3218,28 +4311,7 @@ namespace sl2 {
 		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsBmp( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L".bmp" );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsBmp( _iImage, CUtilities::Append( sRoot, szBuffer ), _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsBmp, u"bmp" );
 	}
 
 	/**
@@ -3373,17 +4445,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
     /**
@@ -3494,17 +4556,7 @@ namespace sl2 {
 			}
 
 
-			{
-				CStdFile sfFile;
-				if ( !sfFile.Create( _sPath.c_str() ) ) {
-					return SL2_E_INVALIDWRITEPERMISSIONS;
-				}
-				if ( !sfFile.WriteToFile( vFile ) ) {
-					return SL2_E_FILEWRITEERROR;
-				}
-			}
-
-			return SL2_E_SUCCESS;
+			return SaveFile( _sPath, vFile, _oOptions );
 
 		}
 		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
@@ -3522,28 +4574,21 @@ namespace sl2 {
 		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsExr( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L".exr" );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsExr( _iImage, CUtilities::Append( sRoot, szBuffer ), _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		if ( _oOptions.bExrMipmaps ) {
+			size_t sFull = CExr::FullChain( _iImage.Width(), _iImage.Height() );
+			if ( !(_oOptions.iExrSaveOption & EXR_LC) && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 && _iImage.Mipmaps() == sFull ) {
+				return ExportAsExr_CExr( _iImage, _sPath, _oOptions, 0, _iImage.Mipmaps(), 0, 0, 0 );
+			}
+			// An OpenEXR mipmapped file must hold every level down to 1-by-1, so anything else is written one surface per file.
+			std::wstring wReason;
+			if ( _oOptions.iExrSaveOption & EXR_LC ) { wReason = L"luminance/chroma files cannot hold mipmaps"; }
+			else if ( _iImage.ArraySize() != 1 || _iImage.Faces() != 1 || _iImage.Depth() != 1 ) { wReason = L"the image has more than one array slice, face, or depth slice"; }
+			else { wReason = std::format( L"the image has {} of the {} levels of a full mipmap chain", _iImage.Mipmaps(), sFull ); }
+			auto sStr = std::format( L"-exr_mipmaps ignored ({}); each level is written to its own file.\r\n", wReason );
+			::OutputDebugStringW( sStr.c_str() );
+			::wprintf( sStr.c_str() );
+		}
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsExr, u"exr" );
 	}
 
     /**
@@ -3559,6 +4604,10 @@ namespace sl2 {
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS ExportAsExr( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sArray, size_t _sFace, size_t _sSlice ) {
+		// FreeImage is only needed for luminance/chroma files.
+		if ( !(_oOptions.iExrSaveOption & EXR_LC) ) {
+			return ExportAsExr_CExr( _iImage, _sPath, _oOptions, _sMip, 1, _sArray, _sFace, _sSlice );
+		}
 		SL2_VKFORMAT fFormat;
 		FREE_IMAGE_TYPE fitType;
 		if ( CFormat::CountChannels( _iImage.Format() ) == 1 ) {
@@ -3658,16 +4707,74 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
+		return SaveFile( _sPath, vConverted, _oOptions );
+	}
+
+	/**
+	 * Exports as EXR using CExr.  Multiple mipmap levels are written to a single tiled, mipmapped file.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \param _sMip The first mipmap level to export.
+	 * \param _sMips The number of mipmap levels to export.
+	 * \param _sArray The array index to export.
+	 * \param _sFace The face to export.
+	 * \param _sSlice The slice to export.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS ExportAsExr_CExr( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sMips, size_t _sArray, size_t _sFace, size_t _sSlice ) {
+		SL2_VKFORMAT fFormat;
+		uint32_t ui32Channels;
+		if ( CFormat::CountChannels( _iImage.Format() ) == 1 ) {
+			fFormat = SL2_VK_FORMAT_R32_SFLOAT;
+			ui32Channels = 1;
+		}
+		else if ( _iImage.Format()->ui8ABits ) {
+			fFormat = SL2_VK_FORMAT_R32G32B32A32_SFLOAT;
+			ui32Channels = 4;
+		}
+		else {
+			fFormat = SL2_VK_FORMAT_R32G32B32_SFLOAT;
+			ui32Channels = 3;
+		}
+
+		std::vector<std::vector<uint8_t>> vConverted;
+		std::vector<CExr::SL2_LEVEL> vLevels;
+		try {
+			vConverted.resize( _sMips );
+			vLevels.resize( _sMips );
+		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+		for ( size_t I = 0; I < _sMips; ++I ) {
+			size_t sMip = _sMip + I;
+			// Unlike the FreeImage path, rows stay in top-down order.
+			SL2_ERRORS eError = _iImage.ConvertToFormat( CFormat::FindFormatDataByVulkan( fFormat ), sMip, _sArray, _sFace, vConverted[I] );
+			if ( eError != SL2_E_SUCCESS ) { return eError; }
+
+			uint32_t ui32Width = _iImage.GetMipmaps()[sMip]->Width();
+			uint32_t ui32Height = _iImage.GetMipmaps()[sMip]->Height();
+			size_t sPitch = CFormat::GetRowSize( CFormat::FindFormatDataByVulkan( fFormat ), ui32Width );
+			float * pfTexels = reinterpret_cast<float *>(vConverted[I].data() + sPitch * ui32Height * _sSlice);
+			if ( ui32Channels != 1 ) {
+				// The same transform as the FreeImage path.  Alpha is left alone.
+				for ( uint32_t H = 0; H < ui32Height; ++H ) {
+					float * pfRow = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(pfTexels) + sPitch * H);
+					for ( uint32_t X = 0; X < ui32Width; ++X ) {
+						float * pfTexel = pfRow + X * ui32Channels;
+						for ( size_t C = 0; C < 3; ++C ) {
+							pfTexel[C] = static_cast<float>(CUtilities::sRGBtoLinear( std::pow( pfTexel[C], 2.2 ) ));
+						}
+					}
+				}
 			}
+			vLevels[I] = { pfTexels, sPitch, ui32Width, ui32Height };
 		}
-		return SL2_E_SUCCESS;
+
+		std::vector<uint8_t> vFile;
+		SL2_ERRORS eError = CExr::Write( vLevels.data(), vLevels.size(), ui32Channels, _oOptions.esExrSettings, vFile );
+		if ( eError != SL2_E_SUCCESS ) { return eError; }
+		return SaveFile( _sPath, vFile, _oOptions );
 	}
 
     /**
@@ -3682,28 +4789,7 @@ namespace sl2 {
 		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsJ2k( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L".j2k" );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsJ2k( _iImage, CUtilities::Append( sRoot, szBuffer ), _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsJ2k, u"j2k" );
 	}
 
 	/**
@@ -3839,17 +4925,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
     /**
@@ -3864,28 +4940,7 @@ namespace sl2 {
 		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsJp2( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L".jp2" );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsJp2( _iImage, CUtilities::Append( sRoot, szBuffer ), _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsJp2, u"jp2" );
 	}
 
 	/**
@@ -4021,17 +5076,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
     /**
@@ -4046,29 +5091,7 @@ namespace sl2 {
 		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsJpg( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			std::u16string sExt = CUtilities::GetFileExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L"." );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsJpg( _iImage, CUtilities::Append( sRoot, szBuffer ) + sExt, _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsJpg, nullptr );
 	}
 
 	/**
@@ -4154,17 +5177,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
     /**
@@ -4356,49 +5369,46 @@ namespace sl2 {
 		}
 
 		// Add the texel data.
-        
-		// For each/face.
-		for ( size_t A = 0; A < _iImage.ArraySize(); ++A ) {
-			for ( size_t F = 0; F < _iImage.Faces(); ++F ) {
-				// For each level.
-				for ( size_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-					if ( dhHeader.ui32Flags & SL2_DF_LINEARSIZE ) {
-						size_t sSrcPitch = sl2::CFormat::GetFormatSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width(), _iImage.GetMipmaps()[M]->Height(), 1 );
-						// For each slice.
-						for ( uint32_t D = 0; D < _iImage.GetMipmaps()[M]->Depth(); ++D ) {
-							const uint8_t * pui8Src = _iImage.Data( M, D, A, F );
-							if ( !sFile.Write( pui8Src, sSrcPitch ) ) { return SL2_E_OUTOFMEMORY; }
+		std::vector<SL2_STREAM_SURFACE> vSurfaces;
+		try {
+			// For each/face.
+			for ( size_t A = 0; A < _iImage.ArraySize(); ++A ) {
+				for ( size_t F = 0; F < _iImage.Faces(); ++F ) {
+					// For each level.
+					for ( size_t M = 0; M < _iImage.Mipmaps(); ++M ) {
+						SL2_STREAM_SURFACE ssSurface;
+						if ( dhHeader.ui32Flags & SL2_DF_LINEARSIZE ) {
+							ssSurface.sRowSize = ssSurface.sSrcPitch = sl2::CFormat::GetFormatSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width(), _iImage.GetMipmaps()[M]->Height(), 1 );
+							ssSurface.sRows = 1;
+						}
+						else {
+							ssSurface.sSrcPitch = sl2::CFormat::GetRowSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
+							ssSurface.sRowSize = sl2::CFormat::GetRowSize_NoPadding( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
+							ssSurface.sRows = _iImage.GetMipmaps()[M]->Height();
 						}
-					}
-					else {
-						size_t sSrcPitch = sl2::CFormat::GetRowSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
-						size_t sDstPitch = sl2::CFormat::GetRowSize_NoPadding( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
 						// For each slice.
 						for ( uint32_t D = 0; D < _iImage.GetMipmaps()[M]->Depth(); ++D ) {
-							const uint8_t * pui8Src = _iImage.Data( M, D, A, F );
-							// For each row.
-							for ( uint32_t H = 0; H < _iImage.GetMipmaps()[M]->Height(); ++H ) {
-								if ( !sFile.Write( pui8Src, sDstPitch ) ) {
-									return SL2_E_OUTOFMEMORY;
-								}
-								pui8Src += sSrcPitch;
-							}
+							ssSurface.pui8Src = _iImage.Data( M, D, A, F );
+							vSurfaces.push_back( ssSurface );
 						}
 					}
 				}
-
 			}
 		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
 
-
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vBuffer ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
+		// The header is written at once and the texels follow straight from the image; the file is never built in memory.
+		CStdFile sfFile;
+		if ( !sfFile.Create( _sPath.c_str() ) ) {
+			return SL2_E_INVALIDWRITEPERMISSIONS;
+		}
+		SL2_ERRORS eError = sfFile.WriteToFile( vBuffer ) ? WriteSurfaces( sfFile, vSurfaces ) : SL2_E_FILEWRITEERROR;
+		if ( eError != SL2_E_SUCCESS ) {
+			// Don't leave a truncated file behind.
+			sfFile.Close();
+			std::error_code ecError;
+			std::filesystem::remove( std::filesystem::path( _sPath ), ecError );
+			return eError;
 		}
 
 		return SL2_E_SUCCESS;
@@ -4440,8 +5450,9 @@ namespace sl2 {
 		tciCreateInfo.isArray = _iImage.ArraySize() > 1 ? KTX_TRUE : KTX_FALSE;
 		tciCreateInfo.generateMipmaps = KTX_FALSE;
 
+		// The texture only supplies the header fields and the image sizes; the texels are streamed straight from _iImage.
 		sl2::CKtxTexture<ktxTexture1> kt1Tex;
-		::KTX_error_code ecErr = ::ktxTexture1_Create( &tciCreateInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, kt1Tex.HandlePointer() );
+		::KTX_error_code ecErr = ::ktxTexture1_Create( &tciCreateInfo, KTX_TEXTURE_CREATE_NO_STORAGE, kt1Tex.HandlePointer() );
 		if ( KTX_SUCCESS != ecErr || kt1Tex.Handle() == nullptr ) { return SL2_E_OUTOFMEMORY; }
 
 		if ( _iImage.Format()->bCompressed ) {
@@ -4455,83 +5466,86 @@ namespace sl2 {
 			(*kt1Tex).glType = _iImage.Format()->ktType;
 			(*kt1Tex).glBaseInternalformat = _iImage.Format()->kbifBaseInternalFormat;
 		}
+		uint32_t ui32TypeSize = (*kt1Tex).glType ? CFormat::KtxTypeSize( static_cast<SL2_KTX_TYPE>((*kt1Tex).glType) ) : 1;
+		if ( !ui32TypeSize ) { return SL2_E_BADFORMAT; }
+
+		// Header.
+		std::vector<uint8_t> vHeader;
+		sl2::CStream sHeader( vHeader );
+		const uint8_t ui8Identifier[] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+		const uint32_t ui32Header[] = {
+			0x04030201,																						// endianness
+			(*kt1Tex).glType,																				// glType
+			ui32TypeSize,																					// glTypeSize
+			(*kt1Tex).glFormat,																				// glFormat
+			(*kt1Tex).glInternalformat,																		// glInternalFormat
+			(*kt1Tex).glBaseInternalformat,																	// glBaseInternalFormat
+			tciCreateInfo.baseWidth,																		// pixelWidth
+			tciCreateInfo.numDimensions > 1 ? tciCreateInfo.baseHeight : 0,									// pixelHeight
+			tciCreateInfo.numDimensions > 2 ? tciCreateInfo.baseDepth : 0,									// pixelDepth
+			tciCreateInfo.isArray ? tciCreateInfo.numLayers : 0,											// numberOfArrayElements
+			tciCreateInfo.numFaces,																			// numberOfFaces
+			tciCreateInfo.numLevels,																		// numberOfMipmapLevels
+			0,																								// bytesOfKeyValueData
+		};
+		if ( !sHeader.Write( ui8Identifier, sizeof( ui8Identifier ) ) || !sHeader.Write( reinterpret_cast<const uint8_t *>(ui32Header), sizeof( ui32Header ) ) ) {
+			return SL2_E_OUTOFMEMORY;
+		}
 
-		// For each/face.
-		for ( size_t A = 0; A < _iImage.ArraySize(); ++A ) {
-			for ( size_t F = 0; F < _iImage.Faces(); ++F ) {
-				// For each level.
-				for ( size_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-					if ( _iImage.Format()->bCompressed ) {
-						size_t sPageSize = CFormat::GetFormatSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width(), _iImage.GetMipmaps()[M]->Height(), 1 );
-						for ( uint32_t D = 0; D < _iImage.GetMipmaps()[M]->Depth(); ++D ) {
-							ktx_uint32_t ui32FaceSlice = 0;
-							if ( _iImage.Faces() > 1 ) {
-								// Cubemap or cubemap array: faceSlice is the cube face.
-								ui32FaceSlice = static_cast<ktx_uint32_t>(F);
-							}
-							else {
-								// 3D/3D array: faceSlice is the depth slice.
-								ui32FaceSlice = static_cast<ktx_uint32_t>(D);
-							}
-
-							ecErr = ktxTexture_SetImageFromMemory( ktxTexture( kt1Tex.Handle() ), static_cast<ktx_uint32_t>(M), static_cast<ktx_uint32_t>(A), ui32FaceSlice, _iImage.Data( M, D, A, F ), static_cast<ktx_size_t>(sPageSize) );
-							if ( ecErr != KTX_SUCCESS ) { return SL2_E_OUTOFMEMORY; }
-						}
-					}
-					else {
-						size_t sDstPitch = sl2::CFormat::GetRowSize_NoPadding( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
-						size_t sPitch = sl2::CFormat::GetRowSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
-						size_t sSrcPageSize = sPitch * _iImage.GetMipmaps()[M]->Height();
-						std::vector<uint8_t> vTmp;
-						try {
-							vTmp.resize( sDstPitch * _iImage.GetMipmaps()[M]->Height() );
-						}
-						catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+		// Each level is its imageSize followed by its images, layer by layer and then face by face or slice by slice.  Rows are padded to 4 bytes and
+		//	compressed blocks are at least 8 bytes, so the cubePadding and mipPadding of the format are always empty.
+		std::vector<SL2_STREAM_SURFACE> vSurfaces;
+		try {
+			for ( size_t M = 0; M < _iImage.Mipmaps(); ++M ) {
+				size_t sImageSize = ktxTexture_GetImageSize( ktxTexture( kt1Tex.Handle() ), static_cast<ktx_uint32_t>(M) );
+				SL2_STREAM_SURFACE ssSurface;
+				if ( _iImage.Format()->bCompressed ) {
+					ssSurface.sRowSize = ssSurface.sSrcPitch = CFormat::GetFormatSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width(), _iImage.GetMipmaps()[M]->Height(), 1 );
+					ssSurface.sRows = 1;
+				}
+				else {
+					ssSurface.sSrcPitch = sl2::CFormat::GetRowSize( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
+					ssSurface.sRowSize = sl2::CFormat::GetRowSize_NoPadding( _iImage.Format(), _iImage.GetMipmaps()[M]->Width() );
+					ssSurface.sRows = _iImage.GetMipmaps()[M]->Height();
+					size_t sRowPitch = ::ktxTexture_GetRowPitch( ktxTexture( kt1Tex.Handle() ), static_cast<ktx_uint32_t>(M) );
+					if ( sRowPitch < ssSurface.sRowSize ) { return SL2_E_BADFORMAT; }
+					ssSurface.sRowPadding = sRowPitch - ssSurface.sRowSize;
+				}
+				if ( (ssSurface.sRowSize + ssSurface.sRowPadding) * ssSurface.sRows != sImageSize ) { return SL2_E_BADFORMAT; }
+
+				// Non-array cube maps store the size of 1 face, everything else the size of the level.
+				uint64_t ui64LevelSize = sImageSize;
+				if ( !(tciCreateInfo.numFaces == 6 && !tciCreateInfo.isArray) ) {
+					ui64LevelSize *= uint64_t( _iImage.ArraySize() ) * _iImage.Faces() * _iImage.GetMipmaps()[M]->Depth();
+				}
+				if ( ui64LevelSize != uint32_t( ui64LevelSize ) ) { return SL2_E_UNSUPPORTEDSIZE; }
+				ssSurface.ui32Prefix = uint32_t( ui64LevelSize );
+				ssSurface.bPrefix = true;
+
+				for ( size_t A = 0; A < _iImage.ArraySize(); ++A ) {
+					for ( size_t F = 0; F < _iImage.Faces(); ++F ) {
 						for ( uint32_t D = 0; D < _iImage.GetMipmaps()[M]->Depth(); ++D ) {
-							uint8_t * pui8Dst = vTmp.data();
-							for ( uint32_t H = 0; H < _iImage.GetMipmaps()[M]->Height(); ++H ) {
-								std::memcpy( pui8Dst, _iImage.Data( M, D, A, F ) + sPitch * H, sDstPitch );
-								pui8Dst += sDstPitch;
-							}
-
-							ktx_uint32_t ui32FaceSlice = 0;
-							if ( _iImage.Faces() > 1 ) {
-								// Cubemap or cubemap array: faceSlice is the cube face.
-								ui32FaceSlice = static_cast<ktx_uint32_t>(F);
-							}
-							else {
-								// 3D/3D array: faceSlice is the depth slice.
-								ui32FaceSlice = static_cast<ktx_uint32_t>(D);
-							}
-
-							ecErr = ktxTexture_SetImageFromMemory( ktxTexture( kt1Tex.Handle() ), static_cast<ktx_uint32_t>(M), static_cast<ktx_uint32_t>(A), ui32FaceSlice, vTmp.data(), static_cast<ktx_size_t>(vTmp.size()) );
-							if ( ecErr != KTX_SUCCESS ) { return SL2_E_OUTOFMEMORY; }
+							ssSurface.pui8Src = _iImage.Data( M, D, A, F );
+							vSurfaces.push_back( ssSurface );
+							ssSurface.bPrefix = false;
 						}
 					}
 				}
 			}
 		}
+		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
 
-		// Write to memory.
-		ktx_uint8_t * fileData = nullptr;
-		ktx_size_t fileSize = 0;
-		ecErr = ktxTexture_WriteToMemory( ktxTexture( kt1Tex.Handle() ), &fileData, &fileSize );
-		SL2_ERRORS eRet = SL2_E_SUCCESS;
-		if ( ecErr != KTX_SUCCESS ) { eRet = SL2_E_OUTOFMEMORY; }
-		else {
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				// Free the memory allocated by ktxTexture_WriteToMemory.
-				eRet = SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			else if ( !sfFile.WriteToFile( fileData, fileSize ) ) {
-				// Free the memory allocated by ktxTexture_WriteToMemory.
-				eRet = SL2_E_FILEWRITEERROR;
-			}
-			// Free the memory allocated by ktxTexture_WriteToMemory.
-			std::free( fileData );
+		CStdFile sfFile;
+		if ( !sfFile.Create( _sPath.c_str() ) ) {
+			return SL2_E_INVALIDWRITEPERMISSIONS;
+		}
+		SL2_ERRORS eRet = sfFile.WriteToFile( vHeader ) ? WriteSurfaces( sfFile, vSurfaces ) : SL2_E_FILEWRITEERROR;
+		if ( eRet != SL2_E_SUCCESS ) {
+			// Don't leave a truncated file behind.
+			sfFile.Close();
+			std::error_code ecError;
+			std::filesystem::remove( std::filesystem::path( _sPath ), ecError );
 		}
-
 		return eRet;
 	}
 
@@ -4665,28 +5679,7 @@ namespace sl2 {
 		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsTga( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L".tga" );
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsTga( _iImage, CUtilities::Append( sRoot, szBuffer ), _oOptions, M, A, F, D );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsTga, u"tga" );
 	}
 
 	/**
@@ -4814,17 +5807,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
     /**
@@ -4836,7 +5819,7 @@ namespace sl2 {
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS ExportAsYuv( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
-		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 ) {
+		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsYuv( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
 		else {
@@ -4907,17 +5890,15 @@ namespace sl2 {
 		}
 		catch ( ... ) { return SL2_E_OUTOFMEMORY; }
 
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
+		if ( _oOptions.pvYuvStream ) {
+			try {
+				_oOptions.pvYuvStream->insert( _oOptions.pvYuvStream->end(), vConverted.begin(), vConverted.end() );
 			}
+			catch ( ... ) { return SL2_E_OUTOFMEMORY; }
+			return SL2_E_SUCCESS;
 		}
 
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
     /**
@@ -4929,35 +5910,10 @@ namespace sl2 {
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS ExportAsPbm( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
-		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 ) {
+		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsPbm( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			std::u16string u16Ext = CUtilities::GetFileExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L"." );
-							std::u16string u16Final = CUtilities::Append( sRoot, szBuffer );
-							try { u16Final.append( u16Ext ); }
-							catch ( ... ) { return SL2_E_OUTOFMEMORY; }
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsPbm( _iImage, u16Final, _oOptions, M, A, F, 0 );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsPbm, nullptr );
 	}
 
 	/**
@@ -5053,17 +6009,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
 	/**
@@ -5075,35 +6021,10 @@ namespace sl2 {
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS ExportAsPgm( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
-		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 ) {
+		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsPgm( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			std::u16string u16Ext = CUtilities::GetFileExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L"." );
-							std::u16string u16Final = CUtilities::Append( sRoot, szBuffer );
-							try { u16Final.append( u16Ext ); }
-							catch ( ... ) { return SL2_E_OUTOFMEMORY; }
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsPgm( _iImage, u16Final, _oOptions, M, A, F, 0 );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsPgm, nullptr );
 	}
 
 	/**
@@ -5199,17 +6120,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
 	/**
@@ -5221,35 +6132,10 @@ namespace sl2 {
 	 * \return Returns an error code.
 	 **/
 	SL2_ERRORS ExportAsIco( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions ) {
-		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 ) {
+		if ( _iImage.Mipmaps() == 1 && _iImage.ArraySize() == 1 && _iImage.Faces() == 1 && _iImage.Depth() == 1 ) {
 			return ExportAsIco( _iImage, _sPath, _oOptions, 0, 0, 0, 0 );
 		}
-		else {
-			wchar_t szBuffer[64];
-			std::u16string sRoot = CUtilities::GetFilePath( _sPath ) + CUtilities::NoExtension( _sPath );
-			std::u16string u16Ext = CUtilities::GetFileExtension( _sPath );
-			for ( uint32_t M = 0; M < _iImage.Mipmaps(); ++M ) {
-				for ( uint32_t A = 0; A < _iImage.ArraySize(); ++A ) {
-					for ( uint32_t F = 0; F < _iImage.Faces(); ++F ) {
-						for ( uint32_t D = 0; D < _iImage.Depth(); ++D ) {
-							wchar_t * pwcBuf = szBuffer;
-							if ( _iImage.Mipmaps() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_M%.2u", M ); }
-							if ( _iImage.ArraySize() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_A%.2u", A ); }
-							if ( _iImage.Faces() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_F%.2u", F ); }
-							if ( _iImage.Depth() > 1 ) { pwcBuf += ::wsprintfW( pwcBuf, L"_D%.2u", D ); }
-							pwcBuf += ::wsprintfW( pwcBuf, L"." );
-							std::u16string u16Final = CUtilities::Append( sRoot, szBuffer );
-							try { u16Final.append( u16Ext ); }
-							catch ( ... ) { return SL2_E_OUTOFMEMORY; }
-							//::wsprintfW( szBuffer, L"_M%.2u_A%.2u_F%.2u_D%.2u.png", M, A, F, D );
-							SL2_ERRORS eErr = ExportAsIco( _iImage, u16Final, _oOptions, M, A, F, 0 );
-							if ( eErr != SL2_E_SUCCESS ) { return eErr; }
-						}
-					}
-				}
-			}
-		}
-		return SL2_E_SUCCESS;
+		return ExportSurfaces( _iImage, _sPath, _oOptions, ExportAsIco, nullptr );
 	}
 
 	/**
@@ -5407,17 +6293,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
 	/**
@@ -5530,17 +6406,7 @@ namespace sl2 {
 			return SL2_E_OUTOFMEMORY;
 		}
 		std::memcpy( vConverted.data(), pbData, dwSize );
-		{
-			CStdFile sfFile;
-			if ( !sfFile.Create( _sPath.c_str() ) ) {
-				return SL2_E_INVALIDWRITEPERMISSIONS;
-			}
-			if ( !sfFile.WriteToFile( vConverted ) ) {
-				return SL2_E_FILEWRITEERROR;
-			}
-		}
-
-		return SL2_E_SUCCESS;
+		return SaveFile( _sPath, vConverted, _oOptions );
 	}
 
 }   // namespace sl2
@@ -11,9 +11,15 @@
 #pragma once
 
 #include "Files/SL2StdFile.h"
+#include "Files/SL2WriteBehind.h"
 #include "Image/PVRTexTool/PVRTexLib.hpp"
 #include "Image/SL2Formats.h"
+#include "Image/SL2Exr.h"
 #include "Image/SL2Image.h"
+#include "Image/SL2PngWriter.h"
+#include "Image/SL2Prefetcher.h"
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -27,6 +33,8 @@ namespace sl2 {
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *					pkifduvFormat = nullptr;										/**< The YUV format. */
 		uint32_t														ui32YuvW = 0;													/**< The YUV file width. */
 		uint32_t														ui32YuvH = 0;													/**< The YUV file height. */
+		uint32_t														ui32YuvFrames = 0;												/**< The number of YUV frames to stream, or 0 for every frame in the file. */
+		bool															bYuvStream = false;												/**< If true, the YUV file is converted one frame at a time instead of as a single image. */
 		bool															bFromClipBoard = false;											/**< If true, the file is loaded from the clipboard instead of from a file. */
 	};
 
@@ -77,6 +85,7 @@ namespace sl2 {
 		uint32_t														ui32ClampW = 0;													/**< Width clamp. */
 		uint32_t														ui32ClampH = 0;													/**< Height clamp. */
 		uint32_t														ui32ClampD = 0;													/**< Depth clamp. */
+		bool															bScaledDecode = false;											/**< If true, JPEG and WebP files may be decoded at a reduced size when they are resampled down. */
 
 		SL2_MIPMAP_HANDLING												mhMipHandling = SL2_MH_GENERATE_NEW;							/**< Fully generate a new set. */
 		size_t															sTotalMips = 0;													/**< How many mipmaps to put into the final result, or 0 to keep existing mipmaps or to generate a full set. */
@@ -89,6 +98,7 @@ namespace sl2 {
 		bool															bNormalizeMips = false;											/**< If mipmaps should be normalized or not. */
 
 		bool															bGenNewPalatte = false;											/**< Generate a new palette (applies only when there is an existing palette). */
+		bool															bSharedPalette = false;											/**< Generate one palette for every mipmap, array slice, face, and frame. */
 
 		sl2::CImage::SL2_WINDOW											wCropWindow;													/**< The cropping window. */
 		uint32_t														ui32BakedW = 0;													/**< Number of baked horizontal iterations. */
@@ -98,6 +108,8 @@ namespace sl2 {
 
 		int																iPngSaveOption = PNG_Z_DEFAULT_COMPRESSION;						/**< Option for saving as PNG. */
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *					pkifdPngFormat = nullptr;										/**< The PNG format. */
+		bool															bPngWriter = false;												/**< If true, non-indexed PNG files are written by CPngWriter instead of FreeImage. */
+		sl2::CPngWriter::SL2_SETTINGS									psPngSettings;													/**< CPngWriter settings.  The level comes from iPngSaveOption. */
 
 		sl2::SL2_VKFORMAT												vkBmpFormat = SL2_VK_FORMAT_UNDEFINED;							/**< The BMP format. */
 		sl2::SL2_VKFORMAT												vkBmpFormatNoMask = SL2_VK_FORMAT_UNDEFINED;					/**< The BMP format when not using a mask. */
@@ -108,6 +120,9 @@ namespace sl2 {
 
 		sl2::SL2_VKFORMAT												vkExrFormat = SL2_VK_FORMAT_UNDEFINED;							/**< The EXR format. */
 		int																iExrSaveOption = EXR_DEFAULT;									/**< Options for saving as EXR. */
+		sl2::CExr::SL2_SETTINGS											esExrSettings;													/**< CExr settings.  Files are written by FreeImage instead when iExrSaveOption has EXR_LC. */
+		uint32_t														ui32ExrThreads = 0;												/**< The size of OpenEXR's thread pool, or 0 for one per core. */
+		bool															bExrMipmaps = false;											/**< If true, the mipmap chain is written to a single tiled EXR file. */
 
 		sl2::SL2_VKFORMAT												vkJ2kFormat = SL2_VK_FORMAT_UNDEFINED;							/**< The J2K format. */
 		int																iJ2kSaveOption = J2K_DEFAULT;									/**< J2K compression amount. */
@@ -121,6 +136,10 @@ namespace sl2 {
 		int																iTgaSaveOption = TARGA_DEFAULT;									/**< TGA option. */
 
 		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *					pkifdYuvFormat = nullptr;										/**< The YUV format. */
+		uint32_t														ui32YuvFramesInFlight = 0;										/**< The maximum number of streamed YUV frames held in memory at once, or 0 for one per core. */
+		uint32_t														ui32ExportThreads = 0;											/**< The number of surfaces exported at once when each surface is saved to its own file, or 0 for one per core. */
+		bool															bYuvConcatenate = false;										/**< If true, streamed YUV frames are written to a single raw stream instead of one file per frame. */
+		std::vector<uint8_t> *											pvYuvStream = nullptr;											/**< If not nullptr, YUV exports are appended here instead of being written to a file. */
 
 		int																iPbmSaveOption = PNM_DEFAULT;									/**< Option for saving as PBM. */
 
@@ -138,9 +157,82 @@ namespace sl2 {
 		bool															bFlipZ = false;													/**< Depth flip? */
 		bool															bPause = false;													/**< If true, the program pauses before closing the command window. */
 		bool															bShowTime = true;												/**< If true, the time taken to perform the conversion is printed. */
+
+		size_t															sPrefetch = 0;													/**< The number of input files to read ahead of the one being converted. */
+		bool															bPrefetchDecode = false;										/**< If true, prefetched files are also decoded ahead of time. */
+		bool															bWriteBehind = false;											/**< If true, output files are written on a background thread. */
+		uint64_t														ui64IoMemory = 1024ULL * 1024ULL * 1024ULL;						/**< The memory prefetching and writing behind may each hold, in bytes. */
+		bool															bLazyDecode = false;											/**< If true, DDS surfaces are decoded only when they are converted. */
+		size_t															sLazySurfaces = 0;												/**< The most lazily decoded surfaces kept at once, or 0 for no limit. */
+		CWriteBehind *													pwbWriteBehind = nullptr;										/**< The queue of output files, if writing behind. */
 		
 	};
 
+	/** A single frame of a streamed YUV file. */
+	struct SL2_YUV_FRAME {
+		uint64_t														ui64Frame = 0;													/**< The index of the frame. */
+		std::vector<uint8_t>											vData;															/**< The converted frame when writing a single raw stream. */
+		SL2_ERRORS														eError = SL2_E_SUCCESS;											/**< The result of the conversion. */
+		bool															bDone = false;													/**< Set when the frame has been converted and not yet consumed. */
+	};
+
+	/** The state shared by the workers converting a streamed YUV file. */
+	struct SL2_YUV_STREAM {
+		const SL2_OPEN_FILE *											pofFile = nullptr;												/**< The file from which to load the frames. */
+		CStdFile *														psfFile = nullptr;												/**< The opened file, read by one worker at a time. */
+		const SL2_OPTIONS *												poOptions = nullptr;											/**< The conversion options, fixed up for the size of the frames.  Read-only. */
+		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA *					pkifdFinalFormat = nullptr;										/**< The requested final format, or nullptr to keep the format of the frames. */
+		std::u16string													u16Path;														/**< The path given for the output. */
+		std::u16string													u16Root;														/**< The output path without its extension. */
+		std::u16string													u16Ext;															/**< The extension of the output path. */
+		std::vector<SL2_YUV_FRAME>										vFrames;														/**< Frame F is converted into vFrames[F%vFrames.size()]. */
+		uint64_t														ui64Frames = 0;													/**< The number of frames to convert. */
+		uint64_t														ui64Next = 0;													/**< The next frame to hand to a worker. */
+		uint64_t														ui64Consumed = 0;												/**< Frames consumed in order by ConvertYuvFrames(); their slots can be reused. */
+		bool															bStop = false;													/**< Tells the workers to stop taking frames. */
+		std::mutex														mFileMutex;														/**< Serializes reads from psfFile. */
+		std::mutex														mMutex;															/**< Guards the frame queue. */
+		std::condition_variable											cvChanged;														/**< Signalled when a frame is taken, converted, or consumed. */
+	};
+
+	/** A single surface exported to its own file. */
+	struct SL2_EXPORT_SURFACE {
+		std::u16string													u16Path;														/**< The path to which to export the surface. */
+		uint32_t														ui32Mip = 0;													/**< The mipmap level. */
+		uint32_t														ui32Array = 0;													/**< The array index. */
+		uint32_t														ui32Face = 0;													/**< The face. */
+		uint32_t														ui32Slice = 0;													/**< The depth slice. */
+		SL2_ERRORS														eError = SL2_E_OUTOFMEMORY;										/**< The result of the export.  Surfaces that are never reached keep SL2_E_OUTOFMEMORY. */
+	};
+
+	/** A surface streamed to a DDS or KTX file. */
+	struct SL2_STREAM_SURFACE {
+		const uint8_t *													pui8Src = nullptr;												/**< The first row of the surface in the image. */
+		size_t															sSrcPitch = 0;													/**< The distance between rows in the image. */
+		size_t															sRowSize = 0;													/**< The number of bytes of each row written to the file. */
+		size_t															sRowPadding = 0;												/**< The number of zeros written after each row. */
+		size_t															sRows = 0;														/**< The number of rows. */
+		uint32_t														ui32Prefix = 0;													/**< A value written before the surface if bPrefix is set. */
+		bool															bPrefix = false;												/**< If true, ui32Prefix is written before the surface. */
+		std::vector<uint8_t>											vPacked;														/**< The rows packed for writing when they can't be written straight from the image. */
+		SL2_ERRORS														eError = SL2_E_SUCCESS;											/**< The result of packing the rows. */
+		bool															bPacked = false;												/**< Set when the surface is ready to be written.  Guarded by SL2_PACK_QUEUE::mMutex. */
+	};
+
+	/** The state shared by WriteSurfaces() and the thread packing surfaces ahead of it. */
+	struct SL2_PACK_QUEUE {
+		std::vector<SL2_STREAM_SURFACE> *								pvSurfaces = nullptr;											/**< The surfaces, in file order. */
+		size_t															sNext = 0;														/**< The next surface to pack. */
+		size_t															sWritten = 0;													/**< The number of surfaces written; their packed rows have been released. */
+		size_t															sAhead = 2;														/**< The most surfaces packed ahead of the one being written. */
+		bool															bStop = false;													/**< Tells the packer to stop taking surfaces. */
+		std::mutex														mMutex;															/**< Guards the queue. */
+		std::condition_variable											cvChanged;														/**< Signalled when a surface is taken, packed, or written. */
+	};
+
+	/** A function that exports a single surface. */
+	typedef SL2_ERRORS (*																PfExportSurface)( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sArray, size_t _sFace, size_t _sSlice );
+
 
 	// == Functions.
 	/**
@@ -166,6 +258,14 @@ namespace sl2 {
 	 **/
 	void																PrintError( const char16_t * _pcText, SL2_ERRORS _eError );
 
+	/**
+	 * Runs the self-tests, which check the fast paths of the library against the exact or generic code they replace.  Each
+	 *	result is printed to the console.
+	 * 
+	 * \return Returns true if every test passed.
+	 **/
+	bool																SelfTest();
+
 	/**
 	 * Fix up the resampling parameters.
 	 * 
@@ -174,6 +274,147 @@ namespace sl2 {
 	 **/
 	void																FixResampling( SL2_OPTIONS &_oOptions, CImage &_iImage );
 
+	/**
+	 * Fix up the resampling parameters for an image of a given size.
+	 * 
+	 * \param _oOptions The options to fix up.
+	 * \param _ui32Width The width of the image.
+	 * \param _ui32Height The height of the image.
+	 * \param _ui32Depth The depth of the image.
+	 **/
+	void																FixResampling( SL2_OPTIONS &_oOptions, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t _ui32Depth );
+
+	/**
+	 * Gets the smallest size needed from an image file to produce the size selected by the options.  Passed to
+	 *	CImage::SetDecodeSize() when -scaled_decode is used.
+	 * 
+	 * \param _pvParm Points to the SL2_OPTIONS.
+	 * \param _ui32Width The width of the image in the file.
+	 * \param _ui32Height The height of the image in the file.
+	 * \param _ui32NeededW Holds the smallest width needed, in the pixels of the file.
+	 * \param _ui32NeededH Holds the smallest height needed, in the pixels of the file.
+	 * \return Returns false if the image must be decoded at its full size.
+	 **/
+	bool																DecodeSize( void * _pvParm, uint32_t _ui32Width, uint32_t _ui32Height, uint32_t &_ui32NeededW, uint32_t &_ui32NeededH );
+
+	/**
+	 * Applies the conversion options to a loaded image.  FixResampling() must already have been called on the options for the image.
+	 * 
+	 * \param _oOptions The options to apply.
+	 * \param _iImage The image to which to apply the options.
+	 **/
+	void																ApplyOptions( const SL2_OPTIONS &_oOptions, CImage &_iImage );
+
+	/**
+	 * Converts a raw YUV file one frame at a time.  Frames are converted in parallel, with at most _oOptions.ui32YuvFramesInFlight frames in memory at once.
+	 *	Each frame is saved to its own file unless _oOptions.bYuvConcatenate is set, in which case the frames are written in order to a single raw YUV stream.
+	 * 
+	 * \param _ofFile The YUV file to convert.
+	 * \param _sPath The path to which to export the frames.
+	 * \param _oOptions Conversion and export options.
+	 * \param _pkifdFinalFormat The requested final format, or nullptr to keep the format of each frame.
+	 * \param _ui64Frames Holds the number of frames converted.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS															ConvertYuvFrames( const SL2_OPEN_FILE &_ofFile, const std::u16string &_sPath, const SL2_OPTIONS &_oOptions,
+		const CFormat::SL2_KTX_INTERNAL_FORMAT_DATA * _pkifdFinalFormat, uint64_t &_ui64Frames );
+
+	/**
+	 * A worker converting a streamed YUV file.  Takes frames from the queue in _pysStream until none remain or it is told to stop.
+	 * 
+	 * \param _pysStream The shared state of the conversion.
+	 **/
+	void																YuvFrameThread( SL2_YUV_STREAM * _pysStream );
+
+	/**
+	 * Loads, converts, and exports a single frame of a streamed YUV file.
+	 * 
+	 * \param _ysStream The shared state of the conversion.
+	 * \param _oOptions The options to pass to the exporters, which may modify them.
+	 * \param _yfFrame The frame to convert.
+	 **/
+	void																ConvertYuvFrame( SL2_YUV_STREAM &_ysStream, SL2_OPTIONS &_oOptions, SL2_YUV_FRAME &_yfFrame );
+
+	/**
+	 * Exports an image to a file whose type is determined by the extension of _sPath.  An empty path sends the image to the clipboard as PNG.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS															ExportImage( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions );
+
+	/**
+	 * Exports an image as YUV if the extension of _sPath or _oOptions.pkifdYuvFormat names a YUV format.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \param _bIsYuv Set to false if _sPath does not name a YUV file, in which case nothing is exported.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS															ExportImageAsYuv( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, bool &_bIsYuv );
+
+	/**
+	 * Exports every mipmap, array slice, face, and depth slice of an image to its own file.  Up to _oOptions.ui32ExportThreads surfaces are converted and
+	 *	encoded at once, and each thread holds only the surface it is exporting.  File names are decided before any thread starts, so they do not depend on
+	 *	the order in which the surfaces finish.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.  The indices of each surface are appended to its name.
+	 * \param _oOptions Export options.
+	 * \param _pfExport The function that exports a single surface.
+	 * \param _pcExt The extension of each file, or nullptr to use the extension of _sPath.
+	 * \return Returns an error code.  If more than one surface fails, the error of the first in export order is returned.
+	 **/
+	SL2_ERRORS															ExportSurfaces( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, PfExportSurface _pfExport,
+		const char16_t * _pcExt );
+
+	/**
+	 * Writes surfaces to a file in order.  A single thread packs the rows of up to SL2_PACK_QUEUE::sAhead surfaces ahead of the one being written, and each
+	 *	packed surface is released once it has been written.
+	 * 
+	 * \param _sfFile The file to which to write.
+	 * \param _vSurfaces The surfaces to write, in file order.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS															WriteSurfaces( CStdFile &_sfFile, std::vector<SL2_STREAM_SURFACE> &_vSurfaces );
+
+	/**
+	 * Writes a whole file.  If writing behind, the file is queued and written on a background thread, and failures are reported when the queue
+	 *	is finished.
+	 * 
+	 * \param _sPath The path of the file to create.
+	 * \param _vData The contents of the file.  Emptied if the file is queued.
+	 * \param _oOptions Options, including the write-behind queue.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS															SaveFile( const std::u16string &_sPath, std::vector<uint8_t> &_vData, SL2_OPTIONS &_oOptions );
+
+	/**
+	 * Determines whether the rows of a surface must be packed before they are written.  Surfaces whose rows are contiguous and unpadded are written
+	 *	straight from the image.
+	 * 
+	 * \param _ssSurface The surface to check.
+	 * \return Returns true if the rows of the surface must be packed.
+	 **/
+	bool																NeedsPacking( const SL2_STREAM_SURFACE &_ssSurface );
+
+	/**
+	 * Packs the rows of a surface that can't be written straight from the image.
+	 * 
+	 * \param _pssSurface The surface to pack.
+	 **/
+	void																PackSurface( SL2_STREAM_SURFACE * _pssSurface );
+
+	/**
+	 * The thread packing surfaces ahead of WriteSurfaces().  Takes surfaces in order until none remain or it is told to stop.
+	 * 
+	 * \param _ppqQueue The shared state of the write.
+	 **/
+	void																PackSurfacesThread( SL2_PACK_QUEUE * _ppqQueue );
+
 	/**
 	 * Exports as PNG.
 	 * 
@@ -214,6 +455,23 @@ namespace sl2 {
 	SL2_ERRORS															ExportAsPng_Indexed( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sArray, size_t _sFace, size_t _sSlice,
 		const CFormat::SL2_BEST_INTERNAL_FORMAT * _pbifFormat );
 
+	/**
+	 * Exports as PNG using CPngWriter.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \param _sMip The mipmap level to export.
+	 * \param _sArray The array index to export.
+	 * \param _sFace The face to export.
+	 * \param _sSlice The slice to export.
+	 * \param _pbifFormat The target format.
+	 * \param _ctColorType The PNG color type of _pbifFormat.
+	 * eturn Returns an error code.
+	 **/
+	SL2_ERRORS															ExportAsPng_Writer( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sArray, size_t _sFace, size_t _sSlice,
+		const CFormat::SL2_BEST_INTERNAL_FORMAT * _pbifFormat, CPngWriter::SL2_COLOR_TYPE _ctColorType );
+
 	/**
 	 * Exports as BMP.
 	 * 
@@ -276,6 +534,21 @@ namespace sl2 {
 	 **/
 	SL2_ERRORS															ExportAsExr( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sArray, size_t _sFace, size_t _sSlice );
 
+	/**
+	 * Exports as EXR using CExr.  Multiple mipmap levels are written to a single tiled, mipmapped file.
+	 * 
+	 * \param _iImage The image to export.
+	 * \param _sPath The path to which to export _iImage.
+	 * \param _oOptions Export options.
+	 * \param _sMip The first mipmap level to export.
+	 * \param _sMips The number of mipmap levels to export.
+	 * \param _sArray The array index to export.
+	 * \param _sFace The face to export.
+	 * \param _sSlice The slice to export.
+	 * \return Returns an error code.
+	 **/
+	SL2_ERRORS															ExportAsExr_CExr( CImage &_iImage, const std::u16string &_sPath, SL2_OPTIONS &_oOptions, size_t _sMip, size_t _sMips, size_t _sArray, size_t _sFace, size_t _sSlice );
+
 	/**
 	 * Exports as J2K.
 	 * 
@@ -0,0 +1,48 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Runs a fixed number of workers across threads drawn from a budget shared by the whole process.
+ */
+
+#include "SL2ParallelFor.h"
+
+
+namespace sl2 {
+
+	// == Members.
+	/** The number of threads currently started by Run(). */
+	std::atomic<size_t> CParallelFor::m_aBusy = 0;
+
+	// == Functions.
+	/**
+	 * Gets the number of threads Run() could start right now.  The calling thread is not counted.
+	 *
+	 * \return Returns the number of threads left in the budget.
+	 **/
+	size_t CParallelFor::Available() {
+		// The first caller runs on a core of its own, so the budget is 1 less than the number of cores.
+		size_t sLimit = std::max<size_t>( std::thread::hardware_concurrency(), 1 ) - 1;
+		size_t sBusy = m_aBusy.load( std::memory_order_relaxed );
+		return sBusy < sLimit ? sLimit - sBusy : 0;
+	}
+
+	/**
+	 * Takes up to _sWanted threads from the budget.
+	 *
+	 * \param _sWanted The number of threads wanted.
+	 * \return Returns the number of threads taken.
+	 **/
+	size_t CParallelFor::Acquire( size_t _sWanted ) {
+		if ( !_sWanted ) { return 0; }
+		size_t sLimit = std::max<size_t>( std::thread::hardware_concurrency(), 1 ) - 1;
+		size_t sBusy = m_aBusy.load( std::memory_order_relaxed );
+		while ( true ) {
+			if ( sBusy >= sLimit ) { return 0; }
+			size_t sTake = std::min( _sWanted, sLimit - sBusy );
+			if ( m_aBusy.compare_exchange_weak( sBusy, sBusy + sTake ) ) { return sTake; }
+		}
+	}
+
+}	// namespace sl2
@@ -0,0 +1,106 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: Runs a fixed number of workers across threads drawn from a budget shared by the whole process.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CParallelFor
+	 * \brief Runs a fixed number of workers across threads drawn from a budget shared by the whole process.
+	 *
+	 * Description: Runs a fixed number of workers across threads drawn from a budget shared by the whole process.  Worker 0
+	 *	always runs on the calling thread.  The others run on new threads while the budget allows it, and on the calling
+	 *	thread, in order, when it does not or when a thread cannot be created.  Because a nested Run() finds the budget
+	 *	already spent by the outer one, nesting does not multiply the number of threads.
+	 */
+	class CParallelFor {
+	public :
+		// == Functions.
+		/**
+		 * Gets the number of workers worth creating for a job.  This is only a hint; Run() gives correct results for any number
+		 *	of workers.
+		 *
+		 * \param _sMax The most workers the job can use.
+		 * \return Returns the number of workers, from 1 to _sMax (0 if _sMax is 0).
+		 **/
+		static size_t										Workers( size_t _sMax ) {
+			return std::min( _sMax, Available() + 1 );
+		}
+
+		/**
+		 * Calls _fFunc( T ) once for every T in [0, _sWorkers).  Returns when all calls have returned.  _fFunc must not throw.
+		 *	Workers that do not get a thread are run after worker 0 on the calling thread, so workers that wait on each other
+		 *	must take their work from a shared counter rather than wait on a particular worker.
+		 *
+		 * \param _sWorkers The number of workers.
+		 * \param _fFunc The function to call for each worker.
+		 **/
+		template <typename _tFunc>
+		static void											Run( size_t _sWorkers, const _tFunc &_fFunc ) {
+			if ( !_sWorkers ) { return; }
+			size_t sGranted = Acquire( _sWorkers - 1 );
+			std::vector<std::thread> vThreads;
+			try {
+				vThreads.reserve( sGranted );
+				for ( size_t T = 1; T <= sGranted; ++T ) {
+					vThreads.push_back( std::thread( [&_fFunc, T]() { _fFunc( T ); } ) );
+				}
+			}
+			catch ( ... ) {}
+			size_t sStarted = vThreads.size();
+			Release( sGranted - sStarted );
+
+			_fFunc( 0 );
+			for ( size_t T = sStarted + 1; T < _sWorkers; ++T ) {
+				_fFunc( T );
+			}
+			for ( auto & tThis : vThreads ) {
+				tThis.join();
+			}
+			Release( sStarted );
+		}
+
+
+	protected :
+		// == Members.
+		/** The number of threads currently started by Run(). */
+		static std::atomic<size_t>							m_aBusy;
+
+
+		// == Functions.
+		/**
+		 * Gets the number of threads Run() could start right now.  The calling thread is not counted.
+		 *
+		 * \return Returns the number of threads left in the budget.
+		 **/
+		static size_t										Available();
+
+		/**
+		 * Takes up to _sWanted threads from the budget.
+		 *
+		 * \param _sWanted The number of threads wanted.
+		 * \return Returns the number of threads taken.
+		 **/
+		static size_t										Acquire( size_t _sWanted );
+
+		/**
+		 * Returns threads to the budget.
+		 *
+		 * \param _sCount The number of threads to return.
+		 **/
+		static void											Release( size_t _sCount ) { if ( _sCount ) { m_aBusy.fetch_sub( _sCount ); } }
+	};
+
+}	// namespace sl2
@@ -11,6 +11,7 @@
 #include "../Utilities/SL2Utilities.h"
 
 #include <immintrin.h>
+#include <limits>
 
 
 namespace sl2 {
@@ -110,25 +111,36 @@ namespace sl2 {
 
 		uint32_t ui32DstW = ui32H;
 		uint32_t ui32DstH = ui32NewW;
+		// Integer reductions (mipmaps) share one set of weights across the interior and are convolved a row at a time.
+		SL2_PERIODIC_RUN prRun;
+		bool bRun = FindPeriodicRun( ui32W, prRun );
 		for ( size_t I = 0; I < (rRes.bAlpha ? 4 : 3); ++I ) {
 			if ( I == 3 ) {
 				// Alpha channel.
 				if ( !CreateContribList( ui32W, ui32NewW, rRes.taAlphaW, rRes.fAlphaFilterW.pfFunc, rRes.fAlphaFilterW.dfSupport, rRes.fFilterScale ) ) { return false; }
+				bRun = FindPeriodicRun( ui32W, prRun );
 			}
 			for ( size_t D = 0; D < ui32D; ++D ) {
 				for ( size_t H = 0; H < ui32H; ++H ) {
 					const double * pdRowStart = _pdIn + I + ((sPagesSize * D) + (H * ui32W * 4));
+					if ( bRun ) { ConvolvePeriodic( pdRowStart, 4, prRun ); }
 					for ( size_t W = 0; W < ui32NewW; ++W ) {
-						for ( size_t J = 0; J < m_cContribs[W].i32Indices.size(); ++J ) {
-							int32_t i32Index = m_cContribs[W].i32Indices[J];
-							if ( i32Index == -1 ) {
-								m_dBuffer[J] = rRes.dBorderColor[I];
-							}
-							else {
-								m_dBuffer[J] = pdRowStart[i32Index*4];
+						double dConvolved;
+						if ( bRun && W >= prRun.sFirst && W < prRun.sEnd ) {
+							dConvolved = m_dRun[W-prRun.sFirst];
+						}
+						else {
+							for ( size_t J = 0; J < m_cContribs[W].i32Indices.size(); ++J ) {
+								int32_t i32Index = m_cContribs[W].i32Indices[J];
+								if ( i32Index == -1 ) {
+									m_dBuffer[J] = rRes.dBorderColor[I];
+								}
+								else {
+									m_dBuffer[J] = pdRowStart[i32Index*4];
+								}
 							}
+							dConvolved = ConvolveAligned( m_cContribs[W].dContributions.data(), m_dBuffer.data(), m_cContribs[W].dContributions.size() );
 						}
-						double dConvolved = ConvolveAligned( m_cContribs[W].dContributions.data(), m_dBuffer.data(), m_cContribs[W].dContributions.size() );
 						size_t sDstIdx = (sNewPagesSize * D) + (W * ui32H) + H;
 						pdDst[I][sDstIdx] = dConvolved;
 					}
@@ -143,17 +155,23 @@ namespace sl2 {
 		uint32_t tW = ui32H;
 		uint32_t tH = ui32NewW;
 		double * pdDst2[4] = { dBufferR2.data(), dBufferG2.data(), dBufferB2.data(), dBufferA2.data() };
+		bRun = FindPeriodicRun( ui32H, prRun );
 		for ( size_t I = 0; I < (rRes.bAlpha ? 4 : 3); ++I ) {
 			if ( I == 3 ) {
 				// Alpha channel.
 				if ( !CreateContribList( ui32H, ui32NewH, rRes.taAlphaH, rRes.fAlphaFilterH.pfFunc, rRes.fAlphaFilterH.dfSupport, rRes.fFilterScale ) ) { return false; }
+				bRun = FindPeriodicRun( ui32H, prRun );
 			}
 			for ( size_t D = 0; D < ui32D; ++D ) {
 				for ( size_t H = 0; H < tH; ++H ) {
 					const double * pdRowStart = pdDst[I] + (sPagesSize * D) + (H * tW);
+					if ( bRun ) { ConvolvePeriodic( pdRowStart, 1, prRun ); }
 					for ( size_t W = 0; W < ui32NewH; ++W ) {
 						double dConvolved;
-						if ( m_cContribs[W].bInsideBounds ) {
+						if ( bRun && W >= prRun.sFirst && W < prRun.sEnd ) {
+							dConvolved = m_dRun[W-prRun.sFirst];
+						}
+						else if ( m_cContribs[W].bInsideBounds ) {
 							dConvolved = ConvolveUnaligned( m_cContribs[W].dContributions.data(), pdRowStart + m_cContribs[W].i32Indices[0], m_cContribs[W].dContributions.size() );
 						}
 						else {
@@ -190,17 +208,23 @@ namespace sl2 {
 			tH = ui32NewW;
 			uint32_t tD = ui32NewH;
 
+			bRun = FindPeriodicRun( ui32D, prRun );
 			for ( size_t I = 0; I < (rRes.bAlpha ? 4 : 3); ++I ) {
 				if ( I == 3 ) {
 					// Alpha channel.
 					if ( !CreateContribList( ui32D, ui32NewD, rRes.taAlphaD, rRes.fAlphaFilterD.pfFunc, rRes.fAlphaFilterD.dfSupport, rRes.fFilterScale ) ) { return false; }
+					bRun = FindPeriodicRun( ui32D, prRun );
 				}
 				for ( size_t D = 0; D < tD; ++D ) {
 					for ( size_t H = 0; H < tH; ++H ) {
 						const double * pdRowStart = pdDst2[I] + (sPagesSize * D) + (H * ui32D);
+						if ( bRun ) { ConvolvePeriodic( pdRowStart, 1, prRun ); }
 						for ( size_t W = 0; W < tW; ++W ) {
 							double dConvolved;
-							if ( m_cContribs[W].bInsideBounds ) {
+							if ( bRun && W >= prRun.sFirst && W < prRun.sEnd ) {
+								dConvolved = m_dRun[W-prRun.sFirst];
+							}
+							else if ( m_cContribs[W].bInsideBounds ) {
 								dConvolved = ConvolveUnaligned( m_cContribs[W].dContributions.data(), pdRowStart + m_cContribs[W].i32Indices[0], m_cContribs[W].dContributions.size() );
 							}
 							else {
@@ -579,6 +603,186 @@ namespace sl2 {
 		return dSum[0];
 	}
 
+	/**
+	 * Adds a weighted row to another row.
+	 *
+	 * \param _pdDst The row to which to add.
+	 * \param _pdSrc The row to weigh and add to _pdDst.
+	 * \param _dWeight The weight.
+	 * \param _sTotal The number of values in each row.
+	 **/
+	void CResampler::AddWeightedRow( double * _pdDst, const double * _pdSrc, double _dWeight, size_t _sTotal ) {
+#ifdef __AVX512F__
+		if ( CUtilities::IsAvx512FSupported() ) {
+			__m512d mWeight = _mm512_set1_pd( _dWeight );
+			while ( _sTotal >= sizeof( __m512d ) / sizeof( double ) ) {
+				_mm512_storeu_pd( _pdDst, _mm512_add_pd( _mm512_loadu_pd( _pdDst ), _mm512_mul_pd( _mm512_loadu_pd( _pdSrc ), mWeight ) ) );
+				_pdDst += sizeof( __m512d ) / sizeof( double );
+				_pdSrc += sizeof( __m512d ) / sizeof( double );
+				_sTotal -= sizeof( __m512d ) / sizeof( double );
+			}
+		}
+#endif	// #ifdef __AVX512F__
+
+#ifdef __AVX__
+		if ( CUtilities::IsAvxSupported() ) {
+			__m256d mWeight = _mm256_set1_pd( _dWeight );
+			while ( _sTotal >= sizeof( __m256d ) / sizeof( double ) ) {
+				_mm256_storeu_pd( _pdDst, _mm256_add_pd( _mm256_loadu_pd( _pdDst ), _mm256_mul_pd( _mm256_loadu_pd( _pdSrc ), mWeight ) ) );
+				_pdDst += sizeof( __m256d ) / sizeof( double );
+				_pdSrc += sizeof( __m256d ) / sizeof( double );
+				_sTotal -= sizeof( __m256d ) / sizeof( double );
+			}
+		}
+#endif	// #ifdef __AVX__
+
+		while ( _sTotal-- ) {
+			(*_pdDst++) += (*_pdSrc++) * _dWeight;
+		}
+	}
+
+	/**
+	 * Finds the run of output texels whose contributions are the same weights applied at a fixed source step.  This
+	 *	happens when the source size is an integer multiple of the destination size (2:1 mipmaps, 4:1, etc.)  The run is
+	 *	found by comparing the contribution lists themselves, so ConvolvePeriodic() uses exactly the weights the general
+	 *	path would use.
+	 *
+	 * \param _ui32SrcSize The source size given to CreateContribList().
+	 * \param _prRun Holds the returned run.
+	 * \return Returns true if a run long enough to be worth using was found and its buffers could be allocated.
+	 **/
+	bool CResampler::FindPeriodicRun( uint32_t _ui32SrcSize, SL2_PERIODIC_RUN &_prRun ) {
+		_prRun.sFirst = _prRun.sEnd = _prRun.sStep = 0;
+		size_t sDst = m_cContribs.size();
+		if ( !sDst || _ui32SrcSize < sDst || (_ui32SrcSize % sDst) != 0 ) { return false; }
+		size_t sStep = _ui32SrcSize / sDst;
+
+		// The middle texel is the one most likely to be away from the borders.
+		size_t sRef = sDst / 2;
+		const SL2_CONTRIBUTIONS & cRef = m_cContribs[sRef];
+		if ( !cRef.bInsideBounds || !cRef.dContributions.size() ) { return false; }
+		auto Matches = [&]( size_t _sIdx ) {
+			const SL2_CONTRIBUTIONS & cThis = m_cContribs[_sIdx];
+			return cThis.bInsideBounds && cThis.dContributions.size() == cRef.dContributions.size() &&
+				int64_t( cThis.i32Indices[0] ) - int64_t( cRef.i32Indices[0] ) == (int64_t( _sIdx ) - int64_t( sRef )) * int64_t( sStep ) &&
+				std::memcmp( cThis.dContributions.data(), cRef.dContributions.data(), cRef.dContributions.size() * sizeof( double ) ) == 0;
+		};
+		size_t sFirst = sRef, sEnd = sRef + 1;
+		while ( sFirst > 0 && Matches( sFirst - 1 ) ) { --sFirst; }
+		while ( sEnd < sDst && Matches( sEnd ) ) { ++sEnd; }
+		// Splitting the row into phases costs more than it saves on tiny runs.
+		if ( sEnd - sFirst < 8 ) { return false; }
+
+		try {
+			m_dPhases.resize( _ui32SrcSize );
+			m_dRun.resize( sEnd - sFirst );
+		}
+		catch ( ... ) { return false; }
+		_prRun.sFirst = sFirst;
+		_prRun.sEnd = sEnd;
+		_prRun.sStep = sStep;
+		return true;
+	}
+
+	/**
+	 * Convolves every texel in a run found by FindPeriodicRun() at once, storing the results in m_dRun.  The row is split
+	 *	into _prRun.sStep phases so that each tap becomes a weighted add of contiguous texels.
+	 *
+	 * \param _pdRow The source row.
+	 * \param _sStride The distance between texels in _pdRow, in doubles.
+	 * \param _prRun The run returned by FindPeriodicRun().
+	 **/
+	void CResampler::ConvolvePeriodic( const double * _pdRow, size_t _sStride, const SL2_PERIODIC_RUN &_prRun ) {
+		// Phase P holds texels P, P + sStep, P + sStep * 2, etc.
+		size_t sPhaseLen = m_cContribs.size();
+		const double * pdPhases = _pdRow;
+		if ( _prRun.sStep != 1 || _sStride != 1 ) {
+			double * pdPhase = m_dPhases.data();
+			for ( size_t J = 0; J < sPhaseLen; ++J ) {
+				const double * pdSrc = _pdRow + J * _prRun.sStep * _sStride;
+				for ( size_t P = 0; P < _prRun.sStep; ++P ) {
+					pdPhase[P*sPhaseLen+J] = pdSrc[P*_sStride];
+				}
+			}
+			pdPhases = pdPhase;
+		}
+
+		const SL2_CONTRIBUTIONS & cRun = m_cContribs[_prRun.sFirst];
+		size_t sTaps = cRun.dContributions.size();
+		size_t sTotal = _prRun.sEnd - _prRun.sFirst;
+		double * pdOut = m_dRun.data();
+		// Tap T of output texel O reads source texel cRun.i32Indices[0] + T + O * sStep, which is texel O + (cRun.i32Indices[0] + T) / sStep of
+		//	phase (cRun.i32Indices[0] + T) % sStep.  Blocks keep the outputs in the cache while every tap is added.
+		constexpr size_t sBlockSize = 512;
+		for ( size_t B = 0; B < sTotal; B += sBlockSize ) {
+			size_t sBlock = std::min( sBlockSize, sTotal - B );
+			std::memset( pdOut + B, 0, sBlock * sizeof( double ) );
+			for ( size_t T = 0; T < sTaps; ++T ) {
+				size_t sIdx = size_t( cRun.i32Indices[0] ) + T;
+				AddWeightedRow( pdOut + B, pdPhases + (sIdx % _prRun.sStep) * sPhaseLen + (sIdx / _prRun.sStep) + B, cRun.dContributions[T], sBlock );
+			}
+		}
+	}
+
+	/**
+	 * Measures the largest difference between ConvolvePeriodic() and the general per-texel convolution Resample() uses
+	 *	elsewhere, over one row of pseudo-random texels.  Every output texel in the run found by FindPeriodicRun() is
+	 *	checked against the convolution of its own contribution list.
+	 *
+	 * \param _ui32SrcSize Size of the source.
+	 * \param _ui32DstSize Size of the destination.
+	 * \param _taAddressMode Texture addressing mode.
+	 * \param _fFilter The filter.
+	 * \param _sStride The distance between texels in the row, in doubles (4 for the width pass, 1 for the others).
+	 * \param _sRunTexels Holds the number of output texels convolved by ConvolvePeriodic(), which is 0 if no run was found.
+	 * \return Returns the largest absolute difference found, or infinity if the contribution list could not be created.
+	 */
+	double CResampler::PeriodicMaxError( uint32_t _ui32SrcSize, uint32_t _ui32DstSize,
+		SL2_TEXTURE_ADDRESSING _taAddressMode, const SL2_FILTER &_fFilter, size_t _sStride, size_t &_sRunTexels ) {
+		_sRunTexels = 0;
+		CResampler rResampler;
+		if ( !rResampler.CreateContribList( _ui32SrcSize, _ui32DstSize, _taAddressMode, _fFilter.pfFunc, _fFilter.dfSupport, 1.0f ) ) { return std::numeric_limits<double>::infinity(); }
+
+		std::vector<double> vRow;
+		try {
+			vRow.resize( size_t( _ui32SrcSize ) * _sStride );
+		}
+		catch ( ... ) { return std::numeric_limits<double>::infinity(); }
+		// A fixed LCG so that failures can be reproduced.
+		uint32_t ui32Seed = 0x2545F491;
+		for ( size_t I = 0; I < vRow.size(); ++I ) {
+			ui32Seed = ui32Seed * 1664525 + 1013904223;
+			vRow[I] = (ui32Seed >> 8) * (1.0 / 16777216.0);
+		}
+
+		SL2_PERIODIC_RUN prRun;
+		if ( !rResampler.FindPeriodicRun( _ui32SrcSize, prRun ) ) { return 0.0; }
+		rResampler.ConvolvePeriodic( vRow.data(), _sStride, prRun );
+
+		constexpr double dBorder = 0.25;
+		double dMax = 0.0;
+		for ( size_t W = prRun.sFirst; W < prRun.sEnd; ++W ) {
+			// The same gathers Resample() does for texels outside of a run.
+			const SL2_CONTRIBUTIONS & cThis = rResampler.m_cContribs[W];
+			double dConvolved;
+			if ( _sStride == 1 && cThis.bInsideBounds ) {
+				dConvolved = ConvolveUnaligned( cThis.dContributions.data(), vRow.data() + cThis.i32Indices[0], cThis.dContributions.size() );
+			}
+			else {
+				for ( size_t J = 0; J < cThis.i32Indices.size(); ++J ) {
+					int32_t i32Index = cThis.i32Indices[J];
+					rResampler.m_dBuffer[J] = i32Index == -1 ? dBorder : vRow[i32Index*_sStride];
+				}
+				dConvolved = ConvolveAligned( cThis.dContributions.data(), rResampler.m_dBuffer.data(), cThis.dContributions.size() );
+			}
+			double dErr = std::fabs( rResampler.m_dRun[W-prRun.sFirst] - dConvolved );
+			// Written so that NaN is reported.
+			if ( !(dErr <= dMax) ) { dMax = std::isnan( dErr ) ? std::numeric_limits<double>::infinity() : dErr; }
+		}
+		_sRunTexels = prRun.sEnd - prRun.sFirst;
+		return dMax;
+	}
+
 	/**
 	 * Applies an N64-style bilinear filter to a 2D CVector4<SL2_ST_RAW> texture.
 	 * The algorithm matches the HLSL n64BilinearFilter function using unfiltered texel loads.
@@ -15,6 +15,7 @@
 #include "../Utilities/SL2Vector4.h"
 
 #include <cmath>
+#include <cstring>
 #include <numbers>
 #include <vector>
 
@@ -161,6 +162,39 @@ namespace sl2 {
 			SL2_TEXTURE_ADDRESSING _taAddressMode,
 			PfFilterFunc _pfFilter, double _dFilterSupport, float _fFilterScale );
 
+		/**
+		 * Gets the contribution list created by the last call to CreateContribList().
+		 *
+		 * \return Returns a constant reference to the contribution list.
+		 */
+		inline const std::vector<SL2_CONTRIBUTIONS> &			Contributions() const { return m_cContribs; }
+
+		/**
+		 * Measures the largest difference between ConvolvePeriodic() and the general per-texel convolution Resample() uses
+		 *	elsewhere, over one row of pseudo-random texels.  Every output texel in the run found by FindPeriodicRun() is
+		 *	checked against the convolution of its own contribution list.
+		 *
+		 * \param _ui32SrcSize Size of the source.
+		 * \param _ui32DstSize Size of the destination.
+		 * \param _taAddressMode Texture addressing mode.
+		 * \param _fFilter The filter.
+		 * \param _sStride The distance between texels in the row, in doubles (4 for the width pass, 1 for the others).
+		 * \param _sRunTexels Holds the number of output texels convolved by ConvolvePeriodic(), which is 0 if no run was found.
+		 * \return Returns the largest absolute difference found, or infinity if the contribution list could not be created.
+		 */
+		static double											PeriodicMaxError( uint32_t _ui32SrcSize, uint32_t _ui32DstSize,
+			SL2_TEXTURE_ADDRESSING _taAddressMode, const SL2_FILTER &_fFilter, size_t _sStride, size_t &_sRunTexels );
+
+		/**
+		 * Adds a weighted row to another row.
+		 *
+		 * \param _pdDst The row to which to add.
+		 * \param _pdSrc The row to weigh and add to _pdDst.
+		 * \param _dWeight The weight.
+		 * \param _sTotal The number of values in each row.
+		 **/
+		static void												AddWeightedRow( double * _pdDst, const double * _pdSrc, double _dWeight, size_t _sTotal );
+
 		/**
 		 * Standard sinc() function.
 		 * 
@@ -754,11 +788,23 @@ namespace sl2 {
 		} * LPSL2_CONTRIB_BOUNDS, * const LPCSL2_CONTRIB_BOUNDS;
 
 
+		/** A run of output texels that share one set of weights, each starting a fixed step further into the source. */
+		struct SL2_PERIODIC_RUN {
+			size_t												sFirst;
+			size_t												sEnd;
+			size_t												sStep;
+		};
+
+
 		// == Members.
 		/** Our array of contributions. */
 		std::vector<SL2_CONTRIBUTIONS>							m_cContribs;
 		/** Buffer for convolution. */
 		std::vector<double, CAlignmentAllocator<double, 64>>	m_dBuffer;
+		/** A source row split into its phases for ConvolvePeriodic(). */
+		std::vector<double, CAlignmentAllocator<double, 64>>	m_dPhases;
+		/** The output of ConvolvePeriodic(). */
+		std::vector<double, CAlignmentAllocator<double, 64>>	m_dRun;
 
 
 		// == Functions.
@@ -782,6 +828,28 @@ namespace sl2 {
 		 **/
 		static double											ConvolveUnaligned( const double * _pdWeights, const double * _pdTexels, size_t _sTotal );
 
+		/**
+		 * Finds the run of output texels whose contributions are the same weights applied at a fixed source step.  This
+		 *	happens when the source size is an integer multiple of the destination size (2:1 mipmaps, 4:1, etc.)  The run is
+		 *	found by comparing the contribution lists themselves, so ConvolvePeriodic() uses exactly the weights the general
+		 *	path would use.
+		 *
+		 * \param _ui32SrcSize The source size given to CreateContribList().
+		 * \param _prRun Holds the returned run.
+		 * \return Returns true if a run long enough to be worth using was found and its buffers could be allocated.
+		 **/
+		bool													FindPeriodicRun( uint32_t _ui32SrcSize, SL2_PERIODIC_RUN &_prRun );
+
+		/**
+		 * Convolves every texel in a run found by FindPeriodicRun() at once, storing the results in m_dRun.  The row is split
+		 *	into _prRun.sStep phases so that each tap becomes a weighted add of contiguous texels.
+		 *
+		 * \param _pdRow The source row.
+		 * \param _sStride The distance between texels in _pdRow, in doubles.
+		 * \param _prRun The run returned by FindPeriodicRun().
+		 **/
+		void													ConvolvePeriodic( const double * _pdRow, size_t _sStride, const SL2_PERIODIC_RUN &_prRun );
+
 	};
 
 }	// namespace sl2
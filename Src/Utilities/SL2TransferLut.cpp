@@ -0,0 +1,403 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: A high-resolution look-up table for transfer functions (gamma curves, ICC curves, etc.)
+ *	Tables are validated against the exact function when they are built and will fall back to the exact
+ *	function for any input outside of the range they cover.
+ */
+
+#include "SL2TransferLut.h"
+#include "SL2Utilities.h"
+#include "../Thread/SL2ParallelFor.h"
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#ifdef _DEBUG
+#include <cassert>
+#endif	// #ifdef _DEBUG
+
+
+// The smallest table tried.
+#define SL2_TLUT_MIN_INTERVALS						1024
+// The largest table tried (512 kilobytes).
+#define SL2_TLUT_MAX_INTERVALS						(1 << 16)
+// Texel count above which TransformRgb() splits the work across threads.
+#define SL2_TLUT_THREAD_TEXELS						(1 << 18)
+
+namespace sl2 {
+
+	// == Members.
+	/** The default maximum error allowed in a table.  Comfortably below the quantization step of 16-bit formats. */
+	double CTransferLut::m_dMaxError = 1.0e-6;
+
+	/** Buffers with fewer than this many texels are converted with the exact functions rather than building a new table. */
+	size_t CTransferLut::m_sMinTexels = 64 * 64;
+
+	CTransferLut::CTransferLut() :
+		m_sIntervals( 0 ),
+		m_dLow( 0.0 ),
+		m_dError( 0.0 ),
+		m_pfFunc( nullptr ),
+		m_pfParmFunc( nullptr ),
+		m_pvParm( nullptr ),
+		m_dPow( 1.0 ) {
+	}
+	CTransferLut::~CTransferLut() {
+	}
+
+	// == Functions.
+	/**
+	 * Creates a table for a plain transfer function.
+	 *
+	 * \param _pfFunc The function to tabulate.
+	 * \param _dMaxError The maximum absolute error allowed between the table and _pfFunc inside the table's range.
+	 * \return Returns true if a table meeting the error requirement could be created.  If false is returned, Sample() still works but always calls the exact function.
+	 **/
+	bool CTransferLut::CreateLut( PfFunc _pfFunc, double _dMaxError ) {
+		Reset();
+		if ( !_pfFunc ) { return false; }
+		m_pfFunc = _pfFunc;
+		return Build( _dMaxError );
+	}
+
+	/**
+	 * Creates a table for a transfer function that takes a parameter.  _pvParm must remain valid for the lifetime of the table.
+	 *
+	 * \param _pfFunc The function to tabulate.
+	 * \param _pvParm The parameter to pass to _pfFunc.
+	 * \param _dMaxError The maximum absolute error allowed between the table and _pfFunc inside the table's range.
+	 * \return Returns true if a table meeting the error requirement could be created.  If false is returned, Sample() still works but always calls the exact function.
+	 **/
+	bool CTransferLut::CreateLut( PfParmFunc _pfFunc, const void * _pvParm, double _dMaxError ) {
+		Reset();
+		if ( !_pfFunc ) { return false; }
+		m_pfParmFunc = _pfFunc;
+		m_pvParm = _pvParm;
+		return Build( _dMaxError );
+	}
+
+	/**
+	 * Creates a table for std::pow( X, _dPow ).
+	 *
+	 * \param _dPow The power.
+	 * \param _dMaxError The maximum absolute error allowed between the table and std::pow() inside the table's range.
+	 * \return Returns true if a table meeting the error requirement could be created.  If false is returned, Sample() still works but always calls the exact function.
+	 **/
+	bool CTransferLut::CreatePowLut( double _dPow, double _dMaxError ) {
+		Reset();
+		m_dPow = _dPow;
+		return Build( _dMaxError );
+	}
+
+	/**
+	 * Resets the table to nothing.
+	 **/
+	void CTransferLut::Reset() {
+		m_vTable = std::vector<double, CAlignmentAllocator<double, 64>>();
+		m_vExact = std::vector<uint8_t>();
+		m_sIntervals = 0;
+		m_dLow = 0.0;
+		m_dError = 0.0;
+		m_pfFunc = nullptr;
+		m_pfParmFunc = nullptr;
+		m_pvParm = nullptr;
+		m_dPow = 1.0;
+	}
+
+	/**
+	 * Gets the number of intervals above Low() that failed validation and are evaluated with the exact function.
+	 *
+	 * \return Returns the number of intervals that use the exact function.
+	 **/
+	size_t CTransferLut::ExactIntervals() const {
+		return size_t( std::count( m_vExact.begin(), m_vExact.end(), uint8_t( 1 ) ) );
+	}
+
+	/**
+	 * Applies a table per channel to the RGB channels of an RGBA64F buffer.  Alpha is untouched.  Large buffers are split across threads.
+	 *
+	 * \param _pdRgba The RGBA64F texels to convert in-place.
+	 * \param _sTotal The number of texels to which _pdRgba points.
+	 * \param _tlR The table for the R channel.
+	 * \param _tlG The table for the G channel.
+	 * \param _tlB The table for the B channel.
+	 **/
+	void CTransferLut::TransformRgb( double * _pdRgba, size_t _sTotal, const CTransferLut &_tlR, const CTransferLut &_tlG, const CTransferLut &_tlB ) {
+		size_t sThreads = _sTotal < SL2_TLUT_THREAD_TEXELS ? 1 : CParallelFor::Workers( _sTotal / (SL2_TLUT_THREAD_TEXELS / 4) );
+		if ( sThreads <= 1 ) {
+			TransformRgbRange( _pdRgba, _sTotal, _tlR, _tlG, _tlB );
+			return;
+		}
+		size_t sChunk = (_sTotal + sThreads - 1) / sThreads;
+		CParallelFor::Run( sThreads, [&]( size_t _sWorker ) {
+			size_t sStart = std::min( sChunk * _sWorker, _sTotal );
+			TransformRgbRange( _pdRgba + sStart * 4, std::min( sChunk, _sTotal - sStart ), _tlR, _tlG, _tlB );
+		} );
+	}
+
+	/**
+	 * Measures the maximum error of Sample() and TransformRgb() against the exact functions of the given tables over every
+	 *	16-bit input and 8 points inside every interval of each table.  Each channel is given different inputs so that the
+	 *	per-channel paths of TransformRgb() are checked.
+	 *
+	 * \param _tlR The table for the R channel.
+	 * \param _tlG The table for the G channel.
+	 * \param _tlB The table for the B channel.
+	 * \return Returns the maximum absolute error found.  NaN results that don't match the exact function count as infinite error.
+	 **/
+	double CTransferLut::MaxError( const CTransferLut &_tlR, const CTransferLut &_tlG, const CTransferLut &_tlB ) {
+		const CTransferLut * ptlTables[3] = { &_tlR, &_tlG, &_tlB };
+		size_t sTotal = 0;
+		for ( size_t C = 0; C < 3; ++C ) {
+			sTotal = std::max( sTotal, 65536 + ptlTables[C]->m_sIntervals * 8 );
+		}
+		// The 16-bit inputs are rotated per channel, and each channel wraps around its own intervals.
+		auto Input = [&]( size_t _sChan, size_t _sIdx ) {
+			if ( _sIdx < 65536 ) { return double( (_sIdx + _sChan * 21845) % 65536 ) / 65535.0; }
+			size_t sIntervals = ptlTables[_sChan]->m_sIntervals;
+			if ( !sIntervals ) { return double( _sIdx % 65536 ) / 65535.0; }
+			size_t sPoint = (_sIdx - 65536) % (sIntervals * 8);
+			return ((sPoint >> 3) + (sPoint & 7) * 0.125) / double( sIntervals );
+		};
+
+		std::vector<double> vRgba;
+		try {
+			vRgba.resize( sTotal * 4 );
+		}
+		catch ( ... ) { return std::numeric_limits<double>::infinity(); }
+		for ( size_t I = 0; I < sTotal; ++I ) {
+			for ( size_t C = 0; C < 3; ++C ) {
+				vRgba[I*4+C] = Input( C, I );
+			}
+			vRgba[I*4+3] = 0.5;
+		}
+		TransformRgb( vRgba.data(), sTotal, _tlR, _tlG, _tlB );
+
+		double dMax = 0.0;
+		auto Check = [&]( double _dVal, double _dExact ) {
+			if ( _dVal == _dExact || (std::isnan( _dVal ) && std::isnan( _dExact )) ) { return; }
+			double dErr = std::abs( _dVal - _dExact );
+			dMax = std::isnan( dErr ) ? std::numeric_limits<double>::infinity() : std::max( dMax, dErr );
+		};
+		for ( size_t I = 0; I < sTotal; ++I ) {
+			for ( size_t C = 0; C < 3; ++C ) {
+				double dIn = Input( C, I );
+				double dExact = ptlTables[C]->Exact( dIn );
+				Check( ptlTables[C]->Sample( dIn ), dExact );
+				Check( vRgba[I*4+C], dExact );
+			}
+			// Alpha must be untouched.
+			Check( vRgba[I*4+3], 0.5 );
+		}
+		return dMax;
+	}
+
+	/**
+	 * Gets a shared table for a plain transfer function, creating it on the first request.  Plain transfer functions have no state, so
+	 *	their tables are created only once for the lifetime of the process.  Thread-safe.
+	 *
+	 * \param _pfFunc The function whose table is to be obtained.
+	 * \return Returns the shared table for the given function.  The table may not be Valid(), in which case it evaluates the exact function.
+	 **/
+	const CTransferLut & CTransferLut::Cached( PfFunc _pfFunc ) {
+		static std::mutex mMutex;
+		static std::map<PfFunc, std::unique_ptr<CTransferLut>> mTables;
+		std::lock_guard<std::mutex> lgLock( mMutex );
+		auto aFound = mTables.find( _pfFunc );
+		if ( aFound != mTables.end() ) { return (*aFound->second); }
+
+		auto & upTable = mTables[_pfFunc];
+		upTable = std::make_unique<CTransferLut>();
+		upTable->CreateLut( _pfFunc );
+		return (*upTable);
+	}
+
+	/**
+	 * Gets a shared table for std::pow( X, _dPow ), creating it on the first request.  Thread-safe.
+	 *
+	 * \param _dPow The power.
+	 * \return Returns the shared table for the given power.
+	 **/
+	const CTransferLut & CTransferLut::CachedPow( double _dPow ) {
+		static std::mutex mMutex;
+		static std::map<double, std::unique_ptr<CTransferLut>> mTables;
+		std::lock_guard<std::mutex> lgLock( mMutex );
+		auto aFound = mTables.find( _dPow );
+		if ( aFound != mTables.end() ) { return (*aFound->second); }
+
+		auto & upTable = mTables[_dPow];
+		upTable = std::make_unique<CTransferLut>();
+		upTable->CreatePowLut( _dPow );
+		return (*upTable);
+	}
+
+	/**
+	 * Builds and validates the table from the currently set exact function.  The table size is doubled until the error requirement is met.
+	 *
+	 * \param _dMaxError The maximum error allowed.
+	 * \return Returns true if the table meets the error requirement.
+	 **/
+	bool CTransferLut::Build( double _dMaxError ) {
+		m_vTable = std::vector<double, CAlignmentAllocator<double, 64>>();
+		m_vExact = std::vector<uint8_t>();
+		m_sIntervals = 0;
+		m_dLow = 0.0;
+		m_dError = 0.0;
+		if ( !(_dMaxError > 0.0) ) { return false; }
+
+		std::vector<double, CAlignmentAllocator<double, 64>> vTable;
+		std::vector<uint8_t> vExact;
+		for ( size_t sIntervals = SL2_TLUT_MIN_INTERVALS; sIntervals <= SL2_TLUT_MAX_INTERVALS; sIntervals <<= 1 ) {
+			try {
+				vTable.resize( sIntervals + 1 );
+				vExact.assign( sIntervals, 0 );
+			}
+			catch ( ... ) { return false; }
+			double dScale = 1.0 / sIntervals;
+			for ( size_t I = 0; I <= sIntervals; ++I ) {
+				vTable[I] = Exact( I * dScale );
+			}
+
+			// Check the quarter points of every interval against the exact function.  Intervals that fail at the very bottom of the
+			//	range, where curves such as pure powers below 1 have slopes no table can follow, move the start of the table up; inputs
+			//	there go to the exact function instead.  Intervals that fail above that are marked so that only they use the exact function.
+			size_t sAllowed = sIntervals < SL2_TLUT_MAX_INTERVALS ? (sIntervals / 1024) : (sIntervals / 16);
+			size_t sLowIntervals = 0;
+			size_t sFailed = 0;
+			double dErr = 0.0;
+			for ( size_t I = 0; I < sIntervals; ++I ) {
+				double dIntervalErr = 0.0;
+				for ( size_t T = 1; T < 4; ++T ) {
+					double dFrac = T * 0.25;
+					double dThisErr = std::abs( vTable[I] + (vTable[I+1] - vTable[I]) * dFrac - Exact( (I + dFrac) * dScale ) );
+					// Written so that NaN counts as a failure.
+					if ( !(dThisErr <= _dMaxError) ) {
+						dIntervalErr = -1.0;
+						break;
+					}
+					dIntervalErr = std::max( dIntervalErr, dThisErr );
+				}
+				if ( dIntervalErr < 0.0 ) {
+					if ( I < sAllowed ) {
+						// Everything below this interval is now below the table.
+						sLowIntervals = I + 1;
+						dErr = 0.0;
+					}
+					else {
+						vExact[I] = 1;
+						++sFailed;
+					}
+					continue;
+				}
+				dErr = std::max( dErr, dIntervalErr );
+			}
+
+			// Smaller tables are used only if every interval passed.  The largest table is used unless so many of its intervals failed
+			//	that it would mostly just be calling the exact function anyway.
+			bool bAccept = sLowIntervals < sIntervals && (sFailed == 0 || (sIntervals == SL2_TLUT_MAX_INTERVALS && sFailed <= sIntervals / 2));
+			if ( bAccept ) {
+				m_vTable = std::move( vTable );
+				if ( sFailed ) { m_vExact = std::move( vExact ); }
+				m_sIntervals = sIntervals;
+				m_dLow = sLowIntervals * dScale;
+				m_dError = dErr;
+#ifdef _DEBUG
+				// Accuracy test: Sample() against the exact function between the validated points.  A kink inside an interval (sampled
+				//	ICC curves) can put the worst error slightly off the quarter points, hence the factor of 2.
+				for ( size_t I = sLowIntervals; I < sIntervals; ++I ) {
+					for ( size_t T = 1; T < 8; T += 2 ) {
+						double dIn = (I + T * 0.125) * dScale;
+						assert( std::abs( Sample( dIn ) - Exact( dIn ) ) <= _dMaxError * 2.0 );
+					}
+				}
+#endif	// #ifdef _DEBUG
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Applies the given tables to a range of RGBA64F texels.
+	 *
+	 * \param _pdRgba The RGBA64F texels to convert in-place.
+	 * \param _sTotal The number of texels to which _pdRgba points.
+	 * \param _tlR The table for the R channel.
+	 * \param _tlG The table for the G channel.
+	 * \param _tlB The table for the B channel.
+	 **/
+	void CTransferLut::TransformRgbRange( double * _pdRgba, size_t _sTotal, const CTransferLut &_tlR, const CTransferLut &_tlG, const CTransferLut &_tlB ) {
+#ifdef __AVX2__
+		if ( CUtilities::IsAvx2Supported() && _tlR.Valid() && _tlG.Valid() && _tlB.Valid() &&
+			!_tlR.m_vExact.size() && !_tlG.m_vExact.size() && !_tlB.m_vExact.size() ) {
+			// When all 3 channels use the same table (TransformRgb() with a single table), the lookups are gathered from that table.  The
+			//	alpha lane is forced to index 0 and then discarded.  Separate tables are separate allocations and are read one channel at a time.
+			const double * pdR = _tlR.m_vTable.data();
+			const double * pdG = _tlG.m_vTable.data();
+			const double * pdB = _tlB.m_vTable.data();
+			bool bShared = pdR == pdG && pdR == pdB;
+			__m256d mScale = _mm256_set_pd( 0.0, double( _tlB.m_sIntervals ), double( _tlG.m_sIntervals ), double( _tlR.m_sIntervals ) );
+			__m256d mMaxIdx = _mm256_set_pd( 0.0, double( _tlB.m_sIntervals - 1 ), double( _tlG.m_sIntervals - 1 ), double( _tlR.m_sIntervals - 1 ) );
+			__m256d mLow = _mm256_set_pd( 0.0, _tlB.m_dLow, _tlG.m_dLow, _tlR.m_dLow );
+			__m256d mOne = _mm256_set1_pd( 1.0 );
+			__m256d mZero = _mm256_setzero_pd();
+			while ( _sTotal-- ) {
+				__m256d mTexel = _mm256_loadu_pd( _pdRgba );
+				__m256d mRgb = _mm256_blend_pd( mTexel, mZero, 0x8 );
+				// Ordered compares so that NaN is out of range.
+				__m256d mIn = _mm256_and_pd( _mm256_cmp_pd( mRgb, mLow, _CMP_GE_OQ ), _mm256_cmp_pd( mRgb, mOne, _CMP_LE_OQ ) );
+				if ( _mm256_movemask_pd( mIn ) == 0xF ) {
+					__m256d mPos = _mm256_mul_pd( mRgb, mScale );
+					__m256d mFloor = _mm256_min_pd( _mm256_floor_pd( mPos ), mMaxIdx );
+					__m256d mFrac = _mm256_sub_pd( mPos, mFloor );
+					__m128i mIdx = _mm256_cvttpd_epi32( mFloor );
+					__m256d mA, mB;
+					if ( bShared ) {
+						mA = _mm256_i32gather_pd( pdR, mIdx, sizeof( double ) );
+						mB = _mm256_i32gather_pd( pdR + 1, mIdx, sizeof( double ) );
+					}
+					else {
+						SL2_ALIGN( 16 ) int32_t i32Idx[4];
+						_mm_store_si128( reinterpret_cast<__m128i *>(i32Idx), mIdx );
+						mA = _mm256_set_pd( 0.0, pdB[i32Idx[2]], pdG[i32Idx[1]], pdR[i32Idx[0]] );
+						mB = _mm256_set_pd( 0.0, pdB[i32Idx[2]+1], pdG[i32Idx[1]+1], pdR[i32Idx[0]+1] );
+					}
+					__m256d mRes = _mm256_add_pd( mA, _mm256_mul_pd( _mm256_sub_pd( mB, mA ), mFrac ) );
+					_mm256_storeu_pd( _pdRgba, _mm256_blend_pd( mRes, mTexel, 0x8 ) );
+#ifdef _DEBUG
+					{
+						// Accuracy test: the vectorized path against the scalar table, which Build() tested against the exact function.
+						SL2_ALIGN( 32 ) double dIn[4];
+						_mm256_store_pd( dIn, mTexel );
+						const CTransferLut * ptlTables[3] = { &_tlR, &_tlG, &_tlB };
+						for ( size_t C = 0; C < 3; ++C ) {
+							assert( std::abs( _pdRgba[C] - ptlTables[C]->Sample( dIn[C] ) ) <= 1.0e-12 );
+						}
+					}
+#endif	// #ifdef _DEBUG
+				}
+				else {
+					_pdRgba[0] = _tlR.Sample( _pdRgba[0] );
+					_pdRgba[1] = _tlG.Sample( _pdRgba[1] );
+					_pdRgba[2] = _tlB.Sample( _pdRgba[2] );
+				}
+				_pdRgba += 4;
+			}
+			return;
+		}
+#endif	// #ifdef __AVX2__
+
+		while ( _sTotal-- ) {
+			_pdRgba[0] = _tlR.Sample( _pdRgba[0] );
+			_pdRgba[1] = _tlG.Sample( _pdRgba[1] );
+			_pdRgba[2] = _tlB.Sample( _pdRgba[2] );
+			_pdRgba += 4;
+		}
+	}
+
+}	// namespace sl2
@@ -0,0 +1,274 @@
+/**
+ * Copyright L. Spiro 2024
+ *
+ * Written by: Shawn (L. Spiro) Wilcoxen
+ *
+ * Description: A high-resolution look-up table for transfer functions (gamma curves, ICC curves, etc.)
+ *	Tables are validated against the exact function when they are built and will fall back to the exact
+ *	function for any input outside of the range they cover or inside any interval that failed validation.
+ */
+
+
+#pragma once
+
+#include "../OS/SL2Os.h"
+#include "SL2AlignmentAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+namespace sl2 {
+
+	/**
+	 * Class CTransferLut
+	 * \brief A high-resolution look-up table for transfer functions.
+	 *
+	 * Description: A high-resolution look-up table for transfer functions (gamma curves, ICC curves, etc.)
+	 *	Tables are validated against the exact function when they are built and will fall back to the exact
+	 *	function for any input outside of the range they cover or inside any interval that failed validation.
+	 */
+	class CTransferLut {
+	public :
+		CTransferLut();
+		~CTransferLut();
+
+
+		// == Types.
+		/** A plain transfer function (matches CFormat::PfTransferFunc). */
+		typedef double (SL2_FASTCALL *							PfFunc)( double _dVal );
+
+		/** A transfer function with a parameter (matches CIcc::PfTransferFunc). */
+		typedef double (*										PfParmFunc)( double _dIn, const void * _pvParm );
+
+
+		// == Functions.
+		/**
+		 * Creates a table for a plain transfer function.
+		 *
+		 * \param _pfFunc The function to tabulate.
+		 * \param _dMaxError The maximum absolute error allowed between the table and _pfFunc inside the table's range.
+		 * \return Returns true if a table meeting the error requirement could be created.  If false is returned, Sample() still works but always calls the exact function.
+		 **/
+		bool													CreateLut( PfFunc _pfFunc, double _dMaxError = m_dMaxError );
+
+		/**
+		 * Creates a table for a transfer function that takes a parameter.  _pvParm must remain valid for the lifetime of the table.
+		 *
+		 * \param _pfFunc The function to tabulate.
+		 * \param _pvParm The parameter to pass to _pfFunc.
+		 * \param _dMaxError The maximum absolute error allowed between the table and _pfFunc inside the table's range.
+		 * \return Returns true if a table meeting the error requirement could be created.  If false is returned, Sample() still works but always calls the exact function.
+		 **/
+		bool													CreateLut( PfParmFunc _pfFunc, const void * _pvParm, double _dMaxError = m_dMaxError );
+
+		/**
+		 * Creates a table for std::pow( X, _dPow ).
+		 *
+		 * \param _dPow The power.
+		 * \param _dMaxError The maximum absolute error allowed between the table and std::pow() inside the table's range.
+		 * \return Returns true if a table meeting the error requirement could be created.  If false is returned, Sample() still works but always calls the exact function.
+		 **/
+		bool													CreatePowLut( double _dPow, double _dMaxError = m_dMaxError );
+
+		/**
+		 * Resets the table to nothing.
+		 **/
+		void													Reset();
+
+		/**
+		 * Is the table valid?  If not, Sample() always calls the exact function.
+		 *
+		 * \return Returns true if the table was created and passed validation.
+		 **/
+		inline bool												Valid() const { return m_vTable.size() != 0; }
+
+		/**
+		 * Gets the maximum error measured against the exact function while the table was being built.
+		 *
+		 * \return Returns the measured maximum error.
+		 **/
+		inline double											Error() const { return m_dError; }
+
+		/**
+		 * Gets the number of intervals in the table.
+		 *
+		 * \return Returns the number of intervals in the table.
+		 **/
+		inline size_t											Intervals() const { return m_sIntervals; }
+
+		/**
+		 * Gets the input value below which the exact function is used.  Curves with infinite slopes at 0 (such as pure powers below 1) can't be tabulated there.
+		 *
+		 * \return Returns the low end of the table's range.
+		 **/
+		inline double											Low() const { return m_dLow; }
+
+		/**
+		 * Gets the number of intervals above Low() that failed validation and are evaluated with the exact function.
+		 *
+		 * \return Returns the number of intervals that use the exact function.
+		 **/
+		size_t													ExactIntervals() const;
+
+		/**
+		 * Evaluates the exact function.
+		 *
+		 * \param _dVal The value to convert.
+		 * \return Returns the converted value.
+		 **/
+		inline double											Exact( double _dVal ) const;
+
+		/**
+		 * Evaluates the table, falling back to the exact function outside of the table's range.
+		 *
+		 * \param _dVal The value to convert.
+		 * \return Returns the converted value.
+		 **/
+		inline double											Sample( double _dVal ) const;
+
+		/**
+		 * Applies the table to the RGB channels of an RGBA64F buffer.  Alpha is untouched.
+		 *
+		 * \param _pdRgba The RGBA64F texels to convert in-place.
+		 * \param _sTotal The number of texels to which _pdRgba points.
+		 **/
+		void													TransformRgb( double * _pdRgba, size_t _sTotal ) const { TransformRgb( _pdRgba, _sTotal, (*this), (*this), (*this) ); }
+
+		/**
+		 * Applies a table per channel to the RGB channels of an RGBA64F buffer.  Alpha is untouched.  Large buffers are split across threads.
+		 *
+		 * \param _pdRgba The RGBA64F texels to convert in-place.
+		 * \param _sTotal The number of texels to which _pdRgba points.
+		 * \param _tlR The table for the R channel.
+		 * \param _tlG The table for the G channel.
+		 * \param _tlB The table for the B channel.
+		 **/
+		static void												TransformRgb( double * _pdRgba, size_t _sTotal, const CTransferLut &_tlR, const CTransferLut &_tlG, const CTransferLut &_tlB );
+
+		/**
+		 * Measures the maximum error of Sample() and TransformRgb() against the exact function over every 16-bit input and 8
+		 *	points inside every interval of the table.
+		 *
+		 * \return Returns the maximum absolute error found.  NaN results that don't match the exact function count as infinite error.
+		 **/
+		double													MaxError() const { return MaxError( (*this), (*this), (*this) ); }
+
+		/**
+		 * Measures the maximum error of Sample() and TransformRgb() against the exact functions of the given tables over every
+		 *	16-bit input and 8 points inside every interval of each table.  Each channel is given different inputs so that the
+		 *	per-channel paths of TransformRgb() are checked.
+		 *
+		 * \param _tlR The table for the R channel.
+		 * \param _tlG The table for the G channel.
+		 * \param _tlB The table for the B channel.
+		 * \return Returns the maximum absolute error found.  NaN results that don't match the exact function count as infinite error.
+		 **/
+		static double											MaxError( const CTransferLut &_tlR, const CTransferLut &_tlG, const CTransferLut &_tlB );
+
+		/**
+		 * Gets a shared table for a plain transfer function, creating it on the first request.  Plain transfer functions have no state, so
+		 *	their tables are created only once for the lifetime of the process.  Thread-safe.
+		 *
+		 * \param _pfFunc The function whose table is to be obtained.
+		 * \return Returns the shared table for the given function.  The table may not be Valid(), in which case it evaluates the exact function.
+		 **/
+		static const CTransferLut &								Cached( PfFunc _pfFunc );
+
+		/**
+		 * Gets a shared table for std::pow( X, _dPow ), creating it on the first request.  Thread-safe.
+		 *
+		 * \param _dPow The power.
+		 * \return Returns the shared table for the given power.
+		 **/
+		static const CTransferLut &								CachedPow( double _dPow );
+
+
+		// == Members.
+		/** The default maximum error allowed in a table.  Comfortably below the quantization step of 16-bit formats. */
+		static double											m_dMaxError;
+		/** Buffers with fewer than this many texels are converted with the exact functions rather than building a new table. */
+		static size_t											m_sMinTexels;
+
+
+	protected :
+		// == Members.
+		/** The table. */
+		std::vector<double, CAlignmentAllocator<double, 64>>	m_vTable;
+		/** One flag per interval, set for intervals that failed validation and use the exact function.  Empty if none failed. */
+		std::vector<uint8_t>									m_vExact;
+		/** The number of intervals in the table (the table has m_sIntervals + 1 entries). */
+		size_t													m_sIntervals;
+		/** The input below which the exact function is used. */
+		double													m_dLow;
+		/** The maximum error measured when the table was built. */
+		double													m_dError;
+		/** The plain transfer function. */
+		PfFunc													m_pfFunc;
+		/** The parameterized transfer function. */
+		PfParmFunc												m_pfParmFunc;
+		/** The parameter for m_pfParmFunc. */
+		const void *											m_pvParm;
+		/** The power for power curves. */
+		double													m_dPow;
+
+
+		// == Functions.
+		/**
+		 * Builds and validates the table from the currently set exact function.  The table size is doubled until the error requirement is met.
+		 *	If the largest table still has failing intervals, those intervals alone fall back to the exact function.
+		 *
+		 * \param _dMaxError The maximum error allowed.
+		 * \return Returns true if a table was created.
+		 **/
+		bool													Build( double _dMaxError );
+
+		/**
+		 * Applies the given tables to a range of RGBA64F texels.
+		 *
+		 * \param _pdRgba The RGBA64F texels to convert in-place.
+		 * \param _sTotal The number of texels to which _pdRgba points.
+		 * \param _tlR The table for the R channel.
+		 * \param _tlG The table for the G channel.
+		 * \param _tlB The table for the B channel.
+		 **/
+		static void												TransformRgbRange( double * _pdRgba, size_t _sTotal, const CTransferLut &_tlR, const CTransferLut &_tlG, const CTransferLut &_tlB );
+	};
+
+
+
+	// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+	// DEFINITIONS
+	// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+	// == Functions.
+	/**
+	 * Evaluates the exact function.
+	 *
+	 * \param _dVal The value to convert.
+	 * \return Returns the converted value.
+	 **/
+	inline double CTransferLut::Exact( double _dVal ) const {
+		if ( m_pfFunc ) { return m_pfFunc( _dVal ); }
+		if ( m_pfParmFunc ) { return m_pfParmFunc( _dVal, m_pvParm ); }
+		return std::pow( _dVal, m_dPow );
+	}
+
+	/**
+	 * Evaluates the table, falling back to the exact function outside of the table's range.
+	 *
+	 * \param _dVal The value to convert.
+	 * \return Returns the converted value.
+	 **/
+	inline double CTransferLut::Sample( double _dVal ) const {
+		// Written so that NaN also takes the exact path.
+		if ( !(_dVal >= m_dLow && _dVal <= 1.0) || !Valid() ) { return Exact( _dVal ); }
+		double dPos = _dVal * m_sIntervals;
+		size_t sIdx = std::min( size_t( dPos ), m_sIntervals - 1 );
+		if ( m_vExact.size() && m_vExact[sIdx] ) { return Exact( _dVal ); }
+		double dFrac = dPos - double( sIdx );
+		return m_vTable[sIdx] + (m_vTable[sIdx+1] - m_vTable[sIdx]) * dFrac;
+	}
+
+}	// namespace sl2